@@ -0,0 +1,275 @@
+/**
+ * @file agrupamento.c
+ *
+ * Agrupamento euclidiano por union-find. Para ver a documentação, consulte o header.
+ */
+
+#include "agrupamento.h"
+
+/* Caixa das amostras de uma folha da fotografia */
+typedef struct {
+  float minimo[DIM], maximo[DIM];
+} caixaFolha;
+
+/* Para achar a folha da fotografia de um nó da árvore (ordenado por  no ) */
+typedef struct {
+  noctree* no;
+  long long folha;
+} folhaDoNo;
+
+typedef struct {
+  _Atomic long long* pai;              // Union-find sobre as amostras da fotografia
+  caixaFolha* caixas;                  // Uma por folha
+  unsigned char* uniforme;             // 1 se as amostras da folha já estão todas no mesmo conjunto
+  folhaDoNo* indice;
+  float distancia, distancia2;
+} contextoAgrupamento;
+
+
+/* Union-find sem lock
+ * ------------------- */
+
+/* O pai sempre tem índice menor que o filho: não há ciclos, e a raiz é o menor índice do conjunto */
+static long long acha(_Atomic long long* pai, long long x) {
+  while (1) {
+    long long p = atomic_load_explicit(&pai[x], memory_order_acquire);
+    if (p == x) return x;
+    long long avo = atomic_load_explicit(&pai[p], memory_order_acquire);
+    if (avo != p) atomic_compare_exchange_weak_explicit(&pai[x], &p, avo, memory_order_release, memory_order_relaxed);
+    x = avo;
+  }
+}
+
+static void une(_Atomic long long* pai, long long a, long long b) {
+  while (1) {
+    a = acha(pai, a);
+    b = acha(pai, b);
+    if (a == b) return;
+    if (a < b) { long long t = a; a = b; b = t; }
+
+    /* Só dá certo se  a  ainda é raiz; c.c. outra thread a uniu antes, e tenta de novo */
+    long long esperado = a;
+    if (atomic_compare_exchange_strong_explicit(&pai[a], &esperado, b, memory_order_acq_rel, memory_order_acquire)) return;
+  }
+}
+
+
+/* Fase 1: dentro das folhas
+ * ------------------------- */
+
+static void uneNaFolha(fotografiaOctree* f, folhaFotografada* folha, vizinhanca* v, void* arg) {
+  contextoAgrupamento* c = (contextoAgrupamento*) arg;
+  long long indiceFolha = folha - f->folhas;
+  amostra* pontos = f->amostras + folha->inicio;
+
+  caixaDaFolha(f, folha, 0, v);
+  memcpy(c->caixas[indiceFolha].minimo, v->minimo, sizeof(v->minimo));
+  memcpy(c->caixas[indiceFolha].maximo, v->maximo, sizeof(v->maximo));
+
+  for (int i = 0; i < folha->qt; i++) {
+    for (int j = i + 1; j < folha->qt; j++) {
+      if (dist2(&pontos[i], &pontos[j]) <= c->distancia2) une(c->pai, folha->inicio + i, folha->inicio + j);
+    }
+  }
+
+  /* Só esta tarefa mexe nas amostras da folha nesta fase */
+  long long raiz = acha(c->pai, folha->inicio);
+  c->uniforme[indiceFolha] = 1;
+  for (int i = 1; i < folha->qt && c->uniforme[indiceFolha]; i++) {
+    if (acha(c->pai, folha->inicio + i) != raiz) c->uniforme[indiceFolha] = 0;
+  }
+}
+
+
+/* Fase 2: entre folhas vizinhas
+ * ----------------------------- */
+
+static int comparaFolhaDoNo(const void* a, const void* b) {
+  uintptr_t x = (uintptr_t) ((const folhaDoNo*) a)->no, y = (uintptr_t) ((const folhaDoNo*) b)->no;
+  return (x > y) - (x < y);
+}
+
+static float distancia2Caixas(const caixaFolha* a, const caixaFolha* b) {
+  float soma = 0;
+  for (int d = 0; d < DIM; d++) {
+    float vao = fmaxf(0, fmaxf(b->minimo[d] - a->maximo[d], a->minimo[d] - b->maximo[d]));
+    soma += vao * vao;
+  }
+  return soma;
+}
+
+/* Une as amostras próximas das folhas  a  e  b . Numa folha uniforme, basta um par por amostra da outra. */
+static void uneFolhas(fotografiaOctree* f, contextoAgrupamento* c, long long a, long long b) {
+  folhaFotografada* fa = &f->folhas[a];
+  folhaFotografada* fb = &f->folhas[b];
+  int uniformeA = c->uniforme[a], uniformeB = c->uniforme[b];
+
+  if (uniformeA && uniformeB && acha(c->pai, fa->inicio) == acha(c->pai, fb->inicio)) return;
+
+  const caixaFolha* caixaB = &c->caixas[b];
+  for (int i = 0; i < fa->qt; i++) {
+    amostra* p = &f->amostras[fa->inicio + i];
+    if (p->x < caixaB->minimo[0] - c->distancia || p->x > caixaB->maximo[0] + c->distancia ||
+        p->y < caixaB->minimo[1] - c->distancia || p->y > caixaB->maximo[1] + c->distancia ||
+        p->z < caixaB->minimo[2] - c->distancia || p->z > caixaB->maximo[2] + c->distancia) continue;
+
+    for (int j = 0; j < fb->qt; j++) {
+      if (dist2(p, &f->amostras[fb->inicio + j]) > c->distancia2) continue;
+      une(c->pai, fa->inicio + i, fb->inicio + j);
+      if (uniformeA && uniformeB) return;
+      if (uniformeB) break;
+    }
+  }
+}
+
+static int noIntersectaCaixa(noctree* no, const float* minimo, const float* maximo) {
+  float centro[DIM] = {no->centro->x, no->centro->y, no->centro->z};
+  for (int d = 0; d < DIM; d++) {
+    if (centro[d] + no->tamanho[d] / 2 < minimo[d] || centro[d] - no->tamanho[d] / 2 > maximo[d]) return 0;
+  }
+  return 1;
+}
+
+/* Desce até as folhas perto da caixa alargada da folha  a  (a raiz é sempre visitada, como em  coletaVizinhanca ) */
+static void visitaVizinhas(fotografiaOctree* f, contextoAgrupamento* c, noctree* no, long long a,
+                           const float* minimo, const float* maximo) {
+  int travou = travaLeitura(no);
+  if (no != f->raiz && !noIntersectaCaixa(no, minimo, maximo)) {
+    destravaLeitura(no, travou);
+    return;
+  }
+
+  if (no->subdividido) {
+    destravaLeitura(no, travou);
+    for (int i = 0; i < QT_FILHOS_NOCTREE; i++) visitaVizinhas(f, c, no->filhos[i], a, minimo, maximo);
+    return;
+  }
+  int vazia = (no->qtPontos == 0);
+  destravaLeitura(no, travou);
+  if (vazia) return;
+
+  folhaDoNo chave = {no, 0};
+  folhaDoNo* achada = (folhaDoNo*) bsearch(&chave, c->indice, f->qtFolhas, sizeof(folhaDoNo), comparaFolhaDoNo);
+  if (achada == NULL || achada->folha <= a) return; // Cada par de folhas uma vez só
+  if (distancia2Caixas(&c->caixas[a], &c->caixas[achada->folha]) > c->distancia2) return;
+
+  uneFolhas(f, c, a, achada->folha);
+}
+
+static void uneComVizinhas(fotografiaOctree* f, folhaFotografada* folha, vizinhanca* v, void* arg) {
+  contextoAgrupamento* c = (contextoAgrupamento*) arg;
+  long long a = folha - f->folhas;
+  (void) v;
+
+  float minimo[DIM], maximo[DIM];
+  for (int d = 0; d < DIM; d++) {
+    minimo[d] = c->caixas[a].minimo[d] - c->distancia;
+    maximo[d] = c->caixas[a].maximo[d] + c->distancia;
+  }
+  visitaVizinhas(f, c, f->raiz, a, minimo, maximo);
+}
+
+
+/* Resultado
+ * --------- */
+
+/* Numera os grupos na ordem em que aparecem e monta as caixas */
+static void numeraGrupos(contextoAgrupamento* c, int minAmostras, agrupamentoOctree* saida) {
+  long long N = saida->qt;
+  long long* tamanho = (long long*) calloc(N > 0 ? N : 1, sizeof(long long));
+  int* grupoDaRaiz = (int*) malloc(sizeof(int) * (N > 0 ? N : 1));
+  CHECK_MALLOC(tamanho);
+  CHECK_MALLOC(grupoDaRaiz);
+
+  /* Como o pai tem índice menor, o pai de  i  já aponta para a raiz quando chega a vez de  i */
+  for (long long i = 0; i < N; i++) {
+    long long raiz = atomic_load_explicit(&c->pai[atomic_load_explicit(&c->pai[i], memory_order_relaxed)], memory_order_relaxed);
+    atomic_store_explicit(&c->pai[i], raiz, memory_order_relaxed);
+    tamanho[raiz]++;
+  }
+
+  int capCaixas = 0;
+  for (long long i = 0; i < N; i++) {
+    long long raiz = atomic_load_explicit(&c->pai[i], memory_order_relaxed);
+    if (raiz == i) {
+      grupoDaRaiz[i] = AGRUPAMENTO_RUIDO;
+      if (tamanho[i] >= minAmostras) {
+        if (saida->qtGrupos == capCaixas) {
+          capCaixas = (capCaixas > 0) ? capCaixas * 2 : 64;
+          saida->caixas = (caixaGrupo*) realloc(saida->caixas, sizeof(caixaGrupo) * capCaixas);
+          CHECK_MALLOC(saida->caixas);
+        }
+        amostra* p = &saida->amostras[i];
+        saida->caixas[saida->qtGrupos] = (caixaGrupo){{p->x, p->y, p->z}, {p->x, p->y, p->z}, 0};
+        grupoDaRaiz[i] = saida->qtGrupos++;
+      }
+    }
+
+    int g = grupoDaRaiz[raiz];
+    saida->grupos[i] = g;
+    if (g == AGRUPAMENTO_RUIDO) {
+      saida->qtRuido++;
+      continue;
+    }
+    caixaGrupo* caixa = &saida->caixas[g];
+    float p[DIM] = {saida->amostras[i].x, saida->amostras[i].y, saida->amostras[i].z};
+    for (int d = 0; d < DIM; d++) {
+      if (p[d] < caixa->minimo[d]) caixa->minimo[d] = p[d];
+      if (p[d] > caixa->maximo[d]) caixa->maximo[d] = p[d];
+    }
+    caixa->qt++;
+  }
+
+  free(tamanho);
+  free(grupoDaRaiz);
+}
+
+
+/* Interface
+ * --------- */
+
+int agrupaEuclidiano(noctree* no, float distancia, int minAmostras, agrupamentoOctree* saida) {
+  memset(saida, 0, sizeof(agrupamentoOctree));
+  if (!(distancia > 0)) return 0;
+
+  fotografiaOctree f;
+  fotografaOctree(no, &f);
+  saida->amostras = f.amostras;
+  saida->qt = f.qt;
+  saida->grupos = (int*) malloc(sizeof(int) * (f.qt > 0 ? f.qt : 1));
+  CHECK_MALLOC(saida->grupos);
+
+  contextoAgrupamento c;
+  c.distancia = distancia;
+  c.distancia2 = distancia * distancia;
+  c.pai = (_Atomic long long*) malloc(sizeof(_Atomic long long) * (f.qt > 0 ? f.qt : 1));
+  c.caixas = (caixaFolha*) malloc(sizeof(caixaFolha) * (f.qtFolhas > 0 ? f.qtFolhas : 1));
+  c.uniforme = (unsigned char*) malloc(f.qtFolhas > 0 ? f.qtFolhas : 1);
+  c.indice = (folhaDoNo*) malloc(sizeof(folhaDoNo) * (f.qtFolhas > 0 ? f.qtFolhas : 1));
+  CHECK_MALLOC(c.pai);
+  CHECK_MALLOC(c.caixas);
+  CHECK_MALLOC(c.uniforme);
+  CHECK_MALLOC(c.indice);
+
+  for (long long i = 0; i < f.qt; i++) atomic_init(&c.pai[i], i);
+  for (long long i = 0; i < f.qtFolhas; i++) c.indice[i] = (folhaDoNo){f.folhas[i].no, i};
+  qsort(c.indice, f.qtFolhas, sizeof(folhaDoNo), comparaFolhaDoNo);
+
+  paraCadaFolha(&f, uneNaFolha, &c);
+  paraCadaFolha(&f, uneComVizinhas, &c);
+  numeraGrupos(&c, minAmostras, saida);
+
+  free(c.pai);
+  free(c.caixas);
+  free(c.uniforme);
+  free(c.indice);
+  free(f.folhas); // As amostras ficam com a saída
+  return 1;
+}
+
+void liberaAgrupamento(agrupamentoOctree* a) {
+  free(a->amostras);
+  free(a->grupos);
+  free(a->caixas);
+  memset(a, 0, sizeof(agrupamentoOctree));
+}
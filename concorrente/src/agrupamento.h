@@ -0,0 +1,68 @@
+/* Agrupamento euclidiano (componentes conexas).
+ *
+ * Duas amostras ficam no mesmo grupo se há uma cadeia de amostras entre elas com
+ * passos de no máximo  distancia  (a segmentação de obstáculos de uma varredura).
+ *
+ * Em vez de crescer regiões com uma busca por amostra, é um union-find sobre as
+ * amostras da fotografia da árvore (ver  vizinhanca.h ), em duas fases paralelas:
+ *    1. cada folha une os pares próximos das suas amostras e guarda a caixa delas;
+ *    2. cada folha desce a árvore até as folhas cuja caixa está a menos de  distancia
+ *       da sua e une os pares entre as duas. Se as duas já são, cada uma, um grupo só
+ *       e esse grupo é o mesmo, o par de folhas é pulado.
+ * O union-find é sem lock: as uniões são CAS no pai da raiz (a maior raiz vai para
+ * baixo da menor), e a busca encurta o caminho pela metade.
+ *
+ * Exemplo:
+ *    agrupamentoOctree a;
+ *    agrupaEuclidiano(raiz, 0.3f, 10, &a);        // Grupos com menos de 10 amostras viram ruído
+ *    ... a.amostras[i] está no grupo a.grupos[i], de caixa a.caixas[a.grupos[i]] ...
+ *    liberaAgrupamento(&a);
+*/
+
+#ifndef AGRUPAMENTO_H
+#define AGRUPAMENTO_H
+
+#include "vizinhanca.h"
+
+/* Grupo das amostras descartadas por  minAmostras */
+#define AGRUPAMENTO_RUIDO         -1
+
+/**
+ * Caixa das amostras de um grupo.
+ */
+typedef struct _CaixaGrupo {
+  float minimo[DIM], maximo[DIM];
+  long long qt;                        // Amostras no grupo
+} caixaGrupo;
+
+/**
+ * Grupo de cada amostra, alinhado com as amostras.
+ */
+typedef struct _AgrupamentoOctree {
+  amostra* amostras;                   // Fotografia das amostras da árvore
+  int* grupos;                         // De 0 a qtGrupos - 1, na ordem em que aparecem; AGRUPAMENTO_RUIDO se o grupo é pequeno
+  caixaGrupo* caixas;                  // Uma por grupo
+  int qtGrupos;
+  long long qt;
+  long long qtRuido;                   // Amostras em AGRUPAMENTO_RUIDO
+} agrupamentoOctree;
+
+/**
+ * Agrupa as amostras da árvore.
+ *
+ * @param no é a raiz da árvore
+ * @param distancia é o maior passo entre duas amostras do mesmo grupo
+ * @param minAmostras é o tamanho mínimo de um grupo; as amostras dos menores vão para AGRUPAMENTO_RUIDO
+ * @param saida recebe o resultado (libere com  liberaAgrupamento )
+ *
+ * @return 1, se ok
+ *         0, se  distancia  não é positiva (saida  fica vazia)
+ */
+int agrupaEuclidiano(noctree* no, float distancia, int minAmostras, agrupamentoOctree* saida);
+
+/**
+ * Libera os vetores do resultado.
+ */
+void liberaAgrupamento(agrupamentoOctree* a);
+
+#endif
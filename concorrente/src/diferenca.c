@@ -0,0 +1,286 @@
+/**
+ * @file diferenca.c
+ *
+ * Diferença entre duas árvores. Para ver a documentação, consulte o header.
+ */
+
+#include "diferenca.h"
+
+/* Um lado da comparação numa célula: um nó da árvore ou, abaixo de uma folha, as amostras
+ * da folha que caem na célula (vetor próprio de quem o recebe) */
+typedef struct {
+  noctree* no;
+  amostra* pontos;
+  int qt;
+} ladoCelula;
+
+typedef struct {
+  regiaoAlterada* regioes;
+  long long qt, capacidade;
+} vetorRegioes;
+
+/* Uma tarefa: a célula, os dois lados e o vetor próprio de saída */
+typedef struct {
+  ladoCelula antes, depois;
+  float centro[DIM], tamanho[DIM];
+  int nivel, alvo;
+  vetorRegioes saida;
+} argDiferenca;
+
+/* Estado do percurso. Na parte de cima (nivelTarefas >= 0), as células desse nível viram
+ * tarefas em vez de serem descidas */
+typedef struct {
+  int alvo;                            // Nível das células comparadas
+  int nivelTarefas;                    // -1 dentro das tarefas
+  vetorRegioes* saida;
+  argDiferenca* fronteira;
+  int qtFronteira, capFronteira;
+} percursoDiferenca;
+
+
+/* Resumo de um lado
+ * ----------------- */
+
+/* Hash de uma amostra pelos bits das coordenadas; somado, não depende da ordem */
+static uint64_t hashAmostra(amostra p) {
+  uint32_t b[DIM];
+  memcpy(b, &p, sizeof(b));
+  return mistura(((uint64_t) b[0] << 32 | b[1]) ^ mistura(b[2]));
+}
+
+static long long contaLado(ladoCelula* l) {
+  if (l->no == NULL) return l->qt;
+
+  noctree* no = l->no;
+  int travou = travaLeitura(no);
+  long long qt = no->qtPontos;
+  int subdividido = no->subdividido;
+  destravaLeitura(no, travou);
+
+  if (subdividido) {
+    for (int i = 0; i < QT_FILHOS_NOCTREE; i++) {
+      ladoCelula filho = {no->filhos[i], NULL, 0};
+      qt += contaLado(&filho);
+    }
+  }
+  return qt;
+}
+
+static uint64_t hashLado(ladoCelula* l) {
+  uint64_t h = 0;
+  if (l->no == NULL) {
+    for (int i = 0; i < l->qt; i++) h += hashAmostra(l->pontos[i]);
+    return h;
+  }
+
+  noctree* no = l->no;
+  int travou = travaLeitura(no);
+  if (no->subdividido) {
+    destravaLeitura(no, travou);
+    for (int i = 0; i < QT_FILHOS_NOCTREE; i++) {
+      ladoCelula filho = {no->filhos[i], NULL, 0};
+      h += hashLado(&filho);
+    }
+    return h;
+  }
+  for (int i = 0; i < no->qtPontos; i++) h += hashAmostra(leAmostra(no, i));
+  destravaLeitura(no, travou);
+  return h;
+}
+
+/* Sem amostras nenhuma, olhando só o nó */
+static int ladoVazio(ladoCelula* l) {
+  if (l->no == NULL) return l->qt == 0;
+
+  int travou = travaLeitura(l->no);
+  int vazio = !l->no->subdividido && l->no->qtPontos == 0;
+  destravaLeitura(l->no, travou);
+  return vazio;
+}
+
+
+/* Percurso
+ * -------- */
+
+/* Reparte as amostras entre os octantes com as mesmas comparações de  realocaAmostra  */
+static void reparte(amostra* pontos, int qt, float* centro, ladoCelula* filhos) {
+  int qtOctante[QT_FILHOS_NOCTREE] = {0};
+  unsigned char* octante = (unsigned char*) malloc(qt > 0 ? qt : 1);
+  CHECK_MALLOC(octante);
+  for (int i = 0; i < qt; i++) {
+    int o = 0;
+    if (pontos[i].x >= centro[0]) o += 1;
+    if (pontos[i].y >= centro[1]) o += 2;
+    if (pontos[i].z >= centro[2]) o += 4;
+    octante[i] = (unsigned char) o;
+    qtOctante[o]++;
+  }
+
+  for (int k = 0; k < QT_FILHOS_NOCTREE; k++) {
+    filhos[k] = (ladoCelula){NULL, NULL, 0};
+    if (qtOctante[k] > 0) {
+      filhos[k].pontos = (amostra*) malloc(sizeof(amostra) * qtOctante[k]);
+      CHECK_MALLOC(filhos[k].pontos);
+    }
+  }
+  for (int i = 0; i < qt; i++) {
+    ladoCelula* f = &filhos[octante[i]];
+    f->pontos[f->qt++] = pontos[i];
+  }
+  free(octante);
+}
+
+/* Os lados das 8 células filhas: os filhos do nó ou as amostras repartidas */
+static void expande(ladoCelula* l, float* centro, ladoCelula* filhos) {
+  if (l->no == NULL) {
+    reparte(l->pontos, l->qt, centro, filhos);
+    return;
+  }
+
+  noctree* no = l->no;
+  int travou = travaLeitura(no);
+  if (no->subdividido) {
+    destravaLeitura(no, travou);
+    for (int k = 0; k < QT_FILHOS_NOCTREE; k++) filhos[k] = (ladoCelula){no->filhos[k], NULL, 0};
+    return;
+  }
+
+  int qt = no->qtPontos;
+  amostra* pontos = (amostra*) malloc(sizeof(amostra) * (qt > 0 ? qt : 1));
+  CHECK_MALLOC(pontos);
+  for (int i = 0; i < qt; i++) pontos[i] = leAmostra(no, i);
+  destravaLeitura(no, travou);
+
+  reparte(pontos, qt, centro, filhos);
+  free(pontos);
+}
+
+static void adicionaRegiao(vetorRegioes* v, float* centro, float* tamanho, long long qtAntes, long long qtDepois) {
+  if (v->qt == v->capacidade) {
+    v->capacidade = v->capacidade > 0 ? 2 * v->capacidade : 64;
+    v->regioes = (regiaoAlterada*) realloc(v->regioes, sizeof(regiaoAlterada) * v->capacidade);
+    CHECK_MALLOC(v->regioes);
+  }
+  regiaoAlterada* r = &v->regioes[v->qt++];
+  for (int d = 0; d < DIM; d++) {
+    r->minimo[d] = centro[d] - tamanho[d] / 2;
+    r->maximo[d] = centro[d] + tamanho[d] / 2;
+  }
+  r->qtAntes = qtAntes;
+  r->qtDepois = qtDepois;
+}
+
+/* Compara os dois lados numa célula; os vetores de amostras dos lados passam a ser desta chamada */
+static void comparaCelula(percursoDiferenca* p, ladoCelula a, ladoCelula b, float* centro, float* tamanho, int nivel) {
+  /* Parte de cima: a célula vira uma tarefa, com os seus vetores */
+  if (nivel == p->nivelTarefas) {
+    if (p->qtFronteira == p->capFronteira) {
+      p->capFronteira = p->capFronteira > 0 ? 2 * p->capFronteira : 64;
+      p->fronteira = (argDiferenca*) realloc(p->fronteira, sizeof(argDiferenca) * p->capFronteira);
+      CHECK_MALLOC(p->fronteira);
+    }
+    argDiferenca* arg = &p->fronteira[p->qtFronteira++];
+    *arg = (argDiferenca){a, b, {0}, {0}, nivel, p->alvo, {NULL, 0, 0}};
+    memcpy(arg->centro, centro, sizeof(arg->centro));
+    memcpy(arg->tamanho, tamanho, sizeof(arg->tamanho));
+    return;
+  }
+
+  /* Célula da resolução: as contagens e, se batem, os hashes */
+  if (nivel == p->alvo) {
+    long long qtA = contaLado(&a), qtB = contaLado(&b);
+    if (qtA != qtB || (qtA > 0 && hashLado(&a) != hashLado(&b))) {
+      adicionaRegiao(p->saida, centro, tamanho, qtA, qtB);
+    }
+    free(a.pontos);
+    free(b.pontos);
+    return;
+  }
+
+  /* Desce junto nos dois lados */
+  ladoCelula filhosA[QT_FILHOS_NOCTREE], filhosB[QT_FILHOS_NOCTREE];
+  expande(&a, centro, filhosA);
+  expande(&b, centro, filhosB);
+  free(a.pontos);
+  free(b.pontos);
+
+  float novoTamanho[DIM];
+  for (int d = 0; d < DIM; d++) novoTamanho[d] = tamanho[d] / 2.0f;
+
+  for (int k = 0; k < QT_FILHOS_NOCTREE; k++) {
+    if (ladoVazio(&filhosA[k]) && ladoVazio(&filhosB[k])) {
+      free(filhosA[k].pontos);
+      free(filhosB[k].pontos);
+      continue;
+    }
+
+    float novoCentro[DIM];
+    centroDoOctante(centro, novoTamanho, k, novoCentro); // As células coincidem com os nós
+
+    comparaCelula(p, filhosA[k], filhosB[k], novoCentro, novoTamanho, nivel + 1);
+  }
+}
+
+static void tarefaDiferenca(void* arg) {
+  argDiferenca* t = (argDiferenca*) arg;
+  percursoDiferenca local = {t->alvo, -1, &t->saida, NULL, 0, 0};
+  comparaCelula(&local, t->antes, t->depois, t->centro, t->tamanho, t->nivel);
+}
+
+
+/* Interface
+ * --------- */
+
+int diferencaOctrees(noctree* antes, noctree* depois, float resolucao, diferencaOctree* saida) {
+  *saida = (diferencaOctree){NULL, 0, 0, 0, {0, 0, 0}};
+  if (!(resolucao > 0)) return 0;
+  if (antes->centro->x != depois->centro->x || antes->centro->y != depois->centro->y ||
+      antes->centro->z != depois->centro->z) return 0;
+  for (int d = 0; d < DIM; d++) {
+    if (antes->tamanho[d] != depois->tamanho[d]) return 0;
+  }
+
+  int alvo = nivelDoVoxel(antes, resolucao, saida->aresta);
+  float centro[DIM] = {antes->centro->x, antes->centro->y, antes->centro->z};
+  float tamanho[DIM];
+  memcpy(tamanho, antes->tamanho, sizeof(tamanho));
+
+  /* Desce a parte de cima juntando as células das tarefas */
+  percursoDiferenca p = {alvo, alvo < DIFERENCA_NIVEIS_TAREFAS ? alvo : DIFERENCA_NIVEIS_TAREFAS, NULL, NULL, 0, 0};
+  comparaCelula(&p, (ladoCelula){antes, NULL, 0}, (ladoCelula){depois, NULL, 0}, centro, tamanho, 0);
+
+  /* Uma tarefa por célula, cada uma no seu vetor */
+  poolTarefas* pool = poolPadrao();
+  grupoTarefas g;
+  iniciaGrupo(&g);
+  for (int i = 0; i < p.qtFronteira; i++) {
+    submeteTarefa(pool, &g, tarefaDiferenca, &p.fronteira[i]);
+  }
+  esperaGrupo(pool, &g);
+
+  /* Concatena os vetores das tarefas */
+  for (int i = 0; i < p.qtFronteira; i++) saida->qt += p.fronteira[i].saida.qt;
+  saida->regioes = (regiaoAlterada*) malloc(sizeof(regiaoAlterada) * (saida->qt > 0 ? saida->qt : 1));
+  CHECK_MALLOC(saida->regioes);
+
+  long long pos = 0;
+  for (int i = 0; i < p.qtFronteira; i++) {
+    vetorRegioes* v = &p.fronteira[i].saida;
+    if (v->qt > 0) memcpy(saida->regioes + pos, v->regioes, sizeof(regiaoAlterada) * v->qt);
+    pos += v->qt;
+    free(v->regioes);
+  }
+  for (long long i = 0; i < saida->qt; i++) {
+    if (saida->regioes[i].qtAntes == 0) saida->qtAdicionadas++;
+    if (saida->regioes[i].qtDepois == 0) saida->qtRemovidas++;
+  }
+
+  free(p.fronteira);
+  return 1;
+}
+
+void liberaDiferenca(diferencaOctree* d) {
+  free(d->regioes);
+  d->regioes = NULL;
+  d->qt = d->qtAdicionadas = d->qtRemovidas = 0;
+}
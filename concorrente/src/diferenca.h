@@ -0,0 +1,68 @@
+/* Diferença entre duas varreduras (detecção de mudanças).
+ *
+ * Compara duas árvores com o mesmo cubo na raiz e diz quais regiões (células de uma
+ * resolução escolhida) ganharam ou perderam amostras. As duas árvores são descidas
+ * juntas, célula a célula: onde uma delas já é folha, as suas amostras são repartidas
+ * entre os octantes como a subdivisão faria. Em cada célula da resolução, as duas
+ * subárvores são resumidas pela contagem e, se as contagens batem, por um hash das
+ * amostras que não depende da ordem; as iguais são descartadas sem comparar amostra
+ * com amostra, e as contagens são lidas dos nós, sem tocar nas amostras.
+ *
+ * As subárvores dos primeiros DIFERENCA_NIVEIS_TAREFAS níveis viram tarefas do
+ * poolPadrao() , cada uma com o seu vetor de regiões.
+ *
+ * Exemplo:
+ *    diferencaOctree d;
+ *    diferencaOctrees(anterior, atual, 0.5f, &d);
+ *    for (long long i = 0; i < d.qt; i++)
+ *      if (d.regioes[i].qtAntes == 0) ... objeto novo em d.regioes[i].minimo/maximo ...
+ *    liberaDiferenca(&d);
+*/
+
+#ifndef DIFERENCA_H
+#define DIFERENCA_H
+
+#include "paralelo.h"
+#include "voxel.h"
+
+/* Níveis cujas células viram tarefas (até 8^2 = 64) */
+#define DIFERENCA_NIVEIS_TAREFAS  2
+
+/**
+ * Uma célula que mudou.
+ */
+typedef struct _RegiaoAlterada {
+  float minimo[DIM], maximo[DIM];      // A célula
+  long long qtAntes, qtDepois;         // Amostras na célula em cada árvore (0 antes: região nova; 0 depois: região esvaziada)
+} regiaoAlterada;
+
+/**
+ * As regiões que mudaram.
+ */
+typedef struct _DiferencaOctree {
+  regiaoAlterada* regioes;             // Na ordem dos octantes
+  long long qt;
+  long long qtAdicionadas;             // Regiões com  qtAntes == 0
+  long long qtRemovidas;               // Regiões com  qtDepois == 0
+  float aresta[DIM];                   // Aresta efetiva das células (ver  nivelDoVoxel )
+} diferencaOctree;
+
+/**
+ * Compara duas árvores. Nenhuma das duas pode receber inserções enquanto isso.
+ *
+ * @param antes é a raiz da árvore anterior
+ * @param depois é a raiz da árvore atual (mesmo centro e mesmo tamanho de  antes )
+ * @param resolucao é a aresta das células comparadas (arredondada como em  nivelDoVoxel )
+ * @param saida recebe as regiões (libere com  liberaDiferenca )
+ *
+ * @return 1, se ok
+ *         0, se os cubos das raízes diferem ou  resolucao  não é positiva (saida  fica vazia)
+ */
+int diferencaOctrees(noctree* antes, noctree* depois, float resolucao, diferencaOctree* saida);
+
+/**
+ * Libera o vetor de regiões.
+ */
+void liberaDiferenca(diferencaOctree* d);
+
+#endif
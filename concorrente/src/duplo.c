@@ -0,0 +1,428 @@
+/**
+ * @file duplo.c
+ *
+ * Percurso duplo entre duas árvores. Para ver a documentação, consulte o header.
+ */
+
+#include "duplo.h"
+
+/* Nó da árvore de caixas: as amostras da subárvore são contíguas na fotografia */
+typedef struct {
+  float minimo[DIM], maximo[DIM];      // Caixa das amostras da subárvore
+  long long inicio, qt;
+  int filhos[QT_FILHOS_NOCTREE];       // Índices em  nos  (só os filhos com amostras)
+  int qtFilhos;                        // 0 na folha
+} noCaixa;
+
+/* Fotografia de uma árvore com as caixas das subárvores. A raiz é  nos[0]  (se há amostras). */
+typedef struct {
+  amostra* amostras;
+  long long qt, capAmostras;
+  noCaixa* nos;
+  int qtNos, capNos;
+} arvoreDeCaixas;
+
+typedef struct {
+  arvoreDeCaixas* a;
+  arvoreDeCaixas* b;
+  float raio2;
+  float* limites2;                     // Vizinhos: a maior distância² atual das amostras de cada nó de A
+  float* melhores2;                    // Vizinhos: distância² à mais próxima em B de cada amostra de A
+  long long* vizinhos;
+} contextoDuplo;
+
+/* Uma tarefa: uma subárvore de A contra B inteira */
+typedef struct {
+  contextoDuplo* c;
+  int noA;
+  parAmostras* pares;                  // Só nos pares
+  long long qt, capacidade;
+} tarefaDupla;
+
+
+/* Árvore de caixas
+ * ---------------- */
+
+static void aumentaCaixa(noCaixa* n, const float* minimo, const float* maximo) {
+  for (int d = 0; d < DIM; d++) {
+    if (minimo[d] < n->minimo[d]) n->minimo[d] = minimo[d];
+    if (maximo[d] > n->maximo[d]) n->maximo[d] = maximo[d];
+  }
+}
+
+/* Devolve o índice do nó, ou -1 se a subárvore não tem amostras (e nada foi acrescentado) */
+static int montaNo(noctree* no, arvoreDeCaixas* c) {
+  if (c->qtNos == c->capNos) {
+    c->capNos = (c->capNos > 0) ? c->capNos * 2 : 256;
+    c->nos = (noCaixa*) realloc(c->nos, sizeof(noCaixa) * c->capNos);
+    CHECK_MALLOC(c->nos);
+  }
+  int k = c->qtNos++;
+  noCaixa n = {{INFINITY, INFINITY, INFINITY}, {-INFINITY, -INFINITY, -INFINITY}, c->qt, 0, {0}, 0};
+
+  int travou = travaLeitura(no);
+  if (no->subdividido) {
+    destravaLeitura(no, travou);
+    for (int i = 0; i < QT_FILHOS_NOCTREE; i++) {
+      int f = montaNo(no->filhos[i], c);
+      if (f < 0) continue;
+      n.filhos[n.qtFilhos++] = f;
+      aumentaCaixa(&n, c->nos[f].minimo, c->nos[f].maximo);
+    }
+  } else {
+    while (c->qt + no->qtPontos > c->capAmostras) {
+      c->capAmostras = (c->capAmostras > 0) ? c->capAmostras * 2 : 1024;
+      c->amostras = (amostra*) realloc(c->amostras, sizeof(amostra) * c->capAmostras);
+      CHECK_MALLOC(c->amostras);
+    }
+    for (int i = 0; i < no->qtPontos; i++) {
+      amostra p = leAmostra(no, i);
+      float v[DIM] = {p.x, p.y, p.z};
+      aumentaCaixa(&n, v, v);
+      c->amostras[c->qt++] = p;
+    }
+    destravaLeitura(no, travou);
+  }
+
+  n.qt = c->qt - n.inicio;
+  if (n.qt == 0) { // Os filhos vazios já se desfizeram, então este é o último nó
+    c->qtNos--;
+    return -1;
+  }
+  c->nos[k] = n;
+  return k;
+}
+
+static void montaArvoreDeCaixas(noctree* raiz, arvoreDeCaixas* c) {
+  memset(c, 0, sizeof(arvoreDeCaixas));
+  montaNo(raiz, c);
+}
+
+static float distancia2Caixas(const noCaixa* a, const noCaixa* b) {
+  float soma = 0;
+  for (int d = 0; d < DIM; d++) {
+    float vao = fmaxf(0, fmaxf(b->minimo[d] - a->maximo[d], a->minimo[d] - b->maximo[d]));
+    soma += vao * vao;
+  }
+  return soma;
+}
+
+/* Maior distância² entre um ponto de  a  e um de  b */
+static float distancia2MaximaCaixas(const noCaixa* a, const noCaixa* b) {
+  float soma = 0;
+  for (int d = 0; d < DIM; d++) {
+    float vao = fmaxf(a->maximo[d] - b->minimo[d], b->maximo[d] - a->minimo[d]);
+    soma += vao * vao;
+  }
+  return soma;
+}
+
+static float distancia2AmostraCaixa(const amostra* p, const noCaixa* n) {
+  float v[DIM] = {p->x, p->y, p->z}, soma = 0;
+  for (int d = 0; d < DIM; d++) {
+    float vao = fmaxf(0, fmaxf(n->minimo[d] - v[d], v[d] - n->maximo[d]));
+    soma += vao * vao;
+  }
+  return soma;
+}
+
+static float diagonal2(const noCaixa* n) {
+  float soma = 0;
+  for (int d = 0; d < DIM; d++) soma += (n->maximo[d] - n->minimo[d]) * (n->maximo[d] - n->minimo[d]);
+  return soma;
+}
+
+/* Desce o lado cujo nó é maior (o outro, se um deles é folha) */
+static int divideA(const noCaixa* a, const noCaixa* b) {
+  if (a->qtFilhos == 0) return 0;
+  if (b->qtFilhos == 0) return 1;
+  return diagonal2(a) >= diagonal2(b);
+}
+
+/* Divide A em subárvores, uma por tarefa, e as executa */
+static void executaTarefas(contextoDuplo* c, void (*rotina)(void*), tarefaDupla** saida, int* qtSaida) {
+  poolTarefas* pool = poolPadrao();
+  int alvo = (pool->qtTrabalhadores + 1) * PARALELO_SUBARVORES_POR_TRABALHADOR;
+  arvoreDeCaixas* a = c->a;
+
+  int capacidade = alvo + QT_FILHOS_NOCTREE, qt = 1;
+  int* fronteira = (int*) malloc(sizeof(int) * capacidade);
+  CHECK_MALLOC(fronteira);
+  fronteira[0] = 0;
+
+  /* Troca sempre o maior nó pelos filhos, até haver subárvores para todos */
+  while (qt < alvo) {
+    int maior = -1;
+    for (int i = 0; i < qt; i++) {
+      noCaixa* n = &a->nos[fronteira[i]];
+      if (n->qtFilhos > 0 && (maior < 0 || n->qt > a->nos[fronteira[maior]].qt)) maior = i;
+    }
+    if (maior < 0) break;
+
+    noCaixa* n = &a->nos[fronteira[maior]];
+    if (qt - 1 + n->qtFilhos > capacidade) {
+      capacidade = qt - 1 + n->qtFilhos;
+      fronteira = (int*) realloc(fronteira, sizeof(int) * capacidade);
+      CHECK_MALLOC(fronteira);
+    }
+    int filhos[QT_FILHOS_NOCTREE], qtFilhos = n->qtFilhos;
+    memcpy(filhos, n->filhos, sizeof(int) * qtFilhos);
+    fronteira[maior] = filhos[0];
+    for (int k = 1; k < qtFilhos; k++) fronteira[qt++] = filhos[k];
+  }
+
+  tarefaDupla* tarefas = (tarefaDupla*) calloc(qt, sizeof(tarefaDupla));
+  CHECK_MALLOC(tarefas);
+  grupoTarefas g;
+  iniciaGrupo(&g);
+  for (int i = 0; i < qt; i++) {
+    tarefas[i].c = c;
+    tarefas[i].noA = fronteira[i];
+    submeteTarefa(pool, &g, rotina, &tarefas[i]);
+  }
+  esperaGrupo(pool, &g);
+
+  free(fronteira);
+  *saida = tarefas;
+  *qtSaida = qt;
+}
+
+
+/* Pares a até um raio
+ * ------------------- */
+
+static void acrescentaPar(tarefaDupla* t, long long a, long long b) {
+  if (t->qt == t->capacidade) {
+    t->capacidade = (t->capacidade > 0) ? t->capacidade * 2 : 256;
+    t->pares = (parAmostras*) realloc(t->pares, sizeof(parAmostras) * t->capacidade);
+    CHECK_MALLOC(t->pares);
+  }
+  t->pares[t->qt++] = (parAmostras){a, b};
+}
+
+static void paresNos(tarefaDupla* t, int indiceA, int indiceB) {
+  contextoDuplo* c = t->c;
+  noCaixa* na = &c->a->nos[indiceA];
+  noCaixa* nb = &c->b->nos[indiceB];
+  if (distancia2Caixas(na, nb) > c->raio2) return;
+
+  /* As caixas inteiras estão no raio: todos os pares, sem medir */
+  if (distancia2MaximaCaixas(na, nb) <= c->raio2) {
+    for (long long i = na->inicio; i < na->inicio + na->qt; i++)
+      for (long long j = nb->inicio; j < nb->inicio + nb->qt; j++) acrescentaPar(t, i, j);
+    return;
+  }
+
+  if (na->qtFilhos == 0 && nb->qtFilhos == 0) {
+    for (long long i = na->inicio; i < na->inicio + na->qt; i++) {
+      amostra* p = &c->a->amostras[i];
+      if (distancia2AmostraCaixa(p, nb) > c->raio2) continue;
+      for (long long j = nb->inicio; j < nb->inicio + nb->qt; j++) {
+        if (dist2(p, &c->b->amostras[j]) <= c->raio2) acrescentaPar(t, i, j);
+      }
+    }
+    return;
+  }
+
+  if (divideA(na, nb)) {
+    for (int k = 0; k < na->qtFilhos; k++) paresNos(t, na->filhos[k], indiceB);
+  } else {
+    for (int k = 0; k < nb->qtFilhos; k++) paresNos(t, indiceA, nb->filhos[k]);
+  }
+}
+
+static void tarefaPares(void* arg) {
+  tarefaDupla* t = (tarefaDupla*) arg;
+  paresNos(t, t->noA, 0);
+}
+
+
+/* Vizinho mais próximo
+ * -------------------- */
+
+static void vizinhosNos(contextoDuplo* c, int indiceA, int indiceB) {
+  noCaixa* na = &c->a->nos[indiceA];
+  noCaixa* nb = &c->b->nos[indiceB];
+  if (distancia2Caixas(na, nb) >= c->limites2[indiceA]) return;
+
+  if (na->qtFilhos == 0 && nb->qtFilhos == 0) {
+    float limite = 0;
+    for (long long i = na->inicio; i < na->inicio + na->qt; i++) {
+      amostra* p = &c->a->amostras[i];
+      if (distancia2AmostraCaixa(p, nb) < c->melhores2[i]) {
+        for (long long j = nb->inicio; j < nb->inicio + nb->qt; j++) {
+          float d2 = dist2(p, &c->b->amostras[j]);
+          if (d2 < c->melhores2[i]) {
+            c->melhores2[i] = d2;
+            c->vizinhos[i] = j;
+          }
+        }
+      }
+      if (c->melhores2[i] > limite) limite = c->melhores2[i];
+    }
+    c->limites2[indiceA] = limite;
+    return;
+  }
+
+  if (divideA(na, nb)) {
+    float limite = 0;
+    for (int k = 0; k < na->qtFilhos; k++) {
+      vizinhosNos(c, na->filhos[k], indiceB);
+      if (c->limites2[na->filhos[k]] > limite) limite = c->limites2[na->filhos[k]];
+    }
+    if (limite < c->limites2[indiceA]) c->limites2[indiceA] = limite;
+    return;
+  }
+
+  /* Os filhos de B mais perto primeiro: o limite cai antes de olhar os longes */
+  int ordem[QT_FILHOS_NOCTREE];
+  float distancias2[QT_FILHOS_NOCTREE];
+  for (int k = 0; k < nb->qtFilhos; k++) {
+    float d2 = distancia2Caixas(na, &c->b->nos[nb->filhos[k]]);
+    int pos = k;
+    while (pos > 0 && distancias2[pos - 1] > d2) {
+      distancias2[pos] = distancias2[pos - 1];
+      ordem[pos] = ordem[pos - 1];
+      pos--;
+    }
+    distancias2[pos] = d2;
+    ordem[pos] = nb->filhos[k];
+  }
+  for (int k = 0; k < nb->qtFilhos; k++) vizinhosNos(c, indiceA, ordem[k]);
+}
+
+static void tarefaVizinhos(void* arg) {
+  tarefaDupla* t = (tarefaDupla*) arg;
+  vizinhosNos(t->c, t->noA, 0);
+}
+
+/* Preenche  melhores2  e  vizinhos  para as amostras de  a  (os dois com  a->qt  posições) */
+static void calculaVizinhos(arvoreDeCaixas* a, arvoreDeCaixas* b, float* melhores2, long long* vizinhos) {
+  for (long long i = 0; i < a->qt; i++) {
+    melhores2[i] = INFINITY;
+    vizinhos[i] = -1;
+  }
+  if (a->qt == 0 || b->qt == 0) return;
+
+  contextoDuplo c = {a, b, 0, NULL, melhores2, vizinhos};
+  c.limites2 = (float*) malloc(sizeof(float) * a->qtNos);
+  CHECK_MALLOC(c.limites2);
+  for (int i = 0; i < a->qtNos; i++) c.limites2[i] = INFINITY;
+
+  tarefaDupla* tarefas;
+  int qtTarefas;
+  executaTarefas(&c, tarefaVizinhos, &tarefas, &qtTarefas);
+
+  free(tarefas);
+  free(c.limites2);
+}
+
+
+/* Interface
+ * --------- */
+
+int paresNoRaio(noctree* a, noctree* b, float raio, paresOctree* saida) {
+  memset(saida, 0, sizeof(paresOctree));
+  if (!(raio >= 0)) return 0;
+
+  arvoreDeCaixas ca, cb;
+  montaArvoreDeCaixas(a, &ca);
+  montaArvoreDeCaixas(b, &cb);
+  saida->amostrasA = ca.amostras;
+  saida->qtA = ca.qt;
+  saida->amostrasB = cb.amostras;
+  saida->qtB = cb.qt;
+
+  if (ca.qt > 0 && cb.qt > 0) {
+    contextoDuplo c = {&ca, &cb, raio * raio, NULL, NULL, NULL};
+    tarefaDupla* tarefas;
+    int qtTarefas;
+    executaTarefas(&c, tarefaPares, &tarefas, &qtTarefas);
+
+    /* Concatena os vetores das tarefas */
+    for (int i = 0; i < qtTarefas; i++) saida->qtPares += tarefas[i].qt;
+    saida->pares = (parAmostras*) malloc(sizeof(parAmostras) * (saida->qtPares > 0 ? saida->qtPares : 1));
+    CHECK_MALLOC(saida->pares);
+    long long pos = 0;
+    for (int i = 0; i < qtTarefas; i++) {
+      if (tarefas[i].qt > 0) memcpy(saida->pares + pos, tarefas[i].pares, sizeof(parAmostras) * tarefas[i].qt);
+      pos += tarefas[i].qt;
+      free(tarefas[i].pares);
+    }
+    free(tarefas);
+  }
+
+  free(ca.nos);
+  free(cb.nos);
+  return 1;
+}
+
+void liberaPares(paresOctree* p) {
+  free(p->amostrasA);
+  free(p->amostrasB);
+  free(p->pares);
+  memset(p, 0, sizeof(paresOctree));
+}
+
+void vizinhosMaisProximos(noctree* a, noctree* b, vizinhosOctree* saida) {
+  arvoreDeCaixas ca, cb;
+  montaArvoreDeCaixas(a, &ca);
+  montaArvoreDeCaixas(b, &cb);
+
+  saida->amostrasA = ca.amostras;
+  saida->qtA = ca.qt;
+  saida->amostrasB = cb.amostras;
+  saida->qtB = cb.qt;
+  saida->vizinhos = (long long*) malloc(sizeof(long long) * (ca.qt > 0 ? ca.qt : 1));
+  saida->distancias = (float*) malloc(sizeof(float) * (ca.qt > 0 ? ca.qt : 1));
+  CHECK_MALLOC(saida->vizinhos);
+  CHECK_MALLOC(saida->distancias);
+
+  calculaVizinhos(&ca, &cb, saida->distancias, saida->vizinhos);
+  for (long long i = 0; i < ca.qt; i++) saida->distancias[i] = sqrtf(saida->distancias[i]);
+
+  free(ca.nos);
+  free(cb.nos);
+}
+
+void liberaVizinhos(vizinhosOctree* v) {
+  free(v->amostrasA);
+  free(v->amostrasB);
+  free(v->vizinhos);
+  free(v->distancias);
+  memset(v, 0, sizeof(vizinhosOctree));
+}
+
+/* Maior distância de uma amostra de  a  à mais próxima em  b  */
+static float hausdorffDirigida2(arvoreDeCaixas* a, arvoreDeCaixas* b) {
+  float* melhores2 = (float*) malloc(sizeof(float) * (a->qt > 0 ? a->qt : 1));
+  long long* vizinhos = (long long*) malloc(sizeof(long long) * (a->qt > 0 ? a->qt : 1));
+  CHECK_MALLOC(melhores2);
+  CHECK_MALLOC(vizinhos);
+
+  calculaVizinhos(a, b, melhores2, vizinhos);
+  float maior = 0;
+  for (long long i = 0; i < a->qt; i++) {
+    if (melhores2[i] > maior) maior = melhores2[i];
+  }
+
+  free(melhores2);
+  free(vizinhos);
+  return maior;
+}
+
+double distanciaHausdorff(noctree* a, noctree* b) {
+  arvoreDeCaixas ca, cb;
+  montaArvoreDeCaixas(a, &ca);
+  montaArvoreDeCaixas(b, &cb);
+
+  double h;
+  if (ca.qt == 0 || cb.qt == 0) h = (ca.qt == cb.qt) ? 0 : INFINITY;
+  else h = sqrt(fmax(hausdorffDirigida2(&ca, &cb), hausdorffDirigida2(&cb, &ca)));
+
+  free(ca.amostras);
+  free(ca.nos);
+  free(cb.amostras);
+  free(cb.nos);
+  return h;
+}
@@ -0,0 +1,103 @@
+/* Percurso duplo: consultas de uma nuvem contra outra.
+ *
+ * Para cada amostra da árvore A, as vizinhas (ou a mais próxima) na árvore B: detecção
+ * de mudanças e alinhamento de varredura com mapa. Em vez de uma busca em B por amostra
+ * de A, as duas árvores são percorridas juntas, em pares de nós, e um par é podado pela
+ * distância entre as caixas dos dois nós: amostras próximas em A fazem o mesmo caminho
+ * em B uma vez só.
+ *
+ * As caixas são as das amostras de cada subárvore (não os cubos dos nós, que não cobrem
+ * as amostras de fora do cubo da raiz), montadas junto com uma fotografia de cada árvore.
+ * A árvore A é dividida em subárvores, uma tarefa do  poolPadrao()  por subárvore, e cada
+ * tarefa percorre a sua subárvore contra B inteira. Os resultados se referem às amostras
+ * das fotografias ( amostrasA  e  amostrasB ), por índice.
+ *
+ * Exemplo:
+ *    paresOctree p;
+ *    paresNoRaio(varredura, mapa, 0.2f, &p);      // p.pares[i].a em p.amostrasA, .b em p.amostrasB
+ *    liberaPares(&p);
+ *
+ *    vizinhosOctree v;
+ *    vizinhosMaisProximos(varredura, mapa, &v);   // v.vizinhos[i], v.distancias[i]
+ *    liberaVizinhos(&v);
+ *
+ *    double h = distanciaHausdorff(antes, depois);
+*/
+
+#ifndef DUPLO_H
+#define DUPLO_H
+
+#include "paralelo.h"
+
+/**
+ * Um par de amostras: índices em  amostrasA  e  amostrasB .
+ */
+typedef struct _ParAmostras {
+  long long a, b;
+} parAmostras;
+
+/**
+ * Todos os pares a até um raio.
+ */
+typedef struct _ParesOctree {
+  amostra* amostrasA;                  // Fotografia da árvore A
+  long long qtA;
+  amostra* amostrasB;                  // Fotografia da árvore B
+  long long qtB;
+  parAmostras* pares;                  // Agrupados pela subárvore de A que os achou
+  long long qtPares;
+} paresOctree;
+
+/**
+ * A amostra mais próxima em B de cada amostra de A.
+ */
+typedef struct _VizinhosOctree {
+  amostra* amostrasA;
+  long long qtA;
+  amostra* amostrasB;
+  long long qtB;
+  long long* vizinhos;                 // vizinhos[i] é o índice em  amostrasB  da mais próxima de amostrasA[i]; -1 se B é vazia
+  float* distancias;                   // INFINITY se B é vazia
+} vizinhosOctree;
+
+/**
+ * Acha os pares (a em A, b em B) com  |a - b| <= raio .
+ *
+ * @param a é a raiz da árvore A
+ * @param b é a raiz da árvore B (pode ser a própria A; aí cada amostra forma par com ela mesma)
+ * @param raio é o raio
+ * @param saida recebe os pares (libere com  liberaPares )
+ *
+ * @return 1, se ok
+ *         0, se  raio  é negativo (saida  fica vazia)
+ */
+int paresNoRaio(noctree* a, noctree* b, float raio, paresOctree* saida);
+
+/**
+ * Libera os vetores dos pares.
+ */
+void liberaPares(paresOctree* p);
+
+/**
+ * Acha a amostra mais próxima em B de cada amostra de A.
+ *
+ * @param a é a raiz da árvore A
+ * @param b é a raiz da árvore B
+ * @param saida recebe os vizinhos (libere com  liberaVizinhos )
+ */
+void vizinhosMaisProximos(noctree* a, noctree* b, vizinhosOctree* saida);
+
+/**
+ * Libera os vetores dos vizinhos.
+ */
+void liberaVizinhos(vizinhosOctree* v);
+
+/**
+ * Distância de Hausdorff entre as nuvens: a maior distância de uma amostra de uma delas à
+ * mais próxima da outra, nos dois sentidos.
+ *
+ * @return a distância; 0 se as duas são vazias; INFINITY se só uma é
+ */
+double distanciaHausdorff(noctree* a, noctree* b);
+
+#endif
@@ -0,0 +1,71 @@
+/**
+ * @file escritor.c
+ *
+ * Escritor com árvore privada. Para ver a documentação, consulte o header.
+ */
+
+#include "escritor.h"
+
+/* Árvore local vazia com o mesmo cubo, profundidade e modo do destino */
+static noctree* novaArvoreLocal(noctree* destino) {
+  amostra* centro = inicializaAmostra(destino->centro->x, destino->centro->y, destino->centro->z);
+  noctree* local = inicializaNo(centro, destino->tamanho, destino->profundidade);
+
+  if (destino->modo == NOCTREE_MODO_QUANTIZADO) compactaOctree(local);
+  if (destino->modo == NOCTREE_MODO_INDICE) usaIndices(local, destino->coordenadas, destino->qtCoordenadas);
+  return local;
+}
+
+/* Amostras na árvore local (privada: sem lock) */
+static int contaAmostras(noctree* no) {
+  if (!no->subdividido) return no->qtPontos;
+
+  int qt = 0;
+  for (int i = 0; i < QT_FILHOS_NOCTREE; i++) qt += contaAmostras(no->filhos[i]);
+  return qt;
+}
+
+escritorPrivado* inicializaEscritorPrivado(noctree* destino, int limite) {
+  escritorPrivado* e = (escritorPrivado*) malloc(sizeof(escritorPrivado));
+  CHECK_MALLOC(e);
+
+  e->destino = destino;
+  e->local = novaArvoreLocal(destino);
+  e->limite = (limite > 0) ? limite : ESCRITOR_LIMITE_PADRAO;
+  e->qtLocal = e->qtRecusadas = 0;
+  e->qtMesclas = e->qtEnxertos = 0;
+  return e;
+}
+
+int insereAmostraEscritor(escritorPrivado* e, amostra* ponto) {
+  int status = insereAmostraPrivada(e->local, ponto);
+  if (status && ++e->qtLocal - e->qtRecusadas >= e->limite) descarregaEscritor(e);
+  return status;
+}
+
+void descarregaEscritor(escritorPrivado* e) {
+  if (e->qtLocal == 0) return;
+
+  long long enxertos;
+  int resultado = mesclaOctrees(e->destino, e->local, &enxertos); // Consome a árvore local
+  e->qtMesclas++;
+  e->qtEnxertos += enxertos; // Os de uma mescla parcial também ficaram no destino
+
+  /* Destino congelado (todo ou em parte): o que não entrou fica na árvore local, e só volta a
+   * ser tentado depois de mais  limite  amostras (em vez de a cada inserção) */
+  if (resultado != NOCTREE_MESCLA_COMPLETA) {
+    if (resultado == NOCTREE_MESCLA_PARCIAL) e->qtLocal = contaAmostras(e->local);
+    e->qtRecusadas = e->qtLocal;
+    return;
+  }
+  e->local = novaArvoreLocal(e->destino);
+  e->qtLocal = e->qtRecusadas = 0;
+}
+
+void destroiEscritorPrivado(escritorPrivado* e) {
+  if (e == NULL) return;
+
+  descarregaEscritor(e);
+  destroiNo(e->local);
+  free(e);
+}
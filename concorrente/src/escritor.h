@@ -0,0 +1,70 @@
+/* Escritor com árvore privada.
+ *
+ * Em vez de inserir amostra por amostra na árvore compartilhada (um lock de escrita por
+ * inserção, disputado com os outros escritores), o escritor monta uma árvore local com o
+ * mesmo cubo da compartilhada, sem lock nenhum, e a cada  limite  amostras a mescla na
+ * compartilhada com  mesclaOctrees : as subárvores vão inteiras para as folhas vazias, e só
+ * os pontos de enxerto são travados. Serve para ingestão em rajadas, em que a árvore
+ * compartilhada pode ver as amostras com algum atraso.
+ *
+ * Um escritor pertence a uma thread só; cada thread escritora tem o seu.
+ *
+ * Exemplo:
+ *    escritorPrivado* e = inicializaEscritorPrivado(raiz, 4096);
+ *    for (...) insereAmostraEscritor(e, inicializaAmostra(x, y, z));
+ *    destroiEscritorPrivado(e); // Mescla o que faltava
+*/
+
+#ifndef ESCRITOR_H
+#define ESCRITOR_H
+
+#include "noctree.h"
+
+/* Amostras acumuladas na árvore local antes de cada mescla, se o limite não é dado */
+#define ESCRITOR_LIMITE_PADRAO 4096
+
+/**
+ * O escritor.
+ */
+typedef struct _EscritorPrivado {
+  noctree* destino;                    // Árvore compartilhada
+  noctree* local;                      // Árvore privada, com o mesmo cubo do destino
+  int limite;                          // Amostras na árvore local que disparam a mescla
+  int qtLocal;                         // Amostras na árvore local agora
+  int qtRecusadas;                     // Das quais o destino recusou na última mescla (congelado)
+  long long qtMesclas;
+  long long qtEnxertos;                // Subárvores enxertadas no destino, somando todas as mesclas
+} escritorPrivado;
+
+/**
+ * Cria um escritor para a árvore  destino .
+ *
+ * @param destino é a raiz da árvore compartilhada
+ * @param limite é a quantidade de amostras acumuladas antes de cada mescla (0 = ESCRITOR_LIMITE_PADRAO)
+ */
+escritorPrivado* inicializaEscritorPrivado(noctree* destino, int limite);
+
+/**
+ * Insere uma amostra na árvore local; se ela recebeu  limite  amostras desde a última mescla,
+ * mescla no destino.
+ * Se o destino está no modo índice,  ponto  aponta para dentro do vetor de coordenadas dele
+ * (os de fora são recusados).
+ *
+ * @return 1, se ok
+ *         0, c.c.
+ */
+int insereAmostraEscritor(escritorPrivado* e, amostra* ponto);
+
+/**
+ * Mescla no destino o que está na árvore local e começa uma árvore local nova. Se o destino
+ * está congelado (todo ou em parte), o que ele recusou continua na árvore local, e a próxima
+ * mescla automática espera mais  limite  amostras.
+ */
+void descarregaEscritor(escritorPrivado* e);
+
+/**
+ * Descarrega o escritor e o libera (com as amostras que um destino congelado recusou).
+ */
+void destroiEscritorPrivado(escritorPrivado* e);
+
+#endif
@@ -0,0 +1,158 @@
+/**
+ * @file estatisticas.c
+ *
+ * Contadores de instrumentação da Octree. Para ver a documentação, consulte o header.
+ */
+
+#include "estatisticas.h"
+#include <stddef.h>
+#include <time.h>
+
+#ifdef NOCTREE_ESTATISTICAS
+
+/* Os contadores são todos uint64_t, antes dos campos calculados na soma */
+#define QT_CONTADORES (offsetof(estatisticasOctree, segundos) / sizeof(uint64_t))
+
+static double agora(void) {
+  struct timespec t;
+  clock_gettime(CLOCK_MONOTONIC, &t);
+  return t.tv_sec + t.tv_nsec / 1e9;
+}
+
+/* Lista global dos blocos das threads. Os blocos nunca são liberados: uma thread
+ * nova adota o bloco de uma que já terminou, e os contadores continuam somando. */
+static blocoEstatisticas* blocos = NULL;
+static pthread_mutex_t mutexBlocos = PTHREAD_MUTEX_INITIALIZER;
+static pthread_once_t chaveCriada = PTHREAD_ONCE_INIT;
+static pthread_key_t chaveBloco;       // Só serve para saber quando a thread termina
+static double inicio = 0;
+
+_Thread_local blocoEstatisticas* estBlocoDaThread = NULL;
+
+static void liberaBloco(void* bloco) {
+  pthread_mutex_lock(&mutexBlocos);
+  ((blocoEstatisticas*) bloco)->livre = 1;
+  pthread_mutex_unlock(&mutexBlocos);
+}
+
+static void criaChave(void) {
+  if (pthread_key_create(&chaveBloco, liberaBloco) != 0) {
+    LOG_ERROR(ERRO_THREAD, "Falha na criação da chave das estatísticas");
+  }
+}
+
+blocoEstatisticas* estRegistraThread(void) {
+  blocoEstatisticas* b;
+  pthread_once(&chaveCriada, criaChave);
+
+  pthread_mutex_lock(&mutexBlocos);
+  if (inicio == 0) inicio = agora();
+  for (b = blocos; b != NULL && !b->livre; b = b->proximo);
+  if (b == NULL) {
+    b = (blocoEstatisticas*) aligned_alloc(TAM_LINHA_CACHE, sizeof(blocoEstatisticas));
+    CHECK_MALLOC(b);
+    memset(b, 0, sizeof(blocoEstatisticas));
+    b->proximo = blocos;
+    blocos = b;
+  }
+  b->livre = 0;
+  pthread_mutex_unlock(&mutexBlocos);
+
+  pthread_setspecific(chaveBloco, b);
+  estBlocoDaThread = b;
+  return b;
+}
+
+static inline int nivel(int profundidade) {
+  if (profundidade < 0) return 0;
+  return (profundidade < EST_QT_NIVEIS) ? profundidade : EST_QT_NIVEIS - 1;
+}
+
+/* Tenta sem esperar; só cronometra quando o lock está ocupado */
+int estTravaLeitura(pthread_rwlock_t* lock, int profundidade) {
+  int n = nivel(profundidade);
+  int status = pthread_rwlock_tryrdlock(lock);
+
+  if (status == EBUSY || status == EAGAIN) {
+    double t0 = agora();
+    status = pthread_rwlock_rdlock(lock);
+    EST_SOMA(nsEspera[n], (agora() - t0) * 1e9);
+    EST_SOMA(esperas[n], 1);
+  }
+  EST_SOMA(aquisicoesLeitura[n], 1);
+  return status;
+}
+
+int estTravaEscrita(pthread_rwlock_t* lock, int profundidade) {
+  int n = nivel(profundidade);
+  int status = pthread_rwlock_trywrlock(lock);
+
+  if (status == EBUSY) {
+    double t0 = agora();
+    status = pthread_rwlock_wrlock(lock);
+    EST_SOMA(nsEspera[n], (agora() - t0) * 1e9);
+    EST_SOMA(esperas[n], 1);
+  }
+  EST_SOMA(aquisicoesEscrita[n], 1);
+  return status;
+}
+
+int octreeEstatisticasRuntime(estatisticasOctree* saida) {
+  memset(saida, 0, sizeof(estatisticasOctree));
+
+  pthread_mutex_lock(&mutexBlocos);
+  uint64_t* soma = (uint64_t*) saida;
+  for (blocoEstatisticas* b = blocos; b != NULL; b = b->proximo) {
+    uint64_t* parcial = (uint64_t*) &b->c;
+    for (size_t i = 0; i < QT_CONTADORES; i++) {
+      soma[i] += __atomic_load_n(&parcial[i], __ATOMIC_RELAXED);
+    }
+  }
+  saida->segundos = (inicio > 0) ? agora() - inicio : 0;
+  pthread_mutex_unlock(&mutexBlocos);
+
+  saida->subdivisoesPorSegundo = (saida->segundos > 0) ? saida->subdivisoes / saida->segundos : 0;
+  return 1;
+}
+
+void octreeZeraEstatisticas(void) {
+  pthread_mutex_lock(&mutexBlocos);
+  for (blocoEstatisticas* b = blocos; b != NULL; b = b->proximo) {
+    uint64_t* parcial = (uint64_t*) &b->c;
+    for (size_t i = 0; i < QT_CONTADORES; i++) {
+      __atomic_store_n(&parcial[i], 0, __ATOMIC_RELAXED);
+    }
+  }
+  inicio = agora();
+  pthread_mutex_unlock(&mutexBlocos);
+}
+
+#else
+
+int octreeEstatisticasRuntime(estatisticasOctree* saida) {
+  memset(saida, 0, sizeof(estatisticasOctree));
+  return 0;
+}
+
+void octreeZeraEstatisticas(void) {}
+
+#endif
+
+void imprimeEstatisticasOctree(FILE* saida, const estatisticasOctree* est) {
+  double porConsulta = est->consultas ? 1.0 / est->consultas : 0;
+
+  fprintf(saida, "  Subdivisões:      %llu (%.1f/seg em %.3f seg)\n",
+          (unsigned long long) est->subdivisoes, est->subdivisoesPorSegundo, est->segundos);
+  fprintf(saida, "  Bytes alocados:   %llu\n", (unsigned long long) est->bytesAlocados);
+  fprintf(saida, "  Consultas:        %llu | por consulta: %.1f nós, %.1f testados, %.1f devolvidos\n",
+          (unsigned long long) est->consultas, est->nosVisitados * porConsulta,
+          est->pontosTestados * porConsulta, est->pontosDevolvidos * porConsulta);
+  fprintf(saida, "  Locks por profundidade (leitura / escrita / esperas / espera média us):\n");
+  for (int n = 0; n < EST_QT_NIVEIS; n++) {
+    if (est->aquisicoesLeitura[n] + est->aquisicoesEscrita[n] == 0) continue;
+    fprintf(saida, "    %2d: %llu / %llu / %llu / %.3f\n", n,
+            (unsigned long long) est->aquisicoesLeitura[n], (unsigned long long) est->aquisicoesEscrita[n],
+            (unsigned long long) est->esperas[n],
+            est->esperas[n] ? est->nsEspera[n] / 1e3 / est->esperas[n] : 0.0);
+  }
+}
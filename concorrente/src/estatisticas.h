@@ -0,0 +1,133 @@
+/* Contadores de instrumentação da Octree concorrente.
+ *
+ * Ligados só quando compilado com a flag -DNOCTREE_ESTATISTICAS (ex.: make desempenho_estatisticas).
+ * Sem a flag, as macros abaixo viram as chamadas de lock de sempre (ou nada), e o
+ * custo na árvore é zero.
+ *
+ * Cada thread escreve apenas no seu próprio bloco de contadores, alinhado à linha
+ * de cache, então não há false sharing nem operações atômicas de leitura-modificação.
+ * Os blocos ficam numa lista global e são somados sob demanda por
+ * octreeEstatisticasRuntime() .
+ *
+ * Exemplo:
+ *    estatisticasOctree est;
+ *    octreeZeraEstatisticas();
+ *    ... inserções e buscas ...
+ *    if (octreeEstatisticasRuntime(&est)) imprimeEstatisticasOctree(stdout, &est);
+*/
+
+#ifndef ESTATISTICAS_H
+#define ESTATISTICAS_H
+
+#include "system.h"
+
+/* Níveis com contadores de lock: profundidades 0 .. NOCTREE_MAX_PROFUNDIDADE+1 (as mais fundas caem no último) */
+#define EST_QT_NIVEIS   (NOCTREE_MAX_PROFUNDIDADE + 2)
+
+/**
+ * Contadores da Octree. É tanto o bloco de cada thread quanto a soma de todos.
+ */
+typedef struct _EstatisticasOctree {
+  /* Locks, por profundidade do nó */
+  uint64_t aquisicoesLeitura[EST_QT_NIVEIS];
+  uint64_t aquisicoesEscrita[EST_QT_NIVEIS];
+  uint64_t esperas[EST_QT_NIVEIS];     // Aquisições que encontraram o lock ocupado
+  uint64_t nsEspera[EST_QT_NIVEIS];    // Tempo bloqueado nessas aquisições
+
+  /* Estrutura */
+  uint64_t subdivisoes;
+  uint64_t bytesAlocados;              // Nós, centros e vetores de amostras (não conta as amostras do usuário)
+
+  /* Consultas (buscaPorRegiao e buscaNaFolha) */
+  uint64_t consultas;
+  uint64_t nosVisitados;
+  uint64_t pontosTestados;             // Amostras das folhas visitadas
+  uint64_t pontosDevolvidos;
+
+  /* Preenchidos só na soma */
+  double segundos;                     // Desde o último octreeZeraEstatisticas() (ou o primeiro contador)
+  double subdivisoesPorSegundo;
+} estatisticasOctree;
+
+/**
+ * Soma os contadores de todas as threads (inclusive as que já terminaram).
+ * A soma é feita sem parar as threads: com a árvore em uso, é uma fotografia aproximada.
+ *
+ * @param saida recebe a soma (zerada se os contadores não foram compilados)
+ *
+ * @return 1, se os contadores foram compilados (-DNOCTREE_ESTATISTICAS)
+ *         0, c.c.
+ */
+int octreeEstatisticasRuntime(estatisticasOctree* saida);
+
+/**
+ * Zera os contadores de todas as threads e reinicia o relógio. Deve ser chamada
+ * com a árvore parada; incrementos concorrentes podem se perder.
+ */
+void octreeZeraEstatisticas(void);
+
+/**
+ * Imprime um resumo legível das estatísticas (médias por consulta e esperas por profundidade).
+ */
+void imprimeEstatisticasOctree(FILE* saida, const estatisticasOctree* est);
+
+
+#ifdef NOCTREE_ESTATISTICAS
+
+/* Bloco de uma thread: contadores mais o encadeamento da lista global */
+typedef struct _BlocoEstatisticas {
+  _Alignas(TAM_LINHA_CACHE) estatisticasOctree c;
+  struct _BlocoEstatisticas* proximo;
+  int livre;                           // A thread dona terminou; o bloco pode ser adotado por outra
+} blocoEstatisticas;
+
+extern _Thread_local blocoEstatisticas* estBlocoDaThread;
+
+/* Registra (ou adota) o bloco da thread atual. Só é chamada no primeiro contador da thread. */
+blocoEstatisticas* estRegistraThread(void);
+
+static inline blocoEstatisticas* estBloco(void) {
+  return estBlocoDaThread ? estBlocoDaThread : estRegistraThread();
+}
+
+/* Só a dona escreve no bloco: load + store relaxados bastam e não travam o barramento */
+#define EST_SOMA(campo, n) \
+  do { \
+    blocoEstatisticas* b_ = estBloco(); \
+    __atomic_store_n(&b_->c.campo, b_->c.campo + (uint64_t)(n), __ATOMIC_RELAXED); \
+  } while (0)
+
+/* Locks instrumentados: contam a aquisição e, se o lock estava ocupado, o tempo de espera */
+int estTravaLeitura(pthread_rwlock_t* lock, int profundidade);
+int estTravaEscrita(pthread_rwlock_t* lock, int profundidade);
+
+#define CONTA(campo, n)        EST_SOMA(campo, n)
+
+#else
+
+#define CONTA(campo, n)
+
+#endif
+
+/* Locks dos nós, conforme a política de sincronização (NOCTREE_POLITICA, em system.h) */
+#if NOCTREE_POLITICA == NOCTREE_POLITICA_SEM_LOCK
+
+#define LOCK_LEITURA(no)       ((void)(no))
+#define LOCK_ESCRITA(no)       ((void)(no))
+#define DESTRAVA(no)           ((void)(no))
+
+#elif defined(NOCTREE_ESTATISTICAS)
+
+#define LOCK_LEITURA(no)       estTravaLeitura(&(no)->lock, (no)->profundidade)
+#define LOCK_ESCRITA(no)       estTravaEscrita(&(no)->lock, (no)->profundidade)
+#define DESTRAVA(no)           pthread_rwlock_unlock(&(no)->lock)
+
+#else
+
+#define LOCK_LEITURA(no)       pthread_rwlock_rdlock(&(no)->lock)
+#define LOCK_ESCRITA(no)       pthread_rwlock_wrlock(&(no)->lock)
+#define DESTRAVA(no)           pthread_rwlock_unlock(&(no)->lock)
+
+#endif
+
+#endif
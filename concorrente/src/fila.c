@@ -0,0 +1,95 @@
+/**
+ * @file fila.c
+ *
+ * Fila circular limitada MPMC baseada em números de sequência por célula
+ * (esquema de D. Vyukov). Para ver a documentação, consulte o header.
+ */
+
+#include "fila.h"
+
+fila* inicializaFila(size_t capacidade) {
+  /* Arredonda para potência de 2 para trocar o módulo por uma máscara */
+  size_t cap = 2;
+  while (cap < capacidade) cap <<= 1;
+
+  fila* f = (fila*) malloc(sizeof(fila));
+  CHECK_MALLOC(f);
+
+  f->celulas = (celulaFila*) malloc(sizeof(celulaFila) * cap);
+  CHECK_MALLOC(f->celulas);
+
+  for (size_t i = 0; i < cap; i++) {
+    atomic_init(&f->celulas[i].sequencia, i);
+    f->celulas[i].dado = NULL;
+  }
+
+  f->mascara = cap - 1;
+  atomic_init(&f->entrada, 0);
+  atomic_init(&f->saida, 0);
+
+  return f;
+}
+
+int enfileira(fila* f, void* dado) {
+  size_t pos = atomic_load_explicit(&f->entrada, memory_order_relaxed);
+
+  for (;;) {
+    celulaFila* celula = &f->celulas[pos & f->mascara];
+    size_t seq = atomic_load_explicit(&celula->sequencia, memory_order_acquire);
+    intptr_t dif = (intptr_t)seq - (intptr_t)pos;
+
+    if (dif == 0) { // Célula livre: tenta reservá-la
+      if (atomic_compare_exchange_weak_explicit(&f->entrada, &pos, pos + 1,
+                                                memory_order_relaxed, memory_order_relaxed)) {
+        celula->dado = dado;
+        atomic_store_explicit(&celula->sequencia, pos + 1, memory_order_release);
+        return 1;
+      }
+      /* Outro produtor ganhou a corrida;  pos  já foi atualizado pelo CAS */
+    }
+    else if (dif < 0) { // A célula ainda não foi consumida -> fila cheia
+      return 0;
+    }
+    else {
+      pos = atomic_load_explicit(&f->entrada, memory_order_relaxed);
+    }
+  }
+}
+
+int desenfileira(fila* f, void** dado) {
+  size_t pos = atomic_load_explicit(&f->saida, memory_order_relaxed);
+
+  for (;;) {
+    celulaFila* celula = &f->celulas[pos & f->mascara];
+    size_t seq = atomic_load_explicit(&celula->sequencia, memory_order_acquire);
+    intptr_t dif = (intptr_t)seq - (intptr_t)(pos + 1);
+
+    if (dif == 0) { // Célula preenchida: tenta consumi-la
+      if (atomic_compare_exchange_weak_explicit(&f->saida, &pos, pos + 1,
+                                                memory_order_relaxed, memory_order_relaxed)) {
+        *dado = celula->dado;
+        /* Libera a célula para a próxima volta do produtor */
+        atomic_store_explicit(&celula->sequencia, pos + f->mascara + 1, memory_order_release);
+        return 1;
+      }
+    }
+    else if (dif < 0) { // Ninguém escreveu aqui ainda -> fila vazia
+      return 0;
+    }
+    else {
+      pos = atomic_load_explicit(&f->saida, memory_order_relaxed);
+    }
+  }
+}
+
+size_t tamanhoFila(fila* f) {
+  size_t saida   = atomic_load_explicit(&f->saida, memory_order_relaxed);
+  size_t entrada = atomic_load_explicit(&f->entrada, memory_order_relaxed);
+  return (entrada > saida) ? entrada - saida : 0;
+}
+
+void destroiFila(fila* f) {
+  if (f == NULL) return;
+  free(f->celulas);
+  free(f);
+}
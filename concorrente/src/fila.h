@@ -0,0 +1,70 @@
+#ifndef FILA_H
+#define FILA_H
+
+#include "system.h"
+#include <stdatomic.h>
+
+/**
+ * Célula da fila circular. O número de sequência diz se a célula está livre
+ * para o produtor ou pronta para o consumidor.
+ */
+typedef struct _CelulaFila {
+  _Atomic size_t sequencia;
+  void* dado;
+} celulaFila;
+
+/**
+ * Fila circular limitada e sem lock com múltiplos produtores e múltiplos
+ * consumidores (serve também para os casos SPSC e MPSC).
+ *
+ * Os índices de entrada e saída ficam em linhas de cache separadas para que
+ * produtores e consumidores não disputem a mesma linha.
+ */
+typedef struct _Fila {
+  celulaFila* celulas;                 // Vetor circular com  capacidade  células
+  size_t mascara;                      // capacidade - 1 (capacidade é potência de 2)
+  char pad0[TAM_LINHA_CACHE];
+  _Atomic size_t entrada;              // Próxima posição a ser escrita
+  char pad1[TAM_LINHA_CACHE - sizeof(size_t)];
+  _Atomic size_t saida;                // Próxima posição a ser lida
+  char pad2[TAM_LINHA_CACHE - sizeof(size_t)];
+} fila;
+
+/**
+ * Inicializa uma fila vazia.
+ *
+ * @param capacidade É a quantidade máxima de elementos. É arredondada para a próxima potência de 2.
+ *
+ * @return Ponteiro para a fila.
+ */
+fila* inicializaFila(size_t capacidade);
+
+/**
+ * Tenta enfileirar um elemento, sem bloquear.
+ *
+ * @return 1, se ok
+ *         0, se a fila está cheia
+ */
+int enfileira(fila* f, void* dado);
+
+/**
+ * Tenta desenfileirar um elemento, sem bloquear.
+ *
+ * @param dado É onde o elemento retirado será escrito.
+ *
+ * @return 1, se ok
+ *         0, se a fila está vazia
+ */
+int desenfileira(fila* f, void** dado);
+
+/**
+ * Quantidade aproximada de elementos na fila (exata se não há concorrência).
+ */
+size_t tamanhoFila(fila* f);
+
+/**
+ * Destrói a fila. Os elementos que ainda estiverem nela não são liberados.
+ */
+void destroiFila(fila* f);
+
+#endif
@@ -0,0 +1,187 @@
+/**
+ * @file filtros.c
+ *
+ * Filtros de outliers. Para ver a documentação, consulte o header.
+ */
+
+#include "filtros.h"
+
+/* Parâmetros e saída de um filtro, repassados às folhas */
+typedef struct {
+  resultadoFiltro* r;
+  float raio;
+  int minVizinhos, k;
+} contextoFiltro;
+
+
+/* Filtros por folha
+ * ----------------- */
+
+static void filtraRaioNaFolha(fotografiaOctree* f, folhaFotografada* folha, vizinhanca* v, void* arg) {
+  contextoFiltro* c = (contextoFiltro*) arg;
+  amostra* pontos = f->amostras + folha->inicio;
+  float raio2 = c->raio * c->raio;
+
+  caixaDaFolha(f, folha, c->raio, v);
+  coletaVizinhanca(f, v);
+
+  for (int i = 0; i < folha->qt; i++) {
+    int dentro = 0; // Inclui a própria amostra
+    for (long long j = 0; j < v->qt && dentro <= c->minVizinhos; j++) {
+      if (dist2(&pontos[i], &v->amostras[j]) <= raio2) dentro++;
+    }
+    c->r->manter[folha->inicio + i] = (dentro - 1 >= c->minVizinhos);
+  }
+}
+
+/* Distância média aos k vizinhos, se a vizinhança coletada garante que eles são os mais próximos.
+ * Os k+1 menores quadrados de distância incluem a própria amostra (distância 0), que é descartada. */
+static int mediaDosVizinhos(vizinhanca* v, int kVizinhos, amostra* p, int completa, float* media) {
+  float melhores[FILTRO_MAX_K + 1];
+  int qt = 0, k = kVizinhos + 1;
+
+  for (long long j = 0; j < v->qt; j++) {
+    float d2 = dist2(p, &v->amostras[j]);
+    if (qt == k && d2 >= melhores[qt - 1]) continue;
+
+    int pos = (qt < k) ? qt++ : qt - 1;
+    while (pos > 0 && melhores[pos - 1] > d2) {
+      melhores[pos] = melhores[pos - 1];
+      pos--;
+    }
+    melhores[pos] = d2;
+  }
+
+  if (!completa) {
+    if (qt < k) return 0;
+    float raio = sqrtf(melhores[qt - 1]);
+    if (p->x - raio < v->minimo[0] || p->x + raio > v->maximo[0] ||
+        p->y - raio < v->minimo[1] || p->y + raio > v->maximo[1] ||
+        p->z - raio < v->minimo[2] || p->z + raio > v->maximo[2]) return 0;
+  }
+
+  if (qt <= 1) {
+    *media = INFINITY; // Sem vizinho nenhum na árvore
+    return 1;
+  }
+  double soma = 0;
+  for (int i = 1; i < qt; i++) soma += sqrtf(melhores[i]);
+  *media = (float)(soma / (qt - 1));
+  return 1;
+}
+
+static void filtraEstatisticoNaFolha(fotografiaOctree* f, folhaFotografada* folha, vizinhanca* v, void* arg) {
+  contextoFiltro* c = (contextoFiltro*) arg;
+  amostra* pontos = f->amostras + folha->inicio;
+  float* distancias = c->r->distancias + folha->inicio;
+  int pendentes = folha->qt;
+
+  for (int i = 0; i < folha->qt; i++) distancias[i] = NAN;
+
+  /* A primeira margem é a aresta da folha; dobra enquanto faltar vizinho */
+  float margem = folha->aresta;
+  while (pendentes > 0) {
+    caixaDaFolha(f, folha, margem, v);
+    int completa = caixaCobreRaiz(f, v);
+    if (completa) { // Vale tudo, inclusive as amostras fora do cubo da raiz
+      for (int d = 0; d < DIM; d++) {
+        v->minimo[d] = -INFINITY;
+        v->maximo[d] = INFINITY;
+      }
+    }
+    coletaVizinhanca(f, v);
+
+    for (int i = 0; i < folha->qt; i++) {
+      if (!isnan(distancias[i])) continue;
+      if (mediaDosVizinhos(v, c->k, &pontos[i], completa, &distancias[i])) pendentes--;
+    }
+    margem *= 2;
+  }
+}
+
+/* Fotografia da árvore (as amostras passam a ser do resultado) e saídas por amostra */
+static void preparaResultado(noctree* raiz, fotografiaOctree* f, resultadoFiltro* r, int comDistancias) {
+  fotografaOctree(raiz, f);
+  r->amostras = f->amostras;
+  r->qt = f->qt;
+
+  r->manter = (unsigned char*) malloc(r->qt > 0 ? r->qt : 1);
+  CHECK_MALLOC(r->manter);
+  if (comDistancias) {
+    r->distancias = (float*) malloc(sizeof(float) * (r->qt > 0 ? r->qt : 1));
+    CHECK_MALLOC(r->distancias);
+  }
+}
+
+static void iniciaResultado(resultadoFiltro* r) {
+  memset(r, 0, sizeof(resultadoFiltro));
+}
+
+
+/* Interface
+ * --------- */
+
+int filtroRaio(noctree* no, float raio, int minVizinhos, resultadoFiltro* saida) {
+  iniciaResultado(saida);
+  if (!(raio > 0)) return 0;
+
+  fotografiaOctree f;
+  preparaResultado(no, &f, saida, 0);
+  contextoFiltro c = {saida, raio, minVizinhos, 0};
+  paraCadaFolha(&f, filtraRaioNaFolha, &c);
+  free(f.folhas);
+
+  for (long long i = 0; i < saida->qt; i++) saida->qtMantidas += saida->manter[i];
+  return 1;
+}
+
+int filtroEstatistico(noctree* no, int k, float alfa, resultadoFiltro* saida) {
+  iniciaResultado(saida);
+  if (k < 1 || k > FILTRO_MAX_K) return 0;
+
+  fotografiaOctree f;
+  preparaResultado(no, &f, saida, 1);
+  contextoFiltro c = {saida, 0, 0, k};
+  paraCadaFolha(&f, filtraEstatisticoNaFolha, &c);
+  free(f.folhas);
+
+  /* Média e desvio das distâncias finitas */
+  double soma = 0, soma2 = 0;
+  long long n = 0;
+  for (long long i = 0; i < saida->qt; i++) {
+    if (isinf(saida->distancias[i])) continue;
+    soma += saida->distancias[i];
+    soma2 += (double) saida->distancias[i] * saida->distancias[i];
+    n++;
+  }
+  saida->media = (n > 0) ? soma / n : 0;
+  saida->desvio = (n > 1) ? sqrt(fmax(0, (soma2 - n * saida->media * saida->media) / (n - 1))) : 0;
+
+  double limite = saida->media + alfa * saida->desvio;
+  for (long long i = 0; i < saida->qt; i++) {
+    saida->manter[i] = (saida->distancias[i] <= limite);
+    saida->qtMantidas += saida->manter[i];
+  }
+  return 1;
+}
+
+noctree* arvoreFiltrada(noctree* no, resultadoFiltro* r) {
+  noctree* nova = inicializaNo(inicializaAmostra(no->centro->x, no->centro->y, no->centro->z), no->tamanho, no->profundidade);
+  if (no->modo == NOCTREE_MODO_QUANTIZADO) {
+    compactaOctree(nova);
+    nova->erroQ += erroQuantizacao(no); // As amostras mantidas já vêm decodificadas, com o erro da original
+  }
+
+  /* A árvore nova só é vista por esta thread até voltar: inserção sem lock */
+  for (long long i = 0; i < r->qt; i++) {
+    if (r->manter[i]) insereAmostraPrivada(nova, inicializaAmostra(r->amostras[i].x, r->amostras[i].y, r->amostras[i].z));
+  }
+  return nova;
+}
+
+void liberaResultadoFiltro(resultadoFiltro* r) {
+  free(r->amostras);
+  free(r->manter);
+  free(r->distancias);
+  iniciaResultado(r);
+}
@@ -0,0 +1,78 @@
+/* Filtros de outliers (ruído de chuva e poeira nas varreduras).
+ *
+ * Filtro por raio: fica a amostra com pelo menos  minVizinhos  outras a até  raio .
+ * Filtro estatístico (SOR): para cada amostra, a distância média aos  k  vizinhos mais
+ * próximos; fica quem não passa de  média + alfa * desvio  dessas distâncias na árvore toda.
+ *
+ * Em vez de uma busca por amostra, o trabalho é por folha (ver  vizinhanca.h ): a
+ * vizinhança da folha (as amostras na caixa das suas amostras, alargada pelo raio) é
+ * coletada uma vez e serve para todas as amostras dela. No SOR, a margem começa com a
+ * aresta da folha e dobra só se algum dos k vizinhos de alguma amostra pode estar fora
+ * da caixa.
+ *
+ * O resultado traz a fotografia das amostras da árvore e uma máscara de quais ficam.
+ *
+ * Exemplo:
+ *    resultadoFiltro r;
+ *    filtroEstatistico(raiz, 16, 1.0f, &r);
+ *    noctree* limpa = arvoreFiltrada(raiz, &r);
+ *    liberaResultadoFiltro(&r);
+*/
+
+#ifndef FILTROS_H
+#define FILTROS_H
+
+#include "vizinhanca.h"
+
+/* Maior k do filtro estatístico */
+#define FILTRO_MAX_K              64
+
+/**
+ * Resultado de um filtro.
+ */
+typedef struct _ResultadoFiltro {
+  amostra* amostras;                   // Cópia das amostras da árvore
+  unsigned char* manter;               // manter[i] = 1 se amostras[i] fica; 0 se é outlier
+  float* distancias;                   // Só no SOR: distância média aos k vizinhos (INFINITY se não há nenhum)
+  long long qt;
+  long long qtMantidas;
+  double media, desvio;                // Só no SOR: das distâncias médias finitas
+} resultadoFiltro;
+
+/**
+ * Filtro por raio.
+ *
+ * @param no é a raiz da árvore
+ * @param raio é o raio da vizinhança
+ * @param minVizinhos é o mínimo de outras amostras na vizinhança para a amostra ficar
+ * @param saida recebe o resultado (libere com  liberaResultadoFiltro )
+ *
+ * @return 1, se ok
+ *         0, se  raio  não é positivo (saida  fica vazia)
+ */
+int filtroRaio(noctree* no, float raio, int minVizinhos, resultadoFiltro* saida);
+
+/**
+ * Filtro estatístico (Statistical Outlier Removal).
+ *
+ * @param no é a raiz da árvore
+ * @param k é a quantidade de vizinhos, de 1 a FILTRO_MAX_K
+ * @param alfa é quantos desvios acima da média a distância de uma amostra pode ficar
+ * @param saida recebe o resultado (libere com  liberaResultadoFiltro )
+ *
+ * @return 1, se ok
+ *         0, se  k  é inválido (saida  fica vazia)
+ */
+int filtroEstatistico(noctree* no, int k, float alfa, resultadoFiltro* saida);
+
+/**
+ * Monta uma árvore nova, com o mesmo cubo, profundidade e modo, só com as amostras mantidas.
+ */
+noctree* arvoreFiltrada(noctree* no, resultadoFiltro* r);
+
+/**
+ * Libera os vetores do resultado.
+ */
+void liberaResultadoFiltro(resultadoFiltro* r);
+
+#endif
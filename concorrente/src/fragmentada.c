@@ -0,0 +1,179 @@
+/**
+ * @file fragmentada.c
+ *
+ * Implementação da Octree fragmentada. Para ver a documentação, consulte o header.
+ */
+
+#include "fragmentada.h"
+
+/* Índice do fragmento no eixo, saturado nas bordas. O ponto exatamente no meio vai
+ * para a metade de cima, como em  realocaAmostra . */
+static int indiceNoEixo(octreeFragmentada* of, float coord, int eixo) {
+  int i = (int) floorf((coord - of->minimo[eixo]) / of->tamanho[eixo] * of->lado);
+  if (i < 0) return 0;
+  return (i < of->lado) ? i : of->lado - 1;
+}
+
+static int indiceDoFragmento(octreeFragmentada* of, int ix, int iy, int iz) {
+  return ix + of->lado * (iy + of->lado * iz);
+}
+
+octreeFragmentada* inicializaOctreeFragmentada(amostra* centro, float* tamanho, int k) {
+  if (k < 0 || k > FRAGMENTADA_MAX_K || k > NOCTREE_MAX_PROFUNDIDADE) {
+    free(centro);
+    return NULL;
+  }
+
+  octreeFragmentada* of = (octreeFragmentada*) malloc(sizeof(octreeFragmentada));
+  CHECK_MALLOC(of);
+
+  of->centro = centro;
+  of->k = k;
+  of->lado = 1 << k;
+  of->qtFragmentos = of->lado * of->lado * of->lado;
+  for (int i = 0; i < DIM; i++) of->tamanho[i] = tamanho[i];
+  of->minimo[0] = centro->x - tamanho[0] / 2;
+  of->minimo[1] = centro->y - tamanho[1] / 2;
+  of->minimo[2] = centro->z - tamanho[2] / 2;
+
+  /* Um bloco alinhado com todos os fragmentos */
+  of->fragmentos = (fragmento*) aligned_alloc(TAM_LINHA_CACHE, sizeof(fragmento) * of->qtFragmentos);
+  CHECK_MALLOC(of->fragmentos);
+  CONTA(bytesAlocados, sizeof(fragmento) * of->qtFragmentos);
+
+  float tamanhoFragmento[DIM];
+  for (int i = 0; i < DIM; i++) tamanhoFragmento[i] = tamanho[i] / of->lado;
+
+  for (int iz = 0; iz < of->lado; iz++) {
+    for (int iy = 0; iy < of->lado; iy++) {
+      for (int ix = 0; ix < of->lado; ix++) {
+        fragmento* f = &of->fragmentos[indiceDoFragmento(of, ix, iy, iz)];
+        amostra* c = inicializaAmostra(of->minimo[0] + (ix + 0.5f) * tamanhoFragmento[0],
+                                       of->minimo[1] + (iy + 0.5f) * tamanhoFragmento[1],
+                                       of->minimo[2] + (iz + 0.5f) * tamanhoFragmento[2]);
+        preparaNo(&f->raiz, c, tamanhoFragmento, k);
+        atomic_init(&f->qtAmostras, 0);
+      }
+    }
+  }
+
+  return of;
+}
+
+/* Cálculo direto do fragmento: três divisões, nenhum lock */
+static fragmento* fragmentoDoPonto(octreeFragmentada* of, amostra* ponto) {
+  int ix = indiceNoEixo(of, ponto->x, 0);
+  int iy = indiceNoEixo(of, ponto->y, 1);
+  int iz = indiceNoEixo(of, ponto->z, 2);
+  return &of->fragmentos[indiceDoFragmento(of, ix, iy, iz)];
+}
+
+noctree* fragmentoDe(octreeFragmentada* of, amostra* ponto) {
+  return &fragmentoDoPonto(of, ponto)->raiz;
+}
+
+int insereAmostraFragmentada(octreeFragmentada* of, amostra* ponto) {
+  fragmento* f = fragmentoDoPonto(of, ponto);
+  int status = insereAmostra(&f->raiz, ponto);
+  if (status) atomic_fetch_add_explicit(&f->qtAmostras, 1, memory_order_relaxed);
+  return status;
+}
+
+/* Guarda em  copias  as amostras da busca num fragmento compactado, que  buscaPorRegiao  devolve por cópia */
+static void copiaDoFragmentoQuantizado(noctree* raiz, amostra* centro, float raio, amostra** copias, int* qtCopias, int* capacidade) {
+  int qt = 0;
+  amostra** achadas = buscaPorRegiao(raiz, centro, raio, &qt);
+  if (*qtCopias + qt > *capacidade) {
+    while (*qtCopias + qt > *capacidade) *capacidade *= 2;
+    *copias = (amostra*) realloc(*copias, sizeof(amostra) * (*capacidade));
+    CHECK_MALLOC(*copias);
+  }
+  for (int i = 0; i < qt; i++) (*copias)[(*qtCopias)++] = *achadas[i];
+  free(achadas);
+}
+
+amostra** buscaPorRegiaoFragmentada(octreeFragmentada* of, amostra* centro, float raio, int* qt_encontrados) {
+  int capacidade = 16, capacidadeCopias = 16, qtCopias = 0;
+  amostra** resultados = (amostra**) malloc(sizeof(amostra*) * capacidade);
+  CHECK_MALLOC(resultados);
+  amostra* copias = (amostra*) malloc(sizeof(amostra) * capacidadeCopias);
+  CHECK_MALLOC(copias);
+  *qt_encontrados = 0;
+
+  /* Só os fragmentos que a caixa da esfera toca */
+  int de[DIM], ate[DIM];
+  float coords[DIM] = {centro->x, centro->y, centro->z};
+  for (int e = 0; e < DIM; e++) {
+    de[e]  = indiceNoEixo(of, coords[e] - raio, e);
+    ate[e] = indiceNoEixo(of, coords[e] + raio, e);
+  }
+
+  for (int iz = de[2]; iz <= ate[2]; iz++) {
+    for (int iy = de[1]; iy <= ate[1]; iy++) {
+      for (int ix = de[0]; ix <= ate[0]; ix++) {
+        noctree* raiz = &of->fragmentos[indiceDoFragmento(of, ix, iy, iz)].raiz;
+        if (raiz->modo == NOCTREE_MODO_QUANTIZADO) {
+          copiaDoFragmentoQuantizado(raiz, centro, raio, &copias, &qtCopias, &capacidadeCopias);
+        } else {
+          passoDaBuscaPorRegiao(raiz, centro, raio * raio, &resultados, qt_encontrados, &capacidade);
+        }
+      }
+    }
+  }
+
+  /* Tira o espaço livre do vetor. As cópias dos fragmentos compactados vão no mesmo bloco,
+   * depois dos ponteiros, como em  buscaPorRegiao : um  free  no vetor libera tudo. */
+  int qtPonteiros = *qt_encontrados;
+  *qt_encontrados += qtCopias;
+  if (*qt_encontrados > 0) {
+    resultados = realloc(resultados, sizeof(amostra*) * (*qt_encontrados) + sizeof(amostra) * qtCopias);
+    CHECK_MALLOC(resultados);
+    amostra* bloco = (amostra*)(resultados + *qt_encontrados);
+    memcpy(bloco, copias, sizeof(amostra) * qtCopias);
+    for (int i = 0; i < qtCopias; i++) resultados[qtPonteiros + i] = &bloco[i];
+  } else {
+    free(resultados);
+    resultados = NULL;
+  }
+  free(copias);
+  CONTA(consultas, 1);
+  CONTA(pontosDevolvidos, *qt_encontrados);
+
+  return resultados;
+}
+
+amostra** buscaNaFolhaFragmentada(octreeFragmentada* of, amostra* alvo, int* qt_encontrados) {
+  return buscaNaFolha(fragmentoDe(of, alvo), alvo, qt_encontrados);
+}
+
+void balancoOctreeFragmentada(octreeFragmentada* of, balancoFragmentos* saida) {
+  double soma = 0, soma2 = 0;
+
+  memset(saida, 0, sizeof(balancoFragmentos));
+  saida->qtFragmentos = of->qtFragmentos;
+  saida->minimo = -1;
+
+  for (int i = 0; i < of->qtFragmentos; i++) {
+    long long qt = atomic_load_explicit(&of->fragmentos[i].qtAmostras, memory_order_relaxed);
+    if (qt == 0) saida->qtVazios++;
+    if (saida->minimo < 0 || qt < saida->minimo) saida->minimo = qt;
+    if (qt > saida->maximo) saida->maximo = qt;
+    soma += qt;
+    soma2 += (double) qt * qt;
+  }
+
+  saida->media = soma / of->qtFragmentos;
+  saida->desvio = sqrt(fmax(0, soma2 / of->qtFragmentos - saida->media * saida->media));
+  saida->desequilibrio = (saida->media > 0) ? saida->maximo / saida->media : 0;
+}
+
+void destroiOctreeFragmentada(octreeFragmentada* of) {
+  if (of == NULL) return;
+
+  for (int i = 0; i < of->qtFragmentos; i++) {
+    esvaziaNo(&of->fragmentos[i].raiz);
+  }
+  free(of->fragmentos);
+  free(of->centro);
+  free(of);
+}
@@ -0,0 +1,108 @@
+/* Octree fragmentada: a raiz já nasce subdividida até a profundidade k.
+ *
+ * Na Octree comum, toda inserção e toda busca passam pelo rwlock da raiz e dos
+ * primeiros níveis, e essas linhas de cache ficam pulando entre os núcleos. Aqui,
+ * os 8^k nós da profundidade k viram raízes independentes (fragmentos), cada uma na
+ * sua própria linha de cache, e o fragmento de uma amostra é calculado direto das
+ * coordenadas, sem passar por lock nenhum. Escritores em fragmentos diferentes não
+ * compartilham nada.
+ *
+ * Cada fragmento é um noctree comum com profundidade k: o limite de profundidade
+ * das folhas é o mesmo da árvore não fragmentada.
+ *
+ * Exemplo:
+ *    octreeFragmentada* of = inicializaOctreeFragmentada(inicializaAmostra(0,0,0), (float[]){100,100,100}, 2);
+ *    insereAmostraFragmentada(of, inicializaAmostra(1, 2, 3));
+ *    amostra** res = buscaPorRegiaoFragmentada(of, &centro, 5, &qt);
+ *    destroiOctreeFragmentada(of);
+*/
+
+#ifndef FRAGMENTADA_H
+#define FRAGMENTADA_H
+
+#include "noctree.h"
+#include <stdatomic.h>
+
+/* Maior k aceito: 8^4 = 4096 fragmentos */
+#define FRAGMENTADA_MAX_K          4
+
+/**
+ * Um fragmento: a raiz de uma subárvore, alinhada e preenchida até a linha de cache,
+ * para que o lock de um fragmento não divida linha com o de outro.
+ */
+typedef struct _Fragmento {
+  _Alignas(TAM_LINHA_CACHE) noctree raiz;
+  _Atomic long long qtAmostras;        // Inserções neste fragmento
+} fragmento;
+
+/**
+ * A árvore fragmentada.
+ */
+typedef struct _OctreeFragmentada {
+  amostra* centro;                     // Centro do cubo todo
+  float tamanho[DIM];                  // Arestas do cubo todo
+  float minimo[DIM];                   // Canto mínimo do cubo
+  int k;                               // Profundidade da fragmentação
+  int lado;                            // Fragmentos por eixo (2^k)
+  int qtFragmentos;                    // lado^3 = 8^k
+  fragmento* fragmentos;               // Índice: ix + lado * (iy + lado * iz)
+} octreeFragmentada;
+
+/**
+ * Balanço das amostras entre os fragmentos.
+ */
+typedef struct _BalancoFragmentos {
+  int qtFragmentos;
+  int qtVazios;
+  long long minimo, maximo;            // Amostras no fragmento menos e mais cheio
+  double media, desvio;
+  double desequilibrio;                // maximo / media (1 = perfeitamente balanceado)
+} balancoFragmentos;
+
+/**
+ * Cria a árvore já fragmentada em 8^k raízes independentes.
+ *
+ * @param centro É o centro do cubo (passa a pertencer à árvore; é liberado se  k  é inválido).
+ * @param tamanho Vetor com as dimensões do cubo em X, Y e Z.
+ * @param k É a profundidade da fragmentação, de 0 (um fragmento só) a FRAGMENTADA_MAX_K.
+ *
+ * @return a árvore, ou NULL se  k  é inválido.
+ */
+octreeFragmentada* inicializaOctreeFragmentada(amostra* centro, float* tamanho, int k);
+
+/**
+ * Devolve o fragmento (a raiz da subárvore) onde cai um ponto. Pontos fora do cubo
+ * vão para o fragmento da borda mais próxima, como na árvore comum.
+ */
+noctree* fragmentoDe(octreeFragmentada* of, amostra* ponto);
+
+/**
+ * Insere uma amostra no seu fragmento.
+ *
+ * @return 1, se ok
+ *         0, c.c.
+ */
+int insereAmostraFragmentada(octreeFragmentada* of, amostra* ponto);
+
+/**
+ * Busca amostras em uma região. Só visita os fragmentos que a esfera pode tocar.
+ * Mesmo contrato de  buscaPorRegiao .
+ */
+amostra** buscaPorRegiaoFragmentada(octreeFragmentada* of, amostra* centro, float raio, int* qt_encontrados);
+
+/**
+ * Busca as amostras da folha onde o alvo cairia. Mesmo contrato de  buscaNaFolha .
+ */
+amostra** buscaNaFolhaFragmentada(octreeFragmentada* of, amostra* alvo, int* qt_encontrados);
+
+/**
+ * Calcula o balanço das amostras entre os fragmentos.
+ */
+void balancoOctreeFragmentada(octreeFragmentada* of, balancoFragmentos* saida);
+
+/**
+ * Destrói a árvore e todas as amostras.
+ */
+void destroiOctreeFragmentada(octreeFragmentada* of);
+
+#endif
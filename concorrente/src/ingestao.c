@@ -0,0 +1,287 @@
+/**
+ * @file ingestao.c
+ *
+ * Pipeline de ingestão: fonte -> [pacotes] -> decodificadores -> [lotes] -> inseridores.
+ * As duas filas são limitadas; pacotes e lotes são pré-alocados e reciclados por
+ * filas de livres, então a fonte sente contrapressão quando a árvore não dá vazão.
+ * Para ver a documentação, consulte o header.
+ */
+
+#include "ingestao.h"
+#include <sched.h>
+#include <time.h>
+
+/* Relógio monotônico em segundos */
+static double agora(void) {
+  struct timespec t;
+  clock_gettime(CLOCK_MONOTONIC, &t);
+  return t.tv_sec + t.tv_nsec / 1000000000.0;
+}
+
+/* Registra a profundidade observada de uma fila */
+static void registraProfundidade(fila* f, atomic_llong* soma, atomic_llong* qt, atomic_size_t* max) {
+  size_t prof = tamanhoFila(f) + 1; // +1: o elemento que acabou de sair
+  atomic_fetch_add_explicit(soma, (long long)prof, memory_order_relaxed);
+  atomic_fetch_add_explicit(qt, 1, memory_order_relaxed);
+
+  size_t atual = atomic_load_explicit(max, memory_order_relaxed);
+  while (prof > atual &&
+         !atomic_compare_exchange_weak_explicit(max, &atual, prof, memory_order_relaxed, memory_order_relaxed));
+}
+
+/* Enfileira esperando por espaço. Cada espera conta como um evento de contrapressão. */
+static void enfileiraBloqueante(ingestao* ing, fila* f, void* dado) {
+  if (enfileira(f, dado)) return;
+
+  atomic_fetch_add_explicit(&ing->esperasContrapressao, 1, memory_order_relaxed);
+  while (!enfileira(f, dado)) {
+    sched_yield();
+  }
+}
+
+/* Desenfileira esperando por um elemento */
+static void* desenfileiraBloqueante(fila* f) {
+  void* dado;
+  while (!desenfileira(f, &dado)) {
+    sched_yield();
+  }
+  return dado;
+}
+
+amostra* decodificaRetorno(const float* origem, const retorno* r) {
+  float cosEl = cosf(r->elevacao);
+  return inicializaAmostra(origem[0] + r->distancia * cosEl * cosf(r->azimute),
+                           origem[1] + r->distancia * cosEl * sinf(r->azimute),
+                           origem[2] + r->distancia * sinf(r->elevacao));
+}
+
+/* Rotina das threads decodificadoras */
+static void* rotinaDecodificadora(void* arg) {
+  ingestao* ing = (ingestao*) arg;
+  lote* atual = (lote*) desenfileiraBloqueante(ing->lotesLivres);
+  atual->qtAmostras = 0;
+
+  for (;;) {
+    /* Lê o fim ANTES de tentar consumir: se a fonte já acabou e a fila está vazia, acabou mesmo */
+    int fim = atomic_load(&ing->fimDaFonte);
+    void* dado;
+
+    if (!desenfileira(ing->pacotesCheios, &dado)) {
+      if (fim) break;
+      sched_yield();
+      continue;
+    }
+    registraProfundidade(ing->pacotesCheios, &ing->somaProfPacotes, &ing->amostrasProfPacotes, &ing->maxProfPacotes);
+
+    pacote* p = (pacote*) dado;
+    for (int i = 0; i < p->qtRetornos; i++) {
+      if (p->retornos[i].distancia <= 0) continue; // Sem eco
+
+      atual->amostras[atual->qtAmostras++] = decodificaRetorno(p->origem, &p->retornos[i]);
+
+      if (atual->qtAmostras == INGESTAO_TAMANHO_LOTE) { // Lote cheio -> entrega
+        enfileiraBloqueante(ing, ing->lotesCheios, atual);
+        atual = (lote*) desenfileiraBloqueante(ing->lotesLivres);
+        atual->qtAmostras = 0;
+      }
+    }
+
+    /* Devolve o pacote para a fonte. Nunca enche: há tantas vagas quanto pacotes. */
+    enfileiraBloqueante(ing, ing->pacotesLivres, p);
+    atomic_fetch_add_explicit(&ing->qtPacotes, 1, memory_order_relaxed);
+  }
+
+  /* Entrega o lote parcial */
+  if (atual->qtAmostras > 0) {
+    enfileiraBloqueante(ing, ing->lotesCheios, atual);
+  } else {
+    enfileiraBloqueante(ing, ing->lotesLivres, atual);
+  }
+
+  atomic_fetch_sub(&ing->decodificadoresAtivos, 1);
+  return NULL;
+}
+
+/* Rotina das threads inseridoras */
+static void* rotinaInseridora(void* arg) {
+  ingestao* ing = (ingestao*) arg;
+
+  for (;;) {
+    int fim = (atomic_load(&ing->decodificadoresAtivos) == 0);
+    void* dado;
+
+    if (!desenfileira(ing->lotesCheios, &dado)) {
+      if (fim) break;
+      sched_yield();
+      continue;
+    }
+    registraProfundidade(ing->lotesCheios, &ing->somaProfLotes, &ing->amostrasProfLotes, &ing->maxProfLotes);
+
+    /* Amostra recusada (árvore congelada, ou num modo sem amostras) continua sendo nossa */
+    lote* l = (lote*) dado;
+    long long inseridas = 0;
+    for (int i = 0; i < l->qtAmostras; i++) {
+      if (insereAmostra(ing->raiz, l->amostras[i])) {
+        inseridas++;
+      } else {
+        free(l->amostras[i]);
+      }
+    }
+    atomic_fetch_add_explicit(&ing->qtAmostras, inseridas, memory_order_relaxed);
+
+    l->qtAmostras = 0;
+    enfileiraBloqueante(ing, ing->lotesLivres, l);
+  }
+
+  return NULL;
+}
+
+ingestao* iniciaIngestao(noctree* raiz, configIngestao* cfg) {
+  ingestao* ing = (ingestao*) malloc(sizeof(ingestao));
+  CHECK_MALLOC(ing);
+
+  /* Configuração, com os padrões onde não foi especificado */
+  ing->raiz = raiz;
+  ing->cfg.qtDecodificadores = (cfg && cfg->qtDecodificadores > 0) ? cfg->qtDecodificadores : 1;
+  ing->cfg.qtInseridores     = (cfg && cfg->qtInseridores > 0)     ? cfg->qtInseridores     : 1;
+  ing->cfg.capacidadeFila    = (cfg && cfg->capacidadeFila > 0)    ? cfg->capacidadeFila    : INGESTAO_CAPACIDADE_FILA;
+
+  int qtPacotes = ing->cfg.capacidadeFila;
+  int qtLotes   = ing->cfg.capacidadeFila + ing->cfg.qtDecodificadores; // Cada decodificador segura um lote aberto
+
+  /* Memória reciclada */
+  ing->memPacotes = (pacote*) malloc(sizeof(pacote) * qtPacotes);
+  CHECK_MALLOC(ing->memPacotes);
+  ing->memLotes = (lote*) malloc(sizeof(lote) * qtLotes);
+  CHECK_MALLOC(ing->memLotes);
+
+  ing->pacotesLivres = inicializaFila(qtPacotes);
+  ing->pacotesCheios = inicializaFila(qtPacotes);
+  ing->lotesLivres   = inicializaFila(qtLotes);
+  ing->lotesCheios   = inicializaFila(qtLotes);
+
+  for (int i = 0; i < qtPacotes; i++) enfileira(ing->pacotesLivres, &ing->memPacotes[i]);
+  for (int i = 0; i < qtLotes; i++) {
+    ing->memLotes[i].qtAmostras = 0;
+    enfileira(ing->lotesLivres, &ing->memLotes[i]);
+  }
+
+  /* Contadores */
+  atomic_init(&ing->fimDaFonte, 0);
+  atomic_init(&ing->decodificadoresAtivos, ing->cfg.qtDecodificadores);
+  atomic_init(&ing->qtPacotes, 0);
+  atomic_init(&ing->qtAmostras, 0);
+  atomic_init(&ing->esperasContrapressao, 0);
+  atomic_init(&ing->somaProfPacotes, 0);
+  atomic_init(&ing->amostrasProfPacotes, 0);
+  atomic_init(&ing->somaProfLotes, 0);
+  atomic_init(&ing->amostrasProfLotes, 0);
+  atomic_init(&ing->maxProfPacotes, 0);
+  atomic_init(&ing->maxProfLotes, 0);
+
+  ing->inicio = agora();
+
+  /* Dispara as threads */
+  ing->decodificadores = (pthread_t*) malloc(sizeof(pthread_t) * ing->cfg.qtDecodificadores);
+  CHECK_MALLOC(ing->decodificadores);
+  ing->inseridores = (pthread_t*) malloc(sizeof(pthread_t) * ing->cfg.qtInseridores);
+  CHECK_MALLOC(ing->inseridores);
+
+  for (int t = 0; t < ing->cfg.qtDecodificadores; t++) {
+    if (pthread_create(&ing->decodificadores[t], NULL, rotinaDecodificadora, ing)) {
+      LOG_ERROR(ERRO_THREAD, "Falha ao criar a thread decodificadora %d", t);
+    }
+  }
+  for (int t = 0; t < ing->cfg.qtInseridores; t++) {
+    if (pthread_create(&ing->inseridores[t], NULL, rotinaInseridora, ing)) {
+      LOG_ERROR(ERRO_THREAD, "Falha ao criar a thread inseridora %d", t);
+    }
+  }
+
+  return ing;
+}
+
+pacote* obtemPacoteLivre(ingestao* ing) {
+  void* dado;
+  if (desenfileira(ing->pacotesLivres, &dado)) return (pacote*) dado;
+
+  /* Todos os pacotes estão em trânsito -> a fonte espera */
+  atomic_fetch_add_explicit(&ing->esperasContrapressao, 1, memory_order_relaxed);
+  return (pacote*) desenfileiraBloqueante(ing->pacotesLivres);
+}
+
+void submetePacote(ingestao* ing, pacote* p) {
+  enfileiraBloqueante(ing, ing->pacotesCheios, p);
+}
+
+long long reproduzArquivo(ingestao* ing, const char* caminho) {
+  FILE* arq = fopen(caminho, "rb");
+  if (arq == NULL) return -1;
+
+  long long qt = 0;
+  for (;;) {
+    pacote* p = obtemPacoteLivre(ing);
+    int32_t qtRetornos;
+
+    if (fread(p->origem, sizeof(float), DIM, arq) != DIM ||
+        fread(&qtRetornos, sizeof(int32_t), 1, arq) != 1 ||
+        qtRetornos < 0 || qtRetornos > PACOTE_MAX_RETORNOS ||
+        fread(p->retornos, sizeof(retorno), qtRetornos, arq) != (size_t) qtRetornos) {
+      /* Fim do arquivo (ou pacote truncado): devolve o pacote sem uso */
+      enfileira(ing->pacotesLivres, p);
+      break;
+    }
+
+    p->qtRetornos = qtRetornos;
+    submetePacote(ing, p);
+    qt++;
+  }
+
+  fclose(arq);
+  return qt;
+}
+
+void finalizaIngestao(ingestao* ing, estatisticasIngestao* saida) {
+  atomic_store(&ing->fimDaFonte, 1);
+
+  for (int t = 0; t < ing->cfg.qtDecodificadores; t++) {
+    pthread_join(ing->decodificadores[t], NULL);
+  }
+  for (int t = 0; t < ing->cfg.qtInseridores; t++) {
+    pthread_join(ing->inseridores[t], NULL);
+  }
+
+  double tempo = agora() - ing->inicio;
+
+  if (saida != NULL) {
+    long long amPac = atomic_load(&ing->amostrasProfPacotes);
+    long long amLot = atomic_load(&ing->amostrasProfLotes);
+
+    saida->qtPacotes  = atomic_load(&ing->qtPacotes);
+    saida->qtAmostras = atomic_load(&ing->qtAmostras);
+    saida->tempo      = tempo;
+    saida->amostrasPorSegundo   = (tempo > 0) ? saida->qtAmostras / tempo : 0;
+    saida->profMediaFilaPacotes = amPac ? (double) atomic_load(&ing->somaProfPacotes) / amPac : 0;
+    saida->profMaxFilaPacotes   = atomic_load(&ing->maxProfPacotes);
+    saida->profMediaFilaLotes   = amLot ? (double) atomic_load(&ing->somaProfLotes) / amLot : 0;
+    saida->profMaxFilaLotes     = atomic_load(&ing->maxProfLotes);
+    saida->esperasContrapressao = atomic_load(&ing->esperasContrapressao);
+  }
+
+  destroiFila(ing->pacotesLivres);
+  destroiFila(ing->pacotesCheios);
+  destroiFila(ing->lotesLivres);
+  destroiFila(ing->lotesCheios);
+  free(ing->memPacotes);
+  free(ing->memLotes);
+  free(ing->decodificadores);
+  free(ing->inseridores);
+  free(ing);
+}
+
+int gravaPacote(FILE* arq, const pacote* p) {
+  int32_t qtRetornos = p->qtRetornos;
+  return fwrite(p->origem, sizeof(float), DIM, arq) == DIM &&
+         fwrite(&qtRetornos, sizeof(int32_t), 1, arq) == 1 &&
+         fwrite(p->retornos, sizeof(retorno), qtRetornos, arq) == (size_t) qtRetornos;
+}
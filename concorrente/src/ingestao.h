@@ -0,0 +1,147 @@
+#ifndef INGESTAO_H
+#define INGESTAO_H
+
+#include "system.h"
+#include "noctree.h"
+#include "fila.h"
+
+/* Máximo de retornos que cabem em um pacote do sensor */
+#define PACOTE_MAX_RETORNOS      384
+
+/* Valores padrão do pipeline de ingestão */
+#define INGESTAO_CAPACIDADE_FILA 256 // Pacotes em trânsito (e lotes em trânsito)
+#define INGESTAO_TAMANHO_LOTE    512 // Amostras por lote entregue aos inseridores
+
+/**
+ * Um retorno do LIDAR, em coordenadas esféricas relativas ao sensor.
+ * Retornos com  distancia <= 0  não tiveram eco e são descartados.
+ */
+typedef struct _Retorno {
+  float distancia;
+  float azimute;                       // Em radianos, no plano XY
+  float elevacao;                      // Em radianos, a partir do plano XY
+} retorno;
+
+/**
+ * Pacote como chega do sensor: a posição do sensor e uma rajada de retornos.
+ */
+typedef struct _Pacote {
+  float origem[DIM];                   // Posição do sensor no referencial da árvore
+  int qtRetornos;                      // Quantidade de retornos válidos em  retornos
+  retorno retornos[PACOTE_MAX_RETORNOS];
+} pacote;
+
+/**
+ * Lote de amostras decodificadas, pronto para ser inserido na árvore.
+ */
+typedef struct _Lote {
+  int qtAmostras;
+  amostra* amostras[INGESTAO_TAMANHO_LOTE];
+} lote;
+
+/**
+ * Configuração do pipeline. Campos zerados assumem o valor padrão.
+ */
+typedef struct _ConfigIngestao {
+  int qtDecodificadores;               // Threads que transformam pacotes em amostras
+  int qtInseridores;                   // Threads que aplicam os lotes na árvore
+  int capacidadeFila;                  // Pacotes (e lotes) em trânsito antes de haver contrapressão
+} configIngestao;
+
+/**
+ * Estatísticas de uma execução do pipeline.
+ */
+typedef struct _EstatisticasIngestao {
+  long long qtPacotes;                 // Pacotes decodificados
+  long long qtAmostras;                // Amostras inseridas na árvore (as recusadas são liberadas e não contam)
+  double tempo;                        // Segundos entre o início e o fim da ingestão
+  double amostrasPorSegundo;           // Vazão sustentada
+  double profMediaFilaPacotes;         // Profundidade média da fila de pacotes (amostrada a cada consumo)
+  size_t profMaxFilaPacotes;           // Profundidade máxima observada
+  double profMediaFilaLotes;
+  size_t profMaxFilaLotes;
+  long long esperasContrapressao;      // Vezes em que um produtor esperou por espaço
+} estatisticasIngestao;
+
+/**
+ * Estado de um pipeline de ingestão em execução.
+ */
+typedef struct _Ingestao {
+  noctree* raiz;
+  configIngestao cfg;
+
+  pacote* memPacotes;                  // Pacotes pré-alocados e reciclados pelas filas
+  lote* memLotes;                      // Idem para os lotes
+  fila* pacotesLivres;
+  fila* pacotesCheios;
+  fila* lotesLivres;
+  fila* lotesCheios;
+
+  pthread_t* decodificadores;
+  pthread_t* inseridores;
+  atomic_int fimDaFonte;               // 1 quando não virão mais pacotes
+  atomic_int decodificadoresAtivos;    // Inseridores só encerram quando chega a 0
+
+  /* Contadores agregados pelas threads */
+  atomic_llong qtPacotes;
+  atomic_llong qtAmostras;
+  atomic_llong esperasContrapressao;
+  atomic_llong somaProfPacotes, amostrasProfPacotes;
+  atomic_llong somaProfLotes, amostrasProfLotes;
+  atomic_size_t maxProfPacotes, maxProfLotes;
+
+  double inicio;
+} ingestao;
+
+/**
+ * Cria as filas e dispara as threads decodificadoras e inseridoras.
+ *
+ * @param raiz É a árvore que receberá as amostras (via  insereAmostra ).
+ * @param cfg É a configuração do pipeline (pode ser NULL para usar os padrões).
+ *
+ * @return O pipeline em execução.
+ */
+ingestao* iniciaIngestao(noctree* raiz, configIngestao* cfg);
+
+/**
+ * Obtém um pacote livre para ser preenchido pela fonte.
+ * Bloqueia enquanto não há pacote livre (contrapressão).
+ */
+pacote* obtemPacoteLivre(ingestao* ing);
+
+/**
+ * Entrega um pacote preenchido aos decodificadores.
+ * Pode ser chamada por várias fontes ao mesmo tempo.
+ */
+void submetePacote(ingestao* ing, pacote* p);
+
+/**
+ * Fonte de reprodução: lê pacotes de um arquivo gravado com  gravaPacote  e os
+ * submete, no lugar do sensor real. Executa na thread chamadora.
+ *
+ * @return quantidade de pacotes reproduzidos, ou -1 se o arquivo não pôde ser lido.
+ */
+long long reproduzArquivo(ingestao* ing, const char* caminho);
+
+/**
+ * Sinaliza o fim da fonte, espera o pipeline esvaziar, junta as threads e libera
+ * o pipeline.
+ *
+ * @param saida Se não for NULL, recebe as estatísticas da execução.
+ */
+void finalizaIngestao(ingestao* ing, estatisticasIngestao* saida);
+
+/**
+ * Grava um pacote no formato binário lido por  reproduzArquivo .
+ *
+ * @return 1, se ok
+ *         0, c.c.
+ */
+int gravaPacote(FILE* arq, const pacote* p);
+
+/**
+ * Converte um retorno em amostra no referencial da árvore.
+ */
+amostra* decodificaRetorno(const float* origem, const retorno* r);
+
+#endif
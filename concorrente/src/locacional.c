@@ -0,0 +1,347 @@
+/**
+ * @file locacional.c
+ *
+ * Índice dos nós por código de Morton. Para ver a documentação, consulte o header.
+ */
+
+#include "locacional.h"
+
+/* Um nó com o seu código */
+typedef struct {
+  uint64_t codigo;
+  noctree* no;
+} parCodigo;
+
+typedef struct {
+  parCodigo* pares;
+  long long qt, capacidade;
+} vetorPares;
+
+/* Uma tarefa: a subárvore a percorrer e o vetor dos seus nós, depois inseridos na tabela */
+typedef struct {
+  indiceLocacional* ind;
+  parCodigo raiz;
+  vetorPares nos;
+  long long novos;
+} argLocacional;
+
+
+/* Tabela
+ * ------ */
+
+/* Insere (ou reescreve) um código sem lock. Devolve 1 se a entrada é nova. */
+static int insereNaTabela(indiceLocacional* ind, uint64_t codigo, noctree* no) {
+  long long mascara = ind->capacidade - 1;
+  for (long long i = (long long) (mistura(codigo) & mascara);; i = (i + 1) & mascara) {
+    entradaLocacional* e = &ind->entradas[i];
+    uint64_t atual = atomic_load(&e->codigo);
+    if (atual == 0) {
+      uint64_t vazio = 0;
+      if (atomic_compare_exchange_strong(&e->codigo, &vazio, codigo)) {
+        atomic_store(&e->no, no);
+        return 1;
+      }
+      atual = vazio; // Outra tarefa pegou a entrada antes
+    }
+    if (atual == codigo) {
+      atomic_store(&e->no, no);
+      return 0;
+    }
+  }
+}
+
+noctree* noPorCodigo(indiceLocacional* ind, uint64_t codigo) {
+  long long mascara = ind->capacidade - 1;
+  for (long long i = (long long) (mistura(codigo) & mascara);; i = (i + 1) & mascara) {
+    uint64_t atual = atomic_load(&ind->entradas[i].codigo);
+    if (atual == codigo) return atomic_load(&ind->entradas[i].no); // NULL se a inserção ainda não terminou
+    if (atual == 0) return NULL;
+  }
+}
+
+
+/* Indexação
+ * --------- */
+
+static void acrescentaPar(vetorPares* v, uint64_t codigo, noctree* no) {
+  if (v->qt == v->capacidade) {
+    v->capacidade = (v->capacidade > 0) ? v->capacidade * 2 : 1024;
+    v->pares = (parCodigo*) realloc(v->pares, sizeof(parCodigo) * v->capacidade);
+    CHECK_MALLOC(v->pares);
+  }
+  v->pares[v->qt++] = (parCodigo){codigo, no};
+}
+
+static void coletaNos(noctree* no, uint64_t codigo, vetorPares* v) {
+  acrescentaPar(v, codigo, no);
+
+  int travou = travaLeitura(no);
+  int subdividido = no->subdividido;
+  destravaLeitura(no, travou);
+  if (!subdividido) return;
+
+  for (int i = 0; i < QT_FILHOS_NOCTREE; i++) coletaNos(no->filhos[i], (codigo << DIM) | (uint64_t) i, v);
+}
+
+static void tarefaColeta(void* arg) {
+  argLocacional* a = (argLocacional*) arg;
+  coletaNos(a->raiz.no, a->raiz.codigo, &a->nos);
+}
+
+static void tarefaInsercao(void* arg) {
+  argLocacional* a = (argLocacional*) arg;
+  for (long long i = 0; i < a->nos.qt; i++) a->novos += insereNaTabela(a->ind, a->nos.pares[i].codigo, a->nos.pares[i].no);
+}
+
+/* Coleta os nós em tarefas (uma por subárvore da fronteira), cresce a tabela se preciso e
+ * insere em tarefas. Devolve quantos nós entraram. */
+static long long indexa(indiceLocacional* ind) {
+  long long antes = atomic_load(&ind->qt);
+  poolTarefas* pool = poolPadrao();
+  int alvo = (pool->qtTrabalhadores + 1) * PARALELO_SUBARVORES_POR_TRABALHADOR;
+
+  /* Desce a parte de cima até haver subárvores para todos; os nós de cima vão direto */
+  vetorPares cima = {NULL, 0, 0};
+  long long qtFronteira = 1;
+  parCodigo* fronteira = (parCodigo*) malloc(sizeof(parCodigo));
+  CHECK_MALLOC(fronteira);
+  fronteira[0] = (parCodigo){1, ind->raiz};
+
+  int desceu = 1;
+  while (qtFronteira < alvo && desceu) {
+    parCodigo* proxima = (parCodigo*) malloc(sizeof(parCodigo) * qtFronteira * QT_FILHOS_NOCTREE);
+    CHECK_MALLOC(proxima);
+    long long qtProxima = 0;
+
+    desceu = 0;
+    for (long long i = 0; i < qtFronteira; i++) {
+      noctree* no = fronteira[i].no;
+      int travou = travaLeitura(no);
+      int subdividido = no->subdividido;
+      destravaLeitura(no, travou);
+
+      if (subdividido) {
+        acrescentaPar(&cima, fronteira[i].codigo, no);
+        for (int k = 0; k < QT_FILHOS_NOCTREE; k++) {
+          proxima[qtProxima++] = (parCodigo){(fronteira[i].codigo << DIM) | (uint64_t) k, no->filhos[k]};
+        }
+        desceu = 1;
+      } else {
+        proxima[qtProxima++] = fronteira[i];
+      }
+    }
+    free(fronteira);
+    fronteira = proxima;
+    qtFronteira = qtProxima;
+  }
+
+  /* 1. Coleta: uma tarefa por subárvore */
+  argLocacional* args = (argLocacional*) calloc(qtFronteira + 1, sizeof(argLocacional));
+  CHECK_MALLOC(args);
+  grupoTarefas g;
+  iniciaGrupo(&g);
+  for (long long i = 0; i < qtFronteira; i++) {
+    args[i] = (argLocacional){ind, fronteira[i], {NULL, 0, 0}, 0};
+    submeteTarefa(pool, &g, tarefaColeta, &args[i]);
+  }
+  esperaGrupo(pool, &g);
+  args[qtFronteira] = (argLocacional){ind, {0, NULL}, cima, 0};
+
+  /* 2. A tabela cresce se os nós não cabem na carga máxima (e aí é refeita do zero, com todos) */
+  long long total = 0;
+  for (long long i = 0; i <= qtFronteira; i++) total += args[i].nos.qt;
+  if (total * 100 > ind->capacidade * LOCACIONAL_CARGA_MAXIMA) {
+    long long capacidade = 64;
+    while (total * 100 > capacidade * LOCACIONAL_CARGA_MAXIMA) capacidade *= 2;
+    free(ind->entradas);
+    ind->entradas = (entradaLocacional*) calloc(capacidade, sizeof(entradaLocacional));
+    CHECK_MALLOC(ind->entradas);
+    ind->capacidade = capacidade;
+    atomic_store(&ind->qt, 0);
+  }
+
+  /* 3. Inserção: as mesmas tarefas, ao mesmo tempo na tabela */
+  iniciaGrupo(&g);
+  for (long long i = 0; i <= qtFronteira; i++) submeteTarefa(pool, &g, tarefaInsercao, &args[i]);
+  esperaGrupo(pool, &g);
+
+  long long novos = 0;
+  for (long long i = 0; i <= qtFronteira; i++) {
+    novos += args[i].novos;
+    free(args[i].nos.pares);
+  }
+  atomic_fetch_add(&ind->qt, novos);
+
+  free(args);
+  free(fronteira);
+  return atomic_load(&ind->qt) - antes; // Se a tabela foi refeita, os que já estavam entraram de novo
+}
+
+
+/* Códigos
+ * ------- */
+
+int nivelDoCodigo(uint64_t codigo) {
+  return (63 - __builtin_clzll(codigo)) / DIM;
+}
+
+uint64_t codigoDoPonto(indiceLocacional* ind, amostra* ponto, int nivel) {
+  float centro[DIM] = {ind->raiz->centro->x, ind->raiz->centro->y, ind->raiz->centro->z};
+  float tamanho[DIM];
+  memcpy(tamanho, ind->raiz->tamanho, sizeof(tamanho));
+
+  /* Mesmas contas de  subdividir , para as células coincidirem com os nós */
+  uint64_t codigo = 1;
+  for (int n = 0; n < nivel; n++) {
+    int o = 0;
+    if (ponto->x >= centro[0]) o += 1;
+    if (ponto->y >= centro[1]) o += 2;
+    if (ponto->z >= centro[2]) o += 4;
+    codigo = (codigo << DIM) | (uint64_t) o;
+
+    for (int d = 0; d < DIM; d++) tamanho[d] = tamanho[d] / 2.0f;
+    centroDoOctante(centro, tamanho, o, centro);
+  }
+  return codigo;
+}
+
+/* O nó mais fundo no caminho até a célula  alvo : busca binária sobre o nível (os prefixos
+ * de  alvo  indexados vão da raiz até algum nível) e, se o índice está atrasado, descida
+ * pelos filhos a partir dali, sem passar do nível do alvo */
+static noctree* noMaisFundo(indiceLocacional* ind, uint64_t alvo, uint64_t* achado) {
+  int nivelAlvo = nivelDoCodigo(alvo);
+  int baixo = 0, alto = nivelAlvo;
+  noctree* no = ind->raiz;
+  while (baixo < alto) {
+    int meio = (baixo + alto + 1) / 2;
+    noctree* n = noPorCodigo(ind, alvo >> (DIM * (nivelAlvo - meio)));
+    if (n != NULL) {
+      baixo = meio;
+      no = n;
+    } else {
+      alto = meio - 1;
+    }
+  }
+
+  while (baixo < nivelAlvo) {
+    int travou = travaLeitura(no);
+    int subdividido = no->subdividido;
+    destravaLeitura(no, travou);
+    if (!subdividido) break;
+
+    baixo++;
+    no = no->filhos[(alvo >> (DIM * (nivelAlvo - baixo))) & 7];
+  }
+
+  if (achado) *achado = alvo >> (DIM * (nivelAlvo - baixo));
+  return no;
+}
+
+
+/* Consultas
+ * --------- */
+
+noctree* folhaDoPonto(indiceLocacional* ind, amostra* ponto, uint64_t* codigo) {
+  CONTA(consultas, 1);
+  return noMaisFundo(ind, codigoDoPonto(ind, ponto, ind->niveis), codigo);
+}
+
+noctree* vizinhoLocacional(indiceLocacional* ind, uint64_t codigo, int dx, int dy, int dz, uint64_t* codigoVizinho) {
+  int nivel = nivelDoCodigo(codigo);
+
+  /* Separa os índices da célula em cada eixo */
+  long long indice[DIM] = {0, 0, 0};
+  for (int k = 0; k < nivel; k++) {
+    int digito = (int) ((codigo >> (DIM * k)) & 7);
+    for (int d = 0; d < DIM; d++) indice[d] |= (long long) ((digito >> d) & 1) << k;
+  }
+
+  const int delta[DIM] = {dx, dy, dz};
+  for (int d = 0; d < DIM; d++) {
+    indice[d] += delta[d];
+    if (indice[d] < 0 || indice[d] >= (1LL << nivel)) return NULL;
+  }
+
+  /* E junta de novo */
+  uint64_t vizinho = 1;
+  for (int k = nivel - 1; k >= 0; k--) {
+    uint64_t digito = 0;
+    for (int d = 0; d < DIM; d++) digito |= (uint64_t) ((indice[d] >> k) & 1) << d;
+    vizinho = (vizinho << DIM) | digito;
+  }
+  return noMaisFundo(ind, vizinho, codigoVizinho);
+}
+
+static void acrescentaFolha(noctree*** folhas, int* qt, int* capacidade, noctree* folha) {
+  for (int i = 0; i < *qt; i++) {
+    if ((*folhas)[i] == folha) return; // Folha maior, vizinha por mais de um lado
+  }
+  if (*qt == *capacidade) {
+    *capacidade = (*capacidade > 0) ? *capacidade * 2 : 32;
+    *folhas = (noctree**) realloc(*folhas, sizeof(noctree*) * *capacidade);
+    CHECK_MALLOC(*folhas);
+  }
+  (*folhas)[(*qt)++] = folha;
+}
+
+/* Folhas de  no  do lado que encosta na célula de origem, que fica na direção  -delta  */
+static void coletaEncostadas(noctree* no, const int* delta, noctree*** folhas, int* qt, int* capacidade) {
+  int travou = travaLeitura(no);
+  int subdividido = no->subdividido;
+  destravaLeitura(no, travou);
+
+  if (!subdividido) {
+    acrescentaFolha(folhas, qt, capacidade, no);
+    return;
+  }
+  for (int k = 0; k < QT_FILHOS_NOCTREE; k++) {
+    int encosta = 1;
+    for (int d = 0; d < DIM; d++) {
+      if (delta[d] == 1) encosta &= !((k >> d) & 1);
+      if (delta[d] == -1) encosta &= (k >> d) & 1;
+    }
+    if (encosta) coletaEncostadas(no->filhos[k], delta, folhas, qt, capacidade);
+  }
+}
+
+int folhasVizinhas(indiceLocacional* ind, uint64_t codigo, noctree*** folhas) {
+  int qt = 0, capacidade = 0;
+  *folhas = NULL;
+
+  for (int dz = -1; dz <= 1; dz++)
+    for (int dy = -1; dy <= 1; dy++)
+      for (int dx = -1; dx <= 1; dx++) {
+        if (dx == 0 && dy == 0 && dz == 0) continue;
+        noctree* vizinho = vizinhoLocacional(ind, codigo, dx, dy, dz, NULL);
+        if (vizinho != NULL) coletaEncostadas(vizinho, (int[]){dx, dy, dz}, folhas, &qt, &capacidade);
+      }
+  return qt;
+}
+
+
+/* Interface
+ * --------- */
+
+indiceLocacional* criaIndiceLocacional(noctree* raiz) {
+  indiceLocacional* ind = (indiceLocacional*) malloc(sizeof(indiceLocacional));
+  CHECK_MALLOC(ind);
+  ind->raiz = raiz;
+  ind->niveis = NOCTREE_MAX_PROFUNDIDADE + 1 - raiz->profundidade;
+  if (ind->niveis < 0) ind->niveis = 0;
+  ind->entradas = NULL;
+  ind->capacidade = 0;
+  atomic_init(&ind->qt, 0);
+
+  indexa(ind);
+  return ind;
+}
+
+long long atualizaIndiceLocacional(indiceLocacional* ind) {
+  return indexa(ind);
+}
+
+void destroiIndiceLocacional(indiceLocacional* ind) {
+  if (ind == NULL) return;
+  free(ind->entradas);
+  free(ind);
+}
@@ -0,0 +1,128 @@
+/* Índice locacional: dos códigos de Morton dos nós para os nós.
+ *
+ * O código de um nó é o caminho da raiz até ele, 3 bits por nível (o octante, como nos
+ * filhos: x no bit 0, y no 1, z no 2), precedido de um bit 1 que marca o nível: a raiz é 1,
+ * o filho i da raiz é 8 + i, e assim por diante. Uma tabela hash de endereçamento aberto,
+ * preenchida sem lock por tarefas do  poolPadrao() , leva do código ao nó.
+ *
+ * Com ela, a folha de um ponto sai de uma busca binária sobre o nível (o código do ponto em
+ * cada nível é um prefixo do código na profundidade máxima), sem descer da raiz pegando um
+ * lock por nível; e os vizinhos de uma folha (face, aresta e vértice) saem de aritmética
+ * sobre o código.
+ *
+ * O índice não é atualizado pelas inserções: os nós criados depois (subdivisões, enxertos)
+ * só entram com  atualizaIndiceLocacional , e até lá as consultas descem normalmente a
+ * partir do nó mais fundo que conhecem, então continuam certas. O índice vale enquanto
+ * nenhum nó da árvore é liberado (ex.: poda do mapa de ocupação,  destroiNo ).
+ *
+ * Exemplo:
+ *    indiceLocacional* ind = criaIndiceLocacional(raiz);
+ *    uint64_t codigo;
+ *    noctree* folha = folhaDoPonto(ind, &p, &codigo);
+ *    noctree** vizinhas;
+ *    int qt = folhasVizinhas(ind, codigo, &vizinhas);
+ *    free(vizinhas);
+ *    destroiIndiceLocacional(ind);
+*/
+
+#ifndef LOCACIONAL_H
+#define LOCACIONAL_H
+
+#include "paralelo.h"
+#include <stdatomic.h>
+
+/* Ocupação máxima da tabela antes de crescer (em porcentagem) */
+#define LOCACIONAL_CARGA_MAXIMA   50
+
+/**
+ * Uma entrada da tabela: código 0 é entrada vazia (nenhum código válido é 0).
+ */
+typedef struct _EntradaLocacional {
+  _Atomic uint64_t codigo;
+  noctree* _Atomic no;
+} entradaLocacional;
+
+/**
+ * O índice de uma árvore.
+ */
+typedef struct _IndiceLocacional {
+  noctree* raiz;
+  int niveis;                          // Níveis abaixo da raiz até a profundidade máxima da árvore
+  entradaLocacional* entradas;
+  long long capacidade;                // Potência de 2
+  _Atomic long long qt;                // Nós indexados
+} indiceLocacional;
+
+/**
+ * Indexa os nós da árvore.
+ *
+ * @param raiz é a raiz da (sub)árvore; os códigos são relativos a ela
+ *
+ * @return o índice (libere com  destroiIndiceLocacional )
+ */
+indiceLocacional* criaIndiceLocacional(noctree* raiz);
+
+/**
+ * Acrescenta os nós criados desde a última indexação. Ninguém pode consultar o índice
+ * enquanto isso (a tabela pode crescer).
+ *
+ * @return quantos nós entraram
+ */
+long long atualizaIndiceLocacional(indiceLocacional* ind);
+
+/**
+ * Libera o índice (a árvore não é tocada).
+ */
+void destroiIndiceLocacional(indiceLocacional* ind);
+
+/**
+ * Nível de um código (0 é a raiz).
+ */
+int nivelDoCodigo(uint64_t codigo);
+
+/**
+ * Código da célula de um ponto num nível, com as mesmas comparações da descida na árvore
+ * (os pontos fora do cubo caem nas células da borda).
+ *
+ * @param nivel vai de 0 a  ind->niveis
+ */
+uint64_t codigoDoPonto(indiceLocacional* ind, amostra* ponto, int nivel);
+
+/**
+ * O nó de um código.
+ *
+ * @return o nó, ou NULL se o código não está indexado
+ */
+noctree* noPorCodigo(indiceLocacional* ind, uint64_t codigo);
+
+/**
+ * A folha que contém um ponto (a mesma de  buscaNaFolha ).
+ *
+ * @param codigo, se não é NULL, recebe o código da folha
+ *
+ * @return a folha. Como em  buscaNaFolha , ela pode se subdividir depois (leia as amostras com o lock de leitura).
+ */
+noctree* folhaDoPonto(indiceLocacional* ind, amostra* ponto, uint64_t* codigo);
+
+/**
+ * O vizinho de um nó na direção (dx, dy, dz), cada um em {-1, 0, 1}: o nó do mesmo nível
+ * (que pode ser subdividido) ou, se não existe, a folha maior que cobre a célula.
+ *
+ * @param codigo é o código do nó
+ * @param codigoVizinho, se não é NULL, recebe o código do vizinho
+ *
+ * @return o vizinho, ou NULL se a célula fica fora do cubo da raiz
+ */
+noctree* vizinhoLocacional(indiceLocacional* ind, uint64_t codigo, int dx, int dy, int dz, uint64_t* codigoVizinho);
+
+/**
+ * As folhas que encostam no nó por face, aresta ou vértice, cada uma uma vez.
+ *
+ * @param codigo é o código do nó
+ * @param folhas recebe o vetor de folhas (libere com  free ; NULL se não há nenhuma)
+ *
+ * @return quantidade de folhas
+ */
+int folhasVizinhas(indiceLocacional* ind, uint64_t codigo, noctree*** folhas);
+
+#endif
@@ -29,7 +29,13 @@ noctree* inicializaNo(amostra* centro, float* tamanho, int profundidade) {
   /* Aloca a memória */
   noctree* no = (noctree*) malloc(sizeof(noctree));
   CHECK_MALLOC(no);
+  CONTA(bytesAlocados, sizeof(noctree));
 
+  preparaNo(no, centro, tamanho, profundidade);
+  return no;
+}
+
+void preparaNo(noctree* no, amostra* centro, float* tamanho, int profundidade) {
   /* Aloca o o vetor de amostras, mas não os pontos em si */
   no->pontos = (amostra**) malloc(sizeof(amostra*) * NOCTREE_CAPACIDADE);
   CHECK_MALLOC(no->pontos);
@@ -37,11 +43,18 @@ noctree* inicializaNo(amostra* centro, float* tamanho, int profundidade) {
   for (int i = 0; i < NOCTREE_CAPACIDADE; i++) {
     no->pontos[i] = NULL; /* Não aloca memória */
   }
+  CONTA(bytesAlocados, sizeof(amostra*) * NOCTREE_CAPACIDADE);
 
 
+  no->pontosQ      = NULL;         // Só é usado no modo quantizado
+  no->erroQ        = 0;            // Idem
+  no->qtCoordenadas = 0;           // Só é usado no modo índice
   no->qtPontos     = 0;            // Qt de amostras no vetor de amostras
+  no->capacidade   = NOCTREE_CAPACIDADE; // Tamanho alocado do vetor de amostras
   no->centro       = centro;       // Ponto que define o centroide do nó
   no->profundidade = profundidade; // Profundidade do nó na árvore
+  no->modo         = NOCTREE_MODO_PONTEIRO;
+  no->logOdds      = NAN;          // Só é usado no modo ocupação
 
   /* Configura os tamanhos em X,Y,Z */
   for(int i = 0; i < DIM; i++) {
@@ -50,16 +63,114 @@ noctree* inicializaNo(amostra* centro, float* tamanho, int profundidade) {
 
   /* Note que os filhos serão inicializados apenas quanto  subdividido == 1 */
   no->subdividido = 0;
+  no->congelado = 0;
   for (int i = 0; i < QT_FILHOS_NOCTREE; i++) {
     no->filhos[i] = NULL; /* Não aloca memória */
   }
 
   /* Inicializa o lock */
+#if NOCTREE_POLITICA != NOCTREE_POLITICA_SEM_LOCK
   if (pthread_rwlock_init(&no->lock, NULL) != 0) {
     LOG_ERROR(ERRO_LOCK, "Falha na inicialização do rwlock");
   }
+#endif
+}
+
+/* Esvazia o vetor de amostras de uma folha sem liberar as amostras (elas foram para outro lugar).
+ * No modo índice,  coordenadas  fica: é de quem chamou. */
+static void largaAmostras(noctree* no) {
+  if (no->modo != NOCTREE_MODO_INDICE) {
+    free(no->pontos);
+    no->pontos = NULL;
+  }
+  free(no->pontosQ);
+  no->pontosQ = NULL;
+  no->qtPontos = no->capacidade = 0;
+}
 
-  return no;
+/* Quantiza uma amostra em relação ao canto mínimo da folha (satura fora do cubo) */
+static void quantizaAmostra(noctree* no, amostra* ponto, uint16_t* q) {
+  float coords[DIM] = {ponto->x, ponto->y, ponto->z};
+  float centro[DIM] = {no->centro->x, no->centro->y, no->centro->z};
+
+  for (int i = 0; i < DIM; i++) {
+    float t = (coords[i] - (centro[i] - no->tamanho[i] / 2)) / no->tamanho[i] * NOCTREE_QUANT_MAX;
+    if (t < 0) t = 0;
+    if (t > NOCTREE_QUANT_MAX) t = NOCTREE_QUANT_MAX;
+    q[i] = (uint16_t)(t + 0.5f);
+  }
+}
+
+/* Desfaz  quantizaAmostra . */
+static void decodificaAmostra(noctree* no, const uint16_t* q, amostra* saida) {
+  saida->x = (no->centro->x - no->tamanho[0] / 2) + q[0] * (no->tamanho[0] / NOCTREE_QUANT_MAX);
+  saida->y = (no->centro->y - no->tamanho[1] / 2) + q[1] * (no->tamanho[1] / NOCTREE_QUANT_MAX);
+  saida->z = (no->centro->z - no->tamanho[2] / 2) + q[2] * (no->tamanho[2] / NOCTREE_QUANT_MAX);
+}
+
+/* Metade do passo de quantização da folha, no pior eixo: o erro de uma amostra quantizada nela */
+static float meioPasso(noctree* no) {
+  float maior = fmaxf(no->tamanho[0], fmaxf(no->tamanho[1], no->tamanho[2]));
+  return maior / (2.0f * NOCTREE_QUANT_MAX);
+}
+
+/* Guarda a amostra na folha, dobrando o vetor quando ele enche (só acontece na
+ * profundidade máxima). No modo quantizado, a amostra é liberada após quantizada;
+ * no modo índice, fica só a sua posição em  coordenadas . */
+static void guardaNaFolha(noctree* no, amostra* ponto) {
+  if (no->qtPontos == no->capacidade) { // Overflow no vetor de amostras
+    no->capacidade = no->capacidade << 1; // Dobra a capacidade
+    if (no->modo == NOCTREE_MODO_QUANTIZADO) {
+      no->pontosQ = (uint16_t*) realloc(no->pontosQ, sizeof(uint16_t) * DIM * no->capacidade);
+      CHECK_MALLOC(no->pontosQ);
+      CONTA(bytesAlocados, sizeof(uint16_t) * DIM * no->qtPontos);
+    } else if (no->modo == NOCTREE_MODO_INDICE) {
+      no->indices = (uint32_t*) realloc(no->indices, sizeof(uint32_t) * no->capacidade);
+      CHECK_MALLOC(no->indices);
+      CONTA(bytesAlocados, sizeof(uint32_t) * no->qtPontos);
+    } else {
+      no->pontos = (amostra**) realloc(no->pontos, sizeof(amostra*) * no->capacidade);
+      CHECK_MALLOC(no->pontos);
+      CONTA(bytesAlocados, sizeof(amostra*) * no->qtPontos);
+    }
+  }
+
+  if (no->modo == NOCTREE_MODO_QUANTIZADO) {
+    quantizaAmostra(no, ponto, &no->pontosQ[DIM * no->qtPontos]);
+    no->erroQ = fmaxf(no->erroQ, meioPasso(no));
+    free(ponto);
+  } else if (no->modo == NOCTREE_MODO_INDICE) {
+    no->indices[no->qtPontos] = (uint32_t) (ponto - no->coordenadas);
+  } else {
+    no->pontos[no->qtPontos] = ponto; // Aloca o ponto
+  }
+  no->qtPontos++;
+}
+
+/* Devolve a i-ésima amostra da folha como amostra*. No modo quantizado, é uma cópia decodificada recém-alocada;
+ * no modo índice, um ponteiro para dentro de  coordenadas . */
+static amostra* extraiAmostra(noctree* no, int i) {
+  if (no->modo == NOCTREE_MODO_INDICE) return &no->coordenadas[no->indices[i]];
+  if (no->modo != NOCTREE_MODO_QUANTIZADO) return no->pontos[i];
+
+  amostra* ponto = inicializaAmostra(0, 0, 0);
+  decodificaAmostra(no, &no->pontosQ[DIM * i], ponto);
+  return ponto;
+}
+
+amostra leAmostra(noctree* folha, int i) {
+  if (folha->modo == NOCTREE_MODO_INDICE) return folha->coordenadas[folha->indices[i]];
+  if (folha->modo != NOCTREE_MODO_QUANTIZADO) return *folha->pontos[i];
+
+  amostra ponto;
+  decodificaAmostra(folha, &folha->pontosQ[DIM * i], &ponto);
+  return ponto;
+}
+
+/* No modo índice, 1 se  ponto  é um elemento de  coordenadas  (só esses têm posição) */
+static int dentroDasCoordenadas(noctree* no, amostra* ponto) {
+  uintptr_t p = (uintptr_t) ponto, inicio = (uintptr_t) no->coordenadas;
+  return p >= inicio && p - inicio < sizeof(amostra) * (uintptr_t) no->qtCoordenadas && (p - inicio) % sizeof(amostra) == 0;
 }
 
 /* Obs: essa função tem melhorias de desempenho bem claras pedindo para serem
@@ -70,20 +181,29 @@ int insereAmostra(noctree* no, amostra* ponto) {
   int status = 1; // Booleano de retorno da função
   int pegueiOLock = 0;
 
+  if (no->congelado) return 0; // Árvore congelada: só consultas
+  if (no->modo == NOCTREE_MODO_OCUPACAO) return 0; // Sem amostras: ver  integraVarredura
+  if (no->modo == NOCTREE_MODO_SOLTO) return 0;    // Itens com extensão: ver  insereItemSolto
+  if (no->modo == NOCTREE_MODO_INDICE && !dentroDasCoordenadas(no, ponto)) return 0; // Sem posição no vetor
+
   /* A primeira coisa é pegar o lock de escrita (apenas se é folha) */
   if (!no->subdividido) { // Aí sim há risco de modificação no nó
-    pthread_rwlock_wrlock(&no->lock);
+    LOCK_ESCRITA(no);
     pegueiOLock = 1;
     LOGP(" Peguei o Lock"); ENDL;
+
+    if (no->congelado) { // Congelada enquanto esperávamos o lock
+      DESTRAVA(no);
+      return 0;
+    }
   }
 
   /* Depois segue normalmente a sessão crítica */
   if (no->subdividido) { // Amostra fica sempre nas folhas
-    realocaAmostra(no, ponto);
+    status = realocaAmostra(no, ponto); // 0 se um nó abaixo foi congelado
   }
   else if (no->qtPontos < NOCTREE_CAPACIDADE) { // É folha & há espaço
-    no->pontos[no->qtPontos] = ponto; // Aloca o ponto
-    no->qtPontos++;
+    guardaNaFolha(no, ponto);
   }
   else { // É folha, mas não há espaço -> subdivide (apenas se profundidade não é max)
     /* Caso 1: profundidade não é máxima */
@@ -92,30 +212,23 @@ int insereAmostra(noctree* no, amostra* ponto) {
 
       // Reidistribui os pontos nos filhos apropriados
       for (int i = 0; i < NOCTREE_CAPACIDADE; i++) {
-        status = status & realocaAmostra(no, no->pontos[i]);
+        status = status & realocaAmostra(no, extraiAmostra(no, i));
       }
       // Housekeeping o vetor de amostras
-      free(no->pontos);
-      no->pontos = NULL;
-      no->qtPontos = no->capacidade = 0;
+      largaAmostras(no);
 
       // E insere o ponto passado como argumento
-      realocaAmostra(no, ponto);
+      status = realocaAmostra(no, ponto);
     }
     /* Caso 2: profundidade é máxima. Decisão de projeto: alocaremos todas as amostras que vierem para esse nó */
     else {
-      if (no->qtPontos == no->capacidade) { // Overflow no vetor de amostras
-        no->capacidade = no->capacidade << 1; // Dobra a capacidade
-        no->pontos = (amostra**) realloc(no->pontos, sizeof(amostra*) * no->capacidade);
-      }
-      no->pontos[no->qtPontos] = ponto; // Aloca o ponto
-      no->qtPontos++;
+      guardaNaFolha(no, ponto);
     }
   }
 
   /* Solta o lock */
   if (pegueiOLock) {
-    pthread_rwlock_unlock(&no->lock);
+    DESTRAVA(no);
     LOGP(" Soltei o Lock"); ENDL;
   }
   return status;
@@ -126,6 +239,7 @@ void subdividir(noctree* no) {
              no->centro->x, no->centro->y, no->centro->z, no->tamanho[0]); ENDL;
 
   float novoTamanho[DIM];
+  CONTA(subdivisoes, 1);
 
   /* Calcula os novos tamanhos */
   for (int j=0; j < DIM; j++) {
@@ -140,6 +254,43 @@ void subdividir(noctree* no) {
     /* Inicializa o filho correspondente */
     no->filhos[i] = inicializaNo(novoCentro, novoTamanho, no->profundidade+1);
 
+    /* O filho herda o modo de armazenamento */
+    if (no->modo == NOCTREE_MODO_QUANTIZADO) {
+      free(no->filhos[i]->pontos);
+      no->filhos[i]->pontos = NULL;
+      no->filhos[i]->pontosQ = (uint16_t*) malloc(sizeof(uint16_t) * DIM * NOCTREE_CAPACIDADE);
+      CHECK_MALLOC(no->filhos[i]->pontosQ);
+      CONTA(bytesAlocados, sizeof(uint16_t) * DIM * NOCTREE_CAPACIDADE);
+      no->filhos[i]->modo = NOCTREE_MODO_QUANTIZADO;
+      /* As amostras do pai são decodificadas e quantizadas de novo no filho: o erro delas vem junto */
+      no->filhos[i]->erroQ = no->erroQ + meioPasso(no->filhos[i]);
+    }
+    /* No modo ocupação, o filho não guarda amostras e começa com a ocupação do pai */
+    if (no->modo == NOCTREE_MODO_OCUPACAO) {
+      free(no->filhos[i]->pontos);
+      no->filhos[i]->pontos = NULL;
+      no->filhos[i]->capacidade = 0;
+      no->filhos[i]->modo = NOCTREE_MODO_OCUPACAO;
+      no->filhos[i]->logOdds = no->logOdds;
+    }
+    /* No modo índice, o filho guarda posições no mesmo vetor de coordenadas */
+    if (no->modo == NOCTREE_MODO_INDICE) {
+      free(no->filhos[i]->pontos);
+      no->filhos[i]->coordenadas = no->coordenadas;
+      no->filhos[i]->qtCoordenadas = no->qtCoordenadas;
+      no->filhos[i]->indices = (uint32_t*) malloc(sizeof(uint32_t) * NOCTREE_CAPACIDADE);
+      CHECK_MALLOC(no->filhos[i]->indices);
+      CONTA(bytesAlocados, sizeof(uint32_t) * NOCTREE_CAPACIDADE);
+      no->filhos[i]->modo = NOCTREE_MODO_INDICE;
+    }
+    /* No modo solto, o filho só aloca o vetor de itens quando recebe o primeiro */
+    if (no->modo == NOCTREE_MODO_SOLTO) {
+      free(no->filhos[i]->pontos);
+      no->filhos[i]->pontos = NULL;
+      no->filhos[i]->capacidade = 0;
+      no->filhos[i]->modo = NOCTREE_MODO_SOLTO;
+    }
+
     LOGP(" -> Filho %d criado com centro (%.2f, %.2f, %.2f) e tamanho (%.2f)",
              i, novoCentro->x, novoCentro->y, novoCentro->z, novoTamanho[0]); ENDL;
 
@@ -166,42 +317,68 @@ int realocaAmostra(noctree* no, amostra* ponto) {
 }
 
 amostra* calculaCentroDoOctante(noctree* no, float* tamanho, int i) {
-  amostra* centro = inicializaAmostra(0, 0, 0);
+  float c[DIM] = {no->centro->x, no->centro->y, no->centro->z}, novo[DIM];
+  CONTA(bytesAlocados, sizeof(amostra));
 
   /* Calcula o centro do octante baseado no nó e no tamanho */
-  centro->x = no->centro->x + ((i & 1) ? tamanho[0] / 2 : -tamanho[0] / 2);
-  centro->y = no->centro->y + ((i & 2) ? tamanho[1] / 2 : -tamanho[1] / 2);
-  centro->z = no->centro->z + ((i & 4) ? tamanho[2] / 2 : -tamanho[2] / 2);
-
-  return centro;
+  centroDoOctante(c, tamanho, i, novo);
+  return inicializaAmostra(novo[0], novo[1], novo[2]);
 }
 
 void destroiNo(noctree* no) {
   if (no == NULL) return;
 
+  esvaziaNo(no);
+  free(no);
+}
+
+void esvaziaNo(noctree* no) {
   if (no->subdividido) {
     for (int i = 0; i < QT_FILHOS_NOCTREE; i++) {
       destroiNo(no->filhos[i]);
     }
   }
 
-  // Libera a memória das amostras guardadas no nó
-  for (int i = 0; i < no->qtPontos; i++) {
-    free(no->pontos[i]);
+  // Libera a memória das amostras guardadas no nó (no modo índice, o vetor de coordenadas é de quem chamou)
+  if (no->modo != NOCTREE_MODO_INDICE) {
+    if (no->pontos != NULL) {
+      for (int i = 0; i < no->qtPontos; i++) {
+        free(no->pontos[i]);
+      }
+    }
+    free(no->pontos);
   }
-  free(no->pontos);
+  free(no->pontosQ); // No modo índice, o vetor de índices
 
   free(no->centro); // Libera a memória do centro do nó
+#if NOCTREE_POLITICA != NOCTREE_POLITICA_SEM_LOCK
   pthread_rwlock_destroy(&no->lock); // Destrói o lock
-  free(no);
+#endif
+}
+
+void reciclaOctree(noctree* no) {
+  if (no->subdividido) {
+    for (int i = 0; i < QT_FILHOS_NOCTREE; i++) {
+      reciclaOctree(no->filhos[i]);
+    }
+    return;
+  }
+
+  if (no->modo != NOCTREE_MODO_INDICE && no->pontos != NULL) {
+    for (int i = 0; i < no->qtPontos; i++) {
+      free(no->pontos[i]);
+    }
+  }
+  no->qtPontos = 0;
 }
 
 void passoDaBuscaPorRegiao(noctree* no, amostra* centro_busca, float raio2, amostra*** resultados, int* qt_encontrados, int* capacidade) {
-  pthread_rwlock_rdlock(&no->lock);
+  int travou = travaLeitura(no);
+  CONTA(nosVisitados, 1);
 
   /* Se a região não passa pelo nó, fim da busca nele e seus filhos */
   if (!esferaIntersectaCubo(centro_busca, sqrtf(raio2), no)) {
-    pthread_rwlock_unlock(&no->lock);
+    destravaLeitura(no, travou);
     return;
   }
   
@@ -215,31 +392,112 @@ void passoDaBuscaPorRegiao(noctree* no, amostra* centro_busca, float raio2, amos
                               resultados, qt_encontrados, capacidade);
       }
     }
-  } else { /* Se é folha, registramos apenas se está dentro da regiao */
+  } else if (no->modo != NOCTREE_MODO_QUANTIZADO) { /* Se é folha, registramos apenas se está dentro da regiao */
+    CONTA(pontosTestados, no->qtPontos);
     for (int i = 0; i < no->qtPontos; i++) {
-      if (dist2(no->pontos[i], centro_busca) <= raio2) { 
+      amostra valor = leAmostra(no, i);
+      if (dist2(&valor, centro_busca) <= raio2) { 
+        amostra* ponto = extraiAmostra(no, i); // Sem cópia: no modo índice, aponta para dentro de  coordenadas
         // Adiciona o ponto ao vetor de resultados, realocando se necessário
         if (*qt_encontrados >= *capacidade) {
           *capacidade *= 2;
           *resultados = realloc(*resultados, sizeof(amostra*) * (*capacidade));
-          // TODO: talvez esse realloc dê problema com as threads
         }
-        (*resultados)[*qt_encontrados] = no->pontos[i];
+        (*resultados)[*qt_encontrados] = ponto;
         (*qt_encontrados)++;
       }
     }
   }
 
   /* Libera o lock */
-  pthread_rwlock_unlock(&no->lock);
+  destravaLeitura(no, travou);
+}
+
+
+/* Empacota cópias de amostras em um único bloco: o vetor de ponteiros seguido das
+ * amostras para as quais eles apontam. Um  free  no vetor libera tudo. */
+static amostra** empacotaCopias(amostra* valores, int qt) {
+  amostra** resultados = (amostra**) malloc(sizeof(amostra*) * qt + sizeof(amostra) * qt);
+  CHECK_MALLOC(resultados);
+
+  amostra* copias = (amostra*)(resultados + qt);
+  memcpy(copias, valores, sizeof(amostra) * qt);
+  for (int i = 0; i < qt; i++) {
+    resultados[i] = &copias[i];
+  }
+  return resultados;
+}
+
+/* Passo da busca por região no modo quantizado. Acumula cópias decodificadas em  valores . */
+static void passoDaBuscaQuantizada(noctree* no, amostra* centro_busca, float raio2, amostra** valores, int* qt_encontrados, int* capacidade) {
+  int travou = travaLeitura(no);
+  CONTA(nosVisitados, 1);
+
+  if (!esferaIntersectaCubo(centro_busca, sqrtf(raio2), no)) {
+    destravaLeitura(no, travou);
+    return;
+  }
+
+  if (no->subdividido) {
+    for (int i = 0; i < QT_FILHOS_NOCTREE; i++) {
+      if (no->filhos[i]) {
+        passoDaBuscaQuantizada(no->filhos[i], centro_busca, raio2, valores, qt_encontrados, capacidade);
+      }
+    }
+  } else {
+    /* Decodificação no próprio laço de distância: canto mínimo e passo da folha */
+    float minX = no->centro->x - no->tamanho[0] / 2, passoX = no->tamanho[0] / NOCTREE_QUANT_MAX;
+    float minY = no->centro->y - no->tamanho[1] / 2, passoY = no->tamanho[1] / NOCTREE_QUANT_MAX;
+    float minZ = no->centro->z - no->tamanho[2] / 2, passoZ = no->tamanho[2] / NOCTREE_QUANT_MAX;
+    CONTA(pontosTestados, no->qtPontos);
+
+    for (int i = 0; i < no->qtPontos; i++) {
+      const uint16_t* q = &no->pontosQ[DIM * i];
+      float x = minX + q[0] * passoX;
+      float y = minY + q[1] * passoY;
+      float z = minZ + q[2] * passoZ;
+      float dx = x - centro_busca->x, dy = y - centro_busca->y, dz = z - centro_busca->z;
+
+      if (dx*dx + dy*dy + dz*dz <= raio2) {
+        if (*qt_encontrados >= *capacidade) {
+          *capacidade *= 2;
+          *valores = (amostra*) realloc(*valores, sizeof(amostra) * (*capacidade));
+          CHECK_MALLOC(*valores);
+        }
+        (*valores)[*qt_encontrados] = (amostra){x, y, z};
+        (*qt_encontrados)++;
+      }
+    }
+  }
+
+  destravaLeitura(no, travou);
 }
 
+/* buscaPorRegiao no modo quantizado */
+static amostra** buscaPorRegiaoQuantizada(noctree* no, amostra* centro, float raio, int* qt_encontrados) {
+  int capacidade = 16;
+  amostra* valores = (amostra*) malloc(sizeof(amostra) * capacidade);
+  CHECK_MALLOC(valores);
+
+  *qt_encontrados = 0;
+  passoDaBuscaQuantizada(no, centro, raio * raio, &valores, qt_encontrados, &capacidade);
+
+  amostra** resultados = (*qt_encontrados > 0) ? empacotaCopias(valores, *qt_encontrados) : NULL;
+  free(valores);
+  CONTA(consultas, 1);
+  CONTA(pontosDevolvidos, *qt_encontrados);
+  return resultados;
+}
 
 amostra** buscaPorRegiao(noctree* no, amostra* centro, float raio, int* qt_encontrados) {
+  if (no->modo == NOCTREE_MODO_QUANTIZADO) {
+    return buscaPorRegiaoQuantizada(no, centro, raio, qt_encontrados);
+  }
+
   int capacidade = 16; // Capacidade inicial do array de resultados
   amostra** resultados = malloc(sizeof(amostra*) * capacidade);
   if (!resultados) return NULL;
-  // TODO: acho que deveria ter um lock para esse vetor de resultados também!!
+  // O vetor é só desta busca; a busca dividida em tarefas ( buscaPorRegiaoParalela ) dá um vetor para cada tarefa
 
   /* Housekeeping da entrada que faz parte da saída */
   *qt_encontrados = 0;
@@ -255,6 +513,8 @@ amostra** buscaPorRegiao(noctree* no, amostra* centro, float raio, int* qt_encon
     free(resultados);
     resultados = NULL;
   }
+  CONTA(consultas, 1);
+  CONTA(pontosDevolvidos, *qt_encontrados);
 
   return resultados;
 }
@@ -265,12 +525,13 @@ amostra** buscaNaFolha(noctree* no, amostra* alvo, int* qt_encontrados) {
   *qt_encontrados = 0;
 
   /* Pega o lock de leitura do nó */
-  pthread_rwlock_rdlock(&no->lock);
+  int travou = travaLeitura(no);
+  CONTA(nosVisitados, 1);
 
   /* Se não estamos na folha */
   if (no->subdividido) {
     /* Libera o pai antes de descer para o filho */
-    pthread_rwlock_unlock(&no->lock); 
+    destravaLeitura(no, travou);
 
     /* Vemos para qual filho devemos ir */
     int posicao = 0;
@@ -287,11 +548,30 @@ amostra** buscaNaFolha(noctree* no, amostra* alvo, int* qt_encontrados) {
   } 
   /* Se estamos numa folha, então é a folha correta */
   else {
+    CONTA(consultas, 1);
+    CONTA(pontosTestados, no->qtPontos);
+    CONTA(pontosDevolvidos, no->qtPontos);
+
     if (no->qtPontos == 0) { /* Se não há amostras -> lista vazia */
-      pthread_rwlock_unlock(&no->lock);
+      destravaLeitura(no, travou);
       return NULL;
     }
 
+    /* No modo quantizado, devolve cópias decodificadas */
+    if (no->modo == NOCTREE_MODO_QUANTIZADO) {
+      amostra* valores = (amostra*) malloc(sizeof(amostra) * no->qtPontos);
+      CHECK_MALLOC(valores);
+      for (int i = 0; i < no->qtPontos; i++) {
+        decodificaAmostra(no, &no->pontosQ[DIM * i], &valores[i]);
+      }
+      amostra** resultados = empacotaCopias(valores, no->qtPontos);
+      *qt_encontrados = no->qtPontos;
+      free(valores);
+
+      destravaLeitura(no, travou);
+      return resultados;
+    }
+
     amostra** resultados = malloc(sizeof(amostra*) * no->qtPontos);
     CHECK_MALLOC(resultados); /* TODO: seria bom largar o lock antes de chamar exit */
     /*if (!resultados) {*/
@@ -299,12 +579,427 @@ amostra** buscaNaFolha(noctree* no, amostra* alvo, int* qt_encontrados) {
     /*  return NULL;*/
     /*}*/
 
-    memcpy(resultados, no->pontos, sizeof(amostra*) * no->qtPontos);
+    if (no->modo == NOCTREE_MODO_INDICE) {
+      for (int i = 0; i < no->qtPontos; i++) resultados[i] = extraiAmostra(no, i);
+    } else {
+      memcpy(resultados, no->pontos, sizeof(amostra*) * no->qtPontos);
+    }
     *qt_encontrados = no->qtPontos;
 
-    pthread_rwlock_unlock(&no->lock);
+    destravaLeitura(no, travou);
     return resultados;
   }
 
 }
 
+
+float compactaOctree(noctree* no) {
+  float erro = 0;
+  if (no->modo == NOCTREE_MODO_INDICE) return 0; // As coordenadas são de quem chamou
+
+  LOCK_ESCRITA(no);
+  if (no->modo != NOCTREE_MODO_QUANTIZADO) {
+    no->modo = NOCTREE_MODO_QUANTIZADO;
+
+    /* Folha: quantiza as amostras atuais e troca o vetor */
+    if (!no->subdividido) {
+      uint16_t* q = (uint16_t*) malloc(sizeof(uint16_t) * DIM * no->capacidade);
+      CHECK_MALLOC(q);
+      CONTA(bytesAlocados, sizeof(uint16_t) * DIM * no->capacidade);
+      for (int i = 0; i < no->qtPontos; i++) {
+        quantizaAmostra(no, no->pontos[i], &q[DIM * i]);
+        free(no->pontos[i]);
+      }
+      free(no->pontos);
+      no->pontos = NULL;
+      no->pontosQ = q;
+      no->erroQ = meioPasso(no);
+    }
+  }
+  if (!no->subdividido) erro = no->erroQ;
+  DESTRAVA(no);
+
+  /* Os filhos, uma vez criados, não mudam: dá para descer sem o lock do pai */
+  if (no->subdividido) {
+    for (int i = 0; i < QT_FILHOS_NOCTREE; i++) {
+      erro = fmaxf(erro, compactaOctree(no->filhos[i]));
+    }
+  }
+
+  return erro;
+}
+
+float erroQuantizacao(noctree* no) {
+  float erro = 0;
+
+  int travou = travaLeitura(no);
+  if (!no->subdividido) {
+    erro = no->erroQ;
+    destravaLeitura(no, travou);
+    return erro;
+  }
+  destravaLeitura(no, travou);
+
+  for (int i = 0; i < QT_FILHOS_NOCTREE; i++) {
+    erro = fmaxf(erro, erroQuantizacao(no->filhos[i]));
+  }
+  return erro;
+}
+
+
+/* Árvores Privadas e Mescla
+ * ------------------------- */
+
+static int octanteDe(noctree* no, amostra* ponto) {
+  int posicao = 0;
+  if (ponto->x >= no->centro->x) posicao += 1;
+  if (ponto->y >= no->centro->y) posicao += 2;
+  if (ponto->z >= no->centro->z) posicao += 4;
+  return posicao;
+}
+
+
+/* Libera um nó da origem cujo conteúdo já foi para o destino (filhos e amostras ficam) */
+static void liberaCasca(noctree* no) {
+  largaAmostras(no);
+  no->subdividido = 0;
+  destroiNo(no);
+}
+
+/* Subdivide uma folha de uma árvore privada (sem lock) */
+static void subdividePrivada(noctree* no) {
+  subdividir(no);
+  for (int i = 0; i < no->qtPontos; i++) {
+    amostra* p = extraiAmostra(no, i);
+    insereAmostraPrivada(no->filhos[octanteDe(no, p)], p);
+  }
+  largaAmostras(no);
+}
+
+int insereAmostraPrivada(noctree* no, amostra* ponto) {
+  if (no->modo == NOCTREE_MODO_INDICE && !dentroDasCoordenadas(no, ponto)) return 0;
+  while (no->subdividido) no = no->filhos[octanteDe(no, ponto)];
+
+  if (no->qtPontos >= NOCTREE_CAPACIDADE && no->profundidade <= NOCTREE_MAX_PROFUNDIDADE) {
+    subdividePrivada(no);
+    return insereAmostraPrivada(no->filhos[octanteDe(no, ponto)], ponto);
+  }
+
+  guardaNaFolha(no, ponto);
+  return 1;
+}
+
+/* Raiz vazia com o mesmo cubo, profundidade e modo de  no  */
+static noctree* raizVaziaComo(noctree* no) {
+  amostra* centro = inicializaAmostra(no->centro->x, no->centro->y, no->centro->z);
+  noctree* vazia = inicializaNo(centro, no->tamanho, no->profundidade);
+  if (no->modo == NOCTREE_MODO_QUANTIZADO) compactaOctree(vazia);
+  if (no->modo == NOCTREE_MODO_INDICE) usaIndices(vazia, no->coordenadas, no->qtCoordenadas);
+  return vazia;
+}
+
+/* Troca amostras e filhos entre dois nós de mesmo cubo e modo (nenhum dos dois compartilhado) */
+static void trocaConteudo(noctree* a, noctree* b) {
+  amostra** pontos = a->pontos;        // No modo índice, é o mesmo vetor de coordenadas nos dois
+  uint16_t* pontosQ = a->pontosQ;      // Ou  indices
+  int capacidade = a->capacidade, qtPontos = a->qtPontos, subdividido = a->subdividido;
+  float erroQ = a->erroQ;
+  noctree* filhos[QT_FILHOS_NOCTREE];
+  memcpy(filhos, a->filhos, sizeof(filhos));
+
+  a->pontos = b->pontos;
+  a->pontosQ = b->pontosQ;
+  a->capacidade = b->capacidade;
+  a->qtPontos = b->qtPontos;
+  a->subdividido = b->subdividido;
+  a->erroQ = b->erroQ;
+  memcpy(a->filhos, b->filhos, sizeof(a->filhos));
+
+  b->pontos = pontos;
+  b->pontosQ = pontosQ;
+  b->capacidade = capacidade;
+  b->qtPontos = qtPontos;
+  b->subdividido = subdividido;
+  b->erroQ = erroQ;
+  memcpy(b->filhos, filhos, sizeof(b->filhos));
+}
+
+/* Lê  subdividido  do destino com o lock de leitura: quem enxertou publicou os filhos com o lock de escrita */
+static int estaSubdividido(noctree* no) {
+  LOCK_LEITURA(no);
+  int subdividido = no->subdividido;
+  DESTRAVA(no);
+  return subdividido;
+}
+
+/* Antes de a mescla guardar uma amostra decodificada de uma folha com limite  erro : a folha
+ * que vai recebê-la passa a cobrir esse erro mais o da nova quantização (e os filhos que ela
+ * criar ao se subdividir herdam isso) */
+static void acumulaErro(noctree* no, amostra* p, float erro) {
+  if (no->modo != NOCTREE_MODO_QUANTIZADO) return;
+
+  for (;;) {
+    while (estaSubdividido(no)) no = no->filhos[octanteDe(no, p)];
+    LOCK_ESCRITA(no);
+    if (!no->subdividido) break;
+    DESTRAVA(no); // Subdividiu enquanto esperávamos o lock
+  }
+  if (!no->congelado) no->erroQ = fmaxf(no->erroQ, erro + meioPasso(no)); // A congelada vai recusar a amostra
+  DESTRAVA(no);
+}
+
+/* Insere numa árvore privada (sobras, subárvore a enxertar) uma amostra decodificada de uma folha com limite  erro  */
+static void insereDecodificadaPrivada(noctree* no, amostra* p, float erro) {
+  acumulaErro(no, p, erro);
+  insereAmostraPrivada(no, p);
+}
+
+/* Insere uma a uma as amostras da (sub)árvore  origem  no destino, liberando a origem. As que
+ * o destino recusa (parte congelada) vão para as sobras. */
+static void reinsereTudo(noctree* destino, noctree* origem, noctree* sobras) {
+  if (origem->subdividido) {
+    for (int i = 0; i < QT_FILHOS_NOCTREE; i++) reinsereTudo(destino, origem->filhos[i], sobras);
+  } else {
+    for (int i = 0; i < origem->qtPontos; i++) {
+      amostra* p = extraiAmostra(origem, i);
+      acumulaErro(destino, p, origem->erroQ);
+      if (!insereAmostra(destino, p)) insereDecodificadaPrivada(sobras, p, origem->erroQ);
+    }
+  }
+  liberaCasca(origem);
+}
+
+/* Uma folha cheia do destino (com o lock de escrita) recebe mais amostras do que cabem: as
+ * amostras antigas e as novas montam uma subárvore privada, enxertada de uma vez */
+static void enxertaComAmostras(noctree* destino, amostra** pontos, int qt, float erro) {
+  noctree* temporaria = raizVaziaComo(destino);
+  if (destino->modo == NOCTREE_MODO_QUANTIZADO) { // As antigas trazem o erro da folha; as novas, o da origem
+    temporaria->erroQ = fmaxf(destino->erroQ, erro) + meioPasso(temporaria);
+  }
+
+  for (int i = 0; i < destino->qtPontos; i++) insereAmostraPrivada(temporaria, extraiAmostra(destino, i));
+  for (int i = 0; i < qt; i++) insereAmostraPrivada(temporaria, pontos[i]);
+  largaAmostras(destino);
+
+  /* Passou da capacidade fora da profundidade máxima: a temporária com certeza se subdividiu */
+  memcpy(destino->filhos, temporaria->filhos, sizeof(temporaria->filhos));
+  destino->subdividido = 1;
+  liberaCasca(temporaria);
+}
+
+/* Leva um punhado de amostras da origem para o destino: na folha, guarda tudo de uma vez (ou
+ * enxerta uma subárvore com elas); se o destino é subdividido, separa as amostras por octante
+ * (no próprio vetor) e desce.  erro  é o limite do erro de quantização que as amostras já trazem. */
+static void mesclaAmostras(noctree* destino, amostra** pontos, int qt, float erro, noctree* sobras) {
+  if (qt == 0) return;
+
+  if (!estaSubdividido(destino)) {
+    LOCK_ESCRITA(destino);
+    if (destino->congelado) { // Congelado no meio da mescla: as amostras ficam com quem chamou
+      DESTRAVA(destino);
+      for (int i = 0; i < qt; i++) insereDecodificadaPrivada(sobras, pontos[i], erro);
+      return;
+    }
+    if (!destino->subdividido) {
+      if (destino->qtPontos + qt <= NOCTREE_CAPACIDADE || destino->profundidade > NOCTREE_MAX_PROFUNDIDADE) {
+        for (int i = 0; i < qt; i++) guardaNaFolha(destino, pontos[i]);
+        if (destino->modo == NOCTREE_MODO_QUANTIZADO) destino->erroQ = fmaxf(destino->erroQ, erro + meioPasso(destino));
+      } else {
+        enxertaComAmostras(destino, pontos, qt, erro);
+      }
+      DESTRAVA(destino);
+      return;
+    }
+    DESTRAVA(destino); // Outro escritor subdividiu antes
+  }
+
+  /* Uma amostra só: a inserção comum pega o mesmo único lock */
+  if (qt == 1) {
+    acumulaErro(destino, pontos[0], erro);
+    if (!insereAmostra(destino, pontos[0])) insereDecodificadaPrivada(sobras, pontos[0], erro);
+    return;
+  }
+
+  /* Separa por octante: as amostras do octante k ficam em [inicio[k], inicio[k+1]) */
+  int inicio[QT_FILHOS_NOCTREE + 1] = {0}, proximo[QT_FILHOS_NOCTREE];
+  amostra** separadas = (amostra**) malloc(sizeof(amostra*) * qt);
+  CHECK_MALLOC(separadas);
+  for (int i = 0; i < qt; i++) inicio[octanteDe(destino, pontos[i]) + 1]++;
+  for (int k = 0; k < QT_FILHOS_NOCTREE; k++) inicio[k + 1] += inicio[k];
+  memcpy(proximo, inicio, sizeof(proximo));
+  for (int i = 0; i < qt; i++) separadas[proximo[octanteDe(destino, pontos[i])]++] = pontos[i];
+  memcpy(pontos, separadas, sizeof(amostra*) * qt);
+  free(separadas);
+
+  for (int k = 0; k < QT_FILHOS_NOCTREE; k++) {
+    mesclaAmostras(destino->filhos[k], pontos + inicio[k], inicio[k + 1] - inicio[k], erro, sobras);
+  }
+}
+
+/* Mescla nós que cobrem o mesmo cubo. Devolve a quantidade de enxertos. */
+static long long mesclaNo(noctree* destino, noctree* origem, noctree* sobras) {
+  long long enxertos = 0;
+
+  /* Origem é folha: suas amostras descem pelo destino */
+  if (!origem->subdividido) {
+    int qt = origem->qtPontos;
+    if (qt > 0) {
+      amostra** pontos = (amostra**) malloc(sizeof(amostra*) * qt);
+      CHECK_MALLOC(pontos);
+      for (int i = 0; i < qt; i++) pontos[i] = extraiAmostra(origem, i);
+      mesclaAmostras(destino, pontos, qt, origem->erroQ, sobras);
+      free(pontos);
+    }
+    liberaCasca(origem);
+    return 0;
+  }
+
+  /* Origem subdividida, destino folha: enxerta os filhos da origem no destino */
+  if (!estaSubdividido(destino)) {
+    LOCK_ESCRITA(destino);
+    if (destino->congelado) { // Nada de enxerto sob um nó congelado: as inserções são recusadas e tudo vai para as sobras
+      DESTRAVA(destino);
+      reinsereTudo(destino, origem, sobras);
+      return 0;
+    }
+    if (!destino->subdividido) {
+      /* As amostras que a folha já tinha descem para a subárvore antes de ela ficar visível */
+      for (int i = 0; i < destino->qtPontos; i++) {
+        amostra* p = extraiAmostra(destino, i);
+        insereDecodificadaPrivada(origem->filhos[octanteDe(origem, p)], p, destino->erroQ);
+      }
+      largaAmostras(destino);
+
+      memcpy(destino->filhos, origem->filhos, sizeof(origem->filhos));
+      destino->subdividido = 1;
+      DESTRAVA(destino);
+
+      liberaCasca(origem);
+      return 1;
+    }
+    DESTRAVA(destino); // Outro escritor subdividiu antes
+  }
+
+  /* Os dois subdivididos: desce junto. Os filhos, uma vez criados, não mudam. */
+  for (int i = 0; i < QT_FILHOS_NOCTREE; i++) {
+    enxertos += mesclaNo(destino->filhos[i], origem->filhos[i], sobras);
+  }
+  liberaCasca(origem);
+  return enxertos;
+}
+
+int mesclaOctrees(noctree* destino, noctree* origem, long long* enxertos) {
+  if (enxertos != NULL) *enxertos = 0;
+  if (destino->congelado) return NOCTREE_MESCLA_RECUSADA;
+
+  /* Posições só fazem sentido no mesmo vetor de coordenadas */
+  if (destino->modo == NOCTREE_MODO_INDICE || origem->modo == NOCTREE_MODO_INDICE) {
+    if (destino->modo != origem->modo || destino->coordenadas != origem->coordenadas ||
+        destino->qtCoordenadas != origem->qtCoordenadas) return NOCTREE_MESCLA_RECUSADA;
+  }
+
+  int mesmoCubo = destino->centro->x == origem->centro->x && destino->centro->y == origem->centro->y &&
+                  destino->centro->z == origem->centro->z && destino->profundidade == origem->profundidade &&
+                  destino->modo == origem->modo;
+  for (int i = 0; i < DIM; i++) mesmoCubo = mesmoCubo && destino->tamanho[i] == origem->tamanho[i];
+
+  /* O conteúdo da origem passa para uma casca, que a mescla consome; a raiz da origem, vazia,
+   * recebe as amostras que caírem numa parte congelada do destino */
+  noctree* conteudo = raizVaziaComo(origem);
+  trocaConteudo(conteudo, origem);
+
+  long long qtEnxertos = 0;
+  if (mesmoCubo) {
+    qtEnxertos = mesclaNo(destino, conteudo, origem);
+  } else {
+    reinsereTudo(destino, conteudo, origem);
+  }
+  if (enxertos != NULL) *enxertos = qtEnxertos;
+
+  if (origem->subdividido || origem->qtPontos > 0) return NOCTREE_MESCLA_PARCIAL; // Sobrou algo: fica com quem chamou
+  destroiNo(origem);
+  return NOCTREE_MESCLA_COMPLETA;
+}
+
+
+/* Modo Índice
+ * ----------- */
+
+int usaIndices(noctree* no, amostra* coordenadas, uint32_t qt) {
+  LOCK_ESCRITA(no);
+  if (no->modo != NOCTREE_MODO_PONTEIRO || no->subdividido || no->qtPontos > 0) {
+    DESTRAVA(no);
+    return 0;
+  }
+
+  uint32_t* indices = (uint32_t*) malloc(sizeof(uint32_t) * no->capacidade);
+  CHECK_MALLOC(indices);
+  CONTA(bytesAlocados, sizeof(uint32_t) * no->capacidade);
+  free(no->pontos);
+  no->coordenadas = coordenadas;
+  no->qtCoordenadas = qt;
+  no->indices = indices;
+  no->modo = NOCTREE_MODO_INDICE;
+  DESTRAVA(no);
+  return 1;
+}
+
+int insereIndice(noctree* no, uint32_t indice) {
+  if (no->modo != NOCTREE_MODO_INDICE || indice >= no->qtCoordenadas) return 0;
+  return insereAmostra(no, &no->coordenadas[indice]);
+}
+
+/* Troca os ponteiros para dentro de  coordenadas  pelas posições */
+static uint32_t* paraIndices(noctree* no, amostra** resultados, int qt) {
+  uint32_t* indices = NULL;
+  if (qt > 0) {
+    indices = (uint32_t*) malloc(sizeof(uint32_t) * qt);
+    CHECK_MALLOC(indices);
+    for (int i = 0; i < qt; i++) indices[i] = (uint32_t) (resultados[i] - no->coordenadas);
+  }
+  free(resultados);
+  return indices;
+}
+
+uint32_t* buscaIndicesPorRegiao(noctree* no, amostra* centro, float raio, int* qt_encontrados) {
+  *qt_encontrados = 0;
+  if (no->modo != NOCTREE_MODO_INDICE) return NULL;
+
+  amostra** resultados = buscaPorRegiao(no, centro, raio, qt_encontrados);
+  return paraIndices(no, resultados, *qt_encontrados);
+}
+
+uint32_t* buscaIndicesNaFolha(noctree* no, amostra* alvo, int* qt_encontrados) {
+  *qt_encontrados = 0;
+  if (no->modo != NOCTREE_MODO_INDICE) return NULL;
+
+  amostra** resultados = buscaNaFolha(no, alvo, qt_encontrados);
+  return paraIndices(no, resultados, *qt_encontrados);
+}
+
+
+/* Modo Congelado
+ * -------------- */
+
+void congela(noctree* no) {
+  /* Com o lock de escrita: quem já estava inserindo neste nó termina antes */
+  LOCK_ESCRITA(no);
+  no->congelado = 1;
+  DESTRAVA(no);
+
+  /* Congelado, o nó não se subdivide mais: os filhos lidos agora são os definitivos */
+  if (no->subdividido) {
+    for (int i = 0; i < QT_FILHOS_NOCTREE; i++) {
+      congela(no->filhos[i]);
+    }
+  }
+}
+
+void descongela(noctree* no) {
+  if (no->subdividido) {
+    for (int i = 0; i < QT_FILHOS_NOCTREE; i++) {
+      descongela(no->filhos[i]);
+    }
+  }
+  no->congelado = 0;
+}
@@ -3,24 +3,66 @@
 
 #include "system.h"
 #include "amostra.h"
+#include "estatisticas.h"
 #include <math.h>
 
 /**
  * Cria a estrutura de dados Noctree, que é um Nó da Octree
  */
 typedef struct _Noctree {
-	amostra** pontos;                    // Vetor com pontos contido no nó.
+  union {
+    amostra** pontos;                  // Vetor com pontos contido no nó.
                                        // Tem tamanho NOCTREE_CAPACIDADE, salvo se está na profundidade máxima (nesse caso, a capacidade é ilimitada).
+    amostra* coordenadas;              // No modo índice: o vetor de coordenadas de quem chama (o mesmo em todos os nós)
+  };
+  union {
+    uint16_t* pontosQ;                 // No modo quantizado, substitui  pontos : 3 deslocamentos (X,Y,Z) por amostra
+    uint32_t* indices;                 // No modo índice, substitui  pontos : posições em  coordenadas
+  };
   int capacidade;                      // É número max de elementos que cabem em  pontos
 	int qtPontos;                        // Quantidade de amostras em  pontos
 	amostra* centro;                     // Ponto central do cubo
 	float tamanho[DIM];                  // Dimensões X, Y, Z do cubo
+  float erroQ;                         // No modo quantizado: limite do erro por eixo das amostras da folha (ver  erroQuantizacao )
 	struct _Noctree *filhos[QT_FILHOS_NOCTREE]; // 8 filhos do Nóctree
 	int subdividido;                     // 1 se o nó foi subdividido; 0 c.c.
+  uint32_t qtCoordenadas;              // No modo índice: tamanho de  coordenadas
+#if NOCTREE_POLITICA != NOCTREE_POLITICA_SEM_LOCK
   pthread_rwlock_t lock;               // Lock de leitura/escrita por nó
+#endif
   int profundidade; 
+  int modo;                            // NOCTREE_MODO_PONTEIRO, NOCTREE_MODO_QUANTIZADO, NOCTREE_MODO_OCUPACAO, NOCTREE_MODO_SOLTO ou NOCTREE_MODO_INDICE. Herdado pelos filhos.
+  float logOdds;                       // Só no modo ocupação: log-odds da folha (NAN se desconhecida); herdado na subdivisão
+  int congelado;                       // 1 enquanto a árvore está congelada (ver  congela ): consultas sem lock, inserções recusadas
 } noctree;
 
+/* Lock de leitura das consultas: nos nós congelados, não há lock nenhum. O retorno de
+ * travaLeitura  diz se o lock foi pego e vai para  destravaLeitura . */
+static inline int travaLeitura(noctree* no) {
+  if (no->congelado) return 0;
+  LOCK_LEITURA(no);
+  return 1;
+}
+
+static inline void destravaLeitura(noctree* no, int travou) {
+  if (travou) DESTRAVA(no);
+}
+
+/* Bytes que o lock ocupa em cada nó (0 sem lock) */
+#if NOCTREE_POLITICA == NOCTREE_POLITICA_SEM_LOCK
+#define NOCTREE_BYTES_LOCK         0
+#else
+#define NOCTREE_BYTES_LOCK         sizeof(pthread_rwlock_t)
+#endif
+
+/* Mistura de 64 bits (splitmix64), para as tabelas hash sobre amostras e códigos de nós */
+static inline uint64_t mistura(uint64_t h) {
+  h += 0x9e3779b97f4a7c15ULL;
+  h = (h ^ (h >> 30)) * 0xbf58476d1ce4e5b9ULL;
+  h = (h ^ (h >> 27)) * 0x94d049bb133111ebULL;
+  return h ^ (h >> 31);
+}
+
 
 /* Funções de Geometria
  * -------------------- */
@@ -51,6 +93,15 @@ int esferaIntersectaCubo(amostra* centro_esfera, float raio, noctree* no);
  */
 noctree* inicializaNo(amostra* centro, float* tamanho, int profundidade);
 
+/**
+ * Inicializa um nó vazio numa memória já alocada por quem chama (ex.: embutido em
+ * outra estrutura, alinhado à linha de cache). Libere com  esvaziaNo .
+ *
+ * @param no É a memória do nó.
+ * @param centro, tamanho, profundidade Como em  inicializaNo .
+ */
+void preparaNo(noctree* no, amostra* centro, float* tamanho, int profundidade);
+
 /**
  * Insere uma amostra em um nó da Octree.
  *
@@ -58,7 +109,7 @@ noctree* inicializaNo(amostra* centro, float* tamanho, int profundidade);
  * @param ponto É uma amostra do LIDAR.
  * 
  * @return 1, se ok
- * 			   0, c.c.
+ * 			   0, c.c. (inclusive se a árvore está congelada; aí a amostra continua sendo de quem chamou)
  */
 int insereAmostra(noctree* no, amostra* ponto);
 
@@ -85,14 +136,42 @@ int realocaAmostra(noctree* no, amostra* ponto);
  */
 amostra* calculaCentroDoOctante(noctree* no, float* tamanho, int i);
 
+/**
+ * Centro do i-ésimo octante de um cubo de centro  centro , sendo  tamanho  as dimensões do
+ * octante (metade das do cubo). É a conta de  calculaCentroDoOctante ; quem percorre células
+ * que não são nós usa a mesma, para elas coincidirem com os nós.
+ */
+static inline void centroDoOctante(const float* centro, const float* tamanho, int i, float* saida) {
+  saida[0] = centro[0] + ((i & 1) ? tamanho[0] / 2 : -tamanho[0] / 2);
+  saida[1] = centro[1] + ((i & 2) ? tamanho[1] / 2 : -tamanho[1] / 2);
+  saida[2] = centro[2] + ((i & 4) ? tamanho[2] / 2 : -tamanho[2] / 2);
+}
+
 /**
  * Destrói um nó da octree de forma segura. Isto é, desalocando o que foi alocado.
  */
 void destroiNo(noctree* no);
 
+/**
+ * Libera tudo o que o nó possui (filhos, amostras, centro e lock), mas não a memória do
+ * próprio nó. É o par de  preparaNo .
+ */
+void esvaziaNo(noctree* no);
+
+/**
+ * Esvazia a (sub)árvore sem desfazer a estrutura: libera as amostras e zera as folhas, mas
+ * mantém os nós, as subdivisões e os vetores das folhas para serem reaproveitados.
+ * Ninguém mais pode estar usando a árvore.
+ *
+ * @param no é a raiz da (sub)árvore
+ */
+void reciclaOctree(noctree* no);
+
 /**
  * Realiza um passo da busca recursiva por região. 
  * NÃO DEVE SER CHAMADA PELO USUÁRIO! Poderia ser static, mas preferi não o fazer para manter a documentação organizada no .h.
+ * Devolve ponteiros para as amostras guardadas; as folhas no modo quantizado, que não as
+ * guardam, são puladas (nelas, use  buscaPorRegiao ).
  *
  * @param no é a raiz da árvore
  * @param centro é o centroide ao redor do qual a busca será realizada
@@ -129,4 +208,159 @@ amostra** buscaPorRegiao(noctree* no, amostra* centro, float raio2, int* qt_enco
  */
 amostra** buscaNaFolha(noctree* no, amostra* alvo, int* qt_encontrados);
 
+/**
+ * Lê a i-ésima amostra de uma folha por valor (decodificada, no modo quantizado).
+ * Quem chama segura o lock de leitura da folha (ou a árvore está congelada).
+ */
+amostra leAmostra(noctree* folha, int i);
+
+
+/* Modo Quantizado
+ * ---------------
+ * Cada amostra de uma folha vira 3 deslocamentos de 16 bits em relação ao canto
+ * mínimo da folha (6 bytes por amostra, contra ~36 do amostra* + amostra alocada).
+ * A decodificação acontece dentro do laço de distância das buscas.
+ *
+ * Nesse modo, as buscas devolvem cópias decodificadas das amostras, alocadas no
+ * mesmo bloco do vetor de resultados: basta o  free  do vetor, como de costume.
+ * As amostras inseridas são quantizadas e liberadas na inserção. */
+
+/**
+ * Converte a (sub)árvore para o modo quantizado. As amostras atuais são
+ * quantizadas e liberadas; inserções futuras já chegam quantizadas.
+ * Uma árvore no modo índice não é convertida (devolve 0).
+ *
+ * @param no é a raiz da (sub)árvore
+ *
+ * @returns o maior erro de quantização por eixo da (sub)árvore (ver  erroQuantizacao )
+ */
+float compactaOctree(noctree* no);
+
+/**
+ * Limite do erro de quantização por eixo. Uma amostra quantizada numa folha de aresta
+ * tamanho  erra no máximo  tamanho / (2 * NOCTREE_QUANT_MAX)  (meio passo). Mas, quando a
+ * folha se subdivide, as suas amostras são decodificadas e quantizadas de novo nos filhos:
+ * cada filho herda o limite do pai, somado ao seu próprio meio passo (o mesmo vale para as
+ * amostras que a mescla leva de uma folha para outra). Numa árvore só, o limite fica abaixo
+ * de  tamanho / NOCTREE_QUANT_MAX  da folha mais rasa que já guardou amostras quantizadas,
+ * no máximo  tamanho_raiz / NOCTREE_QUANT_MAX .
+ * Amostras fora do cubo da raiz são saturadas na borda e não respeitam o limite.
+ *
+ * @param no é a raiz da (sub)árvore
+ *
+ * @returns o maior limite entre as folhas atuais da (sub)árvore
+ */
+float erroQuantizacao(noctree* no);
+
+
+/* Modo Índice
+ * -----------
+ * As amostras já estão num vetor contíguo de quem chama (ex.: o buffer de um quadro):
+ * as folhas guardam só a posição de 32 bits de cada amostra nele (4 bytes por amostra,
+ * contra ~36 do amostra* + amostra alocada). A inserção não copia nem aloca a amostra, e
+ * destruir a árvore não libera o vetor, que não pode ser movido nem liberado antes dela.
+ *
+ * Nesse modo,  insereAmostra  recebe ponteiros para dentro do vetor (&coordenadas[i]) e
+ * recusa (devolve 0) os que apontam para fora dele; as buscas comuns devolvem ponteiros
+ * para dentro dele, e as buscas abaixo devolvem as posições. */
+
+/**
+ * Passa uma árvore vazia para o modo índice.
+ *
+ * @param no é a raiz, ainda sem amostras e sem filhos
+ * @param coordenadas é o vetor das amostras (continua de quem chama)
+ * @param qt é o tamanho do vetor
+ *
+ * @return 1, se ok
+ *         0, se a árvore já tem amostras ou filhos, ou não está no modo ponteiro
+ */
+int usaIndices(noctree* no, amostra* coordenadas, uint32_t qt);
+
+/**
+ * Insere a amostra  coordenadas[indice]  numa árvore do modo índice.
+ *
+ * @return 1, se ok
+ *         0, c.c. (inclusive se a árvore não está no modo índice ou se  indice  passa do fim do vetor)
+ */
+int insereIndice(noctree* no, uint32_t indice);
+
+/**
+ * Como  buscaPorRegiao , mas devolve as posições das amostras em  coordenadas  (libere com  free ).
+ * NULL se nenhuma foi achada ou se a árvore não está no modo índice.
+ */
+uint32_t* buscaIndicesPorRegiao(noctree* no, amostra* centro, float raio, int* qt_encontrados);
+
+/**
+ * Como  buscaNaFolha , mas devolve as posições das amostras em  coordenadas  (libere com  free ).
+ * NULL se a folha está vazia ou se a árvore não está no modo índice.
+ */
+uint32_t* buscaIndicesNaFolha(noctree* no, amostra* alvo, int* qt_encontrados);
+
+
+/* Árvores Privadas e Mescla
+ * -------------------------
+ * Um escritor pode montar uma árvore só sua, sem lock nenhum, e depois mesclá-la na
+ * árvore compartilhada de uma vez: as subárvores da origem são enxertadas nas folhas
+ * do destino, e os locks só são pegos nos pontos de enxerto. */
+
+/**
+ * Insere uma amostra sem pegar lock nenhum. Só para árvores que uma única thread enxerga.
+ *
+ * @return 1, se ok
+ *         0, c.c.
+ */
+int insereAmostraPrivada(noctree* no, amostra* ponto);
+
+/* Resultados de  mesclaOctrees  */
+#define NOCTREE_MESCLA_COMPLETA    1
+#define NOCTREE_MESCLA_PARCIAL     0
+#define NOCTREE_MESCLA_RECUSADA   -1
+
+/**
+ * Mescla a árvore  origem  na  destino  e consome a origem (as amostras passam para o destino).
+ *
+ * Se as raízes têm o mesmo cubo, a mesma profundidade e o mesmo modo, a mescla desce as duas
+ * árvores juntas: onde o destino é folha e a origem não, a subárvore da origem é enxertada
+ * inteira (as amostras que a folha já tinha descem para ela); onde a origem é folha, as amostras
+ * são guardadas na folha do destino de uma vez, se couberem. Caso contrário, as amostras da
+ * origem são inseridas uma a uma.
+ *
+ * O destino pode estar em uso por outras threads; a origem, não. As partes do destino
+ * congeladas (antes ou durante a mescla) não recebem nada: as amostras que cairiam nelas
+ * ficam na origem.
+ *
+ * @param enxertos recebe a quantidade de subárvores enxertadas, inclusive numa mescla
+ *        parcial (pode ser NULL)
+ *
+ * @return NOCTREE_MESCLA_COMPLETA, se tudo entrou (a origem foi liberada)
+ *         NOCTREE_MESCLA_PARCIAL, se parte do destino está congelada (a origem fica só com
+ *         as amostras recusadas)
+ *         NOCTREE_MESCLA_RECUSADA, se o destino está congelado ou uma das duas está no modo
+ *         índice e a outra não está no modo índice sobre o mesmo vetor (a origem fica intacta)
+ */
+int mesclaOctrees(noctree* destino, noctree* origem, long long* enxertos);
+
+
+/* Modo Congelado
+ * --------------
+ * Uma árvore que só vai ser consultada (ex.: a fase de buscas de um benchmark, ou um mapa
+ * carregado) não precisa que cada consulta pegue e solte o rwlock de cada nó visitado.
+ * Congelada, as consultas não tocam lock nenhum e as inserções são recusadas. */
+
+/**
+ * Congela a (sub)árvore. Espera as inserções que já seguram o lock de algum nó terminarem;
+ * as que chegarem depois são recusadas.
+ *
+ * @param no é a raiz da (sub)árvore
+ */
+void congela(noctree* no);
+
+/**
+ * Descongela a (sub)árvore, que volta a aceitar inserções.
+ * Nenhuma consulta pode estar em andamento: as consultas na árvore congelada não pegam lock, então nada as esperaria.
+ *
+ * @param no é a raiz da (sub)árvore
+ */
+void descongela(noctree* no);
+
 #endif
@@ -0,0 +1,184 @@
+/**
+ * @file normais.c
+ *
+ * Normais e curvatura por PCA. Para ver a documentação, consulte o header.
+ */
+
+#include "normais.h"
+
+typedef struct {
+  normaisOctree* n;
+  float raio;
+  amostra* pontoDeVista;
+} contextoNormais;
+
+
+/* Autossistema 3x3
+ * ---------------- */
+
+static void produtoVetorial(const double* a, const double* b, double* saida) {
+  saida[0] = a[1] * b[2] - a[2] * b[1];
+  saida[1] = a[2] * b[0] - a[0] * b[2];
+  saida[2] = a[0] * b[1] - a[1] * b[0];
+}
+
+static double norma2(const double* v) {
+  return v[0] * v[0] + v[1] * v[1] + v[2] * v[2];
+}
+
+/* Autovetor de  l : o maior produto vetorial entre as linhas de  m - l*I  (que são ortogonais a ele).
+ * Devolve 0 se as linhas são todas paralelas (autovalor repetido). */
+static int autovetor(const double* m, double l, double* v) {
+  double linhas[3][3] = {{m[0] - l, m[1], m[2]}, {m[1], m[3] - l, m[4]}, {m[2], m[4], m[5] - l}};
+  double c[3][3], melhor = 0;
+  int qual = -1;
+
+  produtoVetorial(linhas[0], linhas[1], c[0]);
+  produtoVetorial(linhas[0], linhas[2], c[1]);
+  produtoVetorial(linhas[1], linhas[2], c[2]);
+  for (int i = 0; i < 3; i++) {
+    double n2 = norma2(c[i]);
+    if (n2 > melhor) {
+      melhor = n2;
+      qual = i;
+    }
+  }
+
+  double escala = fabs(m[0]) + fabs(m[3]) + fabs(m[5]) + fabs(m[1]) + fabs(m[2]) + fabs(m[4]);
+  if (qual < 0 || melhor <= 1e-24 * escala * escala * escala * escala) return 0;
+
+  double n = sqrt(melhor);
+  for (int d = 0; d < DIM; d++) v[d] = c[qual][d] / n;
+  return 1;
+}
+
+void autoSistemaSimetrico3(const double* m, double* autovalores, double* normal) {
+  double fora = m[1] * m[1] + m[2] * m[2] + m[4] * m[4];
+  double q = (m[0] + m[3] + m[5]) / 3;
+
+  if (fora == 0) { // Diagonal
+    double d[3] = {m[0], m[3], m[5]};
+    int menor = 0;
+    for (int i = 1; i < 3; i++) if (d[i] < d[menor]) menor = i;
+    normal[0] = normal[1] = normal[2] = 0;
+    normal[menor] = 1;
+
+    for (int i = 0; i < 3; i++) autovalores[i] = d[i];
+    for (int i = 0; i < 2; i++)
+      for (int j = i + 1; j < 3; j++)
+        if (autovalores[j] < autovalores[i]) { double t = autovalores[i]; autovalores[i] = autovalores[j]; autovalores[j] = t; }
+    return;
+  }
+
+  /* B = (m - qI) / p tem autovalores 2cos(phi + 2k*pi/3), com  cos(3phi) = det(B) / 2  */
+  double a00 = m[0] - q, a11 = m[3] - q, a22 = m[5] - q;
+  double p = sqrt((a00 * a00 + a11 * a11 + a22 * a22 + 2 * fora) / 6);
+  double b00 = a00 / p, b11 = a11 / p, b22 = a22 / p, b01 = m[1] / p, b02 = m[2] / p, b12 = m[4] / p;
+  double r = (b00 * (b11 * b22 - b12 * b12) - b01 * (b01 * b22 - b12 * b02) + b02 * (b01 * b12 - b11 * b02)) / 2;
+  if (r < -1) r = -1;
+  if (r > 1) r = 1;
+  double phi = acos(r) / 3;
+
+  double maior = q + 2 * p * cos(phi);
+  double menor = q + 2 * p * cos(phi + 2 * M_PI / 3);
+  autovalores[0] = menor;
+  autovalores[1] = 3 * q - maior - menor;
+  autovalores[2] = maior;
+
+  if (autovetor(m, menor, normal)) return;
+
+  /* O menor autovalor é duplo (amostras numa reta): qualquer direção perpendicular ao maior serve */
+  double eixo[DIM];
+  if (!autovetor(m, maior, eixo)) {
+    normal[0] = normal[1] = 0;
+    normal[2] = 1;
+    return;
+  }
+  double outro[DIM] = {0, 0, 0};
+  outro[fabs(eixo[0]) < 0.9 ? 0 : 1] = 1;
+  produtoVetorial(eixo, outro, normal);
+  double n = sqrt(norma2(normal));
+  for (int d = 0; d < DIM; d++) normal[d] /= n;
+}
+
+
+/* Normais por folha
+ * ----------------- */
+
+static void normaisNaFolha(fotografiaOctree* f, folhaFotografada* folha, vizinhanca* v, void* arg) {
+  contextoNormais* c = (contextoNormais*) arg;
+  float raio2 = c->raio * c->raio;
+
+  caixaDaFolha(f, folha, c->raio, v);
+  coletaVizinhanca(f, v);
+
+  for (int i = 0; i < folha->qt; i++) {
+    long long indice = folha->inicio + i;
+    amostra* p = &f->amostras[indice];
+
+    /* Momentos em relação à própria amostra, que é perto da média: menos cancelamento */
+    double s[DIM] = {0, 0, 0}, m[6] = {0, 0, 0, 0, 0, 0};
+    int qt = 0;
+    for (long long j = 0; j < v->qt; j++) {
+      if (dist2(p, &v->amostras[j]) > raio2) continue;
+      double dx = v->amostras[j].x - p->x, dy = v->amostras[j].y - p->y, dz = v->amostras[j].z - p->z;
+      s[0] += dx; s[1] += dy; s[2] += dz;
+      m[0] += dx * dx; m[1] += dx * dy; m[2] += dx * dz;
+      m[3] += dy * dy; m[4] += dy * dz; m[5] += dz * dz;
+      qt++;
+    }
+
+    if (qt < 3) {
+      c->n->normais[indice] = (amostra){0, 0, 0};
+      c->n->curvaturas[indice] = NAN;
+      continue;
+    }
+
+    double cov[6] = {m[0] / qt - s[0] * s[0] / qt / qt, m[1] / qt - s[0] * s[1] / qt / qt, m[2] / qt - s[0] * s[2] / qt / qt,
+                     m[3] / qt - s[1] * s[1] / qt / qt, m[4] / qt - s[1] * s[2] / qt / qt, m[5] / qt - s[2] * s[2] / qt / qt};
+    double l[3], normal[DIM];
+    autoSistemaSimetrico3(cov, l, normal);
+
+    if (c->pontoDeVista != NULL) {
+      double vx = c->pontoDeVista->x - p->x, vy = c->pontoDeVista->y - p->y, vz = c->pontoDeVista->z - p->z;
+      if (normal[0] * vx + normal[1] * vy + normal[2] * vz < 0) {
+        for (int d = 0; d < DIM; d++) normal[d] = -normal[d];
+      }
+    }
+
+    double soma = fmax(0, l[0]) + fmax(0, l[1]) + fmax(0, l[2]);
+    c->n->normais[indice] = (amostra){(float) normal[0], (float) normal[1], (float) normal[2]};
+    c->n->curvaturas[indice] = (soma > 0) ? (float)(fmax(0, l[0]) / soma) : 0;
+  }
+}
+
+
+/* Interface
+ * --------- */
+
+int calculaNormais(noctree* no, float raio, amostra* pontoDeVista, normaisOctree* saida) {
+  memset(saida, 0, sizeof(normaisOctree));
+  if (!(raio > 0)) return 0;
+
+  fotografiaOctree f;
+  fotografaOctree(no, &f);
+  saida->amostras = f.amostras;
+  saida->qt = f.qt;
+  saida->normais = (amostra*) malloc(sizeof(amostra) * (f.qt > 0 ? f.qt : 1));
+  saida->curvaturas = (float*) malloc(sizeof(float) * (f.qt > 0 ? f.qt : 1));
+  CHECK_MALLOC(saida->normais);
+  CHECK_MALLOC(saida->curvaturas);
+
+  contextoNormais c = {saida, raio, pontoDeVista};
+  paraCadaFolha(&f, normaisNaFolha, &c);
+
+  free(f.folhas); // As amostras ficam com a saída
+  return 1;
+}
+
+void liberaNormais(normaisOctree* n) {
+  free(n->amostras);
+  free(n->normais);
+  free(n->curvaturas);
+  memset(n, 0, sizeof(normaisOctree));
+}
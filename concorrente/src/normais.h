@@ -0,0 +1,61 @@
+/* Normais e curvatura de superfície por PCA.
+ *
+ * Para cada amostra, a matriz de covariância das vizinhas a até  raio : a normal é o
+ * autovetor do menor autovalor e a curvatura é  l0 / (l0 + l1 + l2)  (0 num plano,
+ * 1/3 numa nuvem isotrópica). Os autovalores saem da fórmula fechada da cúbica
+ * característica (método trigonométrico), sem iteração.
+ *
+ * O trabalho é por folha (ver  vizinhanca.h ): a vizinhança da folha é coletada uma
+ * vez e serve para todas as suas amostras. Os resultados são atributos por amostra,
+ * alinhados com a fotografia da árvore em  normaisOctree.amostras .
+ *
+ * Exemplo:
+ *    normaisOctree n;
+ *    calculaNormais(raiz, 0.5f, &sensor, &n);   // Normais viradas para o sensor
+ *    ... n.amostras[i], n.normais[i], n.curvaturas[i] ...
+ *    liberaNormais(&n);
+*/
+
+#ifndef NORMAIS_H
+#define NORMAIS_H
+
+#include "vizinhanca.h"
+
+/**
+ * Normais e curvaturas, alinhadas com as amostras.
+ */
+typedef struct _NormaisOctree {
+  amostra* amostras;                   // Fotografia das amostras da árvore
+  amostra* normais;                    // Vetores unitários (0,0,0 se há menos de 3 amostras na vizinhança)
+  float* curvaturas;                   // NAN se há menos de 3 amostras na vizinhança
+  long long qt;
+} normaisOctree;
+
+/**
+ * Autovalores e autovetor do menor autovalor de uma matriz simétrica 3x3.
+ *
+ * @param m é a matriz, só a metade de cima: {xx, xy, xz, yy, yz, zz}
+ * @param autovalores recebe os autovalores em ordem crescente
+ * @param normal recebe o autovetor unitário do menor autovalor
+ */
+void autoSistemaSimetrico3(const double* m, double* autovalores, double* normal);
+
+/**
+ * Calcula a normal e a curvatura de cada amostra.
+ *
+ * @param no é a raiz da árvore
+ * @param raio é o raio da vizinhança
+ * @param pontoDeVista, se não é NULL, é para onde as normais apontam (ex.: o sensor); c.c. o sentido é arbitrário
+ * @param saida recebe os resultados (libere com  liberaNormais )
+ *
+ * @return 1, se ok
+ *         0, se  raio  não é positivo (saida  fica vazia)
+ */
+int calculaNormais(noctree* no, float raio, amostra* pontoDeVista, normaisOctree* saida);
+
+/**
+ * Libera os vetores dos resultados.
+ */
+void liberaNormais(normaisOctree* n);
+
+#endif
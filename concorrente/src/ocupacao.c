@@ -0,0 +1,363 @@
+/**
+ * @file ocupacao.c
+ *
+ * Mapa de ocupação por log-odds. Para ver a documentação, consulte o header.
+ */
+
+#include "ocupacao.h"
+#include <limits.h>
+
+/* A grade dos voxels: o cubo da raiz dividido em  2^niveis  por eixo */
+typedef struct {
+  float minimo[DIM];
+  float aresta[DIM];                   // Aresta do voxel em cada eixo
+  int niveis;
+  int n;                               // Voxels por eixo
+} gradeOcupacao;
+
+/* Chaves de voxels: código de Morton deslocado de 1 bit; o bit 0 diz se é o voxel do retorno (ocupado) */
+typedef struct {
+  uint64_t* chaves;
+  long long qt, capacidade;
+} vetorChaves;
+
+typedef struct {
+  gradeOcupacao* g;
+  amostra* origem;
+  amostra* retornos;
+  long long de, ate;                   // Retornos [de, ate)
+  float alcanceMaximo;
+  vetorChaves saida;
+} argRaios;
+
+typedef struct {
+  noctree* raiz;
+  int niveis;
+  uint64_t* chaves;
+  long long de, ate;                   // Chaves [de, ate)
+} argVoxels;
+
+
+/* Chaves
+ * ------ */
+
+/* Intercala os bits dos índices na ordem dos filhos da árvore (x no bit 0, y no 1, z no 2 de cada nível) */
+static uint64_t codigoMorton(const int* indice, int niveis) {
+  uint64_t codigo = 0;
+  for (int b = niveis - 1; b >= 0; b--) {
+    codigo = (codigo << DIM) | ((indice[0] >> b) & 1) | (((indice[1] >> b) & 1) << 1) | (((indice[2] >> b) & 1) << 2);
+  }
+  return codigo;
+}
+
+static void acrescentaChave(vetorChaves* v, const int* indice, int niveis, int ocupado) {
+  if (v->qt == v->capacidade) {
+    v->capacidade = (v->capacidade > 0) ? v->capacidade * 2 : 1024;
+    v->chaves = (uint64_t*) realloc(v->chaves, sizeof(uint64_t) * v->capacidade);
+    CHECK_MALLOC(v->chaves);
+  }
+  v->chaves[v->qt++] = (codigoMorton(indice, niveis) << 1) | (uint64_t) ocupado;
+}
+
+/* Radix sort LSD, de 8 em 8 bits, só nos  bits  de baixo */
+static void ordenaChaves(uint64_t* chaves, long long qt, int bits) {
+  uint64_t* aux = (uint64_t*) malloc(sizeof(uint64_t) * (qt > 0 ? qt : 1));
+  CHECK_MALLOC(aux);
+  uint64_t* de = chaves;
+  uint64_t* para = aux;
+
+  for (int deslocamento = 0; deslocamento < bits; deslocamento += 8) {
+    long long contagem[257] = {0};
+    for (long long i = 0; i < qt; i++) contagem[((de[i] >> deslocamento) & 0xFF) + 1]++;
+    for (int k = 0; k < 256; k++) contagem[k + 1] += contagem[k];
+    for (long long i = 0; i < qt; i++) para[contagem[(de[i] >> deslocamento) & 0xFF]++] = de[i];
+    uint64_t* t = de; de = para; para = t;
+  }
+  if (de != chaves) memcpy(chaves, de, sizeof(uint64_t) * qt);
+  free(aux);
+}
+
+/* Deixa uma chave por voxel, já ordenadas: a última, que é a ocupada se houver. Devolve quantas ficaram. */
+static long long deduplicaChaves(uint64_t* chaves, long long qt) {
+  long long m = 0;
+  for (long long i = 0; i < qt; i++) {
+    if (i + 1 < qt && (chaves[i] >> 1) == (chaves[i + 1] >> 1)) continue;
+    chaves[m++] = chaves[i];
+  }
+  return m;
+}
+
+
+/* Raios
+ * ----- */
+
+static int indiceNaGrade(const gradeOcupacao* g, float x, int d) {
+  int i = (int) floorf((x - g->minimo[d]) / g->aresta[d]);
+  return (i < 0) ? 0 : (i >= g->n) ? g->n - 1 : i;
+}
+
+/* Lança o raio de  origem  a  retorno  (DDA de Amanatides e Woo), recortado no cubo da raiz */
+static void lancaRaio(const gradeOcupacao* g, amostra* origem, amostra* retorno, float alcanceMaximo, vetorChaves* saida) {
+  float a[DIM] = {origem->x, origem->y, origem->z};
+  float v[DIM] = {retorno->x - a[0], retorno->y - a[1], retorno->z - a[2]};
+  float comprimento = sqrtf(v[0] * v[0] + v[1] * v[1] + v[2] * v[2]);
+  int ocupado = 1;
+
+  if (alcanceMaximo > 0 && comprimento > alcanceMaximo) {
+    for (int d = 0; d < DIM; d++) v[d] *= alcanceMaximo / comprimento;
+    ocupado = 0;
+  }
+
+  /* Recorta o segmento  a + t*v , t em [0, 1], no cubo */
+  float t0 = 0, t1 = 1;
+  for (int d = 0; d < DIM; d++) {
+    float lo = g->minimo[d], hi = g->minimo[d] + g->n * g->aresta[d];
+    if (v[d] == 0) {
+      if (a[d] < lo || a[d] > hi) return;
+      continue;
+    }
+    float ta = (lo - a[d]) / v[d], tb = (hi - a[d]) / v[d];
+    if (ta > tb) { float t = ta; ta = tb; tb = t; }
+    if (ta > t0) t0 = ta;
+    if (tb < t1) t1 = tb;
+  }
+  if (t0 > t1) return;
+  if (t1 < 1) ocupado = 0; // O retorno está fora do cubo
+
+  int i[DIM], fim[DIM], passo[DIM];
+  float tMax[DIM], tDelta[DIM];
+  for (int d = 0; d < DIM; d++) {
+    i[d] = indiceNaGrade(g, a[d] + t0 * v[d], d);
+    fim[d] = indiceNaGrade(g, a[d] + t1 * v[d], d);
+    passo[d] = (v[d] > 0) ? 1 : (v[d] < 0) ? -1 : 0;
+    if (passo[d] == 0) {
+      tMax[d] = tDelta[d] = INFINITY;
+    } else {
+      float borda = g->minimo[d] + (i[d] + (passo[d] > 0)) * g->aresta[d];
+      tMax[d] = (borda - a[d]) / v[d];
+      tDelta[d] = g->aresta[d] / fabsf(v[d]);
+    }
+  }
+
+  /* Os voxels até o do fim (exclusive) ficam livres; o erro de arredondamento é limitado pela quantidade de passos */
+  for (int passos = 0; passos < DIM * g->n; passos++) {
+    if (i[0] == fim[0] && i[1] == fim[1] && i[2] == fim[2]) break;
+    acrescentaChave(saida, i, g->niveis, 0);
+
+    int d = (tMax[0] < tMax[1]) ? ((tMax[0] < tMax[2]) ? 0 : 2) : ((tMax[1] < tMax[2]) ? 1 : 2);
+    i[d] += passo[d];
+    tMax[d] += tDelta[d];
+    if (i[d] < 0 || i[d] >= g->n) return;
+  }
+  acrescentaChave(saida, fim, g->niveis, ocupado);
+}
+
+static void tarefaRaios(void* arg) {
+  argRaios* a = (argRaios*) arg;
+  for (long long k = a->de; k < a->ate; k++) lancaRaio(a->g, a->origem, &a->retornos[k], a->alcanceMaximo, &a->saida);
+
+  /* Os raios vizinhos passam pelos mesmos voxels: deduplica já na tarefa */
+  ordenaChaves(a->saida.chaves, a->saida.qt, DIM * a->g->niveis + 1);
+  a->saida.qt = deduplicaChaves(a->saida.chaves, a->saida.qt);
+}
+
+
+/* Atualização e poda
+ * ------------------ */
+
+static void atualizaVoxel(noctree* raiz, int niveis, uint64_t chave) {
+  noctree* no = raiz;
+  for (int k = niveis - 1; k >= 0; k--) {
+    /* Lê  subdividido  com o lock de leitura: quem subdividiu publicou os filhos com o de escrita */
+    LOCK_LEITURA(no);
+    int folha = !no->subdividido;
+    DESTRAVA(no);
+
+    if (folha) { // Desce uma folha podada (ou desconhecida) até o voxel
+      LOCK_ESCRITA(no);
+      if (!no->subdividido) subdividir(no);
+      DESTRAVA(no);
+    }
+    no = no->filhos[(chave >> (1 + DIM * k)) & (QT_FILHOS_NOCTREE - 1)];
+  }
+
+  LOCK_ESCRITA(no);
+  float l = isnan(no->logOdds) ? 0 : no->logOdds;
+  l += (chave & 1) ? OCUPACAO_LOG_ACERTO : OCUPACAO_LOG_LIVRE;
+  no->logOdds = fminf(OCUPACAO_LOG_MAX, fmaxf(OCUPACAO_LOG_MIN, l));
+  DESTRAVA(no);
+}
+
+static void tarefaVoxels(void* arg) {
+  argVoxels* a = (argVoxels*) arg;
+  for (long long k = a->de; k < a->ate; k++) atualizaVoxel(a->raiz, a->niveis, a->chaves[k]);
+}
+
+static int mesmoValor(float a, float b) {
+  return (isnan(a) && isnan(b)) || a == b;
+}
+
+/* Junta os filhos iguais num nó só. Devolve 1 se  no  acabou folha. Os nós em  limite  já foram podados. */
+static int podaNo(noctree* no, int limite) {
+  if (!no->subdividido) return 1;
+  if (no->profundidade >= limite) return 0;
+
+  int folhas = 1;
+  for (int i = 0; i < QT_FILHOS_NOCTREE; i++) folhas &= podaNo(no->filhos[i], limite);
+  if (!folhas) return 0;
+
+  float valor = no->filhos[0]->logOdds;
+  for (int i = 1; i < QT_FILHOS_NOCTREE; i++) {
+    if (!mesmoValor(no->filhos[i]->logOdds, valor)) return 0;
+  }
+
+  for (int i = 0; i < QT_FILHOS_NOCTREE; i++) {
+    destroiNo(no->filhos[i]);
+    no->filhos[i] = NULL;
+  }
+  no->subdividido = 0;
+  no->logOdds = valor;
+  return 1;
+}
+
+static void tarefaPoda(void* arg) {
+  podaNo((noctree*) arg, INT_MAX);
+}
+
+static void coletaSubarvores(noctree* no, int profundidade, noctree** fronteira, int* qt) {
+  if (!no->subdividido) return;
+  if (no->profundidade == profundidade) {
+    fronteira[(*qt)++] = no;
+    return;
+  }
+  for (int i = 0; i < QT_FILHOS_NOCTREE; i++) coletaSubarvores(no->filhos[i], profundidade, fronteira, qt);
+}
+
+/* As subárvores do nível OCUPACAO_NIVEIS_PODA em tarefas, depois os níveis de cima */
+static void podaOcupacao(noctree* raiz) {
+  int limite = raiz->profundidade + OCUPACAO_NIVEIS_PODA;
+  int capacidade = 1;
+  for (int k = 0; k < OCUPACAO_NIVEIS_PODA; k++) capacidade *= QT_FILHOS_NOCTREE;
+
+  noctree** fronteira = (noctree**) malloc(sizeof(noctree*) * capacidade);
+  CHECK_MALLOC(fronteira);
+  int qt = 0;
+  coletaSubarvores(raiz, limite, fronteira, &qt);
+
+  poolTarefas* pool = poolPadrao();
+  grupoTarefas g;
+  iniciaGrupo(&g);
+  for (int i = 0; i < qt; i++) submeteTarefa(pool, &g, tarefaPoda, fronteira[i]);
+  esperaGrupo(pool, &g);
+
+  podaNo(raiz, limite);
+  free(fronteira);
+}
+
+
+/* Interface
+ * --------- */
+
+noctree* inicializaOcupacao(amostra* centro, float* tamanho) {
+  noctree* raiz = inicializaNo(centro, tamanho, 0);
+  free(raiz->pontos);
+  raiz->pontos = NULL;
+  raiz->capacidade = 0;
+  raiz->modo = NOCTREE_MODO_OCUPACAO;
+  return raiz;
+}
+
+long long integraVarredura(noctree* raiz, amostra* origem, amostra* retornos, long long qt, float alcanceMaximo) {
+  if (raiz->modo != NOCTREE_MODO_OCUPACAO) return -1;
+
+  gradeOcupacao g;
+  g.niveis = NOCTREE_MAX_PROFUNDIDADE + 1 - raiz->profundidade;
+  g.n = 1 << g.niveis;
+  float c[DIM] = {raiz->centro->x, raiz->centro->y, raiz->centro->z};
+  for (int d = 0; d < DIM; d++) {
+    g.minimo[d] = c[d] - raiz->tamanho[d] / 2;
+    g.aresta[d] = raiz->tamanho[d] / g.n;
+  }
+
+  /* 1. Raios em tarefas, cada uma com as suas chaves já deduplicadas */
+  poolTarefas* pool = poolPadrao();
+  long long qtTarefas = (qt + OCUPACAO_GRAO_RAIOS - 1) / OCUPACAO_GRAO_RAIOS;
+  argRaios* raios = (argRaios*) calloc(qtTarefas > 0 ? qtTarefas : 1, sizeof(argRaios));
+  CHECK_MALLOC(raios);
+
+  grupoTarefas grupo;
+  iniciaGrupo(&grupo);
+  for (long long t = 0; t < qtTarefas; t++) {
+    long long de = t * OCUPACAO_GRAO_RAIOS;
+    long long ate = (de + OCUPACAO_GRAO_RAIOS < qt) ? de + OCUPACAO_GRAO_RAIOS : qt;
+    raios[t] = (argRaios){&g, origem, retornos, de, ate, alcanceMaximo, {NULL, 0, 0}};
+    submeteTarefa(pool, &grupo, tarefaRaios, &raios[t]);
+  }
+  esperaGrupo(pool, &grupo);
+
+  /* 2. Uma chave por voxel na varredura toda */
+  long long total = 0;
+  for (long long t = 0; t < qtTarefas; t++) total += raios[t].saida.qt;
+  uint64_t* chaves = (uint64_t*) malloc(sizeof(uint64_t) * (total > 0 ? total : 1));
+  CHECK_MALLOC(chaves);
+  long long pos = 0;
+  for (long long t = 0; t < qtTarefas; t++) {
+    if (raios[t].saida.qt > 0) memcpy(chaves + pos, raios[t].saida.chaves, sizeof(uint64_t) * raios[t].saida.qt);
+    pos += raios[t].saida.qt;
+    free(raios[t].saida.chaves);
+  }
+  free(raios);
+  ordenaChaves(chaves, total, DIM * g.niveis + 1);
+  total = deduplicaChaves(chaves, total);
+
+  /* 3. Atualizações em tarefas: na ordem de Morton, cada tarefa fica num pedaço contíguo da árvore */
+#if NOCTREE_POLITICA == NOCTREE_POLITICA_SEM_LOCK
+  /* Sem lock, só um escritor por vez: as atualizações viram uma tarefa só, executada aqui mesmo */
+  argVoxels todas = {raiz, g.niveis, chaves, 0, total};
+  tarefaVoxels(&todas);
+#else
+  qtTarefas = (total + OCUPACAO_GRAO_VOXELS - 1) / OCUPACAO_GRAO_VOXELS;
+  argVoxels* voxels = (argVoxels*) malloc(sizeof(argVoxels) * (qtTarefas > 0 ? qtTarefas : 1));
+  CHECK_MALLOC(voxels);
+  iniciaGrupo(&grupo);
+  for (long long t = 0; t < qtTarefas; t++) {
+    long long de = t * OCUPACAO_GRAO_VOXELS;
+    long long ate = (de + OCUPACAO_GRAO_VOXELS < total) ? de + OCUPACAO_GRAO_VOXELS : total;
+    voxels[t] = (argVoxels){raiz, g.niveis, chaves, de, ate};
+    submeteTarefa(pool, &grupo, tarefaVoxels, &voxels[t]);
+  }
+  esperaGrupo(pool, &grupo);
+  free(voxels);
+#endif
+  free(chaves);
+
+  /* 4. Poda das subárvores uniformes */
+  podaOcupacao(raiz);
+  return total;
+}
+
+int consultaOcupacao(noctree* raiz, amostra* ponto, noctree** folha) {
+  if (folha != NULL) *folha = NULL;
+  if (fabsf(ponto->x - raiz->centro->x) > raiz->tamanho[0] / 2 ||
+      fabsf(ponto->y - raiz->centro->y) > raiz->tamanho[1] / 2 ||
+      fabsf(ponto->z - raiz->centro->z) > raiz->tamanho[2] / 2) return OCUPACAO_DESCONHECIDO;
+
+  noctree* no = raiz;
+  int travou = travaLeitura(no);
+  while (no->subdividido) {
+    int posicao = 0;
+    if (ponto->x >= no->centro->x) posicao += 1;
+    if (ponto->y >= no->centro->y) posicao += 2;
+    if (ponto->z >= no->centro->z) posicao += 4;
+    noctree* filho = no->filhos[posicao];
+    destravaLeitura(no, travou);
+    no = filho;
+    travou = travaLeitura(no);
+  }
+  float l = no->logOdds;
+  destravaLeitura(no, travou);
+
+  if (folha != NULL) *folha = no;
+  if (isnan(l)) return OCUPACAO_DESCONHECIDO;
+  return (l >= OCUPACAO_LIMIAR) ? OCUPACAO_OCUPADO : OCUPACAO_LIVRE;
+}
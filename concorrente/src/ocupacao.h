@@ -0,0 +1,84 @@
+/* Mapa de ocupação probabilístico (modo NOCTREE_MODO_OCUPACAO).
+ *
+ * Para navegação: em vez das amostras, cada folha guarda o log-odds de ocupação do seu
+ * cubo (livre, ocupado ou desconhecido). As folhas da profundidade NOCTREE_MAX_PROFUNDIDADE + 1
+ * são os voxels do mapa; uma folha mais rasa vale para todo o seu cubo.
+ *
+ * Integrar uma varredura lança um raio da origem do sensor até cada retorno (DDA na grade
+ * dos voxels): os voxels atravessados ficam mais livres e o do retorno, mais ocupado.
+ * Os raios são lançados em tarefas do  poolPadrao() ; as chaves dos voxels (código de
+ * Morton, na ordem dos octantes) são ordenadas e deduplicadas, de modo que cada voxel é
+ * atualizado uma vez só por varredura (ocupado ganha de livre), e as atualizações também
+ * são divididas em tarefas (compilado sem lock, elas rodam na thread que chamou). No fim,
+ * as subárvores cujas folhas têm todas o mesmo valor (ex.: saturadas em OCUPACAO_LOG_MIN)
+ * são podadas num nó só.
+ *
+ * Exemplo:
+ *    noctree* mapa = inicializaOcupacao(inicializaAmostra(0,0,0), (float[]){100,100,100});
+ *    integraVarredura(mapa, &sensor, retornos, qt, 30);   // Retornos além de 30 só liberam o caminho
+ *    if (consultaOcupacao(mapa, &alvo, NULL) == OCUPACAO_OCUPADO) ...
+ *    destroiNo(mapa);
+*/
+
+#ifndef OCUPACAO_H
+#define OCUPACAO_H
+
+#include "paralelo.h"
+
+/* Atualizações de log-odds (p = 0.7 no acerto e 0.4 no caminho livre) e limites (p de 0.12 a 0.97) */
+#define OCUPACAO_LOG_ACERTO       0.85f
+#define OCUPACAO_LOG_LIVRE       -0.4f
+#define OCUPACAO_LOG_MIN         -2.0f
+#define OCUPACAO_LOG_MAX          3.5f
+
+/* Log-odds a partir do qual o voxel é ocupado (p = 0.5) */
+#define OCUPACAO_LIMIAR           0.0f
+
+/* Raios por tarefa e voxels por tarefa */
+#define OCUPACAO_GRAO_RAIOS       1024
+#define OCUPACAO_GRAO_VOXELS      4096
+
+/* Níveis da árvore cujas subárvores são podadas em tarefas (8^2 = 64 subárvores) */
+#define OCUPACAO_NIVEIS_PODA      2
+
+/* Estados de um ponto do mapa */
+#define OCUPACAO_LIVRE            0
+#define OCUPACAO_OCUPADO          1
+#define OCUPACAO_DESCONHECIDO     2
+
+/**
+ * Cria um mapa de ocupação vazio (tudo desconhecido).
+ *
+ * @param centro é o centro do cubo (passa a pertencer ao mapa)
+ * @param tamanho são as dimensões do cubo; a aresta do voxel é  tamanho / 2^(NOCTREE_MAX_PROFUNDIDADE + 1)
+ *
+ * @return a raiz do mapa (libere com  destroiNo )
+ */
+noctree* inicializaOcupacao(amostra* centro, float* tamanho);
+
+/**
+ * Integra uma varredura. Ninguém mais pode estar usando o mapa enquanto isso (a poda libera nós).
+ *
+ * @param raiz é a raiz do mapa
+ * @param origem é a posição do sensor
+ * @param retornos são os pontos medidos
+ * @param qt é a quantidade de retornos
+ * @param alcanceMaximo, se positivo, corta os raios mais longos: o caminho até ele fica livre e o retorno não conta
+ *
+ * @return quantidade de voxels atualizados (cada um uma vez), ou -1 se  raiz  não está no modo ocupação
+ */
+long long integraVarredura(noctree* raiz, amostra* origem, amostra* retornos, long long qt, float alcanceMaximo);
+
+/**
+ * Consulta o estado do mapa num ponto.
+ *
+ * @param raiz é a raiz do mapa
+ * @param ponto é o ponto consultado
+ * @param folha, se não é NULL, recebe a folha que contém o ponto (o voxel, ou o nó podado que o cobre;
+ *        NULL fora do cubo). Vale até a próxima  integraVarredura .
+ *
+ * @return OCUPACAO_LIVRE, OCUPACAO_OCUPADO ou OCUPACAO_DESCONHECIDO (inclusive fora do cubo)
+ */
+int consultaOcupacao(noctree* raiz, amostra* ponto, noctree** folha);
+
+#endif
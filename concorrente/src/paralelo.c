@@ -0,0 +1,233 @@
+/**
+ * @file paralelo.c
+ *
+ * Operações da Octree sobre o pool de tarefas. Para ver a documentação, consulte o header.
+ */
+
+#include "paralelo.h"
+
+typedef struct {
+  noctree* raiz;
+  amostra** pontos;
+  long long qt;
+  _Atomic long long* inseridas;
+} argInsercao;
+
+typedef struct {
+  noctree* raiz;
+  amostra** centros;
+  int inicio, fim;
+  float raio;
+  amostra*** resultados;
+  int* qts;
+} argConsultas;
+
+typedef struct {
+  noctree* no;                         // Subárvore desta tarefa
+  amostra* centro;
+  float raio2;
+  amostra** resultados;                // Vetor próprio da tarefa
+  int qt, capacidade;
+} argSubBusca;
+
+typedef struct {
+  noctree* no;
+  int niveis;                          // Níveis que ainda viram tarefas abaixo deste nó
+} argDestruicao;
+
+static void tarefaInsercao(void* arg) {
+  argInsercao* a = (argInsercao*) arg;
+  long long ok = 0;
+  for (long long i = 0; i < a->qt; i++) ok += insereAmostra(a->raiz, a->pontos[i]);
+  atomic_fetch_add_explicit(a->inseridas, ok, memory_order_relaxed);
+}
+
+long long insereLoteParalelo(noctree* raiz, amostra** pontos, long long qt) {
+#if NOCTREE_POLITICA == NOCTREE_POLITICA_SEM_LOCK
+  /* Sem lock, só um escritor por vez: o lote inteiro vira uma tarefa, executada aqui mesmo */
+  _Atomic long long inseridas = 0;
+  argInsercao a = {raiz, pontos, qt, &inseridas};
+  tarefaInsercao(&a);
+  return atomic_load(&inseridas);
+#else
+  poolTarefas* pool = poolPadrao();
+  _Atomic long long inseridas = 0;
+  long long qtTarefas = (qt + PARALELO_GRAO_INSERCAO - 1) / PARALELO_GRAO_INSERCAO;
+  if (qtTarefas == 0) return 0;
+
+  argInsercao* args = (argInsercao*) malloc(sizeof(argInsercao) * qtTarefas);
+  CHECK_MALLOC(args);
+
+  grupoTarefas g;
+  iniciaGrupo(&g);
+  for (long long t = 0; t < qtTarefas; t++) {
+    long long inicio = t * PARALELO_GRAO_INSERCAO;
+    long long fim = (inicio + PARALELO_GRAO_INSERCAO < qt) ? inicio + PARALELO_GRAO_INSERCAO : qt;
+    args[t] = (argInsercao){raiz, pontos + inicio, fim - inicio, &inseridas};
+    submeteTarefa(pool, &g, tarefaInsercao, &args[t]);
+  }
+  esperaGrupo(pool, &g);
+
+  free(args);
+  return atomic_load(&inseridas);
+#endif
+}
+
+static void tarefaConsultas(void* arg) {
+  argConsultas* a = (argConsultas*) arg;
+  for (int i = a->inicio; i < a->fim; i++) {
+    a->resultados[i] = buscaPorRegiao(a->raiz, a->centros[i], a->raio, &a->qts[i]);
+  }
+}
+
+amostra*** buscaPorRegiaoEmLote(noctree* raiz, amostra** centros, int qtConsultas, float raio, int* qts) {
+  poolTarefas* pool = poolPadrao();
+  int qtTarefas = (qtConsultas + PARALELO_GRAO_CONSULTAS - 1) / PARALELO_GRAO_CONSULTAS;
+
+  amostra*** resultados = (amostra***) malloc(sizeof(amostra**) * (qtConsultas > 0 ? qtConsultas : 1));
+  argConsultas* args = (argConsultas*) malloc(sizeof(argConsultas) * (qtTarefas > 0 ? qtTarefas : 1));
+  CHECK_MALLOC(resultados);
+  CHECK_MALLOC(args);
+
+  grupoTarefas g;
+  iniciaGrupo(&g);
+  for (int t = 0; t < qtTarefas; t++) {
+    int inicio = t * PARALELO_GRAO_CONSULTAS;
+    int fim = (inicio + PARALELO_GRAO_CONSULTAS < qtConsultas) ? inicio + PARALELO_GRAO_CONSULTAS : qtConsultas;
+    args[t] = (argConsultas){raiz, centros, inicio, fim, raio, resultados, qts};
+    submeteTarefa(pool, &g, tarefaConsultas, &args[t]);
+  }
+  esperaGrupo(pool, &g);
+
+  free(args);
+  return resultados;
+}
+
+static void tarefaSubBusca(void* arg) {
+  argSubBusca* a = (argSubBusca*) arg;
+  a->capacidade = 16;
+  a->resultados = (amostra**) malloc(sizeof(amostra*) * a->capacidade);
+  CHECK_MALLOC(a->resultados);
+  passoDaBuscaPorRegiao(a->no, a->centro, a->raio2, &a->resultados, &a->qt, &a->capacidade);
+}
+
+/* Fração do cubo da raiz coberta pela caixa da esfera: a estimativa do custo da busca */
+static double fracaoDaRaiz(noctree* raiz, amostra* centro, float raio) {
+  float c[DIM] = {centro->x, centro->y, centro->z};
+  float r[DIM] = {raiz->centro->x, raiz->centro->y, raiz->centro->z};
+  double fracao = 1;
+  for (int d = 0; d < DIM; d++) {
+    float meia = raiz->tamanho[d] / 2;
+    float ini = fmaxf(c[d] - raio, r[d] - meia), fim = fminf(c[d] + raio, r[d] + meia);
+    fracao *= (fim > ini) ? (fim - ini) / raiz->tamanho[d] : 0;
+  }
+  return fracao;
+}
+
+amostra** buscaPorRegiaoParalela(noctree* raiz, amostra* centro, float raio, int* qt_encontrados) {
+  if (raiz->modo == NOCTREE_MODO_QUANTIZADO || fracaoDaRaiz(raiz, centro, raio) < PARALELO_FRACAO_MINIMA) {
+    return buscaPorRegiao(raiz, centro, raio, qt_encontrados);
+  }
+
+  poolTarefas* pool = poolPadrao();
+  float raio2 = raio * raio;
+  int alvo = (pool->qtTrabalhadores + 1) * PARALELO_SUBARVORES_POR_TRABALHADOR;
+
+  /* Desce a parte de cima, podando o que não toca a esfera, até haver subárvores para todos.
+   * Os filhos, uma vez criados, não mudam: as subárvores são buscadas sem o lock dos ancestrais. */
+  int capacidade = QT_FILHOS_NOCTREE, qt = 1;
+  noctree** fronteira = (noctree**) malloc(sizeof(noctree*) * capacidade);
+  CHECK_MALLOC(fronteira);
+  fronteira[0] = raiz;
+
+  int desceu = 1;
+  while (qt > 0 && qt < alvo && desceu) {
+    noctree** proxima = (noctree**) malloc(sizeof(noctree*) * qt * QT_FILHOS_NOCTREE);
+    CHECK_MALLOC(proxima);
+    int qtProxima = 0;
+
+    desceu = 0;
+    for (int i = 0; i < qt; i++) {
+      noctree* no = fronteira[i];
+      int travou = travaLeitura(no);
+      CONTA(nosVisitados, 1);
+      int toca = esferaIntersectaCubo(centro, raio, no);
+      int subdividido = no->subdividido;
+      destravaLeitura(no, travou);
+
+      if (!toca) continue;
+      if (subdividido) {
+        for (int k = 0; k < QT_FILHOS_NOCTREE; k++) proxima[qtProxima++] = no->filhos[k];
+        desceu = 1;
+      } else {
+        proxima[qtProxima++] = no;
+      }
+    }
+    free(fronteira);
+    fronteira = proxima;
+    qt = qtProxima;
+  }
+
+  /* Uma tarefa por subárvore, cada uma no seu vetor */
+  argSubBusca* args = (argSubBusca*) calloc(qt > 0 ? qt : 1, sizeof(argSubBusca));
+  CHECK_MALLOC(args);
+  grupoTarefas g;
+  iniciaGrupo(&g);
+  for (int i = 0; i < qt; i++) {
+    args[i] = (argSubBusca){fronteira[i], centro, raio2, NULL, 0, 0};
+    submeteTarefa(pool, &g, tarefaSubBusca, &args[i]);
+  }
+  esperaGrupo(pool, &g);
+
+  /* Concatena os vetores das tarefas */
+  *qt_encontrados = 0;
+  for (int i = 0; i < qt; i++) *qt_encontrados += args[i].qt;
+
+  amostra** resultados = NULL;
+  if (*qt_encontrados > 0) {
+    resultados = (amostra**) malloc(sizeof(amostra*) * (*qt_encontrados));
+    CHECK_MALLOC(resultados);
+  }
+  for (int i = 0, pos = 0; i < qt; i++) {
+    if (args[i].qt > 0) memcpy(resultados + pos, args[i].resultados, sizeof(amostra*) * args[i].qt);
+    pos += args[i].qt;
+    free(args[i].resultados);
+  }
+  CONTA(consultas, 1);
+  CONTA(pontosDevolvidos, *qt_encontrados);
+
+  free(args);
+  free(fronteira);
+  return resultados;
+}
+
+/* Os filhos viram tarefas (os argumentos ficam na pilha: só se volta daqui depois do grupo terminar) */
+static void tarefaDestruicao(void* arg) {
+  argDestruicao* a = (argDestruicao*) arg;
+  noctree* no = a->no;
+
+  if (a->niveis == 0 || !no->subdividido) {
+    destroiNo(no);
+    return;
+  }
+
+  poolTarefas* pool = poolPadrao();
+  argDestruicao filhos[QT_FILHOS_NOCTREE];
+  grupoTarefas g;
+  iniciaGrupo(&g);
+  for (int i = 0; i < QT_FILHOS_NOCTREE; i++) {
+    filhos[i] = (argDestruicao){no->filhos[i], a->niveis - 1};
+    submeteTarefa(pool, &g, tarefaDestruicao, &filhos[i]);
+  }
+  esperaGrupo(pool, &g);
+
+  no->subdividido = 0; // Os filhos já foram; agora é só o próprio nó
+  destroiNo(no);
+}
+
+void destroiNoParalelo(noctree* no) {
+  if (no == NULL) return;
+
+  argDestruicao a = {no, PARALELO_NIVEIS_DESTRUICAO};
+  tarefaDestruicao(&a);
+}
@@ -0,0 +1,81 @@
+/* Operações da Octree que se dividem em tarefas no pool da biblioteca.
+ *
+ * Uma operação grande vira várias tarefas de um grupoTarefas no  poolPadrao() ,
+ * e a thread que chamou ajuda a executá-las até o grupo terminar. Assim, quem
+ * chama não precisa criar threads, e operações chamadas de dentro de uma tarefa
+ * (ex.: uma busca em lote dentro de outra operação) não criam threads extras.
+ *
+ * Exemplo:
+ *    configuraPoolPadrao(4, 1);            // Opcional: 4 trabalhadores fixos nos núcleos
+ *    insereLoteParalelo(raiz, pontos, qt);
+ *    amostra*** res = buscaPorRegiaoEmLote(raiz, centros, qtConsultas, 5, qts);
+ *    amostra** grande = buscaPorRegiaoParalela(raiz, &centro, 40, &qt);
+ *    destroiNoParalelo(raiz);
+*/
+
+#ifndef PARALELO_H
+#define PARALELO_H
+
+#include "noctree.h"
+#include "tarefas.h"
+
+/* Amostras por tarefa na inserção em lote */
+#define PARALELO_GRAO_INSERCAO     2048
+
+/* Consultas por tarefa na busca em lote */
+#define PARALELO_GRAO_CONSULTAS    16
+
+/* Fração do volume da raiz que a caixa da esfera precisa cobrir para a busca se dividir em tarefas */
+#define PARALELO_FRACAO_MINIMA     (1.0 / 64)
+
+/* Subárvores por trabalhador na divisão de uma busca (equilibra regiões desiguais) */
+#define PARALELO_SUBARVORES_POR_TRABALHADOR 4
+
+/* Níveis da árvore cujos filhos viram tarefas na destruição (8^2 = 64 subárvores) */
+#define PARALELO_NIVEIS_DESTRUICAO 2
+
+/**
+ * Insere um lote de amostras, dividido em tarefas. Compilada sem lock
+ * (NOCTREE_POLITICA_SEM_LOCK), insere tudo na thread que chamou.
+ *
+ * @param raiz é a raiz da árvore
+ * @param pontos são as amostras (passam a pertencer à árvore)
+ * @param qt é a quantidade de amostras
+ *
+ * @return a quantidade de amostras inseridas com sucesso
+ */
+long long insereLoteParalelo(noctree* raiz, amostra** pontos, long long qt);
+
+/**
+ * Faz várias buscas por região com o mesmo raio, divididas em tarefas.
+ *
+ * @param raiz é a raiz da árvore
+ * @param centros são os centros das buscas
+ * @param qtConsultas é a quantidade de buscas
+ * @param raio é o raio das buscas
+ * @param qts recebe a quantidade de amostras encontradas em cada busca (vetor com  qtConsultas  posições)
+ *
+ * @return vetor com o resultado de cada busca. O vetor e cada resultado devem ser liberados por quem chamou.
+ */
+amostra*** buscaPorRegiaoEmLote(noctree* raiz, amostra** centros, int qtConsultas, float raio, int* qts);
+
+/**
+ * Busca por região que, se a esfera é grande, divide a própria busca em tarefas.
+ *
+ * A árvore é descida a partir da raiz, podando os nós fora da esfera, até haver subárvores
+ * para todos os trabalhadores. Cada subárvore é buscada por uma tarefa em um vetor próprio,
+ * e os vetores são concatenados no fim. Se a caixa da esfera cobre menos que
+ * PARALELO_FRACAO_MINIMA  do cubo da raiz (ou a árvore está no modo quantizado),
+ * a busca é a  buscaPorRegiao  comum, na thread que chamou.
+ *
+ * Mesmo contrato de  buscaPorRegiao .
+ */
+amostra** buscaPorRegiaoParalela(noctree* raiz, amostra* centro, float raio, int* qt_encontrados);
+
+/**
+ * Destrói a árvore e todas as amostras, com as subárvores dos primeiros níveis destruídas em paralelo.
+ * Mesmo contrato de  destroiNo : ninguém mais pode estar usando a árvore.
+ */
+void destroiNoParalelo(noctree* no);
+
+#endif
@@ -0,0 +1,94 @@
+/**
+ * @file quadros.c
+ *
+ * Quadros com buffer duplo ou triplo. Para ver a documentação, consulte o header.
+ */
+
+#include "quadros.h"
+#include <sched.h>
+
+gerenciadorQuadros* inicializaGerenciadorQuadros(amostra* centro, float* tamanho, int qtQuadros) {
+  if (qtQuadros < 2 || qtQuadros > QUADROS_MAX) {
+    free(centro);
+    return NULL;
+  }
+
+  gerenciadorQuadros* g = (gerenciadorQuadros*) aligned_alloc(TAM_LINHA_CACHE, sizeof(gerenciadorQuadros));
+  CHECK_MALLOC(g);
+  g->qtQuadros = qtQuadros;
+  for (int i = 0; i < qtQuadros; i++) {
+    amostra* c = (i == 0) ? centro : inicializaAmostra(centro->x, centro->y, centro->z);
+    g->quadros[i].raiz = inicializaNo(c, tamanho, 0);
+    g->quadros[i].numero = -1;
+    atomic_init(&g->quadros[i].leitores, 0);
+  }
+  atomic_init(&g->frente, 0);
+  g->tras = 1;
+  g->qtPublicados = 0;
+  g->qtEsperas = 0;
+  return g;
+}
+
+noctree* quadroDeTras(gerenciadorQuadros* g) {
+  return g->quadros[g->tras].raiz;
+}
+
+long long publicaQuadro(gerenciadorQuadros* g) {
+  int antiga = atomic_load(&g->frente);
+  long long numero = g->qtPublicados++;
+
+  g->quadros[g->tras].numero = numero;
+  atomic_store(&g->frente, g->tras);
+
+  /* Próxima árvore de trás: a mais antiga que nenhum leitor fixou. A que acabou de sair da
+   * frente fica por último, pois é a que tem mais chance de ainda ter leitores. */
+  int candidatos[QUADROS_MAX], qt = 0;
+  for (int i = 0; i < g->qtQuadros; i++) {
+    if (i != g->tras && i != antiga) candidatos[qt++] = i;
+  }
+  candidatos[qt++] = antiga;
+
+  int livre = -1, esperou = 0;
+  while (livre < 0) {
+    for (int k = 0; k < qt && livre < 0; k++) {
+      if (atomic_load(&g->quadros[candidatos[k]].leitores) == 0) livre = candidatos[k];
+    }
+    if (livre < 0) {
+      esperou = 1;
+      sched_yield();
+    }
+  }
+  g->qtEsperas += esperou;
+
+  /* Sem leitores, e nenhum leitor novo consegue fixá-lo (ver  fixaQuadro ): recicla */
+  reciclaOctree(g->quadros[livre].raiz);
+  g->quadros[livre].numero = -1;
+  g->tras = livre;
+  return numero;
+}
+
+quadro* fixaQuadro(gerenciadorQuadros* g) {
+  while (1) {
+    int i = atomic_load(&g->frente);
+    quadro* q = &g->quadros[i];
+    atomic_fetch_add(&q->leitores, 1);
+
+    /* Se a frente mudou entre a leitura e o incremento, o publicador pode ter escolhido
+     * este quadro para reciclar antes de ver o incremento: solta e tenta de novo. */
+    if (atomic_load(&g->frente) == i) return q;
+    atomic_fetch_sub(&q->leitores, 1);
+  }
+}
+
+void liberaQuadro(quadro* q) {
+  atomic_fetch_sub_explicit(&q->leitores, 1, memory_order_release);
+}
+
+void destroiGerenciadorQuadros(gerenciadorQuadros* g) {
+  if (g == NULL) return;
+
+  for (int i = 0; i < g->qtQuadros; i++) {
+    destroiNo(g->quadros[i].raiz);
+  }
+  free(g);
+}
@@ -0,0 +1,96 @@
+/* Quadros com buffer duplo ou triplo.
+ *
+ * A cada varredura do sensor, os escritores enchem a árvore de trás enquanto os leitores
+ * consultam a da frente, que já está completa. Publicar é trocar um índice atômico: a
+ * árvore de trás vira a da frente, e uma árvore antiga, assim que nenhum leitor a usa
+ * mais, é reciclada (os nós são mantidos, só as amostras são liberadas) e vira a nova
+ * árvore de trás. Leitores e escritores nunca estão na mesma árvore, então um leitor
+ * nunca espera um lock segurado por um escritor, nem vê um quadro pela metade.
+ *
+ * Os leitores fixam o quadro da frente com um contador de referências: fixar custa dois
+ * incrementos atômicos, sem lock. Com três quadros, o publicador quase nunca espera leitores
+ * atrasados: há sempre um quadro antigo livre para reciclar.
+ *
+ * Exemplo:
+ *    gerenciadorQuadros* g = inicializaGerenciadorQuadros(inicializaAmostra(0,0,0), (float[]){100,100,100}, 3);
+ *    // Escritores (uma varredura):
+ *    insereAmostra(quadroDeTras(g), inicializaAmostra(x, y, z));
+ *    publicaQuadro(g);
+ *    // Leitores:
+ *    quadro* q = fixaQuadro(g);
+ *    amostra** res = buscaPorRegiao(q->raiz, &centro, 5, &qt);
+ *    liberaQuadro(q);
+*/
+
+#ifndef QUADROS_H
+#define QUADROS_H
+
+#include "noctree.h"
+#include <stdatomic.h>
+
+/* Maior quantidade de quadros de um gerenciador (buffer triplo) */
+#define QUADROS_MAX                3
+
+/**
+ * Um quadro: uma árvore e os leitores que a fixaram, cada um na sua linha de cache.
+ */
+typedef struct _Quadro {
+  _Alignas(TAM_LINHA_CACHE) _Atomic int leitores;
+  noctree* raiz;
+  long long numero;                    // Quantas publicações antes desta (-1: nunca publicado)
+} quadro;
+
+/**
+ * O gerenciador. Escritores só usam o quadro de trás; leitores só o da frente.
+ */
+typedef struct _GerenciadorQuadros {
+  quadro quadros[QUADROS_MAX];
+  int qtQuadros;                       // 2 (buffer duplo) ou 3 (triplo)
+  _Alignas(TAM_LINHA_CACHE) _Atomic int frente; // Quadro publicado
+  int tras;                            // Quadro sendo escrito (só o publicador muda)
+  long long qtPublicados;
+  long long qtEsperas;                 // Publicações que esperaram leitores largarem um quadro antigo
+} gerenciadorQuadros;
+
+/**
+ * Cria o gerenciador com  qtQuadros  árvores do mesmo cubo, todas vazias.
+ * Antes da primeira publicação, os leitores veem um quadro vazio.
+ *
+ * @param centro é o centro do cubo (passa a pertencer ao gerenciador)
+ * @param tamanho são as arestas do cubo
+ * @param qtQuadros é 2 ou 3
+ *
+ * @return o gerenciador, ou NULL se  qtQuadros  é inválido (aí  centro  é liberado)
+ */
+gerenciadorQuadros* inicializaGerenciadorQuadros(amostra* centro, float* tamanho, int qtQuadros);
+
+/**
+ * A árvore de trás, onde os escritores inserem a próxima varredura (com  insereAmostra ).
+ */
+noctree* quadroDeTras(gerenciadorQuadros* g);
+
+/**
+ * Publica a árvore de trás e prepara uma nova, reciclando o quadro mais antigo que
+ * nenhum leitor estiver usando (espera, se todos estiverem).
+ * Só uma thread publica, e depois de os escritores terminarem a varredura.
+ *
+ * @return o número do quadro publicado
+ */
+long long publicaQuadro(gerenciadorQuadros* g);
+
+/**
+ * Fixa o quadro da frente: ele não será reciclado até  liberaQuadro .
+ */
+quadro* fixaQuadro(gerenciadorQuadros* g);
+
+/**
+ * Solta um quadro fixado por  fixaQuadro .
+ */
+void liberaQuadro(quadro* q);
+
+/**
+ * Destrói o gerenciador e as árvores. Ninguém mais pode estar usando os quadros.
+ */
+void destroiGerenciadorQuadros(gerenciadorQuadros* g);
+
+#endif
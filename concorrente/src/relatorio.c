@@ -0,0 +1,205 @@
+/**
+ * @file relatorio.c
+ *
+ * Relatório da forma e da memória da Octree. Para ver a documentação, consulte o header.
+ */
+
+#include "relatorio.h"
+#include "tarefas.h"
+#include <stdatomic.h>
+
+/* Subárvores por thread na divisão do percurso (equilibra árvores desbalanceadas) */
+#define REL_SUBARVORES_POR_THREAD  8
+
+typedef struct {
+  noctree** fronteira;                 // Subárvores a percorrer
+  int qtFronteira;
+  _Atomic int proxima;                 // Próxima subárvore livre
+} trabalhoRelatorio;
+
+typedef struct {
+  trabalhoRelatorio* trabalho;
+  relatorioOctree parcial;
+} argRelatorio;
+
+static int nivelDoNo(noctree* no) {
+  if (no->profundidade < 0) return 0;
+  return (no->profundidade < REL_QT_NIVEIS) ? no->profundidade : REL_QT_NIVEIS - 1;
+}
+
+/* Conta um nó (sem descer). Devolve 1 se ele tem filhos. */
+static int contaNo(noctree* no, relatorioOctree* r) {
+  int travou = travaLeitura(no);
+  int n = nivelDoNo(no);
+  int subdividido = no->subdividido;
+
+  r->qtNos++;
+  r->nosPorNivel[n]++;
+  if (no->profundidade > r->profundidadeMaxima) r->profundidadeMaxima = no->profundidade;
+  r->bytesNos += sizeof(noctree) - NOCTREE_BYTES_LOCK;
+  r->bytesLocks += NOCTREE_BYTES_LOCK;
+  r->bytesCentros += sizeof(amostra);
+
+  if (!subdividido) {
+    int qt = no->qtPontos;
+    r->qtFolhas++;
+    r->folhasPorNivel[n]++;
+    r->qtPontos += qt;
+    if (qt == 0) r->qtFolhasVazias++;
+    r->ocupacao[(qt <= NOCTREE_CAPACIDADE) ? qt : REL_QT_OCUPACOES - 1]++;
+
+    /* Transbordo: só acontece na profundidade máxima */
+    if (qt > NOCTREE_CAPACIDADE) {
+      int faixa = 0;
+      for (long long limite = 2 * NOCTREE_CAPACIDADE; qt > limite && faixa < REL_QT_TRANSBORDOS - 1; limite *= 2) faixa++;
+      r->qtTransbordos++;
+      r->pontosEmTransbordo += qt;
+      r->transbordos[faixa]++;
+      if (qt > r->maiorTransbordo) r->maiorTransbordo = qt;
+    }
+
+    if (no->modo == NOCTREE_MODO_QUANTIZADO) {
+      r->bytesVetores += (no->pontosQ != NULL) ? (long long) sizeof(uint16_t) * DIM * no->capacidade : 0;
+    } else if (no->modo == NOCTREE_MODO_INDICE) {
+      r->bytesVetores += (no->indices != NULL) ? (long long) sizeof(uint32_t) * no->capacidade : 0; // As amostras são de quem chamou
+    } else {
+      r->bytesVetores += (no->pontos != NULL) ? (long long) sizeof(amostra*) * no->capacidade : 0;
+      r->bytesAmostras += (long long) sizeof(amostra) * qt;
+    }
+  }
+  destravaLeitura(no, travou);
+
+  return subdividido;
+}
+
+/* Percurso sequencial de uma subárvore. Os filhos, uma vez criados, não mudam. */
+static void percorre(noctree* no, relatorioOctree* r) {
+  if (contaNo(no, r)) {
+    for (int i = 0; i < QT_FILHOS_NOCTREE; i++) {
+      percorre(no->filhos[i], r);
+    }
+  }
+}
+
+static void tarefaRelatorio(void* arg) {
+  argRelatorio* a = (argRelatorio*) arg;
+  trabalhoRelatorio* t = a->trabalho;
+
+  for (int i = atomic_fetch_add(&t->proxima, 1); i < t->qtFronteira; i = atomic_fetch_add(&t->proxima, 1)) {
+    percorre(t->fronteira[i], &a->parcial);
+  }
+}
+
+void somaRelatorioOctree(relatorioOctree* total, const relatorioOctree* p) {
+  total->qtNos          += p->qtNos;
+  total->qtFolhas       += p->qtFolhas;
+  total->qtFolhasVazias += p->qtFolhasVazias;
+  total->qtPontos       += p->qtPontos;
+  if (p->profundidadeMaxima > total->profundidadeMaxima) total->profundidadeMaxima = p->profundidadeMaxima;
+
+  for (int i = 0; i < REL_QT_NIVEIS; i++) {
+    total->nosPorNivel[i]    += p->nosPorNivel[i];
+    total->folhasPorNivel[i] += p->folhasPorNivel[i];
+  }
+  for (int i = 0; i < REL_QT_OCUPACOES; i++) total->ocupacao[i] += p->ocupacao[i];
+
+  total->qtTransbordos      += p->qtTransbordos;
+  total->pontosEmTransbordo += p->pontosEmTransbordo;
+  if (p->maiorTransbordo > total->maiorTransbordo) total->maiorTransbordo = p->maiorTransbordo;
+  for (int i = 0; i < REL_QT_TRANSBORDOS; i++) total->transbordos[i] += p->transbordos[i];
+
+  total->bytesNos      += p->bytesNos;
+  total->bytesLocks    += p->bytesLocks;
+  total->bytesCentros  += p->bytesCentros;
+  total->bytesVetores  += p->bytesVetores;
+  total->bytesAmostras += p->bytesAmostras;
+
+  total->bytesTotal = total->bytesNos + total->bytesLocks + total->bytesCentros + total->bytesVetores + total->bytesAmostras;
+  total->bytesPorPonto = total->qtPontos ? (double) total->bytesTotal / total->qtPontos : 0;
+}
+
+void geraRelatorioOctree(noctree* raiz, int nthreads, relatorioOctree* saida) {
+  if (nthreads < 1) nthreads = 1;
+  memset(saida, 0, sizeof(relatorioOctree));
+
+  /* Desce a parte de cima, nível a nível, até haver subárvores para todas as threads */
+  int capacidade = QT_FILHOS_NOCTREE, qt = 1;
+  noctree** fronteira = (noctree**) malloc(sizeof(noctree*) * capacidade);
+  CHECK_MALLOC(fronteira);
+  fronteira[0] = raiz;
+
+  int alvo = (nthreads > 1) ? nthreads * REL_SUBARVORES_POR_THREAD : 1;
+  int desceu = 1;
+  while (qt < alvo && desceu) {
+    noctree** proxima = (noctree**) malloc(sizeof(noctree*) * qt * QT_FILHOS_NOCTREE);
+    CHECK_MALLOC(proxima);
+    int qtProxima = 0;
+
+    desceu = 0;
+    for (int i = 0; i < qt; i++) {
+      int travou = travaLeitura(fronteira[i]);
+      int subdividido = fronteira[i]->subdividido;
+      destravaLeitura(fronteira[i], travou);
+
+      if (subdividido) { // Conta o nó aqui e passa os filhos adiante
+        contaNo(fronteira[i], saida);
+        for (int k = 0; k < QT_FILHOS_NOCTREE; k++) proxima[qtProxima++] = fronteira[i]->filhos[k];
+        desceu = 1;
+      } else {
+        proxima[qtProxima++] = fronteira[i];
+      }
+    }
+    free(fronteira);
+    fronteira = proxima;
+    qt = qtProxima;
+  }
+
+  /* Divide as subárvores entre as tarefas do pool; cada uma soma no seu relatório */
+  trabalhoRelatorio trabalho = {fronteira, qt, 0};
+  argRelatorio* args = (argRelatorio*) calloc(nthreads, sizeof(argRelatorio));
+  CHECK_MALLOC(args);
+
+  grupoTarefas g;
+  iniciaGrupo(&g);
+  for (int t = 0; t < nthreads; t++) {
+    args[t].trabalho = &trabalho;
+    if (t > 0) submeteTarefa(poolPadrao(), &g, tarefaRelatorio, &args[t]);
+  }
+  tarefaRelatorio(&args[0]); // Esta thread também trabalha
+  if (nthreads > 1) esperaGrupo(poolPadrao(), &g);
+  for (int t = 0; t < nthreads; t++) somaRelatorioOctree(saida, &args[t].parcial);
+
+  free(args);
+  free(fronteira);
+}
+
+void imprimeRelatorioOctree(FILE* saida, const relatorioOctree* r) {
+  fprintf(saida, "  Nós: %lld | folhas: %lld (%lld vazias, %.1f%%) | amostras: %lld | profundidade máxima: %d\n",
+          r->qtNos, r->qtFolhas, r->qtFolhasVazias, r->qtFolhas ? 100.0 * r->qtFolhasVazias / r->qtFolhas : 0,
+          r->qtPontos, r->profundidadeMaxima);
+
+  fprintf(saida, "  Profundidade (nós / folhas):\n");
+  for (int i = 0; i < REL_QT_NIVEIS; i++) {
+    if (r->nosPorNivel[i] == 0) continue;
+    fprintf(saida, "    %2d%s: %lld / %lld\n", i, (i == REL_QT_NIVEIS - 1) ? "+" : " ",
+            r->nosPorNivel[i], r->folhasPorNivel[i]);
+  }
+
+  fprintf(saida, "  Ocupação das folhas (amostras: folhas):");
+  for (int i = 0; i < REL_QT_OCUPACOES - 1; i++) fprintf(saida, " %d: %lld |", i, r->ocupacao[i]);
+  fprintf(saida, " >%d: %lld\n", NOCTREE_CAPACIDADE, r->ocupacao[REL_QT_OCUPACOES - 1]);
+
+  if (r->qtTransbordos > 0) {
+    fprintf(saida, "  Transbordos na profundidade máxima: %lld folhas, %lld amostras, maior com %d\n",
+            r->qtTransbordos, r->pontosEmTransbordo, r->maiorTransbordo);
+    long long limite = NOCTREE_CAPACIDADE;
+    for (int i = 0; i < REL_QT_TRANSBORDOS; i++, limite *= 2) {
+      if (r->transbordos[i] == 0) continue;
+      if (i == REL_QT_TRANSBORDOS - 1) fprintf(saida, "    > %lld: %lld\n", limite, r->transbordos[i]);
+      else fprintf(saida, "    (%lld, %lld]: %lld\n", limite, 2 * limite, r->transbordos[i]);
+    }
+  }
+
+  fprintf(saida, "  Memória (bytes): nós %lld | locks %lld | centros %lld | vetores %lld | amostras %lld | total %lld (%.1f por amostra)\n",
+          r->bytesNos, r->bytesLocks, r->bytesCentros, r->bytesVetores, r->bytesAmostras, r->bytesTotal, r->bytesPorPonto);
+}
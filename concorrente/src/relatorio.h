@@ -0,0 +1,79 @@
+/* Relatório da forma e da memória de uma Octree.
+ *
+ * Percorre a árvore em paralelo e responde perguntas que as buscas lentas só
+ * insinuam: quão funda ela está de verdade, quão cheias estão as folhas, quantos
+ * octantes vazios  subdividir  criou e quanto crescem as folhas da profundidade
+ * máxima (que não subdividem mais).
+ *
+ * Exemplo:
+ *    relatorioOctree r;
+ *    geraRelatorioOctree(raiz, 4, &r);
+ *    imprimeRelatorioOctree(stdout, &r);
+*/
+
+#ifndef RELATORIO_H
+#define RELATORIO_H
+
+#include "noctree.h"
+
+/* Profundidades contadas: 0 .. NOCTREE_MAX_PROFUNDIDADE+1 (as folhas param aí) */
+#define REL_QT_NIVEIS        (NOCTREE_MAX_PROFUNDIDADE + 2)
+
+/* Histograma de ocupação: uma faixa por quantidade 0 .. NOCTREE_CAPACIDADE, mais uma para o transbordo */
+#define REL_QT_OCUPACOES     (NOCTREE_CAPACIDADE + 2)
+
+/* Tamanhos das folhas transbordadas, em faixas de potências de 2: (CAP*2^(i-1), CAP*2^i] */
+#define REL_QT_TRANSBORDOS   16
+
+/**
+ * Forma e memória de uma (sub)árvore.
+ */
+typedef struct _RelatorioOctree {
+  long long qtNos;
+  long long qtFolhas;
+  long long qtFolhasVazias;
+  long long qtPontos;
+  int profundidadeMaxima;              // Maior profundidade com algum nó
+
+  long long nosPorNivel[REL_QT_NIVEIS];
+  long long folhasPorNivel[REL_QT_NIVEIS];
+  long long ocupacao[REL_QT_OCUPACOES];       // Folhas com i amostras (a última faixa: mais que NOCTREE_CAPACIDADE)
+
+  /* Folhas da profundidade máxima que passaram de NOCTREE_CAPACIDADE */
+  long long qtTransbordos;
+  long long pontosEmTransbordo;
+  int maiorTransbordo;
+  long long transbordos[REL_QT_TRANSBORDOS];  // Por faixa de tamanho
+
+  /* Memória, em bytes */
+  long long bytesNos;                  // A estrutura noctree, sem o lock
+  long long bytesLocks;
+  long long bytesCentros;
+  long long bytesVetores;              // Vetores de amostras das folhas (pontos, pontosQ ou indices), pela capacidade
+  long long bytesAmostras;             // Amostras apontadas pelas folhas (só no modo ponteiro)
+  long long bytesTotal;
+  double bytesPorPonto;
+} relatorioOctree;
+
+/**
+ * Gera o relatório de uma (sub)árvore. A parte de cima é percorrida por esta thread até
+ * haver subárvores suficientes para dividir entre  nthreads  tarefas do  poolPadrao() .
+ * Pode ser chamada com a árvore em uso (pega os locks de leitura), mas aí é uma fotografia aproximada.
+ *
+ * @param raiz é a raiz da (sub)árvore
+ * @param nthreads é a quantidade de tarefas do percurso (1 = sequencial, sem usar o pool)
+ * @param saida recebe o relatório
+ */
+void geraRelatorioOctree(noctree* raiz, int nthreads, relatorioOctree* saida);
+
+/**
+ * Soma o relatório de outra (sub)árvore no total (ex.: os fragmentos de uma octreeFragmentada).
+ */
+void somaRelatorioOctree(relatorioOctree* total, const relatorioOctree* parcial);
+
+/**
+ * Imprime um relatório legível: histogramas de profundidade e ocupação, transbordos e memória por categoria.
+ */
+void imprimeRelatorioOctree(FILE* saida, const relatorioOctree* r);
+
+#endif
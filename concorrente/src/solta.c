@@ -0,0 +1,333 @@
+/**
+ * @file solta.c
+ *
+ * Octree solta. Para ver a documentação, consulte o header.
+ */
+
+#include "solta.h"
+
+/* Teste de uma caixa numa consulta: < 0 se a caixa fica de fora; senão, o t do impacto (0 fora dos raios) */
+typedef float (*testeCaixa)(caixaItem* caixa, void* contexto);
+
+typedef struct {
+  impactoSolto* impactos;
+  int qt, capacidade;
+} vetorImpactos;
+
+typedef struct {
+  amostra origem, direcao;
+  float tMaximo;
+} raioDeVisada;
+
+typedef struct {
+  amostra centro;
+  float raio2;
+} esferaBusca;
+
+
+/* Geometria
+ * --------- */
+
+/* O cubo alargado de um nó: o cubo com metade da aresta a mais de cada lado */
+static void cuboSolto(float* centro, float* tamanho, caixaItem* solta) {
+  for (int d = 0; d < DIM; d++) {
+    solta->minimo[d] = centro[d] - tamanho[d];
+    solta->maximo[d] = centro[d] + tamanho[d];
+  }
+}
+
+static int contemCaixa(caixaItem* fora, caixaItem* dentro) {
+  for (int d = 0; d < DIM; d++) {
+    if (dentro->minimo[d] < fora->minimo[d] || dentro->maximo[d] > fora->maximo[d]) return 0;
+  }
+  return 1;
+}
+
+static float sobrepoe(caixaItem* caixa, void* contexto) {
+  caixaItem* janela = (caixaItem*) contexto;
+  for (int d = 0; d < DIM; d++) {
+    if (caixa->minimo[d] > janela->maximo[d] || janela->minimo[d] > caixa->maximo[d]) return -1;
+  }
+  return 0;
+}
+
+static float pertoDoCentro(caixaItem* caixa, void* contexto) {
+  esferaBusca* e = (esferaBusca*) contexto;
+  const float c[DIM] = {e->centro.x, e->centro.y, e->centro.z};
+  float d2 = 0;
+  for (int d = 0; d < DIM; d++) {
+    float fora = fmaxf(caixa->minimo[d] - c[d], fmaxf(0, c[d] - caixa->maximo[d]));
+    d2 += fora * fora;
+  }
+  return (d2 <= e->raio2) ? 0 : -1;
+}
+
+/* Método das placas: o intervalo de t dentro da caixa em cada eixo */
+static float atravessa(caixaItem* caixa, void* contexto) {
+  raioDeVisada* r = (raioDeVisada*) contexto;
+  const float o[DIM] = {r->origem.x, r->origem.y, r->origem.z};
+  const float v[DIM] = {r->direcao.x, r->direcao.y, r->direcao.z};
+  float entrada = 0, saida = r->tMaximo;
+
+  for (int d = 0; d < DIM; d++) {
+    if (v[d] == 0) {
+      if (o[d] < caixa->minimo[d] || o[d] > caixa->maximo[d]) return -1;
+      continue;
+    }
+    float t0 = (caixa->minimo[d] - o[d]) / v[d];
+    float t1 = (caixa->maximo[d] - o[d]) / v[d];
+    if (t0 > t1) { float tmp = t0; t0 = t1; t1 = tmp; }
+    entrada = fmaxf(entrada, t0);
+    saida = fminf(saida, t1);
+    if (entrada > saida) return -1;
+  }
+  return entrada;
+}
+
+
+/* Itens
+ * ----- */
+
+static void calculaCentro(caixaItem* caixa, amostra* centro) {
+  centro->x = (caixa->minimo[0] + caixa->maximo[0]) / 2;
+  centro->y = (caixa->minimo[1] + caixa->maximo[1]) / 2;
+  centro->z = (caixa->minimo[2] + caixa->maximo[2]) / 2;
+}
+
+/* Guarda o item no vetor do nó. Quem chama segura o lock de escrita. */
+static void guardaItem(noctree* no, itemSolto* item) {
+  if (no->qtPontos == no->capacidade) {
+    no->capacidade = (no->capacidade > 0) ? no->capacidade << 1 : 4;
+    no->pontos = (amostra**) realloc(no->pontos, sizeof(amostra*) * no->capacidade);
+    CHECK_MALLOC(no->pontos);
+    CONTA(bytesAlocados, sizeof(amostra*) * no->qtPontos);
+  }
+  no->pontos[no->qtPontos++] = &item->centro;
+}
+
+/* Tira do vetor do nó (sem liberar) o primeiro item com o id. Quem chama segura o lock de escrita. */
+static itemSolto* tiraItem(noctree* no, long long id) {
+  for (int i = 0; i < no->qtPontos; i++) {
+    itemSolto* item = (itemSolto*) no->pontos[i];
+    if (item->id == id) {
+      no->pontos[i] = no->pontos[--no->qtPontos];
+      return item;
+    }
+  }
+  return NULL;
+}
+
+/* O nó de uma caixa: desce pelo octante do centro enquanto o cubo alargado do filho contém a
+ * caixa. Com  cria , subdivide no caminho; sem, para no primeiro nó não subdividido (um item
+ * mais fundo teria subdividido o caminho). NULL se a árvore está congelada e precisava criar. */
+static noctree* noDaCaixa(noctree* raiz, caixaItem* caixa, int cria) {
+  amostra c;
+  calculaCentro(caixa, &c);
+
+  noctree* no = raiz;
+  while (no->profundidade <= NOCTREE_MAX_PROFUNDIDADE) {
+    int o = 0;
+    if (c.x >= no->centro->x) o += 1;
+    if (c.y >= no->centro->y) o += 2;
+    if (c.z >= no->centro->z) o += 4;
+
+    /* Mesmas contas de  subdividir : o cubo alargado é o que as consultas vão usar */
+    float tamanho[DIM], centro[DIM];
+    float pai[DIM] = {no->centro->x, no->centro->y, no->centro->z};
+    for (int d = 0; d < DIM; d++) tamanho[d] = no->tamanho[d] / 2.0f;
+    centroDoOctante(pai, tamanho, o, centro);
+    caixaItem solta;
+    cuboSolto(centro, tamanho, &solta);
+    if (!contemCaixa(&solta, caixa)) break;
+
+    int travou = travaLeitura(no);
+    int subdividido = no->subdividido;
+    destravaLeitura(no, travou);
+
+    if (!subdividido) {
+      if (!cria) break;
+      LOCK_ESCRITA(no);
+      if (no->congelado) {
+        DESTRAVA(no);
+        return NULL;
+      }
+      if (!no->subdividido) subdividir(no);
+      DESTRAVA(no);
+    }
+    no = no->filhos[o];
+  }
+  return no;
+}
+
+
+/* Consultas
+ * --------- */
+
+static void acrescentaImpacto(vetorImpactos* v, long long id, float t) {
+  if (v->qt == v->capacidade) {
+    v->capacidade = (v->capacidade > 0) ? v->capacidade * 2 : 64;
+    v->impactos = (impactoSolto*) realloc(v->impactos, sizeof(impactoSolto) * v->capacidade);
+    CHECK_MALLOC(v->impactos);
+  }
+  v->impactos[v->qt++] = (impactoSolto){id, t};
+}
+
+/* Visita os nós cujo cubo alargado passa no teste e testa os seus itens. Os itens da raiz são
+ * sempre testados (podem estar fora do cubo). */
+static void percorre(noctree* no, int ehRaiz, testeCaixa teste, void* contexto, vetorImpactos* v) {
+  if (!ehRaiz) {
+    float centro[DIM] = {no->centro->x, no->centro->y, no->centro->z};
+    caixaItem solta;
+    cuboSolto(centro, no->tamanho, &solta);
+    if (teste(&solta, contexto) < 0) return;
+  }
+
+  int travou = travaLeitura(no);
+  CONTA(nosVisitados, 1);
+  CONTA(pontosTestados, no->qtPontos);
+  for (int i = 0; i < no->qtPontos; i++) {
+    itemSolto* item = (itemSolto*) no->pontos[i];
+    float t = teste(&item->caixa, contexto);
+    if (t >= 0) acrescentaImpacto(v, item->id, t);
+  }
+  int subdividido = no->subdividido;
+  destravaLeitura(no, travou);
+
+  /* Os filhos, uma vez criados, não mudam */
+  if (subdividido) {
+    for (int i = 0; i < QT_FILHOS_NOCTREE; i++) percorre(no->filhos[i], 0, teste, contexto, v);
+  }
+}
+
+static int apenasIds(vetorImpactos* v, long long** ids) {
+  *ids = NULL;
+  if (v->qt > 0) {
+    *ids = (long long*) malloc(sizeof(long long) * v->qt);
+    CHECK_MALLOC(*ids);
+    for (int i = 0; i < v->qt; i++) (*ids)[i] = v->impactos[i].id;
+  }
+  free(v->impactos);
+  CONTA(consultas, 1);
+  CONTA(pontosDevolvidos, v->qt);
+  return v->qt;
+}
+
+static int comparaImpactos(const void* a, const void* b) {
+  float ta = ((const impactoSolto*) a)->t, tb = ((const impactoSolto*) b)->t;
+  return (ta > tb) - (ta < tb);
+}
+
+
+/* Interface
+ * --------- */
+
+noctree* inicializaSolta(amostra* centro, float* tamanho) {
+  noctree* raiz = inicializaNo(centro, tamanho, 0);
+  free(raiz->pontos);
+  raiz->pontos = NULL;
+  raiz->capacidade = 0;
+  raiz->modo = NOCTREE_MODO_SOLTO;
+  return raiz;
+}
+
+int insereItemSolto(noctree* raiz, caixaItem* caixa, long long id) {
+  if (raiz->modo != NOCTREE_MODO_SOLTO || raiz->congelado) return 0;
+
+  noctree* no = noDaCaixa(raiz, caixa, 1);
+  if (no == NULL) return 0;
+
+  itemSolto* item = (itemSolto*) malloc(sizeof(itemSolto));
+  CHECK_MALLOC(item);
+  CONTA(bytesAlocados, sizeof(itemSolto));
+  calculaCentro(caixa, &item->centro);
+  item->caixa = *caixa;
+  item->id = id;
+
+  LOCK_ESCRITA(no);
+  if (no->congelado) { // Congelada enquanto esperávamos o lock
+    DESTRAVA(no);
+    free(item);
+    return 0;
+  }
+  guardaItem(no, item);
+  DESTRAVA(no);
+  return 1;
+}
+
+int removeItemSolto(noctree* raiz, long long id, caixaItem* caixa) {
+  if (raiz->modo != NOCTREE_MODO_SOLTO || raiz->congelado) return 0;
+
+  noctree* no = noDaCaixa(raiz, caixa, 0);
+  LOCK_ESCRITA(no);
+  itemSolto* item = no->congelado ? NULL : tiraItem(no, id);
+  DESTRAVA(no);
+
+  free(item);
+  return item != NULL;
+}
+
+int moveItemSolto(noctree* raiz, long long id, caixaItem* atual, caixaItem* nova) {
+  if (raiz->modo != NOCTREE_MODO_SOLTO || raiz->congelado) return 0;
+
+  noctree* origem = noDaCaixa(raiz, atual, 0);
+  noctree* destino = noDaCaixa(raiz, nova, 1);
+  if (destino == NULL) return 0;
+
+  /* Caso comum: o item continua no mesmo nó, só a caixa muda */
+  if (origem == destino) {
+    LOCK_ESCRITA(origem);
+    int achou = 0;
+    for (int i = 0; i < origem->qtPontos && !achou && !origem->congelado; i++) {
+      itemSolto* item = (itemSolto*) origem->pontos[i];
+      if (item->id == id) {
+        calculaCentro(nova, &item->centro);
+        item->caixa = *nova;
+        achou = 1;
+      }
+    }
+    DESTRAVA(origem);
+    return achou;
+  }
+
+  /* Senão, sai de um nó e entra no outro com os dois locks (na ordem dos endereços, para dois
+   * movimentos opostos não se travarem): nenhum dos dois pode ser congelado no meio, e o item
+   * nunca fica fora da árvore */
+  noctree* primeiro = ((uintptr_t) origem < (uintptr_t) destino) ? origem : destino;
+  noctree* segundo = (primeiro == origem) ? destino : origem;
+  LOCK_ESCRITA(primeiro);
+  LOCK_ESCRITA(segundo);
+  itemSolto* item = (origem->congelado || destino->congelado) ? NULL : tiraItem(origem, id);
+  if (item != NULL) {
+    calculaCentro(nova, &item->centro);
+    item->caixa = *nova;
+    guardaItem(destino, item);
+  }
+  DESTRAVA(segundo);
+  DESTRAVA(primeiro);
+  return item != NULL;
+}
+
+int buscaSobreposicao(noctree* raiz, caixaItem* caixa, long long** ids) {
+  vetorImpactos v = {NULL, 0, 0};
+  percorre(raiz, 1, sobrepoe, caixa, &v);
+  return apenasIds(&v, ids);
+}
+
+int buscaItensPorRegiao(noctree* raiz, amostra* centro, float raio, long long** ids) {
+  esferaBusca e = {*centro, raio * raio};
+  vetorImpactos v = {NULL, 0, 0};
+  if (raio >= 0) percorre(raiz, 1, pertoDoCentro, &e, &v);
+  return apenasIds(&v, ids);
+}
+
+int lancaRaioSolto(noctree* raiz, amostra* origem, amostra* direcao, float tMaximo, impactoSolto** impactos) {
+  raioDeVisada r = {*origem, *direcao, tMaximo};
+  vetorImpactos v = {NULL, 0, 0};
+  if (tMaximo >= 0) percorre(raiz, 1, atravessa, &r, &v);
+
+  if (v.qt > 1) qsort(v.impactos, v.qt, sizeof(impactoSolto), comparaImpactos);
+  CONTA(consultas, 1);
+  CONTA(pontosDevolvidos, v.qt);
+  *impactos = v.impactos;
+  return v.qt;
+}
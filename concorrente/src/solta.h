@@ -0,0 +1,125 @@
+/* Octree solta (modo NOCTREE_MODO_SOLTO): itens com extensão.
+ *
+ * Caixas de objetos detectados, triângulos de malha: itens que atravessam as faces dos
+ * octantes e, numa árvore de pontos, não teriam folha. Na octree solta, o cubo de cada nó é
+ * alargado (fator 2: metade da aresta para cada lado) e o item fica no nó mais fundo cujo
+ * cubo contém o centro do item e cujo cubo alargado contém o item inteiro. A profundidade
+ * sai só do tamanho do item, e qualquer nó (não só as folhas) guarda itens.
+ *
+ * Os nós são os mesmos da árvore de pontos: criados por  subdividir , com o mesmo lock por
+ * nó, liberados por  destroiNo  (que libera também os itens) e congeláveis com  congela .
+ * Os itens ficam no vetor  pontos  de cada nó: um  itemSolto  começa pelo seu centro, e é
+ * esse ponteiro que o vetor guarda. Itens grandes demais ou com centro fora do cubo ficam
+ * na raiz.
+ *
+ * Exemplo:
+ *    noctree* cena = inicializaSolta(inicializaAmostra(0,0,0), (float[]){100,100,100});
+ *    insereItemSolto(cena, &(caixaItem){{1,1,0}, {3,2,1}}, 42);
+ *    long long* ids;
+ *    int qt = buscaSobreposicao(cena, &janela, &ids);
+ *    free(ids);
+ *    moveItemSolto(cena, 42, &caixaAntiga, &caixaNova);
+ *    destroiNo(cena);
+*/
+
+#ifndef SOLTA_H
+#define SOLTA_H
+
+#include "noctree.h"
+
+/**
+ * Caixa alinhada aos eixos.
+ */
+typedef struct _CaixaItem {
+  float minimo[DIM], maximo[DIM];
+} caixaItem;
+
+/**
+ * Um item guardado num nó. O centro vem primeiro: é ele que o vetor  pontos  do nó aponta.
+ */
+typedef struct _ItemSolto {
+  amostra centro;                      // Centro da caixa (decide o nó)
+  caixaItem caixa;
+  long long id;                        // Identificador de quem inseriu
+} itemSolto;
+
+/**
+ * Um item atingido por um raio.
+ */
+typedef struct _ImpactoSolto {
+  long long id;
+  float t;                             // Parâmetro de entrada do raio na caixa (0 se a origem está dentro)
+} impactoSolto;
+
+/**
+ * Cria uma octree solta vazia.
+ *
+ * @param centro é o centro do cubo (passa a pertencer à árvore)
+ * @param tamanho são as dimensões do cubo
+ *
+ * @return a raiz (libere com  destroiNo )
+ */
+noctree* inicializaSolta(amostra* centro, float* tamanho);
+
+/**
+ * Insere um item.
+ *
+ * @param raiz é a raiz da árvore
+ * @param caixa é a caixa do item
+ * @param id é o identificador do item (não precisa ser único, mas  moveItemSolto  e  removeItemSolto
+ *        tratam o primeiro que acharem)
+ *
+ * @return 1, se ok
+ *         0, se a árvore não está no modo solto ou está congelada
+ */
+int insereItemSolto(noctree* raiz, caixaItem* caixa, long long id);
+
+/**
+ * Remove um item.
+ *
+ * @param caixa é a caixa com que o item está na árvore (ela diz em que nó ele está)
+ *
+ * @return 1, se o item foi achado e removido; 0, c.c.
+ */
+int removeItemSolto(noctree* raiz, long long id, caixaItem* caixa);
+
+/**
+ * Move um item. Se o item continua cabendo no mesmo nó (o caso comum de um objeto que
+ * anda pouco entre quadros), só a caixa é trocada, sem tirar o item do vetor.
+ *
+ * @param atual é a caixa com que o item está na árvore
+ * @param nova é a nova caixa
+ *
+ * @return 1, se o item foi achado e movido; 0, c.c.
+ */
+int moveItemSolto(noctree* raiz, long long id, caixaItem* atual, caixaItem* nova);
+
+/**
+ * Acha os itens cuja caixa intersecta uma caixa (as faces contam).
+ *
+ * @param ids recebe os identificadores (libere com  free ; NULL se não há nenhum)
+ *
+ * @return quantidade de itens
+ */
+int buscaSobreposicao(noctree* raiz, caixaItem* caixa, long long** ids);
+
+/**
+ * Acha os itens cuja caixa está a até  raio  de um ponto (como  buscaPorRegiao , para itens).
+ *
+ * @param ids recebe os identificadores (libere com  free ; NULL se não há nenhum)
+ *
+ * @return quantidade de itens
+ */
+int buscaItensPorRegiao(noctree* raiz, amostra* centro, float raio, long long** ids);
+
+/**
+ * Acha os itens atingidos por um raio  origem + t * direcao , com  0 <= t <= tMaximo .
+ *
+ * @param direcao não precisa ser unitária (t fica na unidade dela)
+ * @param impactos recebe os itens em ordem crescente de t (libere com  free ; NULL se não há nenhum)
+ *
+ * @return quantidade de itens
+ */
+int lancaRaioSolto(noctree* raiz, amostra* origem, amostra* direcao, float tMaximo, impactoSolto** impactos);
+
+#endif
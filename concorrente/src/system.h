@@ -6,6 +6,7 @@
 #include <string.h>
 #include <errno.h>
 #include <pthread.h>
+#include <stdint.h>
 
 /* DEFINIÇÕES
    ---------- */
@@ -17,10 +18,29 @@
 #define QT_FILHOS_NOCTREE          8 // Quantidade de filhos de cada Nó Octree
 #define NOCTREE_MAX_PROFUNDIDADE   8 // Limite para a recursão de subdivisão
 
+/* Política de sincronização dos nós, escolhida na compilação (-DNOCTREE_POLITICA=...) */
+#define NOCTREE_POLITICA_SEM_LOCK  0 // Uma thread só: o nó não tem lock, e travar não faz nada
+#define NOCTREE_POLITICA_RWLOCK    1 // Um rwlock por nó (padrão)
+#ifndef NOCTREE_POLITICA
+#define NOCTREE_POLITICA           NOCTREE_POLITICA_RWLOCK
+#endif
+
+/* Tamanho da linha de cache, usado para separar dados escritos por threads diferentes */
+#define TAM_LINHA_CACHE           64
+
+/* Modos de armazenamento das amostras nas folhas */
+#define NOCTREE_MODO_PONTEIRO      0 // Vetor de amostra* (padrão)
+#define NOCTREE_MODO_QUANTIZADO    1 // Deslocamentos de 16 bits em relação ao canto mínimo da folha
+#define NOCTREE_MODO_OCUPACAO      2 // Sem amostras: cada folha guarda o log-odds de ocupação do seu cubo (ver ocupacao.h)
+#define NOCTREE_MODO_SOLTO         3 // Octree solta: qualquer nó guarda itens com extensão em  pontos  (ver solta.h)
+#define NOCTREE_MODO_INDICE        4 // Índices de 32 bits num vetor de coordenadas de quem chama (ver  usaIndices )
+#define NOCTREE_QUANT_MAX      65535 // Maior valor de uma coordenada quantizada
+
 /* ERROS
    ---------- */
 #define ERRO_ALOCACAO              1
 #define ERRO_LOCK                  2
+#define ERRO_THREAD                3
 
 // Macro para logar erros
 #define LOG_ERROR(codigo, fmt, ...) \
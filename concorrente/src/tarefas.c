@@ -0,0 +1,248 @@
+/**
+ * @file tarefas.c
+ *
+ * Pool de tarefas com roubo de trabalho. Para ver a documentação, consulte o header.
+ */
+
+#define _GNU_SOURCE // pthread_setaffinity_np
+#include "tarefas.h"
+#include <sched.h>
+#include <unistd.h>
+
+#define DEQUE_CAPACIDADE_INICIAL  256
+
+/* Trabalhador da thread atual (e de qual pool) */
+static _Thread_local poolTarefas* poolDaThread = NULL;
+static _Thread_local int idDaThread = -1;
+
+/* Pool padrão da biblioteca */
+static poolTarefas* padrao = NULL;
+static int padraoTrabalhadores = 0, padraoAfinidade = 0;
+static pthread_mutex_t mutexPadrao = PTHREAD_MUTEX_INITIALIZER;
+
+typedef struct {
+  poolTarefas* pool;
+  int id;
+  int afinidade;
+} argTrabalhador;
+
+
+/* Deque
+ * ----- */
+
+static void iniciaDeque(dequeTarefas* d) {
+  pthread_mutex_init(&d->mutex, NULL);
+  d->capacidade = DEQUE_CAPACIDADE_INICIAL;
+  d->tarefas = (tarefa*) malloc(sizeof(tarefa) * d->capacidade);
+  CHECK_MALLOC(d->tarefas);
+  d->topo = d->fundo = 0;
+}
+
+/* Empilha no fundo, dobrando o vetor se ele encheu */
+static void empilhaNoFundo(dequeTarefas* d, tarefa t) {
+  pthread_mutex_lock(&d->mutex);
+  if (d->fundo - d->topo == d->capacidade) {
+    tarefa* novo = (tarefa*) malloc(sizeof(tarefa) * d->capacidade * 2);
+    CHECK_MALLOC(novo);
+    for (long i = d->topo; i < d->fundo; i++) {
+      novo[i & (2 * d->capacidade - 1)] = d->tarefas[i & (d->capacidade - 1)];
+    }
+    free(d->tarefas);
+    d->tarefas = novo;
+    d->capacidade *= 2;
+  }
+  d->tarefas[d->fundo & (d->capacidade - 1)] = t;
+  d->fundo++;
+  pthread_mutex_unlock(&d->mutex);
+}
+
+/* O dono tira do fundo (LIFO); o ladrão, do topo (FIFO) */
+static int retira(dequeTarefas* d, tarefa* t, int peloFundo) {
+  int achou = 0;
+  pthread_mutex_lock(&d->mutex);
+  if (d->fundo > d->topo) {
+    if (peloFundo) *t = d->tarefas[--d->fundo & (d->capacidade - 1)];
+    else           *t = d->tarefas[d->topo++ & (d->capacidade - 1)];
+    achou = 1;
+  }
+  pthread_mutex_unlock(&d->mutex);
+  return achou;
+}
+
+
+/* Execução
+ * -------- */
+
+/* Procura uma tarefa: primeiro no próprio deque, depois roubando dos outros */
+static int pegaTarefa(poolTarefas* pool, int id, tarefa* t) {
+  if (id >= 0 && retira(&pool->deques[id], t, 1)) return 1;
+
+  int n = pool->qtTrabalhadores;
+  int inicio = (id >= 0) ? id + 1 : (int)(atomic_load_explicit(&pool->proximoDeque, memory_order_relaxed) % n);
+  for (int k = 0; k < n; k++) {
+    int vitima = (inicio + k) % n;
+    if (vitima != id && retira(&pool->deques[vitima], t, 0)) return 1;
+  }
+  return 0;
+}
+
+static void executaTarefa(poolTarefas* pool, tarefa* t) {
+  atomic_fetch_sub(&pool->enfileiradas, 1);
+  t->funcao(t->arg);
+  atomic_fetch_sub_explicit(&t->grupo->pendentes, 1, memory_order_release);
+}
+
+static void* rotinaTrabalhador(void* arg) {
+  argTrabalhador a = *(argTrabalhador*) arg;
+  poolTarefas* pool = a.pool;
+  tarefa t;
+  free(arg);
+
+  poolDaThread = pool;
+  idDaThread = a.id;
+
+  if (a.afinidade) {
+    long nucleos = sysconf(_SC_NPROCESSORS_ONLN);
+    cpu_set_t conjunto;
+    CPU_ZERO(&conjunto);
+    CPU_SET(a.id % (nucleos > 0 ? nucleos : 1), &conjunto);
+    pthread_setaffinity_np(pthread_self(), sizeof(cpu_set_t), &conjunto); // Se falhar, segue sem afinidade
+  }
+
+  while (1) {
+    if (pegaTarefa(pool, a.id, &t)) {
+      executaTarefa(pool, &t);
+      continue;
+    }
+
+    /* Nada para fazer: dorme até chegar tarefa (ver  submeteTarefa  para a ordem dos contadores) */
+    pthread_mutex_lock(&pool->mutexSono);
+    atomic_fetch_add(&pool->dormindo, 1);
+    while (atomic_load(&pool->enfileiradas) == 0 && !atomic_load(&pool->encerrar)) {
+      pthread_cond_wait(&pool->acorda, &pool->mutexSono);
+    }
+    atomic_fetch_sub(&pool->dormindo, 1);
+    pthread_mutex_unlock(&pool->mutexSono);
+
+    if (atomic_load(&pool->encerrar) && atomic_load(&pool->enfileiradas) == 0) break;
+  }
+  return NULL;
+}
+
+
+/* Interface
+ * --------- */
+
+poolTarefas* criaPool(int qtTrabalhadores, int afinidade) {
+  if (qtTrabalhadores <= 0) qtTrabalhadores = (int) sysconf(_SC_NPROCESSORS_ONLN);
+  if (qtTrabalhadores <= 0) qtTrabalhadores = 1;
+
+  poolTarefas* pool = (poolTarefas*) malloc(sizeof(poolTarefas));
+  CHECK_MALLOC(pool);
+  pool->qtTrabalhadores = qtTrabalhadores;
+  pool->threads = (pthread_t*) malloc(sizeof(pthread_t) * qtTrabalhadores);
+  pool->deques = (dequeTarefas*) aligned_alloc(TAM_LINHA_CACHE, sizeof(dequeTarefas) * qtTrabalhadores);
+  CHECK_MALLOC(pool->threads);
+  CHECK_MALLOC(pool->deques);
+  atomic_init(&pool->enfileiradas, 0);
+  atomic_init(&pool->dormindo, 0);
+  atomic_init(&pool->encerrar, 0);
+  atomic_init(&pool->proximoDeque, 0);
+  pthread_mutex_init(&pool->mutexSono, NULL);
+  pthread_cond_init(&pool->acorda, NULL);
+
+  for (int i = 0; i < qtTrabalhadores; i++) iniciaDeque(&pool->deques[i]);
+
+  for (int i = 0; i < qtTrabalhadores; i++) {
+    argTrabalhador* a = (argTrabalhador*) malloc(sizeof(argTrabalhador));
+    CHECK_MALLOC(a);
+    *a = (argTrabalhador){pool, i, afinidade};
+    if (pthread_create(&pool->threads[i], NULL, rotinaTrabalhador, a) != 0) {
+      LOG_ERROR(ERRO_THREAD, "Falha na criação do trabalhador %d", i);
+    }
+  }
+  return pool;
+}
+
+void destroiPool(poolTarefas* pool) {
+  if (pool == NULL) return;
+
+  pthread_mutex_lock(&pool->mutexSono);
+  atomic_store(&pool->encerrar, 1);
+  pthread_cond_broadcast(&pool->acorda);
+  pthread_mutex_unlock(&pool->mutexSono);
+
+  /* Só depois de todos saírem: até lá, qualquer um ainda pode tentar roubar de qualquer deque */
+  for (int i = 0; i < pool->qtTrabalhadores; i++) pthread_join(pool->threads[i], NULL);
+  for (int i = 0; i < pool->qtTrabalhadores; i++) {
+    pthread_mutex_destroy(&pool->deques[i].mutex);
+    free(pool->deques[i].tarefas);
+  }
+  pthread_mutex_destroy(&pool->mutexSono);
+  pthread_cond_destroy(&pool->acorda);
+  free(pool->deques);
+  free(pool->threads);
+  free(pool);
+}
+
+static void destroiPoolPadrao(void) {
+  destroiPool(padrao);
+  padrao = NULL;
+}
+
+poolTarefas* poolPadrao(void) {
+  pthread_mutex_lock(&mutexPadrao);
+  if (padrao == NULL) {
+    padrao = criaPool(padraoTrabalhadores, padraoAfinidade);
+    atexit(destroiPoolPadrao);
+  }
+  pthread_mutex_unlock(&mutexPadrao);
+  return padrao;
+}
+
+int configuraPoolPadrao(int qtTrabalhadores, int afinidade) {
+  int ok = 0;
+  pthread_mutex_lock(&mutexPadrao);
+  if (padrao == NULL) {
+    padraoTrabalhadores = qtTrabalhadores;
+    padraoAfinidade = afinidade;
+    ok = 1;
+  }
+  pthread_mutex_unlock(&mutexPadrao);
+  return ok;
+}
+
+void iniciaGrupo(grupoTarefas* grupo) {
+  atomic_init(&grupo->pendentes, 0);
+}
+
+void submeteTarefa(poolTarefas* pool, grupoTarefas* grupo, void (*funcao)(void*), void* arg) {
+  int id = trabalhadorAtual(pool);
+  if (id < 0) id = (int)(atomic_fetch_add_explicit(&pool->proximoDeque, 1, memory_order_relaxed) % pool->qtTrabalhadores);
+
+  atomic_fetch_add_explicit(&grupo->pendentes, 1, memory_order_relaxed);
+  empilhaNoFundo(&pool->deques[id], (tarefa){funcao, arg, grupo});
+
+  /* Primeiro conta a tarefa, depois olha quem dorme: o trabalhador faz o contrário
+   * (conta que vai dormir, depois olha as tarefas), então um dos dois sempre vê o outro. */
+  atomic_fetch_add(&pool->enfileiradas, 1);
+  if (atomic_load(&pool->dormindo) > 0) {
+    pthread_mutex_lock(&pool->mutexSono);
+    pthread_cond_signal(&pool->acorda);
+    pthread_mutex_unlock(&pool->mutexSono);
+  }
+}
+
+void esperaGrupo(poolTarefas* pool, grupoTarefas* grupo) {
+  int id = trabalhadorAtual(pool);
+  tarefa t;
+
+  while (atomic_load_explicit(&grupo->pendentes, memory_order_acquire) > 0) {
+    if (pegaTarefa(pool, id, &t)) executaTarefa(pool, &t);
+    else sched_yield(); // As tarefas restantes já estão rodando em outros trabalhadores
+  }
+}
+
+int trabalhadorAtual(poolTarefas* pool) {
+  return (poolDaThread == pool) ? idDaThread : -1;
+}
@@ -0,0 +1,114 @@
+/* Pool de tarefas com roubo de trabalho.
+ *
+ * Cada trabalhador tem o seu deque: empilha e desempilha as próprias tarefas pelo
+ * fundo (as mais recentes, ainda quentes na cache) e, quando fica sem nada, rouba
+ * pelo topo do deque de outro (as mais antigas, que costumam ser as maiores
+ * subárvores). Tarefas criadas fora do pool são distribuídas entre os deques.
+ *
+ * O paralelismo é do tipo fork-join: as tarefas de uma operação pertencem a um
+ * grupoTarefas, e quem espera o grupo ajuda a executar tarefas enquanto espera,
+ * então uma tarefa pode criar subtarefas e esperá-las sem travar o pool.
+ *
+ * Exemplo:
+ *    grupoTarefas g;
+ *    iniciaGrupo(&g);
+ *    for (int i = 0; i < 8; i++) submeteTarefa(poolPadrao(), &g, processaFilho, filhos[i]);
+ *    esperaGrupo(poolPadrao(), &g);
+*/
+
+#ifndef TAREFAS_H
+#define TAREFAS_H
+
+#include "system.h"
+#include <stdatomic.h>
+
+/**
+ * Conjunto de tarefas que se espera juntas.
+ */
+typedef struct _GrupoTarefas {
+  _Atomic long pendentes;              // Tarefas submetidas e ainda não terminadas
+} grupoTarefas;
+
+typedef struct _Tarefa {
+  void (*funcao)(void*);
+  void* arg;
+  grupoTarefas* grupo;
+} tarefa;
+
+/**
+ * Deque de um trabalhador: vetor circular que cresce, protegido por um mutex
+ * (o dono e os ladrões raramente disputam, pois usam pontas opostas).
+ */
+typedef struct _DequeTarefas {
+  _Alignas(TAM_LINHA_CACHE) pthread_mutex_t mutex;
+  tarefa* tarefas;
+  long capacidade;                     // Potência de 2
+  long topo;                           // Ponta dos ladrões
+  long fundo;                          // Ponta do dono
+} dequeTarefas;
+
+/**
+ * O pool.
+ */
+typedef struct _PoolTarefas {
+  int qtTrabalhadores;
+  pthread_t* threads;
+  dequeTarefas* deques;                // Um por trabalhador
+  _Atomic long enfileiradas;           // Tarefas nos deques (ainda não começadas)
+  _Atomic int dormindo;                // Trabalhadores esperando em  acorda
+  _Atomic int encerrar;
+  _Atomic unsigned proximoDeque;       // Distribui as tarefas submetidas de fora
+  pthread_mutex_t mutexSono;
+  pthread_cond_t acorda;
+} poolTarefas;
+
+/**
+ * Cria um pool.
+ *
+ * @param qtTrabalhadores é a quantidade de threads (0 = uma por núcleo)
+ * @param afinidade 1 fixa o trabalhador i no núcleo i (módulo a quantidade de núcleos); 0 deixa com o escalonador
+ *
+ * @return o pool, já com os trabalhadores esperando tarefas
+ */
+poolTarefas* criaPool(int qtTrabalhadores, int afinidade);
+
+/**
+ * Espera as tarefas enfileiradas, encerra os trabalhadores e libera o pool.
+ */
+void destroiPool(poolTarefas* pool);
+
+/**
+ * Pool da biblioteca, usado pelas operações paralelas da árvore. É criado no
+ * primeiro uso, com a configuração de  configuraPoolPadrao  (ou uma thread por núcleo).
+ */
+poolTarefas* poolPadrao(void);
+
+/**
+ * Define a quantidade de threads e a afinidade do pool padrão. Só tem efeito antes do primeiro  poolPadrao() .
+ *
+ * @return 1, se ok
+ *         0, se o pool padrão já existe
+ */
+int configuraPoolPadrao(int qtTrabalhadores, int afinidade);
+
+/**
+ * Zera um grupo de tarefas.
+ */
+void iniciaGrupo(grupoTarefas* grupo);
+
+/**
+ * Submete uma tarefa ao pool. Dentro de um trabalhador, vai para o próprio deque; fora, para o de algum trabalhador.
+ */
+void submeteTarefa(poolTarefas* pool, grupoTarefas* grupo, void (*funcao)(void*), void* arg);
+
+/**
+ * Espera todas as tarefas do grupo, executando tarefas do pool enquanto isso.
+ */
+void esperaGrupo(poolTarefas* pool, grupoTarefas* grupo);
+
+/**
+ * Índice do trabalhador que executa a thread atual neste pool, ou -1 se a thread não é dele.
+ */
+int trabalhadorAtual(poolTarefas* pool);
+
+#endif
@@ -0,0 +1,165 @@
+/**
+ * @file vizinhanca.c
+ *
+ * Trabalho por folha com vizinhança compartilhada. Para ver a documentação, consulte o header.
+ */
+
+#include "vizinhanca.h"
+
+/* Uma tarefa: um intervalo de folhas e a sua vizinhança */
+typedef struct {
+  fotografiaOctree* f;
+  long long de, ate;                   // Folhas [de, ate)
+  void (*funcao)(fotografiaOctree*, folhaFotografada*, vizinhanca*, void*);
+  void* contexto;
+} argFolhas;
+
+
+/* Fotografia
+ * ---------- */
+
+static void fotografaNo(noctree* no, fotografiaOctree* f) {
+  int travou = travaLeitura(no);
+  if (no->subdividido) {
+    destravaLeitura(no, travou);
+    for (int i = 0; i < QT_FILHOS_NOCTREE; i++) fotografaNo(no->filhos[i], f);
+    return;
+  }
+
+  if (no->qtPontos > 0) {
+    if (f->qtFolhas == f->capFolhas) {
+      f->capFolhas = (f->capFolhas > 0) ? f->capFolhas * 2 : 256;
+      f->folhas = (folhaFotografada*) realloc(f->folhas, sizeof(folhaFotografada) * f->capFolhas);
+      CHECK_MALLOC(f->folhas);
+    }
+    while (f->qt + no->qtPontos > f->capAmostras) {
+      f->capAmostras = (f->capAmostras > 0) ? f->capAmostras * 2 : 1024;
+      f->amostras = (amostra*) realloc(f->amostras, sizeof(amostra) * f->capAmostras);
+      CHECK_MALLOC(f->amostras);
+    }
+
+    float aresta = fmaxf(no->tamanho[0], fmaxf(no->tamanho[1], no->tamanho[2]));
+    f->folhas[f->qtFolhas++] = (folhaFotografada){f->qt, no->qtPontos, aresta, no};
+    for (int i = 0; i < no->qtPontos; i++) f->amostras[f->qt++] = leAmostra(no, i);
+  }
+  destravaLeitura(no, travou);
+}
+
+void fotografaOctree(noctree* raiz, fotografiaOctree* f) {
+  memset(f, 0, sizeof(fotografiaOctree));
+  f->raiz = raiz;
+  fotografaNo(raiz, f);
+}
+
+void liberaFotografia(fotografiaOctree* f) {
+  free(f->amostras);
+  free(f->folhas);
+  memset(f, 0, sizeof(fotografiaOctree));
+}
+
+
+/* Vizinhança
+ * ---------- */
+
+void caixaDaFolha(fotografiaOctree* f, folhaFotografada* folha, float margem, vizinhanca* v) {
+  amostra* pontos = f->amostras + folha->inicio;
+  v->minimo[0] = v->maximo[0] = pontos[0].x;
+  v->minimo[1] = v->maximo[1] = pontos[0].y;
+  v->minimo[2] = v->maximo[2] = pontos[0].z;
+  for (int i = 1; i < folha->qt; i++) {
+    float p[DIM] = {pontos[i].x, pontos[i].y, pontos[i].z};
+    for (int d = 0; d < DIM; d++) {
+      if (p[d] < v->minimo[d]) v->minimo[d] = p[d];
+      if (p[d] > v->maximo[d]) v->maximo[d] = p[d];
+    }
+  }
+  for (int d = 0; d < DIM; d++) {
+    v->minimo[d] -= margem;
+    v->maximo[d] += margem;
+  }
+}
+
+int caixaCobreRaiz(fotografiaOctree* f, vizinhanca* v) {
+  noctree* raiz = f->raiz;
+  float c[DIM] = {raiz->centro->x, raiz->centro->y, raiz->centro->z};
+  for (int d = 0; d < DIM; d++) {
+    if (v->minimo[d] > c[d] - raiz->tamanho[d] / 2 || v->maximo[d] < c[d] + raiz->tamanho[d] / 2) return 0;
+  }
+  return 1;
+}
+
+static int noIntersectaCaixa(noctree* no, vizinhanca* v) {
+  float c[DIM] = {no->centro->x, no->centro->y, no->centro->z};
+  for (int d = 0; d < DIM; d++) {
+    if (c[d] + no->tamanho[d] / 2 < v->minimo[d] || c[d] - no->tamanho[d] / 2 > v->maximo[d]) return 0;
+  }
+  return 1;
+}
+
+/* As folhas da borda podem guardar amostras fora do cubo da raiz, então a raiz sempre é visitada */
+static void coletaNo(noctree* no, noctree* raiz, vizinhanca* v) {
+  int travou = travaLeitura(no);
+  if (no != raiz && !noIntersectaCaixa(no, v)) {
+    destravaLeitura(no, travou);
+    return;
+  }
+
+  if (no->subdividido) {
+    destravaLeitura(no, travou);
+    for (int i = 0; i < QT_FILHOS_NOCTREE; i++) coletaNo(no->filhos[i], raiz, v);
+    return;
+  }
+
+  for (int i = 0; i < no->qtPontos; i++) {
+    amostra p = leAmostra(no, i);
+    if (p.x < v->minimo[0] || p.x > v->maximo[0] || p.y < v->minimo[1] || p.y > v->maximo[1] ||
+        p.z < v->minimo[2] || p.z > v->maximo[2]) continue;
+
+    if (v->qt == v->capacidade) {
+      v->capacidade = (v->capacidade > 0) ? v->capacidade * 2 : 256;
+      v->amostras = (amostra*) realloc(v->amostras, sizeof(amostra) * v->capacidade);
+      CHECK_MALLOC(v->amostras);
+    }
+    v->amostras[v->qt++] = p;
+  }
+  destravaLeitura(no, travou);
+}
+
+void coletaVizinhanca(fotografiaOctree* f, vizinhanca* v) {
+  v->qt = 0;
+  coletaNo(f->raiz, f->raiz, v);
+}
+
+
+/* Tarefas
+ * ------- */
+
+static void tarefaFolhas(void* arg) {
+  argFolhas* a = (argFolhas*) arg;
+  vizinhanca v;
+  memset(&v, 0, sizeof(vizinhanca));
+
+  for (long long i = a->de; i < a->ate; i++) a->funcao(a->f, &a->f->folhas[i], &v, a->contexto);
+  free(v.amostras);
+}
+
+void paraCadaFolha(fotografiaOctree* f, void (*funcao)(fotografiaOctree*, folhaFotografada*, vizinhanca*, void*), void* contexto) {
+  poolTarefas* pool = poolPadrao();
+  long long qtTarefas = (f->qtFolhas + VIZINHANCA_GRAO_FOLHAS - 1) / VIZINHANCA_GRAO_FOLHAS;
+  if (qtTarefas == 0) return;
+
+  argFolhas* args = (argFolhas*) malloc(sizeof(argFolhas) * qtTarefas);
+  CHECK_MALLOC(args);
+
+  grupoTarefas g;
+  iniciaGrupo(&g);
+  for (long long t = 0; t < qtTarefas; t++) {
+    long long de = t * VIZINHANCA_GRAO_FOLHAS;
+    long long ate = (de + VIZINHANCA_GRAO_FOLHAS < f->qtFolhas) ? de + VIZINHANCA_GRAO_FOLHAS : f->qtFolhas;
+    args[t] = (argFolhas){f, de, ate, funcao, contexto};
+    submeteTarefa(pool, &g, tarefaFolhas, &args[t]);
+  }
+  esperaGrupo(pool, &g);
+
+  free(args);
+}
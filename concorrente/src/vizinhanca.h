@@ -0,0 +1,96 @@
+/* Trabalho por folha com vizinhança compartilhada.
+ *
+ * Base dos filtros, das normais e dos agrupamentos: em vez de uma busca por amostra,
+ * cada folha coleta uma vez as amostras de uma caixa em volta das suas (a vizinhança)
+ * e processa todas as suas amostras contra ela. As folhas são divididas em tarefas
+ * no  poolPadrao() , e cada tarefa reaproveita o mesmo vetor de vizinhança entre as
+ * suas folhas, sem alocação por consulta.
+ *
+ * As amostras são lidas de uma fotografia da árvore: uma cópia, na ordem dos octantes
+ * (na folha, na ordem de inserção), com o intervalo de cada folha. Os resultados por
+ * amostra de quem usa este módulo ficam alinhados com  fotografiaOctree.amostras .
+ * A árvore não deve receber inserções enquanto isso (congelá-la antes evita também
+ * os locks de leitura).
+ *
+ * Exemplo:
+ *    fotografiaOctree f;
+ *    fotografaOctree(raiz, &f);
+ *    paraCadaFolha(&f, processaFolha, &contexto);   // processaFolha chama coletaVizinhanca
+ *    liberaFotografia(&f);
+*/
+
+#ifndef VIZINHANCA_H
+#define VIZINHANCA_H
+
+#include "paralelo.h"
+
+/* Folhas por tarefa */
+#define VIZINHANCA_GRAO_FOLHAS    32
+
+/**
+ * Uma folha da fotografia.
+ */
+typedef struct _FolhaFotografada {
+  long long inicio;                    // Primeira amostra da folha em  amostras
+  int qt;
+  float aresta;                        // Maior aresta da folha
+  noctree* no;                         // A folha na árvore
+} folhaFotografada;
+
+/**
+ * Cópia das amostras da árvore, folha a folha.
+ */
+typedef struct _FotografiaOctree {
+  noctree* raiz;
+  amostra* amostras;
+  long long qt;
+  folhaFotografada* folhas;
+  long long qtFolhas;
+  long long capAmostras, capFolhas;
+} fotografiaOctree;
+
+/**
+ * Amostras coletadas numa caixa. Pertence a uma tarefa e é reaproveitada entre as folhas.
+ */
+typedef struct _Vizinhanca {
+  float minimo[DIM], maximo[DIM];      // A caixa
+  amostra* amostras;
+  long long qt, capacidade;
+} vizinhanca;
+
+/**
+ * Copia as amostras da (sub)árvore, folha a folha (só as folhas com amostras).
+ */
+void fotografaOctree(noctree* raiz, fotografiaOctree* f);
+
+/**
+ * Libera os vetores da fotografia.
+ */
+void liberaFotografia(fotografiaOctree* f);
+
+/**
+ * Define a caixa da vizinhança: a caixa das amostras da folha, alargada por  margem .
+ */
+void caixaDaFolha(fotografiaOctree* f, folhaFotografada* folha, float margem, vizinhanca* v);
+
+/**
+ * Diz se a caixa cobre o cubo da raiz (nenhum vizinho no cubo fica fora dela).
+ */
+int caixaCobreRaiz(fotografiaOctree* f, vizinhanca* v);
+
+/**
+ * Coleta na vizinhança as amostras da árvore que estão na caixa (o que havia antes é descartado).
+ */
+void coletaVizinhanca(fotografiaOctree* f, vizinhanca* v);
+
+/**
+ * Chama  funcao  para cada folha da fotografia, em tarefas de VIZINHANCA_GRAO_FOLHAS folhas. Cada
+ * tarefa passa a sua vizinhança para as suas folhas; ela é liberada no fim.
+ *
+ * @param f é a fotografia
+ * @param funcao processa uma folha
+ * @param contexto é repassado para  funcao
+ */
+void paraCadaFolha(fotografiaOctree* f, void (*funcao)(fotografiaOctree*, folhaFotografada*, vizinhanca*, void*), void* contexto);
+
+#endif
@@ -0,0 +1,292 @@
+/**
+ * @file voxel.c
+ *
+ * Redução por grade de voxels. Para ver a documentação, consulte o header.
+ */
+
+#include "voxel.h"
+
+/* Amostras de um voxel, somadas enquanto a subárvore é percorrida */
+typedef struct {
+  amostra centro;                      // Centro do voxel
+  double soma[DIM];
+  long long qt;
+  amostra primeira, maisProxima;
+  float menorDist2;
+} acumulador;
+
+/* Amostra de uma folha rasa, com o voxel onde cai e a posição na folha (desempata a ordenação) */
+typedef struct {
+  uint64_t chave;
+  int ordem;
+  amostra p;
+} amostraComChave;
+
+/* Uma tarefa: a subárvore, o vetor próprio de saída e um rascunho reaproveitado pelas folhas */
+typedef struct {
+  noctree* no;
+  int niveis;                          // Níveis entre  no  e o voxel
+  int modo;
+  amostra* reduzidas;
+  int qt, capacidade;
+  amostraComChave* rascunho;
+  int capRascunho;
+} argVoxel;
+
+
+/* Acumulador
+ * ---------- */
+
+static void iniciaAcumulador(acumulador* a, amostra centro) {
+  a->centro = centro;
+  a->soma[0] = a->soma[1] = a->soma[2] = 0;
+  a->qt = 0;
+  a->menorDist2 = INFINITY;
+}
+
+static void acumula(acumulador* a, amostra p) {
+  if (a->qt == 0) a->primeira = p;
+  a->soma[0] += p.x;
+  a->soma[1] += p.y;
+  a->soma[2] += p.z;
+  a->qt++;
+
+  float d2 = dist2(&p, &a->centro);
+  if (d2 < a->menorDist2) {
+    a->menorDist2 = d2;
+    a->maisProxima = p;
+  }
+}
+
+/* Acrescenta o representante do voxel (se tem amostras) à saída da tarefa */
+static void emite(argVoxel* t, acumulador* a) {
+  if (a->qt == 0) return;
+
+  if (t->qt >= t->capacidade) {
+    t->capacidade = (t->capacidade > 0) ? t->capacidade * 2 : 64;
+    t->reduzidas = (amostra*) realloc(t->reduzidas, sizeof(amostra) * t->capacidade);
+    CHECK_MALLOC(t->reduzidas);
+  }
+
+  amostra r;
+  if (t->modo == VOXEL_PRIMEIRO) r = a->primeira;
+  else if (t->modo == VOXEL_MAIS_PROXIMO) r = a->maisProxima;
+  else r = (amostra){(float)(a->soma[0] / a->qt), (float)(a->soma[1] / a->qt), (float)(a->soma[2] / a->qt)};
+  t->reduzidas[t->qt++] = r;
+}
+
+
+/* Percurso
+ * -------- */
+
+/* Soma toda a subárvore num voxel só. Os filhos, uma vez criados, não mudam: desce sem o lock do pai. */
+static void colapsa(noctree* no, acumulador* a) {
+  int travou = travaLeitura(no);
+  if (no->subdividido) {
+    destravaLeitura(no, travou);
+    for (int i = 0; i < QT_FILHOS_NOCTREE; i++) colapsa(no->filhos[i], a);
+    return;
+  }
+
+  for (int i = 0; i < no->qtPontos; i++) acumula(a, leAmostra(no, i));
+  destravaLeitura(no, travou);
+}
+
+static int comparaChaves(const void* a, const void* b) {
+  const amostraComChave* x = (const amostraComChave*) a;
+  const amostraComChave* y = (const amostraComChave*) b;
+  if (x->chave != y->chave) return (x->chave < y->chave) ? -1 : 1;
+  return x->ordem - y->ordem;
+}
+
+/* Folha mais rasa que o voxel: separa as amostras pelos  2^niveis  voxels por eixo da folha.
+ * As amostras são copiadas com o lock; a ordenação e a soma, sem. */
+static void separaFolha(argVoxel* t, noctree* folha, int niveis, int travou) {
+  int qt = folha->qtPontos;
+  if (qt > t->capRascunho) {
+    t->capRascunho = qt;
+    t->rascunho = (amostraComChave*) realloc(t->rascunho, sizeof(amostraComChave) * qt);
+    CHECK_MALLOC(t->rascunho);
+  }
+
+  long long lado = 1LL << niveis;
+  float minimo[DIM], aresta[DIM];
+  float c[DIM] = {folha->centro->x, folha->centro->y, folha->centro->z};
+  for (int d = 0; d < DIM; d++) {
+    aresta[d] = folha->tamanho[d] / lado;
+    minimo[d] = c[d] - folha->tamanho[d] / 2;
+  }
+
+  for (int i = 0; i < qt; i++) {
+    amostra p = leAmostra(folha, i);
+    float v[DIM] = {p.x, p.y, p.z};
+    long long idx[DIM];
+    for (int d = 0; d < DIM; d++) {
+      idx[d] = (long long) floorf((v[d] - minimo[d]) / aresta[d]);
+      if (idx[d] < 0) idx[d] = 0;              // Amostras fora do cubo da raiz caem no voxel da borda
+      if (idx[d] >= lado) idx[d] = lado - 1;
+    }
+    t->rascunho[i] = (amostraComChave){(uint64_t)(idx[0] + lado * (idx[1] + lado * idx[2])), i, p};
+  }
+  destravaLeitura(folha, travou);
+
+  qsort(t->rascunho, qt, sizeof(amostraComChave), comparaChaves);
+
+  for (int i = 0; i < qt; ) {
+    uint64_t chave = t->rascunho[i].chave;
+    long long ix = chave % lado, iy = (chave / lado) % lado, iz = chave / lado / lado;
+    acumulador a;
+    iniciaAcumulador(&a, (amostra){minimo[0] + (ix + 0.5f) * aresta[0],
+                                   minimo[1] + (iy + 0.5f) * aresta[1],
+                                   minimo[2] + (iz + 0.5f) * aresta[2]});
+    for (; i < qt && t->rascunho[i].chave == chave; i++) acumula(&a, t->rascunho[i].p);
+    emite(t, &a);
+  }
+}
+
+static void passoVoxel(argVoxel* t, noctree* no, int niveis) {
+  /* Chegou no voxel: o nó inteiro vira uma amostra */
+  if (niveis == 0) {
+    acumulador a;
+    iniciaAcumulador(&a, *no->centro);
+    colapsa(no, &a);
+    emite(t, &a);
+    return;
+  }
+
+  int travou = travaLeitura(no);
+  if (no->subdividido) {
+    destravaLeitura(no, travou);
+    for (int i = 0; i < QT_FILHOS_NOCTREE; i++) passoVoxel(t, no->filhos[i], niveis - 1);
+    return;
+  }
+  separaFolha(t, no, niveis, travou); // Solta o lock
+}
+
+static void tarefaVoxel(void* arg) {
+  argVoxel* t = (argVoxel*) arg;
+  passoVoxel(t, t->no, t->niveis);
+}
+
+/* Reduz a árvore num vetor de amostras (valores, não ponteiros) */
+static amostra* reduz(noctree* raiz, float s, int modo, int* qt) {
+  float aresta[DIM];
+  int nivel = nivelDoVoxel(raiz, s, aresta);
+  poolTarefas* pool = poolPadrao();
+  int alvo = (pool->qtTrabalhadores + 1) * PARALELO_SUBARVORES_POR_TRABALHADOR;
+
+  /* Desce a parte de cima até haver subárvores para todos (ou até a profundidade do voxel) */
+  int capacidade = 1, qtFronteira = 1;
+  noctree** fronteira = (noctree**) malloc(sizeof(noctree*) * capacidade);
+  CHECK_MALLOC(fronteira);
+  fronteira[0] = raiz;
+
+  int desceu = 1;
+  while (qtFronteira < alvo && desceu) {
+    noctree** proxima = (noctree**) malloc(sizeof(noctree*) * qtFronteira * QT_FILHOS_NOCTREE);
+    CHECK_MALLOC(proxima);
+    int qtProxima = 0;
+
+    desceu = 0;
+    for (int i = 0; i < qtFronteira; i++) {
+      noctree* no = fronteira[i];
+      int subdividido = 0;
+      if (no->profundidade - raiz->profundidade < nivel) {
+        int travou = travaLeitura(no);
+        subdividido = no->subdividido;
+        destravaLeitura(no, travou);
+      }
+
+      if (subdividido) {
+        for (int k = 0; k < QT_FILHOS_NOCTREE; k++) proxima[qtProxima++] = no->filhos[k];
+        desceu = 1;
+      } else {
+        proxima[qtProxima++] = no;
+      }
+    }
+    free(fronteira);
+    fronteira = proxima;
+    qtFronteira = qtProxima;
+  }
+
+  /* Uma tarefa por subárvore, cada uma no seu vetor */
+  argVoxel* args = (argVoxel*) calloc(qtFronteira, sizeof(argVoxel));
+  CHECK_MALLOC(args);
+  grupoTarefas g;
+  iniciaGrupo(&g);
+  for (int i = 0; i < qtFronteira; i++) {
+    args[i] = (argVoxel){fronteira[i], nivel - (fronteira[i]->profundidade - raiz->profundidade), modo, NULL, 0, 0, NULL, 0};
+    submeteTarefa(pool, &g, tarefaVoxel, &args[i]);
+  }
+  esperaGrupo(pool, &g);
+
+  /* Concatena os vetores das tarefas */
+  *qt = 0;
+  for (int i = 0; i < qtFronteira; i++) *qt += args[i].qt;
+
+  amostra* reduzidas = (amostra*) malloc(sizeof(amostra) * (*qt > 0 ? *qt : 1));
+  CHECK_MALLOC(reduzidas);
+  for (int i = 0, pos = 0; i < qtFronteira; i++) {
+    if (args[i].qt > 0) memcpy(reduzidas + pos, args[i].reduzidas, sizeof(amostra) * args[i].qt);
+    pos += args[i].qt;
+    free(args[i].reduzidas);
+    free(args[i].rascunho);
+  }
+
+  free(args);
+  free(fronteira);
+  return reduzidas;
+}
+
+
+/* Interface
+ * --------- */
+
+int nivelDoVoxel(noctree* no, float s, float* aresta) {
+  int nivel = 0;
+  for (int d = 0; d < DIM; d++) aresta[d] = no->tamanho[d];
+
+  while (nivel < VOXEL_MAX_NIVEIS && (aresta[0] > s || aresta[1] > s || aresta[2] > s)) {
+    for (int d = 0; d < DIM; d++) aresta[d] /= 2;
+    nivel++;
+  }
+  return nivel;
+}
+
+amostra** downsampleVoxel(noctree* no, float s, int modo, int* qt) {
+  *qt = 0;
+  if (!(s > 0)) return NULL;
+
+  amostra* reduzidas = reduz(no, s, modo, qt);
+  if (*qt == 0) {
+    free(reduzidas);
+    return NULL;
+  }
+
+  /* Vetor de ponteiros seguido das amostras, como nas buscas do modo quantizado */
+  amostra** resultados = (amostra**) malloc(sizeof(amostra*) * (*qt) + sizeof(amostra) * (*qt));
+  CHECK_MALLOC(resultados);
+  amostra* copias = (amostra*)(resultados + *qt);
+  memcpy(copias, reduzidas, sizeof(amostra) * (*qt));
+  for (int i = 0; i < *qt; i++) resultados[i] = &copias[i];
+
+  free(reduzidas);
+  return resultados;
+}
+
+noctree* downsampleVoxelArvore(noctree* no, float s, int modo) {
+  if (!(s > 0)) return NULL;
+
+  int qt;
+  amostra* reduzidas = reduz(no, s, modo, &qt);
+
+  /* A árvore nova só é vista por esta thread até voltar: inserção sem lock */
+  noctree* nova = inicializaNo(inicializaAmostra(no->centro->x, no->centro->y, no->centro->z), no->tamanho, no->profundidade);
+  if (no->modo == NOCTREE_MODO_QUANTIZADO) compactaOctree(nova);
+  for (int i = 0; i < qt; i++) {
+    insereAmostraPrivada(nova, inicializaAmostra(reduzidas[i].x, reduzidas[i].y, reduzidas[i].z));
+  }
+
+  free(reduzidas);
+  return nova;
+}
@@ -0,0 +1,65 @@
+/* Redução por grade de voxels sobre a hierarquia da Octree.
+ *
+ * Cada voxel de aresta  s  vira uma amostra só. Em vez de calcular a chave de
+ * cada amostra e agrupar tudo numa tabela hash, a grade é a própria árvore: o voxel
+ * é o nó da profundidade cuja aresta é a maior que não passa de  s , e cada nó
+ * dessa profundidade é colapsado numa amostra. Só as folhas mais rasas que essa
+ * profundidade (que guardam vários voxels) separam suas amostras por voxel, e
+ * isso acontece dentro da folha, com poucas amostras de cada vez.
+ *
+ * As subárvores são divididas em tarefas no  poolPadrao() .
+ *
+ * Exemplo:
+ *    int qt;
+ *    amostra** reduzidas = downsampleVoxel(raiz, 0.5f, VOXEL_CENTROIDE, &qt);
+ *    ...
+ *    free(reduzidas);                      // Um free só: as amostras estão no mesmo bloco
+ *    noctree* menor = downsampleVoxelArvore(raiz, 0.5f, VOXEL_MAIS_PROXIMO);
+*/
+
+#ifndef VOXEL_H
+#define VOXEL_H
+
+#include "paralelo.h"
+
+/* Representante de cada voxel */
+#define VOXEL_CENTROIDE            0 // Média das amostras do voxel
+#define VOXEL_PRIMEIRO             1 // A primeira amostra (ordem dos octantes; na folha, ordem de inserção)
+#define VOXEL_MAIS_PROXIMO         2 // A amostra mais próxima do centro do voxel
+
+/* Maior diferença de profundidade entre a raiz e o voxel (2^20 voxels por eixo) */
+#define VOXEL_MAX_NIVEIS          20
+
+/**
+ * Aresta efetiva do voxel em cada eixo: a aresta da raiz dividida pela menor
+ * potência de 2 que a deixa menor ou igual a  s  em todos os eixos.
+ *
+ * @param no é a raiz da (sub)árvore
+ * @param s é a aresta pedida
+ * @param aresta recebe a aresta efetiva em X, Y e Z
+ *
+ * @return quantos níveis abaixo da raiz fica o voxel
+ */
+int nivelDoVoxel(noctree* no, float s, float* aresta);
+
+/**
+ * Reduz a (sub)árvore a uma amostra por voxel ocupado.
+ *
+ * @param no é a raiz da (sub)árvore
+ * @param s é a aresta do voxel (ver  nivelDoVoxel )
+ * @param modo é VOXEL_CENTROIDE, VOXEL_PRIMEIRO ou VOXEL_MAIS_PROXIMO
+ * @param qt recebe a quantidade de amostras devolvidas
+ *
+ * @return um vetor com as amostras, alocadas no mesmo bloco do vetor (basta um  free ),
+ *         ou NULL se a árvore está vazia ou  s  não é positivo
+ */
+amostra** downsampleVoxel(noctree* no, float s, int modo, int* qt);
+
+/**
+ * Como  downsampleVoxel , mas devolve uma árvore nova com o mesmo cubo, profundidade e modo.
+ *
+ * @return a árvore reduzida (destrua com  destroiNo ), ou NULL se  s  não é positivo
+ */
+noctree* downsampleVoxelArvore(noctree* no, float s, int modo);
+
+#endif
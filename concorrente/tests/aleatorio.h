@@ -0,0 +1,66 @@
+/* Gerador pseudoaleatório rápido para os testes de desempenho.
+ *
+ * xoshiro256** (Blackman & Vigna), semeado com splitmix64. Cada thread tem o seu
+ * próprio estado, então não há a contenção do estado escondido de  rand() , e a
+ * sequência de cada fluxo depende só da semente e do número do fluxo.
+ *
+ * Exemplo:
+ *    geradorAleatorio g;
+ *    semeiaGerador(&g, semente, idThread);
+ *    float u = aleatorioUnif01(&g);
+*/
+
+#ifndef ALEATORIO_H
+#define ALEATORIO_H
+
+#include <stdint.h>
+
+typedef struct {
+  uint64_t s[4];
+} geradorAleatorio;
+
+static inline uint64_t splitmix64(uint64_t* x) {
+  uint64_t z = (*x += 0x9e3779b97f4a7c15ULL);
+  z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+  z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+  return z ^ (z >> 31);
+}
+
+/* Fluxos diferentes da mesma semente são independentes entre si */
+static inline void semeiaGerador(geradorAleatorio* g, uint64_t semente, uint64_t fluxo) {
+  uint64_t x = semente ^ (fluxo * 0xd1342543de82ef95ULL);
+  for (int i = 0; i < 4; i++) {
+    g->s[i] = splitmix64(&x);
+  }
+}
+
+static inline uint64_t rotl64(uint64_t x, int k) {
+  return (x << k) | (x >> (64 - k));
+}
+
+static inline uint64_t proximoAleatorio(geradorAleatorio* g) {
+  uint64_t* s = g->s;
+  uint64_t resultado = rotl64(s[1] * 5, 7) * 9;
+  uint64_t t = s[1] << 17;
+
+  s[2] ^= s[0];
+  s[3] ^= s[1];
+  s[1] ^= s[2];
+  s[0] ^= s[3];
+  s[2] ^= t;
+  s[3] = rotl64(s[3], 45);
+
+  return resultado;
+}
+
+/* Uniforme em [0, 1) com os 24 bits que cabem na mantissa de um float */
+static inline float aleatorioUnif01(geradorAleatorio* g) {
+  return (proximoAleatorio(g) >> 40) * (1.0f / 16777216.0f);
+}
+
+/* Inteiro uniforme em [0, n) (multiplicação de Lemire, sem o laço de rejeição) */
+static inline uint64_t aleatorioAte(geradorAleatorio* g, uint64_t n) {
+  return (uint64_t)(((unsigned __int128) proximoAleatorio(g) * n) >> 64);
+}
+
+#endif
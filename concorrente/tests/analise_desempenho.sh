@@ -3,30 +3,52 @@
 # ===================================================================
 # Script de Análise de Desempenho para a Octree Concorrente
 # ===================================================================
-# Este script executa o programa de desempenho com várias configurações,
+# Este script executa o driver de desempenho com várias configurações,
 # repete cada teste para obter dados confiáveis e salva os resultados
 # em um arquivo CSV para fácil análise e geração de gráficos.
+# O próprio driver emite as linhas do CSV (--saida csv), então não há
+# mais extração de tempos por grep.
 # -------------------------------------------------------------------
 
 # --- VERIFICAÇÃO INICIAL ---
-if [ -z "$1" ] || ([ "$1" != "busca" ] && [ "$1" != "criacao" ]); then
-  echo "Argumentos inválidos! Uso: $0 [busca|criacao]"
+if [ -z "$1" ] || ([ "$1" != "busca" ] && [ "$1" != "criacao" ] && [ "$1" != "mistura" ] && [ "$1" != "agrupamento" ]); then
+  echo "Argumentos inválidos! Uso: $0 [busca|criacao|mistura|agrupamento] [conjunto de dados]"
   exit 1
 fi
 
 TIPO_TESTE=$1
+DADOS=${2:-uniforme} # uniforme | gaussiano | lidar | arquivo:<caminho>
 
 # --- CONFIGURAÇÃO DOS TESTES ---
+EXECUTAVEL="./desempenho"
+AQUECIMENTO=1
 
 # Parâmetros para o teste de CRIAÇÃO
 if [ "$TIPO_TESTE" == "criacao" ]; then
   THREADS_A_TESTAR=(1 2 4 8)
   AMOSTRAS_A_TESTAR=(100000 1000000 5000000 7500000 10000000)
   REPETICOES=10
-  EXECUTAVEL="./desempenho_criacao"
   ARQUIVO_SAIDA="resultados_desempenho_criacao.csv"
-  COLUNAS_CSV="Threads,Amostras,Repeticao,TempoDeExecucao"
-  LINHA_GREP="Tempo de execução concorrente:"
+
+# Parâmetros para o teste MISTURA (leitura e escrita simultâneas)
+elif [ "$TIPO_TESTE" == "mistura" ]; then
+  THREADS_A_TESTAR=(2 4 8)
+  AMOSTRAS_A_TESTAR=(1000000)
+  ESCRITA_A_TESTAR="0,1,5,10,20,50" # Varredura feita pelo próprio driver
+  DURACAO=5
+  REPETICOES=3
+  ARQUIVO_SAIDA="resultados_desempenho_mistura.csv"
+
+# Parâmetros para o teste de AGRUPAMENTO (escala com os trabalhadores do pool, até todos os núcleos)
+elif [ "$TIPO_TESTE" == "agrupamento" ]; then
+  NUCLEOS=$(nproc)
+  THREADS_A_TESTAR=()
+  for ((t = 1; t < NUCLEOS; t *= 2)); do THREADS_A_TESTAR+=($t); done
+  THREADS_A_TESTAR+=($NUCLEOS)
+  AMOSTRAS_A_TESTAR=(1000000 5000000)
+  PASSOS_A_TESTAR=(0.5 1 2)
+  REPETICOES=5
+  ARQUIVO_SAIDA="resultados_desempenho_agrupamento.csv"
 
 # Parâmetros para o teste de BUSCA
 else # busca
@@ -34,17 +56,15 @@ else # busca
   THREADS_LEITURA_A_TESTAR=(1 2 4 8)
   AMOSTRAS_A_TESTAR=(1000000 5000000)
   BUSCAS_A_TESTAR=(1000 10000 50000 100000 500000)
+  CONGELA_A_TESTAR=("" "--congela") # Com e sem locks nas consultas (coluna "congelada" do CSV)
   REPETICOES=5
-  EXECUTAVEL="./desempenho_busca"
   ARQUIVO_SAIDA="resultados_desempenho_busca.csv"
-  COLUNAS_CSV="ThreadsEscrita,ThreadsLeitura,Amostras,Buscas,Repeticao,TempoDeBusca"
-  LINHA_GREP="Tempo de buscas na octree:"
 fi
 
 
 # --- COMPILAÇÃO ---
-echo "Compilando o binário de teste '$EXECUTAVEL'..."
-gcc -o $EXECUTAVEL "${EXECUTAVEL}.c" ../src/noctree.c ../src/amostra.c -I ../src/ -Wall -Wextra -lm
+echo "Compilando o driver de desempenho '$EXECUTAVEL'..."
+make -C .. desempenho
 if [ $? -ne 0 ]; then
     echo "Erro de compilação. Abortando."
     exit 1
@@ -53,11 +73,18 @@ echo "Compilação bem-sucedida."
 
 
 # --- EXECUÇÃO DOS TESTES ---
-echo "Iniciando análise de desempenho para '$TIPO_TESTE'..."
+echo "Iniciando análise de desempenho para '$TIPO_TESTE' sobre o conjunto '$DADOS'..."
 echo "Os resultados serão salvos em '$ARQUIVO_SAIDA'"
 
-# Cria o cabeçalho do arquivo CSV
-echo "$COLUNAS_CSV" > "$ARQUIVO_SAIDA"
+# Cria o arquivo CSV apenas com o cabeçalho
+$EXECUTAVEL --saida csv --cabecalho --repeticoes 1 --amostras 1 --aquecimento 0 | head -n 1 > "$ARQUIVO_SAIDA"
+
+# Executa uma configuração e acrescenta as linhas (sem cabeçalho) ao CSV
+executa() {
+  if ! $EXECUTAVEL --dados "$DADOS" --aquecimento $AQUECIMENTO --repeticoes $REPETICOES --saida csv "$@" >> "$ARQUIVO_SAIDA"; then
+    echo "  AVISO: a execução com '$*' falhou."
+  fi
+}
 
 # Loop principal sobre cada configuração
 if [ "$TIPO_TESTE" == "criacao" ]; then
@@ -65,16 +92,25 @@ if [ "$TIPO_TESTE" == "criacao" ]; then
     for n_amostras in "${AMOSTRAS_A_TESTAR[@]}"; do
       echo "-----------------------------------------------------------------"
       echo "Testando com $n_threads Threads e $n_amostras Amostras..."
-
-      for i in $(seq 1 $REPETICOES); do
-        printf "  - Repetição %d de %d...\n" "$i" "$REPETICOES"
-        SAIDA=$($EXECUTAVEL "$n_threads" "$n_amostras" 2>&1)
-        TEMPO=$(echo "$SAIDA" | grep "$LINHA_GREP" | awk -F': ' '{print $2}' | sed 's/[^0-9.]*//g')
-        if [ -z "$TEMPO" ]; then
-          echo "  AVISO: Não foi possível extrair o tempo para esta execução. Pulando."
-          TEMPO="ERRO"
-        fi
-        echo "$n_threads,$n_amostras,$i,$TEMPO" >> "$ARQUIVO_SAIDA"
+      executa --carga insercao --escritoras "$n_threads" --amostras "$n_amostras"
+    done
+  done
+elif [ "$TIPO_TESTE" == "mistura" ]; then
+  for n_threads in "${THREADS_A_TESTAR[@]}"; do
+    for n_amostras in "${AMOSTRAS_A_TESTAR[@]}"; do
+      echo "-----------------------------------------------------------------"
+      echo "Testando com $n_threads Threads mistas e $n_amostras Amostras, escritas em {$ESCRITA_A_TESTAR}%..."
+      executa --carga mistura --threads "$n_threads" --amostras "$n_amostras" \
+              --escrita "$ESCRITA_A_TESTAR" --duracao "$DURACAO"
+    done
+  done
+elif [ "$TIPO_TESTE" == "agrupamento" ]; then
+  for n_threads in "${THREADS_A_TESTAR[@]}"; do
+    for n_amostras in "${AMOSTRAS_A_TESTAR[@]}"; do
+      for passo in "${PASSOS_A_TESTAR[@]}"; do
+        echo "-----------------------------------------------------------------"
+        echo "Testando com $n_threads trabalhadores, $n_amostras amostras e passo $passo..."
+        executa --carga agrupamento --leitoras "$n_threads" --amostras "$n_amostras" --raio "$passo"
       done
     done
   done
@@ -83,18 +119,11 @@ else # busca
     for n_threads_leit in "${THREADS_LEITURA_A_TESTAR[@]}"; do
       for n_amostras in "${AMOSTRAS_A_TESTAR[@]}"; do
         for n_buscas in "${BUSCAS_A_TESTAR[@]}"; do
-          echo "-----------------------------------------------------------------"
-          echo "Testando com $n_threads_esc (E), $n_threads_leit (L), $n_amostras amostras, $n_buscas buscas..."
-
-          for i in $(seq 1 $REPETICOES); do
-            printf "  - Repetição %d de %d...\n" "$i" "$REPETICOES"
-            SAIDA=$($EXECUTAVEL "$n_threads_esc" "$n_threads_leit" "$n_amostras" "$n_buscas" 2>&1)
-            TEMPO=$(echo "$SAIDA" | grep "$LINHA_GREP" | awk -F': ' '{print $2}' | sed 's/[^0-9.]*//g')
-            if [ -z "$TEMPO" ]; then
-              echo "  AVISO: Não foi possível extrair o tempo para esta execução. Pulando."
-              TEMPO="ERRO"
-            fi
-            echo "$n_threads_esc,$n_threads_leit,$n_amostras,$n_buscas,$i,$TEMPO" >> "$ARQUIVO_SAIDA"
+          for congela in "${CONGELA_A_TESTAR[@]}"; do
+            echo "-----------------------------------------------------------------"
+            echo "Testando com $n_threads_esc (E), $n_threads_leit (L), $n_amostras amostras, $n_buscas buscas ${congela:-(com locks)}..."
+            executa --carga raio --escritoras "$n_threads_esc" --leitoras "$n_threads_leit" \
+                    --amostras "$n_amostras" --consultas "$n_buscas" $congela
           done
         done
       done
@@ -0,0 +1,217 @@
+/**
+ * @file conjuntos.c
+ *
+ * Geradores dos conjuntos de dados usados nos testes de desempenho.
+ * Para ver a documentação, consulte o header.
+ */
+
+#include "conjuntos.h"
+#include "aleatorio.h"
+#include <math.h>
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+/* Alcance máximo do LIDAR sintético e a cota do chão */
+#define LIDAR_ALCANCE           45.0f
+#define LIDAR_Z_SENSOR         -40.0f
+
+/* Uniforme em [a, b) */
+static float unif(geradorAleatorio* g, float a, float b) {
+  return a + aleatorioUnif01(g) * (b - a);
+}
+
+/* Normal padrão (Box-Muller) */
+static float normal(geradorAleatorio* g) {
+  float u1 = aleatorioUnif01(g);
+  float u2 = aleatorioUnif01(g);
+  if (u1 < 1e-7f) u1 = 1e-7f;
+  return sqrtf(-2.0f * logf(u1)) * cosf(2.0f * (float)M_PI * u2);
+}
+
+/* Mantém a coordenada dentro da região */
+static float limita(float v) {
+  if (v < REGIAO_MENOS) return REGIAO_MENOS;
+  if (v > REGIAO_MAIS)  return REGIAO_MAIS;
+  return v;
+}
+
+/* Cada gerador preenche as amostras [ini, fim) com o seu próprio fluxo aleatório */
+static void geraUniforme(conjunto* c, geradorAleatorio* g, long long ini, long long fim) {
+  for (long long i = DIM * ini; i < DIM * fim; i++) {
+    c->coords[i] = unif(g, REGIAO_MENOS, REGIAO_MAIS);
+  }
+}
+
+static void geraGaussiano(conjunto* c, geradorAleatorio* g, long long ini, long long fim) {
+  for (long long i = ini; i < fim; i++) {
+    int k = aleatorioAte(g, GAUSSIANO_QT_AGLOMERADOS);
+    for (int j = 0; j < DIM; j++) {
+      c->coords[DIM*i + j] = limita(c->centros[k][j] + GAUSSIANO_DESVIO * normal(g));
+    }
+  }
+}
+
+/* Anéis de um sensor sobre um chão plano. Parte dos feixes bate em obstáculos antes do chão. */
+static void geraLidar(conjunto* c, geradorAleatorio* g, long long ini, long long fim) {
+  const float elevMin = -25.0f * (float)M_PI / 180.0f;
+  const float elevMax =   5.0f * (float)M_PI / 180.0f;
+
+  for (long long i = ini; i < fim; i++) {
+    int anel = i % LIDAR_QT_ANEIS;
+    float elev = elevMin + (elevMax - elevMin) * anel / (LIDAR_QT_ANEIS - 1);
+    float azim = unif(g, 0, 2.0f * (float)M_PI);
+    float dist;
+
+    if (elev < 0 && aleatorioUnif01(g) > 0.2f) {
+      dist = LIDAR_ALTURA_SENSOR / sinf(-elev); // Chão
+      if (dist > LIDAR_ALCANCE) dist = LIDAR_ALCANCE;
+    } else {
+      dist = unif(g, 3.0f, LIDAR_ALCANCE);     // Obstáculo
+    }
+    dist += 0.02f * normal(g);                 // Ruído de medida
+
+    c->coords[DIM*i + 0] = limita(dist * cosf(elev) * cosf(azim));
+    c->coords[DIM*i + 1] = limita(dist * cosf(elev) * sinf(azim));
+    c->coords[DIM*i + 2] = limita(LIDAR_Z_SENSOR + dist * sinf(elev));
+  }
+}
+
+/* Argumento das threads geradoras */
+typedef struct {
+  conjunto* c;
+  uint64_t semente;
+  int idThread;
+  int nthreads;
+} argGeracao;
+
+/* Cada thread gera os blocos idThread, idThread + nthreads, ... O bloco b usa o fluxo b + 1
+ * da semente, então o conjunto não depende da quantidade de threads. */
+static void* rotinaGeradora(void* arg) {
+  argGeracao* a = (argGeracao*) arg;
+  long long qtBlocos = (a->c->qtAmostras + CONJUNTO_TAM_BLOCO - 1) / CONJUNTO_TAM_BLOCO;
+
+  for (long long b = a->idThread; b < qtBlocos; b += a->nthreads) {
+    geradorAleatorio g;
+    semeiaGerador(&g, a->semente, b + 1);
+
+    long long ini = b * CONJUNTO_TAM_BLOCO;
+    long long fim = ini + CONJUNTO_TAM_BLOCO;
+    if (fim > a->c->qtAmostras) fim = a->c->qtAmostras;
+
+    switch (a->c->tipo) {
+      case CONJUNTO_UNIFORME:  geraUniforme(a->c, &g, ini, fim);  break;
+      case CONJUNTO_GAUSSIANO: geraGaussiano(a->c, &g, ini, fim); break;
+      case CONJUNTO_LIDAR:     geraLidar(a->c, &g, ini, fim);     break;
+      default: break;
+    }
+  }
+  return NULL;
+}
+
+/* Lê "x y z" por linha. Retorna 0 se o arquivo não pôde ser lido. */
+static int leArquivo(conjunto* c, const char* caminho) {
+  FILE* arq = fopen(caminho, "r");
+  if (arq == NULL) return 0;
+
+  long long capacidade = 1024;
+  c->coords = (float*) malloc(sizeof(float) * DIM * capacidade);
+  CHECK_MALLOC(c->coords);
+  c->qtAmostras = 0;
+
+  float x, y, z;
+  while (fscanf(arq, "%f %f %f", &x, &y, &z) == 3) {
+    if (c->qtAmostras == capacidade) {
+      capacidade *= 2;
+      c->coords = (float*) realloc(c->coords, sizeof(float) * DIM * capacidade);
+      CHECK_MALLOC(c->coords);
+    }
+    c->coords[DIM*c->qtAmostras + 0] = x;
+    c->coords[DIM*c->qtAmostras + 1] = y;
+    c->coords[DIM*c->qtAmostras + 2] = z;
+    c->qtAmostras++;
+  }
+
+  fclose(arq);
+  return c->qtAmostras > 0;
+}
+
+int interpretaConjunto(const char* nome, tipoConjunto* tipo, const char** caminho) {
+  *caminho = NULL;
+  if (strcmp(nome, "uniforme") == 0)  { *tipo = CONJUNTO_UNIFORME;  return 1; }
+  if (strcmp(nome, "gaussiano") == 0) { *tipo = CONJUNTO_GAUSSIANO; return 1; }
+  if (strcmp(nome, "lidar") == 0)     { *tipo = CONJUNTO_LIDAR;     return 1; }
+  if (strncmp(nome, "arquivo:", 8) == 0 && nome[8] != '\0') {
+    *tipo = CONJUNTO_ARQUIVO;
+    *caminho = nome + 8;
+    return 1;
+  }
+  return 0;
+}
+
+const char* nomeConjunto(tipoConjunto tipo) {
+  switch (tipo) {
+    case CONJUNTO_UNIFORME:  return "uniforme";
+    case CONJUNTO_GAUSSIANO: return "gaussiano";
+    case CONJUNTO_LIDAR:     return "lidar";
+    case CONJUNTO_ARQUIVO:   return "arquivo";
+  }
+  return "?";
+}
+
+conjunto* geraConjunto(tipoConjunto tipo, long long N, const char* caminho, uint64_t semente, int nthreads) {
+  conjunto* c = (conjunto*) malloc(sizeof(conjunto));
+  CHECK_MALLOC(c);
+  c->tipo = tipo;
+  c->coords = NULL;
+
+  if (tipo == CONJUNTO_ARQUIVO) {
+    if (!leArquivo(c, caminho)) {
+      free(c->coords);
+      free(c);
+      return NULL;
+    }
+    return c;
+  }
+
+  c->qtAmostras = N;
+  c->coords = (float*) malloc(sizeof(float) * DIM * N);
+  CHECK_MALLOC(c->coords);
+
+  /* Centros dos aglomerados vêm do fluxo 0 */
+  geradorAleatorio g;
+  semeiaGerador(&g, semente, 0);
+  for (int k = 0; k < GAUSSIANO_QT_AGLOMERADOS; k++) {
+    for (int j = 0; j < DIM; j++) {
+      c->centros[k][j] = unif(&g, REGIAO_MENOS + 5, REGIAO_MAIS - 5);
+    }
+  }
+
+  /* Gera em paralelo */
+  if (nthreads < 1) nthreads = 1;
+  pthread_t* tid = (pthread_t*) malloc(sizeof(pthread_t) * nthreads);
+  CHECK_MALLOC(tid);
+  argGeracao* args = (argGeracao*) malloc(sizeof(argGeracao) * nthreads);
+  CHECK_MALLOC(args);
+
+  for (int t = 0; t < nthreads; t++) {
+    args[t] = (argGeracao){c, semente, t, nthreads};
+    if (pthread_create(&tid[t], NULL, rotinaGeradora, &args[t])) {
+      LOG_ERROR(ERRO_THREAD, "Falha ao criar a thread geradora %d", t);
+    }
+  }
+  for (int t = 0; t < nthreads; t++) {
+    pthread_join(tid[t], NULL);
+  }
+
+  free(tid);
+  free(args);
+  return c;
+}
+
+void destroiConjunto(conjunto* c) {
+  if (c == NULL) return;
+  free(c->coords);
+  free(c);
+}
@@ -0,0 +1,74 @@
+#ifndef CONJUNTOS_H
+#define CONJUNTOS_H
+
+#include "../src/system.h"
+
+/* Região onde as amostras sintéticas são geradas: cubo de aresta 100 centrado na origem */
+#define REGIAO_MENOS             -50
+#define REGIAO_MAIS               50
+
+/* Parâmetros dos conjuntos sintéticos */
+#define GAUSSIANO_QT_AGLOMERADOS  16 // Quantidade de aglomerados gaussianos
+#define GAUSSIANO_DESVIO        2.0f // Desvio padrão de cada aglomerado
+#define LIDAR_QT_ANEIS            32 // Feixes do sensor sintético
+#define LIDAR_ALTURA_SENSOR     2.0f // Altura do sensor em relação ao chão
+
+/* Amostras geradas por cada fluxo aleatório (a unidade de paralelismo da geração) */
+#define CONJUNTO_TAM_BLOCO     65536
+
+/**
+ * Tipos de conjunto de dados disponíveis para os testes de desempenho.
+ */
+typedef enum {
+  CONJUNTO_UNIFORME,                   // Uniforme no cubo da região
+  CONJUNTO_GAUSSIANO,                  // Aglomerados gaussianos espalhados na região
+  CONJUNTO_LIDAR,                      // Anéis de um LIDAR sintético sobre um chão plano, com obstáculos
+  CONJUNTO_ARQUIVO                     // Lido de um arquivo texto com "x y z" por linha
+} tipoConjunto;
+
+/**
+ * Conjunto de dados já gerado, com as coordenadas contíguas (X,Y,Z por amostra).
+ */
+typedef struct _Conjunto {
+  tipoConjunto tipo;
+  long long qtAmostras;
+  float* coords;
+  float centros[GAUSSIANO_QT_AGLOMERADOS][DIM]; // Centros dos aglomerados (só para CONJUNTO_GAUSSIANO)
+} conjunto;
+
+/**
+ * Converte o nome de um conjunto ("uniforme", "gaussiano", "lidar" ou "arquivo:<caminho>").
+ *
+ * @param caminho Recebe o caminho do arquivo, se for o caso (aponta para dentro de  nome ).
+ *
+ * @return 1, se ok
+ *         0, se o nome não é conhecido
+ */
+int interpretaConjunto(const char* nome, tipoConjunto* tipo, const char** caminho);
+
+/**
+ * Nome de um tipo de conjunto, para os relatórios.
+ */
+const char* nomeConjunto(tipoConjunto tipo);
+
+/**
+ * Gera (ou lê) um conjunto de dados. A geração é paralela, com um gerador por
+ * bloco de CONJUNTO_TAM_BLOCO amostras: o mesmo  semente  gera o mesmo conjunto,
+ * qualquer que seja  nthreads .
+ *
+ * @param tipo É o tipo do conjunto.
+ * @param N É a quantidade de amostras (ignorada para arquivos, que definem a própria quantidade).
+ * @param caminho É o arquivo de entrada, quando  tipo == CONJUNTO_ARQUIVO .
+ * @param semente É a semente dos geradores.
+ * @param nthreads É a quantidade de threads geradoras.
+ *
+ * @return o conjunto, ou NULL se o arquivo não pôde ser lido.
+ */
+conjunto* geraConjunto(tipoConjunto tipo, long long N, const char* caminho, uint64_t semente, int nthreads);
+
+/**
+ * Libera um conjunto de dados.
+ */
+void destroiConjunto(conjunto* c);
+
+#endif
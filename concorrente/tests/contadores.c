@@ -0,0 +1,92 @@
+/**
+ * @file contadores.c
+ *
+ * Contadores de hardware via perf_event_open. Para ver a documentação, consulte o header.
+ */
+
+#include "contadores.h"
+
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+
+const char* nomesContadoresHW[QT_CONTADORES_HW] = {"ciclos", "instrucoes", "falhas_llc", "falhas_dtlb"};
+
+/* Tipo e configuração de cada evento, na ordem de  eventoHW  */
+static const struct { uint32_t tipo; uint64_t config; } eventos[QT_CONTADORES_HW] = {
+  {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES},
+  {PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS},
+  {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES},
+  {PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_DTLB | (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+                       (PERF_COUNT_HW_CACHE_RESULT_MISS << 16)},
+};
+
+/* Formato da leitura com  PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING  */
+typedef struct {
+  uint64_t valor;
+  uint64_t habilitado;
+  uint64_t rodando;
+} leituraHW;
+
+int abreContadoresHW(contadoresHW* c) {
+  int abertos = 0;
+  c->erro = 0;
+
+  for (int i = 0; i < QT_CONTADORES_HW; i++) {
+    struct perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = eventos[i].tipo;
+    attr.config = eventos[i].config;
+    attr.disabled = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+    /* pid 0 e cpu -1: só a thread atual, em qualquer núcleo */
+    c->fd[i] = (int) syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+    if (c->fd[i] < 0) {
+      if (c->erro == 0) c->erro = errno;
+    } else {
+      abertos++;
+    }
+  }
+  return abertos;
+}
+
+void ligaContadoresHW(contadoresHW* c) {
+  for (int i = 0; i < QT_CONTADORES_HW; i++) {
+    if (c->fd[i] < 0) continue;
+    ioctl(c->fd[i], PERF_EVENT_IOC_RESET, 0);
+    ioctl(c->fd[i], PERF_EVENT_IOC_ENABLE, 0);
+  }
+}
+
+void desligaContadoresHW(contadoresHW* c) {
+  for (int i = 0; i < QT_CONTADORES_HW; i++) {
+    if (c->fd[i] >= 0) ioctl(c->fd[i], PERF_EVENT_IOC_DISABLE, 0);
+  }
+}
+
+void leContadoresHW(contadoresHW* c, uint64_t* valores, int* validos) {
+  for (int i = 0; i < QT_CONTADORES_HW; i++) {
+    leituraHW l;
+    valores[i] = 0;
+    validos[i] = 0;
+    if (c->fd[i] < 0 || read(c->fd[i], &l, sizeof(l)) != (ssize_t) sizeof(l) || l.rodando == 0) continue;
+
+    /* Multiplexado: estima o total pela fração do tempo em que o evento foi contado */
+    valores[i] = (l.rodando < l.habilitado) ? (uint64_t)((double) l.valor * l.habilitado / l.rodando) : l.valor;
+    validos[i] = 1;
+  }
+}
+
+void fechaContadoresHW(contadoresHW* c) {
+  for (int i = 0; i < QT_CONTADORES_HW; i++) {
+    if (c->fd[i] >= 0) close(c->fd[i]);
+    c->fd[i] = -1;
+  }
+}
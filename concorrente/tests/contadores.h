@@ -0,0 +1,75 @@
+/* Contadores de hardware (perf_event_open) para os testes de desempenho.
+ *
+ * Cada thread abre os seus contadores (ciclos, instruções, falhas na LLC e no dTLB),
+ * liga logo depois da barreira e desliga ao fim da fase medida. Só o espaço de
+ * usuário é contado, o que basta com  perf_event_paranoid <= 2 .
+ *
+ * Se algum evento não existe (máquina virtual, kernel sem PMU, permissão), ele
+ * fica inválido e o resto continua: quem usa deve olhar  validos .
+ *
+ * Exemplo:
+ *    contadoresHW hw;
+ *    abreContadoresHW(&hw);
+ *    ligaContadoresHW(&hw);
+ *    . . .
+ *    desligaContadoresHW(&hw);
+ *    leContadoresHW(&hw, valores, validos);
+ *    fechaContadoresHW(&hw);
+*/
+
+#ifndef CONTADORES_H
+#define CONTADORES_H
+
+#include <stdint.h>
+
+typedef enum {
+  HW_CICLOS,
+  HW_INSTRUCOES,
+  HW_FALHAS_LLC,
+  HW_FALHAS_DTLB,
+  QT_CONTADORES_HW
+} eventoHW;
+
+/* Nomes curtos, para as colunas do CSV/JSON */
+extern const char* nomesContadoresHW[QT_CONTADORES_HW];
+
+/**
+ * Descritores dos eventos da thread que os abriu (-1 se o evento não abriu).
+ */
+typedef struct {
+  int fd[QT_CONTADORES_HW];
+  int erro;                            // errno da primeira falha, ou 0
+} contadoresHW;
+
+/**
+ * Abre os contadores, desligados, para a thread atual.
+ *
+ * @return quantos eventos abriram (0 se nenhum)
+ */
+int abreContadoresHW(contadoresHW* c);
+
+/**
+ * Zera e liga os contadores abertos.
+ */
+void ligaContadoresHW(contadoresHW* c);
+
+/**
+ * Desliga os contadores abertos.
+ */
+void desligaContadoresHW(contadoresHW* c);
+
+/**
+ * Lê os contadores. Os valores são escalados pelo tempo em que o evento esteve de fato
+ * no PMU, caso o kernel tenha multiplexado os eventos.
+ *
+ * @param valores recebe um valor por evento
+ * @param validos recebe 1 para os eventos lidos, 0 c.c.
+ */
+void leContadoresHW(contadoresHW* c, uint64_t* valores, int* validos);
+
+/**
+ * Fecha os descritores.
+ */
+void fechaContadoresHW(contadoresHW* c);
+
+#endif
@@ -1,178 +1,952 @@
 /**
  * @file Arquivo fonte para analisar o desempenho de Octree
+ *
+ * Driver único dos testes de desempenho. Escolhe o conjunto de dados, a carga de
+ * trabalho e a quantidade de threads pela linha de comando, faz execuções de
+ * aquecimento, mede a latência de cada operação e emite o resultado em texto,
+ * CSV ou JSON (uma linha por classe de operação e repetição).
+ *
+ * Os dados são gerados antes das medidas, com geradores próprios de cada thread
+ * semeados por --semente. Cada thread aloca as suas amostras e sorteia os alvos
+ * das suas consultas antes de uma barreira; a região medida só tem operações na árvore.
  */
 
 #include <stdio.h>
 #include <stdlib.h>
 #include <stdbool.h>
 #include <pthread.h>
-#include <unistd.h> // Para a função sleep()
+#include <getopt.h>
+#include <unistd.h>
+#include <time.h>
 
 #include "../src/noctree.h"
+#include "../src/relatorio.h"
+#include "../src/fragmentada.h"
+#include "../src/paralelo.h"
+#include "../src/escritor.h"
+#include "../src/agrupamento.h"
+#include "conjuntos.h"
+#include "aleatorio.h"
+#include "contadores.h"
 #include "timer.h"
 
-/* Define a região que serão geradas as amostras: cubo de aresta 100 */
-#define REGIAO_X_MENOS -50
-#define REGIAO_X_MAIS   50
-#define REGIAO_Y_MENOS -50
-#define REGIAO_Y_MAIS   50
-#define REGIAO_Z_MENOS -50
-#define REGIAO_Z_MAIS   50
+/* Valores padrão da linha de comando */
+#define PADRAO_AMOSTRAS     1000000
+#define PADRAO_CONSULTAS      10000
+#define PADRAO_RAIO               5
+#define PADRAO_AQUECIMENTO        1
+#define PADRAO_REPETICOES         3
+#define PADRAO_DURACAO          2.0 // Segundos de cada execução da carga mistura
+#define PADRAO_THREADS_MISTURA    2
 
-/* Gera um ponto no R^3 com uma distribuição uniforme */
-amostra* geraAmostraUnif(void) {
-  /* Gera as posições em X,Y,Z no intervalo possível */
-  float pos_x = REGIAO_X_MENOS + (((float)rand() / (float)RAND_MAX) * (REGIAO_X_MAIS - REGIAO_X_MENOS) );
-  float pos_y = REGIAO_Y_MENOS + (((float)rand() / (float)RAND_MAX) * (REGIAO_Y_MAIS - REGIAO_Y_MENOS) );
-  float pos_z = REGIAO_Z_MENOS + (((float)rand() / (float)RAND_MAX) * (REGIAO_Z_MAIS - REGIAO_Z_MENOS) );
+/* Alvos sorteados por thread na carga mistura (reusados em ciclo) */
+#define QT_ALVOS_MISTURA       4096
 
-  return inicializaAmostra(pos_x, pos_y, pos_z);
-}
+/* Máximo de proporções de escrita em uma varredura da carga mistura */
+#define MAX_PROPORCOES           16
 
-/* Gera os pontos aleatórios e insere na octree */
-void preencheOctreeUnif(noctree* raiz, int qtPontos) {
-  /* Insere os pontos */
-  for (int i = 0; i < qtPontos; i++) {
-    insereAmostra(raiz, geraAmostraUnif());
-  }
-}
+/* Fluxos aleatórios das leitoras (os fluxos baixos são dos blocos do conjunto de dados) */
+#define FLUXO_LEITORAS    (1ULL << 32)
+
+/* Cargas de trabalho */
+typedef enum {
+  CARGA_INSERCAO,                      // Escritoras inserem as N amostras
+  CARGA_RAIO,                          // Árvore pronta; leitoras fazem buscaPorRegiao
+  CARGA_FOLHA,                         // Árvore pronta; leitoras fazem buscaNaFolha
+  CARGA_MISTO,                         // Metade pronta; escritoras inserem a outra metade enquanto as leitoras buscam
+  CARGA_MISTURA,                       // Metade pronta; por um tempo fixo, cada thread sorteia inserção ou busca por região
+  CARGA_AGRUPAMENTO                    // Árvore pronta; agrupaEuclidiano com passo  raio , num pool de  leitoras  trabalhadores
+} tipoCarga;
+
+static const char* nomesCargas[] = {"insercao", "raio", "folha", "misto", "mistura", "agrupamento"};
 
-/* Argumento da thread */
+typedef enum { SAIDA_TEXTO, SAIDA_CSV, SAIDA_JSON } formatoSaida;
+
+/* Configuração de uma bateria de execuções */
+typedef struct {
+  tipoCarga carga;
+  tipoConjunto tipoDados;
+  const char* caminhoDados;
+  long long N;                         // Amostras na árvore
+  long long qtConsultas;               // Consultas (somando todas as leitoras)
+  int nEscritoras;
+  int nLeitoras;
+  float raio;
+  int aquecimento;                     // Execuções descartadas antes das medidas
+  int repeticoes;                      // Execuções medidas
+  formatoSaida saida;
+  int cabecalho;                       // Imprime o cabeçalho do CSV
+  unsigned long long semente;
+
+  /* Carga mistura */
+  double duracao;                      // Segundos de cada execução
+  int nMistas;                         // Threads que executam a mistura
+  int qtProporcoes;                    // Proporções de escrita a varrer (a primeira é a referência)
+  double proporcoes[MAX_PROPORCOES];   // Em porcentagem das operações
+  double escritaPct;                   // Proporção da execução atual
+
+  int relatorio;                       // Imprime a forma e a memória da árvore ao fim de cada execução
+  int contadores;                      // Mede os contadores de hardware de cada thread (perf_event_open)
+  int fragmentos;                      // Profundidade k da árvore fragmentada (8^k raízes); -1 usa a árvore comum
+  int buscaParalela;                   // Buscas por região grandes divididas em tarefas do pool (buscaPorRegiaoParalela)
+  int mescla;                          // Amostras por mescla das escritoras com árvore privada; 0 insere direto
+  int congela;                         // Congela a árvore antes das fases só de consultas (raio e folha)
+} configuracao;
+
+/* A árvore medida: a comum ou a fragmentada (--fragmentos) */
 typedef struct {
-  pthread_t* tid;
   noctree* raiz;
-  long int idThread;
-  long int nthreads;
-  long long int N;
-} dados_thread_escrita_t;
+  octreeFragmentada* fragmentada;
+  int buscaParalela;                   // Só na árvore comum
+} arvoreMedida;
 
+/* Resumo de uma classe de operação em uma execução */
 typedef struct {
-  pthread_t* tid;
-  long int idThread;
-  double tempoParcial;
-  long long int qtAmostras;
-} ret_thread_escrita_t;
+  const char* classe;                  // "insercao" ou "consulta"
+  long long qtOps;
+  double tempo;                        // Do início da fase até a última thread da classe terminar
+  double vazao;                        // Operações por segundo
+  double media, p50, p99, p999;        // Latências, em microssegundos
+  long long qtEncontradas;             // Amostras devolvidas pelas consultas
+  double escritaPct;                   // Porcentagem de inserções entre as operações da fase
+  double degradacaoP99;                // p99 da consulta dividido pelo p99 da primeira proporção da varredura
+  double hwPorOp[QT_CONTADORES_HW];    // Contadores de hardware por operação
+  int hwValido[QT_CONTADORES_HW];      // 1 se o contador foi lido em todas as threads da classe
+  int hwErro;                          // errno da primeira falha ao abrir os contadores
+  int hwNoPool;                        // 1 se parte das operações rodou no pool padrão (contadores vazios)
+} medida;
+
+/* Argumento e retorno de cada thread */
+typedef struct {
+  int id;
+  arvoreMedida* arvore;
+  const conjunto* dados;
+  const configuracao* cfg;
+  long long ini, fim;                  // Amostras [ini, fim) do conjunto a inserir
+  long long qtNaArvore;                // As consultas miram as amostras [0, qtNaArvore)
+  long long qtConsultas;
+  pthread_barrier_t* barreira;         // Separa a preparação da região medida
+  amostra** amostras;                  // Escritoras: amostras já alocadas, prontas para inserir
+  amostra* alvos;                      // Leitoras: centros das consultas, já sorteados
+  double* latencias;                   // Uma por operação, em segundos
+  long long qtLatencias;
+  long long capLatencias;
+  double* latenciasEscrita;            // Na carga mistura,  latencias  fica com as consultas e este com as inserções
+  long long qtLatenciasEscrita;
+  long long capLatenciasEscrita;
+  long long qtEncontradas;
+  double termino;                      // Instante em que a thread acabou
+  contadoresHW hw;                     // Contadores de hardware desta thread (com --contadores)
+  uint64_t hwValores[QT_CONTADORES_HW];
+  int hwValidos[QT_CONTADORES_HW];
+  int noPool;                          // As operações desta thread rodam em parte nos trabalhadores do pool padrão
+} argThread;
+
+
+/* Operações na árvore medida
+ * -------------------------- */
+
+static int insere(arvoreMedida* arv, amostra* ponto) {
+  return arv->fragmentada ? insereAmostraFragmentada(arv->fragmentada, ponto) : insereAmostra(arv->raiz, ponto);
+}
+
+static amostra** buscaRegiao(arvoreMedida* arv, amostra* centro, float raio, int* qt_encontrados) {
+  if (arv->fragmentada) return buscaPorRegiaoFragmentada(arv->fragmentada, centro, raio, qt_encontrados);
+  return arv->buscaParalela ? buscaPorRegiaoParalela(arv->raiz, centro, raio, qt_encontrados)
+                            : buscaPorRegiao(arv->raiz, centro, raio, qt_encontrados);
+}
+
+static amostra** buscaFolha(arvoreMedida* arv, amostra* alvo, int* qt_encontrados) {
+  return arv->fragmentada ? buscaNaFolhaFragmentada(arv->fragmentada, alvo, qt_encontrados)
+                          : buscaNaFolha(arv->raiz, alvo, qt_encontrados);
+}
+
+
+/* Rotinas das Threads
+ * ------------------- */
+
+/* Abre os contadores de hardware da thread (antes da barreira, fora da região medida) */
+static void preparaContadores(argThread* a) {
+  if (a->cfg->contadores) abreContadoresHW(&a->hw);
+}
+
+/* Liga os contadores logo depois da barreira */
+static void ligaContadores(argThread* a) {
+  if (a->cfg->contadores) ligaContadoresHW(&a->hw);
+}
+
+/* Desliga, lê e fecha os contadores ao fim da região medida */
+static void encerraContadores(argThread* a) {
+  if (!a->cfg->contadores) return;
+  desligaContadoresHW(&a->hw);
+  leContadoresHW(&a->hw, a->hwValores, a->hwValidos);
+  fechaContadoresHW(&a->hw);
+}
 
-/* Função que será executada pela thread escritora */
+/* Insere as amostras [ini, fim) do conjunto, medindo cada inserção */
 void* rotina_escritora(void* arg) {
-  dados_thread_escrita_t* dados = (dados_thread_escrita_t*)arg;
-  double inicio, fim;
+  argThread* a = (argThread*) arg;
+  const float* c = a->dados->coords;
+  long long qt = a->fim - a->ini;
+  double t0, t1;
+
+  /* Preparação: aloca as amostras fora da região medida */
+  a->amostras = (amostra**) malloc(sizeof(amostra*) * (qt + 1));
+  CHECK_MALLOC(a->amostras);
+  for (long long i = 0; i < qt; i++) {
+    long long k = a->ini + i;
+    a->amostras[i] = inicializaAmostra(c[DIM*k], c[DIM*k + 1], c[DIM*k + 2]);
+  }
+  /* Com --mescla, a escritora monta uma árvore privada e a mescla na compartilhada a cada  mescla  amostras */
+  escritorPrivado* e = (a->cfg->mescla > 0 && a->arvore->raiz) ? inicializaEscritorPrivado(a->arvore->raiz, a->cfg->mescla) : NULL;
+  preparaContadores(a);
+  pthread_barrier_wait(a->barreira);
+  ligaContadores(a);
+
+  for (long long i = 0; i < qt; i++) {
+    GET_TIME(t0);
+    if (e) insereAmostraEscritor(e, a->amostras[i]);
+    else insere(a->arvore, a->amostras[i]);
+    GET_TIME(t1);
+    a->latencias[a->qtLatencias++] = t1 - t0;
+  }
+  if (e) { // A última mescla entra na latência da última inserção
+    GET_TIME(t0);
+    descarregaEscritor(e);
+    GET_TIME(t1);
+    if (a->qtLatencias > 0) a->latencias[a->qtLatencias - 1] += t1 - t0;
+    destroiEscritorPrivado(e);
+  }
 
-LOGP("%s: Tentando inserir o ponto (%.1f, %.1f, %.1f)", dados->nome_thread, dados->ponto->x, dados->ponto->y, dados->ponto->z); ENDL;
+  encerraContadores(a);
+  GET_TIME(a->termino);
+  return NULL;
+}
 
-  /* Calcula quantas amostras precisa inserir */
-  int qtAmostrasAGerar = dados->N / dados->nthreads;
-  if (dados->idThread == 1) qtAmostrasAGerar += dados->N % dados->nthreads; // A última fica com o resto, se houver
+/* Faz  qtConsultas  buscas centradas em amostras sorteadas do conjunto */
+void* rotina_leitora(void* arg) {
+  argThread* a = (argThread*) arg;
+  const float* c = a->dados->coords;
+  long long qtAmostras = a->qtNaArvore;
+  int qt_encontrados;
+  double t0, t1;
+
+  /* Preparação: sorteia os alvos com o gerador desta thread */
+  geradorAleatorio g;
+  semeiaGerador(&g, a->cfg->semente, FLUXO_LEITORAS + a->id);
+  a->alvos = (amostra*) malloc(sizeof(amostra) * (a->qtConsultas + 1));
+  CHECK_MALLOC(a->alvos);
+  for (long long k = 0; k < a->qtConsultas; k++) {
+    long long i = aleatorioAte(&g, qtAmostras);
+    a->alvos[k] = (amostra){c[DIM*i], c[DIM*i + 1], c[DIM*i + 2]};
+  }
+  preparaContadores(a);
+  pthread_barrier_wait(a->barreira);
+  ligaContadores(a);
+
+  for (long long k = 0; k < a->qtConsultas; k++) {
+    amostra** res;
+
+    GET_TIME(t0);
+    if (a->cfg->carga == CARGA_FOLHA) {
+      res = buscaFolha(a->arvore, &a->alvos[k], &qt_encontrados);
+    } else {
+      res = buscaRegiao(a->arvore, &a->alvos[k], a->cfg->raio, &qt_encontrados);
+    }
+    GET_TIME(t1);
 
-  /* Insere as amostras */
-  GET_TIME(inicio);
-  preencheOctreeUnif(dados->raiz, qtAmostrasAGerar);
-  GET_TIME(fim);
+    free(res);
+    a->latencias[a->qtLatencias++] = t1 - t0;
+    a->qtEncontradas += qt_encontrados;
+  }
 
-  /* Gera o retorno */
-  ret_thread_escrita_t* ret = (ret_thread_escrita_t*) malloc(sizeof(ret_thread_escrita_t));
-  CHECK_MALLOC(ret);
+  encerraContadores(a);
+  GET_TIME(a->termino);
+  return NULL;
+}
 
-  ret->tid = dados->tid;
-  ret->idThread = dados->idThread;
-  ret->tempoParcial = fim - inicio;
-  ret->qtAmostras = qtAmostrasAGerar;
+/* Guarda uma latência, dobrando o vetor quando enche (fora do trecho cronometrado) */
+static void registraLatencia(double** vetor, long long* qt, long long* cap, double valor) {
+  if (*qt == *cap) {
+    *cap *= 2;
+    *vetor = (double*) realloc(*vetor, sizeof(double) * (*cap));
+    CHECK_MALLOC(*vetor);
+  }
+  (*vetor)[(*qt)++] = valor;
+}
 
-  LOGP("%s: Inserção concluída.", dados->nome_thread); ENDL;
-  pthread_exit((void*) ret);
+/* Carga mistura: até acabar o tempo, cada operação é uma inserção com probabilidade
+ * escritaPct% ou uma busca por região, c.c. */
+void* rotina_mista(void* arg) {
+  argThread* a = (argThread*) arg;
+  const float* c = a->dados->coords;
+  long long qtParaInserir = a->fim - a->ini, inseridas = 0;
+  float probEscrita = (float)(a->cfg->escritaPct / 100.0);
+  int qt_encontrados;
+  double t0, t1, prazo;
+
+  /* Preparação: amostras, alvos e o gerador que sorteia as operações */
+  geradorAleatorio g;
+  semeiaGerador(&g, a->cfg->semente, FLUXO_LEITORAS + a->id);
+
+  a->amostras = (amostra**) malloc(sizeof(amostra*) * (qtParaInserir + 1));
+  CHECK_MALLOC(a->amostras);
+  for (long long i = 0; i < qtParaInserir; i++) {
+    long long k = a->ini + i;
+    a->amostras[i] = inicializaAmostra(c[DIM*k], c[DIM*k + 1], c[DIM*k + 2]);
+  }
+  a->alvos = (amostra*) malloc(sizeof(amostra) * QT_ALVOS_MISTURA);
+  CHECK_MALLOC(a->alvos);
+  for (int k = 0; k < QT_ALVOS_MISTURA; k++) {
+    long long i = aleatorioAte(&g, a->qtNaArvore);
+    a->alvos[k] = (amostra){c[DIM*i], c[DIM*i + 1], c[DIM*i + 2]};
+  }
+  preparaContadores(a);
+  pthread_barrier_wait(a->barreira);
+  ligaContadores(a);
+
+  GET_TIME(t0);
+  prazo = t0 + a->cfg->duracao;
+  for (long long k = 0; t0 < prazo; k++) {
+    if (aleatorioUnif01(&g) < probEscrita) {
+      if (inseridas == qtParaInserir) { // Acabaram as amostras desta thread
+        fprintf(stderr, "[AVISO] thread %d inseriu todas as suas amostras antes do prazo; aumente --amostras\n", a->id);
+        break;
+      }
+      GET_TIME(t0);
+      insere(a->arvore, a->amostras[inseridas++]);
+      GET_TIME(t1);
+      registraLatencia(&a->latenciasEscrita, &a->qtLatenciasEscrita, &a->capLatenciasEscrita, t1 - t0);
+    } else {
+      GET_TIME(t0);
+      amostra** res = buscaRegiao(a->arvore, &a->alvos[k % QT_ALVOS_MISTURA], a->cfg->raio, &qt_encontrados);
+      GET_TIME(t1);
+      free(res);
+      registraLatencia(&a->latencias, &a->qtLatencias, &a->capLatencias, t1 - t0);
+      a->qtEncontradas += qt_encontrados;
+    }
+    t0 = t1;
+  }
+  encerraContadores(a);
+
+  /* As amostras não inseridas ainda são desta thread */
+  for (long long i = inseridas; i < qtParaInserir; i++) free(a->amostras[i]);
+
+  GET_TIME(a->termino);
+  return NULL;
 }
 
-int main(int argc, char *argv[]) {
-  srand(time(NULL));
-  int nthreads;                    // Qt de threads (passada linha de comando)
-  long long int N;                 // Qt de pontos na octree
-  double inicio, fim, delta, total = 0; // Marcações de tempo
-  pthread_t *tid;                  // Identificadores das threads no sistema
-  noctree* raiz = inicializaNo(inicializaAmostra(0,0,0), (float[]){100,100,100}, 0);
-  dados_thread_escrita_t* ptArgEscrita;
-  ret_thread_escrita_t* rets;
-  double tempoTotalThreads;
-  
-
-  printf("Tomadas de Tempo:\n");
-
-  GET_TIME(inicio)
-
-  //--le e avalia os parametros de entrada
-  if(argc<3) {
-    printf("Digite: %s <numero de threads> <N>\n", argv[0]);
-    return 1;
+
+/* Execução
+ * -------- */
+
+/* Prepara os argumentos de  n  threads que dividem as amostras [ini, fim) */
+static argThread* preparaEscritoras(int n, arvoreMedida* arvore, const conjunto* dados, const configuracao* cfg,
+                                    long long ini, long long fim) {
+  argThread* args = (argThread*) calloc(n, sizeof(argThread));
+  CHECK_MALLOC(args);
+
+  long long total = fim - ini;
+  for (int t = 0; t < n; t++) {
+    args[t].id = t;
+    args[t].arvore = arvore;
+    args[t].dados = dados;
+    args[t].cfg = cfg;
+    args[t].ini = ini + total * t / n;
+    args[t].fim = ini + total * (t + 1) / n;
+    args[t].latencias = (double*) malloc(sizeof(double) * (args[t].fim - args[t].ini + 1));
+    CHECK_MALLOC(args[t].latencias);
+  }
+  return args;
+}
+
+/* Prepara os argumentos de  n  leitoras que dividem as consultas. Buscam entre as  qtNaArvore  primeiras amostras. */
+/* Com --busca-paralela na árvore comum, as buscas por região rodam em parte nos trabalhadores do pool */
+static int buscasNoPool(const configuracao* cfg) {
+  return cfg->buscaParalela && cfg->fragmentos < 0 && cfg->carga != CARGA_INSERCAO && cfg->carga != CARGA_FOLHA;
+}
+
+static argThread* preparaLeitoras(int n, arvoreMedida* arvore, const conjunto* dados, const configuracao* cfg,
+                                  long long qtNaArvore) {
+  argThread* args = (argThread*) calloc(n, sizeof(argThread));
+  CHECK_MALLOC(args);
+
+  for (int t = 0; t < n; t++) {
+    args[t].id = t;
+    args[t].arvore = arvore;
+    args[t].dados = dados;
+    args[t].cfg = cfg;
+    args[t].qtNaArvore = qtNaArvore;
+    args[t].qtConsultas = cfg->qtConsultas * (t + 1) / n - cfg->qtConsultas * t / n;
+    args[t].noPool = buscasNoPool(cfg);
+    args[t].latencias = (double*) malloc(sizeof(double) * (args[t].qtConsultas + 1));
+    CHECK_MALLOC(args[t].latencias);
   }
-  nthreads = atoi(argv[1]);
-  N = atoll(argv[2]);
+  return args;
+}
+
+/* Prepara os argumentos de  n  threads mistas: dividem as amostras [ini, fim) e buscam entre [0, ini) */
+static argThread* preparaMistas(int n, arvoreMedida* arvore, const conjunto* dados, const configuracao* cfg,
+                                long long ini, long long fim) {
+  argThread* args = preparaEscritoras(n, arvore, dados, cfg, ini, fim);
+
+  for (int t = 0; t < n; t++) {
+    args[t].qtNaArvore = ini;
+    args[t].noPool = buscasNoPool(cfg);
+    args[t].capLatencias = args[t].capLatenciasEscrita = 1 << 16;
+    args[t].latencias = (double*) realloc(args[t].latencias, sizeof(double) * args[t].capLatencias);
+    CHECK_MALLOC(args[t].latencias);
+    args[t].latenciasEscrita = (double*) malloc(sizeof(double) * args[t].capLatenciasEscrita);
+    CHECK_MALLOC(args[t].latenciasEscrita);
+  }
+  return args;
+}
 
-  //--aloca as estruturas
-  tid = (pthread_t*) malloc(sizeof(pthread_t)*(nthreads+1));
+/* As amostras em si passaram a ser da árvore; só os vetores são liberados */
+static void liberaArgs(argThread* args, int n) {
+  for (int t = 0; t < n; t++) {
+    free(args[t].latencias);
+    free(args[t].latenciasEscrita);
+    free(args[t].amostras);
+    free(args[t].alvos);
+  }
+  free(args);
+}
+
+/* Dispara as threads de dois grupos ao mesmo tempo e espera todas.
+ * Devolve o instante em que todas terminaram a preparação (início da região medida). */
+static double executaFase(argThread* grupoA, int nA, void* (*rotinaA)(void*),
+                          argThread* grupoB, int nB, void* (*rotinaB)(void*)) {
+  pthread_t* tid = (pthread_t*) malloc(sizeof(pthread_t) * (nA + nB));
   CHECK_MALLOC(tid);
+  pthread_barrier_t barreira;
+  double inicio;
+
+  pthread_barrier_init(&barreira, NULL, nA + nB + 1);
+  for (int t = 0; t < nA; t++) grupoA[t].barreira = &barreira;
+  for (int t = 0; t < nB; t++) grupoB[t].barreira = &barreira;
 
-  rets = (ret_thread_escrita_t*) malloc(sizeof(ret_thread_escrita_t) * nthreads);
-  CHECK_MALLOC(rets);
-
-  //--cria as threads
-  GET_TIME(fim);
-  delta = fim - inicio;
-  printf("  Início da criação das threads em %lf\n", fim);
-  total += delta;
-
-  GET_TIME(inicio)
-  for(long int t=0; t<nthreads; t++) {
-    /* Cria o argumento */
-    ptArgEscrita = (dados_thread_escrita_t*) malloc(sizeof(dados_thread_escrita_t));
-    CHECK_MALLOC(ptArgEscrita);
-
-    ptArgEscrita->tid = &tid[t];
-    ptArgEscrita->raiz = raiz;
-    ptArgEscrita->idThread = t;
-    ptArgEscrita->nthreads = nthreads;
-    ptArgEscrita->N = N;
-
-    /* Inicializa a thread */
-    if (pthread_create((void*)ptArgEscrita, NULL, rotina_escritora, (void *)t)) {
+  for (int t = 0; t < nA; t++) {
+    if (pthread_create(&tid[t], NULL, rotinaA, &grupoA[t])) {
       printf("--ERRO: pthread_create()\n"); exit(-1);
     }
   }
+  for (int t = 0; t < nB; t++) {
+    if (pthread_create(&tid[nA + t], NULL, rotinaB, &grupoB[t])) {
+      printf("--ERRO: pthread_create()\n"); exit(-1);
+    }
+  }
+  pthread_barrier_wait(&barreira);
+  GET_TIME(inicio);
 
-  GET_TIME(fim);
-  delta = fim - inicio;
-  printf("  Fim da criação das Threads em %lf\n", fim);
-  total += delta;
+  for (int t = 0; t < nA + nB; t++) {
+    if (pthread_join(tid[t], NULL)) {
+      printf("--ERRO: pthread_join() \n"); exit(-1);
+    }
+  }
+
+  pthread_barrier_destroy(&barreira);
+  free(tid);
+  return inicio;
+}
 
-  //--espera todas as threads terminarem
-  GET_TIME(inicio)
-  for (int t=0; t<nthreads; t++) {
-    if (pthread_join(tid[t], (void**) &rets[t])) {
-      printf("--ERRO: pthread_join() \n"); exit(-1); 
-    } 
+static int comparaDouble(const void* a, const void* b) {
+  double x = *(const double*) a, y = *(const double*) b;
+  return (x > y) - (x < y);
+}
+
+/* Percentil  p  (em [0,1]) de um vetor ordenado */
+static double percentil(const double* ordenado, long long n, double p) {
+  if (n == 0) return 0;
+  long long i = (long long)(p * (n - 1) + 0.5);
+  return ordenado[i];
+}
+
+/* Soma os contadores de hardware de um grupo e divide pelas operações das threads.
+ * Na carga mistura, cada thread faz as duas classes: o número vale para todas as operações dela.
+ * Os contadores são da thread que os abriu: se parte do trabalho rodou no pool, as colunas ficam
+ * vazias em vez de subestimadas. */
+static void resumeContadores(medida* m, argThread* args, int n) {
+  long long ops = 0;
+  for (int t = 0; t < n; t++) {
+    ops += args[t].qtLatencias + args[t].qtLatenciasEscrita;
+    m->hwNoPool = m->hwNoPool || args[t].noPool;
+  }
+  if (m->hwNoPool) return;
+
+  for (int e = 0; e < QT_CONTADORES_HW; e++) {
+    uint64_t soma = 0;
+    m->hwValido[e] = (ops > 0);
+    for (int t = 0; t < n; t++) {
+      soma += args[t].hwValores[e];
+      m->hwValido[e] = m->hwValido[e] && args[t].hwValidos[e];
+      if (!args[t].hwValidos[e] && m->hwErro == 0) m->hwErro = args[t].hw.erro;
+    }
+    m->hwPorOp[e] = m->hwValido[e] ? (double) soma / ops : 0;
   }
-  GET_TIME(fim);
-  delta = fim - inicio;
-  printf("  Fim das Threads em %lf\n", fim);
-  total += delta;
+}
 
+/* Junta as latências de um grupo de threads e calcula o resumo.
+ * Com  escrita , usa as latências de inserção das threads mistas. */
+static medida resume(const char* classe, argThread* args, int n, double inicioFase, int escrita) {
+  medida m;
+  double termino = inicioFase;
+
+  memset(&m, 0, sizeof(medida));
+  m.classe = classe;
+  m.degradacaoP99 = 1;
+  if (args[0].cfg->contadores) resumeContadores(&m, args, n);
+
+  for (int t = 0; t < n; t++) {
+    m.qtOps += escrita ? args[t].qtLatenciasEscrita : args[t].qtLatencias;
+    if (!escrita) m.qtEncontradas += args[t].qtEncontradas;
+    if (args[t].termino > termino) termino = args[t].termino;
+  }
 
-  printf("\n");
-  printf("RESUMO THREADS\n");
-  printf("--------------\n");
-  for (int t = 0; t < nthreads; t++) {
-    printf("Thread #%ld\n", rets[t].idThread);
-    printf("  Gerados e inseridos: %lld\n", rets[t].qtAmostras);
-    printf("  Tempo parcial: %lf\n", rets[t].tempoParcial);
-    tempoTotalThreads += rets[t].tempoParcial;
+  double* todas = (double*) malloc(sizeof(double) * (m.qtOps + 1));
+  CHECK_MALLOC(todas);
+  long long k = 0;
+  double soma = 0;
+  for (int t = 0; t < n; t++) {
+    double* lat = escrita ? args[t].latenciasEscrita : args[t].latencias;
+    long long qt = escrita ? args[t].qtLatenciasEscrita : args[t].qtLatencias;
+    for (long long i = 0; i < qt; i++) {
+      todas[k++] = lat[i];
+      soma += lat[i];
+    }
   }
+  qsort(todas, m.qtOps, sizeof(double), comparaDouble);
 
-  printf("\n");
-  printf("RESUMO PROGRAMA\n");
-  printf("---------------\n");
-  printf("Tempo de processamento das threads: %lf", tempoTotalThreads);
-  printf("Tempo total do programa:            %lf", total);
+  m.tempo = termino - inicioFase;
+  m.vazao = (m.tempo > 0) ? m.qtOps / m.tempo : 0;
+  m.media = (m.qtOps > 0) ? 1e6 * soma / m.qtOps : 0;
+  m.p50   = 1e6 * percentil(todas, m.qtOps, 0.50);
+  m.p99   = 1e6 * percentil(todas, m.qtOps, 0.99);
+  m.p999  = 1e6 * percentil(todas, m.qtOps, 0.999);
 
-  destroiNo(raiz);
-  free(rets);
+  free(todas);
+  return m;
+}
+
+/* Relatório da árvore ao fim da execução (em texto vai junto das medidas; nos outros formatos, para o stderr) */
+static void relataArvore(const configuracao* cfg, arvoreMedida* arv) {
+  relatorioOctree r, parcial;
+  FILE* saida = (cfg->saida == SAIDA_TEXTO) ? stdout : stderr;
+  int nucleos = (int) sysconf(_SC_NPROCESSORS_ONLN);
+
+  if (arv->fragmentada) {
+    memset(&r, 0, sizeof(relatorioOctree));
+    for (int i = 0; i < arv->fragmentada->qtFragmentos; i++) {
+      geraRelatorioOctree(&arv->fragmentada->fragmentos[i].raiz, nucleos, &parcial);
+      somaRelatorioOctree(&r, &parcial);
+    }
+  } else {
+    geraRelatorioOctree(arv->raiz, nucleos, &r);
+  }
+  fprintf(saida, "Forma da árvore ao fim da execução\n");
+  imprimeRelatorioOctree(saida, &r);
+}
+
+/* Balanço das amostras entre os fragmentos, junto do relatório */
+static void relataFragmentos(const configuracao* cfg, octreeFragmentada* of) {
+  balancoFragmentos b;
+  FILE* saida = (cfg->saida == SAIDA_TEXTO) ? stdout : stderr;
+
+  balancoOctreeFragmentada(of, &b);
+  fprintf(saida, "Fragmentos (k = %d): %d, %d vazios | amostras por fragmento: mín %lld, máx %lld, média %.1f, desvio %.1f | máx/média %.2f\n",
+          of->k, b.qtFragmentos, b.qtVazios, b.minimo, b.maximo, b.media, b.desvio, b.desequilibrio);
+}
+
+static arvoreMedida criaArvore(const configuracao* cfg) {
+  arvoreMedida arv = {NULL, NULL, cfg->buscaParalela};
+  if (cfg->fragmentos >= 0) {
+    arv.fragmentada = inicializaOctreeFragmentada(inicializaAmostra(0,0,0), (float[]){100,100,100}, cfg->fragmentos);
+  } else {
+    arv.raiz = inicializaNo(inicializaAmostra(0,0,0), (float[]){100,100,100}, 0);
+  }
+  return arv;
+}
+
+/* Congela a árvore (ou cada fragmento): as consultas deixam de pegar locks */
+static void congelaArvore(arvoreMedida* arv) {
+  if (arv->fragmentada) {
+    for (int i = 0; i < arv->fragmentada->qtFragmentos; i++) congela(&arv->fragmentada->fragmentos[i].raiz);
+  } else {
+    congela(arv->raiz);
+  }
+}
+
+/* Relata (se pedido) e destrói a árvore ao fim da execução */
+static void encerraArvore(const configuracao* cfg, arvoreMedida* arv) {
+  if (cfg->relatorio) {
+    relataArvore(cfg, arv);
+    if (arv->fragmentada) relataFragmentos(cfg, arv->fragmentada);
+  }
+  if (arv->fragmentada) destroiOctreeFragmentada(arv->fragmentada);
+  else destroiNo(arv->raiz);
+}
+
+/* Uma execução completa da carga. Devolve quantas medidas escreveu em  saida  (no máximo 2). */
+static int executa(const configuracao* cfg, const conjunto* dados, medida* saida) {
+  arvoreMedida arv = criaArvore(cfg);
+  long long N = dados->qtAmostras;
+  double inicio;
+  int qtMedidas = 0;
+
+  /* Quanto do conjunto é carregado antes da fase medida */
+  long long preCarga = (cfg->carga == CARGA_INSERCAO) ? 0 :
+                       (cfg->carga == CARGA_MISTO || cfg->carga == CARGA_MISTURA) ? N / 2 : N;
+
+  if (preCarga > 0) {
+    argThread* pre = preparaEscritoras(cfg->nEscritoras, &arv, dados, cfg, 0, preCarga);
+    executaFase(pre, cfg->nEscritoras, rotina_escritora, NULL, 0, NULL);
+    liberaArgs(pre, cfg->nEscritoras);
+  }
+
+  /* Os contadores de instrumentação (se compilados) cobrem só a fase medida */
+  octreeZeraEstatisticas();
+
+  /* Fase medida do agrupamento: uma operação só, nas threads do pool padrão */
+  if (cfg->carga == CARGA_AGRUPAMENTO) {
+    agrupamentoOctree a;
+    double fim;
+    GET_TIME(inicio);
+    agrupaEuclidiano(arv.raiz, cfg->raio, 1, &a);
+    GET_TIME(fim);
+
+    double tempo = fim - inicio;
+    saida[qtMedidas++] = (medida){.classe = "agrupamento", .qtOps = N, .tempo = tempo, .vazao = N / tempo,
+                                  .media = tempo * 1e6, .p50 = tempo * 1e6, .p99 = tempo * 1e6, .p999 = tempo * 1e6,
+                                  .qtEncontradas = a.qtGrupos, .hwNoPool = cfg->contadores};
+    liberaAgrupamento(&a);
+    encerraArvore(cfg, &arv);
+    return qtMedidas;
+  }
+
+  /* Fase medida da carga mistura: só threads mistas */
+  if (cfg->carga == CARGA_MISTURA) {
+    argThread* mis = preparaMistas(cfg->nMistas, &arv, dados, cfg, preCarga, N);
+    inicio = executaFase(mis, cfg->nMistas, rotina_mista, NULL, 0, NULL);
+
+    saida[qtMedidas++] = resume("insercao", mis, cfg->nMistas, inicio, 1);
+    saida[qtMedidas++] = resume("consulta", mis, cfg->nMistas, inicio, 0);
+    saida[0].escritaPct = saida[1].escritaPct = cfg->escritaPct;
+
+    liberaArgs(mis, cfg->nMistas);
+    encerraArvore(cfg, &arv);
+    return qtMedidas;
+  }
+
+  /* Fase medida */
+  int nEsc = (cfg->carga == CARGA_INSERCAO || cfg->carga == CARGA_MISTO) ? cfg->nEscritoras : 0;
+  int nLeit = (cfg->carga == CARGA_INSERCAO) ? 0 : cfg->nLeitoras;
+  argThread* esc = preparaEscritoras(nEsc, &arv, dados, cfg, preCarga, N);
+  argThread* leit = preparaLeitoras(nLeit, &arv, dados, cfg, preCarga > 0 ? preCarga : N);
+  if (cfg->congela && nEsc == 0) congelaArvore(&arv);
+
+  inicio = executaFase(esc, nEsc, rotina_escritora, leit, nLeit, rotina_leitora);
+
+  if (nEsc > 0)  saida[qtMedidas++] = resume("insercao", esc, nEsc, inicio, 0);
+  if (nLeit > 0) saida[qtMedidas++] = resume("consulta", leit, nLeit, inicio, 0);
+
+  /* Porcentagem de escritas efetivamente feitas na fase */
+  long long totalOps = 0, opsEscrita = (nEsc > 0) ? saida[0].qtOps : 0;
+  for (int m = 0; m < qtMedidas; m++) totalOps += saida[m].qtOps;
+  for (int m = 0; m < qtMedidas; m++) saida[m].escritaPct = totalOps ? 100.0 * opsEscrita / totalOps : 0;
+
+  liberaArgs(esc, nEsc);
+  liberaArgs(leit, nLeit);
+  encerraArvore(cfg, &arv);
+  return qtMedidas;
+}
+
+
+/* Saída
+ * ----- */
+
+/* 1 se a fase medida rodou com a árvore congelada (só nas cargas sem escritoras) */
+static int arvoreCongelada(const configuracao* cfg) {
+  return cfg->congela && (cfg->carga == CARGA_RAIO || cfg->carga == CARGA_FOLHA);
+}
+
+static void imprimeCabecalhoCSV(void) {
+  printf("carga,dados,amostras,consultas,escritoras,leitoras,raio,repeticao,classe,"
+         "operacoes,tempo_s,vazao_ops_s,lat_media_us,lat_p50_us,lat_p99_us,lat_p999_us,encontradas,"
+         "escrita_pct,degradacao_p99");
+  for (int e = 0; e < QT_CONTADORES_HW; e++) printf(",%s_op", nomesContadoresHW[e]);
+  printf(",fragmentos,busca_paralela,mescla,congelada\n");
+}
+
+/* Contadores de hardware por operação, como colunas finais; os não medidos ficam vazios (CSV) ou null (JSON) */
+static void imprimeContadores(const medida* m, int json) {
+  for (int e = 0; e < QT_CONTADORES_HW; e++) {
+    if (json) printf(",\"%s_op\":", nomesContadoresHW[e]);
+    else printf(",");
+    if (m->hwValido[e]) printf("%.2f", m->hwPorOp[e]);
+    else if (json) printf("null");
+  }
+}
+
+static void imprimeMedida(const configuracao* cfg, long long N, int repeticao, const medida* m) {
+  const char* carga = nomesCargas[cfg->carga];
+  const char* dados = nomeConjunto(cfg->tipoDados);
+  /* Na carga mistura, as mesmas threads escrevem e leem */
+  int nEsc = (cfg->carga == CARGA_MISTURA) ? cfg->nMistas : cfg->nEscritoras;
+  int nLeit = (cfg->carga == CARGA_MISTURA) ? cfg->nMistas : cfg->nLeitoras;
+
+  switch (cfg->saida) {
+    case SAIDA_CSV:
+      printf("%s,%s,%lld,%lld,%d,%d,%g,%d,%s,%lld,%.6f,%.1f,%.3f,%.3f,%.3f,%.3f,%lld,%.2f,%.3f",
+             carga, dados, N, cfg->qtConsultas, nEsc, nLeit, cfg->raio, repeticao,
+             m->classe, m->qtOps, m->tempo, m->vazao, m->media, m->p50, m->p99, m->p999, m->qtEncontradas,
+             m->escritaPct, m->degradacaoP99);
+      imprimeContadores(m, 0);
+      printf(",%d,%d,%d,%d\n", cfg->fragmentos, cfg->buscaParalela, cfg->mescla, arvoreCongelada(cfg));
+      break;
+
+    case SAIDA_JSON:
+      printf("{\"carga\":\"%s\",\"dados\":\"%s\",\"amostras\":%lld,\"consultas\":%lld,"
+             "\"escritoras\":%d,\"leitoras\":%d,\"raio\":%g,\"repeticao\":%d,\"classe\":\"%s\","
+             "\"operacoes\":%lld,\"tempo_s\":%.6f,\"vazao_ops_s\":%.1f,\"lat_media_us\":%.3f,"
+             "\"lat_p50_us\":%.3f,\"lat_p99_us\":%.3f,\"lat_p999_us\":%.3f,\"encontradas\":%lld,"
+             "\"escrita_pct\":%.2f,\"degradacao_p99\":%.3f",
+             carga, dados, N, cfg->qtConsultas, nEsc, nLeit, cfg->raio, repeticao,
+             m->classe, m->qtOps, m->tempo, m->vazao, m->media, m->p50, m->p99, m->p999, m->qtEncontradas,
+             m->escritaPct, m->degradacaoP99);
+      imprimeContadores(m, 1);
+      printf(",\"fragmentos\":%d,\"busca_paralela\":%d,\"mescla\":%d,\"congelada\":%d}\n",
+             cfg->fragmentos, cfg->buscaParalela, cfg->mescla, arvoreCongelada(cfg));
+      break;
+
+    default:
+      printf("Repetição %d - %s (%.1lf%% de escritas)\n", repeticao, m->classe, m->escritaPct);
+      printf("  Operações:        %lld\n", m->qtOps);
+      printf("  Tempo:            %lf seg\n", m->tempo);
+      printf("  Vazão:            %.1lf ops/seg\n", m->vazao);
+      printf("  Latência (us):    média %.3lf | p50 %.3lf | p99 %.3lf | p99.9 %.3lf\n",
+             m->media, m->p50, m->p99, m->p999);
+      if (m->qtEncontradas > 0) printf("  Amostras achadas: %lld\n", m->qtEncontradas);
+      if (cfg->carga == CARGA_MISTURA && strcmp(m->classe, "consulta") == 0) {
+        printf("  p99 / p99 com %.1lf%% de escritas: %.3lf\n", cfg->proporcoes[0], m->degradacaoP99);
+      }
+      if (m->hwValido[HW_CICLOS] || m->hwValido[HW_INSTRUCOES] || m->hwValido[HW_FALHAS_LLC] || m->hwValido[HW_FALHAS_DTLB]) {
+        printf("  Por operação:    ");
+        if (m->hwValido[HW_CICLOS])     printf(" %.1lf ciclos |", m->hwPorOp[HW_CICLOS]);
+        if (m->hwValido[HW_INSTRUCOES]) printf(" %.1lf instruções |", m->hwPorOp[HW_INSTRUCOES]);
+        if (m->hwValido[HW_CICLOS] && m->hwValido[HW_INSTRUCOES] && m->hwPorOp[HW_CICLOS] > 0) {
+          printf(" IPC %.2lf |", m->hwPorOp[HW_INSTRUCOES] / m->hwPorOp[HW_CICLOS]);
+        }
+        if (m->hwValido[HW_FALHAS_LLC])  printf(" %.2lf falhas LLC |", m->hwPorOp[HW_FALHAS_LLC]);
+        if (m->hwValido[HW_FALHAS_DTLB]) printf(" %.2lf falhas dTLB |", m->hwPorOp[HW_FALHAS_DTLB]);
+        printf("\n");
+      }
+      break;
+  }
+}
+
+static void uso(const char* prog) {
+  printf("Uso: %s [opções]\n", prog);
+  printf("  -c, --carga C         insercao | raio | folha | misto | mistura | agrupamento (padrão: insercao)\n");
+  printf("  -d, --dados D         uniforme | gaussiano | lidar | arquivo:<caminho> (padrão: uniforme)\n");
+  printf("  -n, --amostras N      amostras na árvore (padrão: %d)\n", PADRAO_AMOSTRAS);
+  printf("  -q, --consultas Q     consultas, somando todas as leitoras (padrão: %d)\n", PADRAO_CONSULTAS);
+  printf("  -e, --escritoras E    threads escritoras (padrão: 1)\n");
+  printf("  -l, --leitoras L      threads leitoras; no agrupamento, trabalhadores do pool (padrão: 1)\n");
+  printf("  -r, --raio R          raio das buscas por região; no agrupamento, o passo (padrão: %d)\n", PADRAO_RAIO);
+  printf("  -w, --aquecimento W   execuções descartadas (padrão: %d)\n", PADRAO_AQUECIMENTO);
+  printf("  -k, --repeticoes K    execuções medidas (padrão: %d)\n", PADRAO_REPETICOES);
+  printf("  -t, --threads T       threads da carga mistura (padrão: %d)\n", PADRAO_THREADS_MISTURA);
+  printf("  -p, --escrita P[,P..] %% de inserções na carga mistura; uma lista faz uma varredura (padrão: 5)\n");
+  printf("  -D, --duracao S       segundos de cada execução da carga mistura (padrão: %.0f)\n", PADRAO_DURACAO);
+  printf("  -o, --saida S         texto | csv | json (padrão: texto)\n");
+  printf("  -H, --cabecalho       imprime o cabeçalho do CSV\n");
+  printf("  -P, --contadores      mede ciclos, instruções e falhas de LLC/dTLB por operação (perf_event_open)\n");
+  printf("  -f, --fragmentos K    usa a árvore fragmentada em 8^K raízes (0 a %d)\n", FRAGMENTADA_MAX_K);
+  printf("  -B, --busca-paralela  divide as buscas por região grandes em tarefas do pool da biblioteca\n");
+  printf("  -M, --mescla N        escritoras montam árvores privadas e as mesclam na compartilhada a cada N amostras\n");
+  printf("  -Z, --congela        congela a árvore antes da fase medida das cargas raio e folha (consultas sem lock)\n");
+  printf("  -R, --relatorio       imprime a forma e a memória da árvore ao fim de cada execução\n");
+  printf("  -s, --semente S       semente dos geradores; a mesma semente reproduz a execução (padrão: hora atual)\n");
+}
+
+/* Lê a linha de comando. Retorna 0 se algo está errado. */
+static int interpretaArgumentos(int argc, char* argv[], configuracao* cfg) {
+  static struct option opcoes[] = {
+    {"carga",       required_argument, 0, 'c'},
+    {"dados",       required_argument, 0, 'd'},
+    {"amostras",    required_argument, 0, 'n'},
+    {"consultas",   required_argument, 0, 'q'},
+    {"escritoras",  required_argument, 0, 'e'},
+    {"leitoras",    required_argument, 0, 'l'},
+    {"raio",        required_argument, 0, 'r'},
+    {"aquecimento", required_argument, 0, 'w'},
+    {"repeticoes",  required_argument, 0, 'k'},
+    {"threads",     required_argument, 0, 't'},
+    {"escrita",     required_argument, 0, 'p'},
+    {"duracao",     required_argument, 0, 'D'},
+    {"saida",       required_argument, 0, 'o'},
+    {"cabecalho",   no_argument,       0, 'H'},
+    {"relatorio",   no_argument,       0, 'R'},
+    {"contadores",  no_argument,       0, 'P'},
+    {"fragmentos",  required_argument, 0, 'f'},
+    {"busca-paralela", no_argument,    0, 'B'},
+    {"mescla",      required_argument, 0, 'M'},
+    {"congela",     no_argument,       0, 'Z'},
+    {"semente",     required_argument, 0, 's'},
+    {"ajuda",       no_argument,       0, 'h'},
+    {0, 0, 0, 0}
+  };
+
+  *cfg = (configuracao){CARGA_INSERCAO, CONJUNTO_UNIFORME, NULL, PADRAO_AMOSTRAS, PADRAO_CONSULTAS, 1, 1,
+                        PADRAO_RAIO, PADRAO_AQUECIMENTO, PADRAO_REPETICOES, SAIDA_TEXTO, 0, (unsigned long long) time(NULL),
+                        PADRAO_DURACAO, PADRAO_THREADS_MISTURA, 1, {5}, 5, 0, 0, -1, 0, 0, 0};
+
+  int op;
+  while ((op = getopt_long(argc, argv, "c:d:n:q:e:l:r:w:k:t:p:D:f:M:o:HRPBZs:h", opcoes, NULL)) != -1) {
+    switch (op) {
+      case 'c': {
+        int achou = 0;
+        for (int i = 0; i < (int)(sizeof(nomesCargas) / sizeof(nomesCargas[0])); i++) {
+          if (strcmp(optarg, nomesCargas[i]) == 0) { cfg->carga = (tipoCarga) i; achou = 1; }
+        }
+        if (!achou) return 0;
+        break;
+      }
+      case 'd': if (!interpretaConjunto(optarg, &cfg->tipoDados, &cfg->caminhoDados)) return 0; break;
+      case 'n': cfg->N = atoll(optarg); break;
+      case 'q': cfg->qtConsultas = atoll(optarg); break;
+      case 'e': cfg->nEscritoras = atoi(optarg); break;
+      case 'l': cfg->nLeitoras = atoi(optarg); break;
+      case 'r': cfg->raio = atof(optarg); break;
+      case 'w': cfg->aquecimento = atoi(optarg); break;
+      case 'k': cfg->repeticoes = atoi(optarg); break;
+      case 't': cfg->nMistas = atoi(optarg); break;
+      case 'D': cfg->duracao = atof(optarg); break;
+      case 'p': {
+        char* resto = optarg;
+        cfg->qtProporcoes = 0;
+        while (*resto != '\0' && cfg->qtProporcoes < MAX_PROPORCOES) {
+          double p = strtod(resto, &resto);
+          if (p < 0 || p > 100) return 0;
+          cfg->proporcoes[cfg->qtProporcoes++] = p;
+          if (*resto == ',') resto++;
+          else if (*resto != '\0') return 0;
+        }
+        if (cfg->qtProporcoes == 0) return 0;
+        break;
+      }
+      case 'o':
+        if (strcmp(optarg, "texto") == 0)     cfg->saida = SAIDA_TEXTO;
+        else if (strcmp(optarg, "csv") == 0)  cfg->saida = SAIDA_CSV;
+        else if (strcmp(optarg, "json") == 0) cfg->saida = SAIDA_JSON;
+        else return 0;
+        break;
+      case 'H': cfg->cabecalho = 1; break;
+      case 'R': cfg->relatorio = 1; break;
+      case 'P': cfg->contadores = 1; break;
+      case 'f': cfg->fragmentos = atoi(optarg); break;
+      case 'B': cfg->buscaParalela = 1; break;
+      case 'M': cfg->mescla = atoi(optarg); break;
+      case 'Z': cfg->congela = 1; break;
+      case 's': cfg->semente = strtoull(optarg, NULL, 10); break;
+      default: return 0;
+    }
+  }
+
+  return cfg->N > 0 && cfg->nEscritoras > 0 && cfg->nLeitoras > 0 && cfg->nMistas > 0 && cfg->duracao > 0 && cfg->fragmentos <= FRAGMENTADA_MAX_K && cfg->mescla >= 0 &&
+         (cfg->carga != CARGA_AGRUPAMENTO || cfg->fragmentos < 0) && cfg->qtConsultas >= 0 && cfg->aquecimento >= 0 && cfg->repeticoes > 0;
+}
+
+int main(int argc, char *argv[]) {
+  configuracao cfg;
+  medida medidas[2];
+
+  if (!interpretaArgumentos(argc, argv, &cfg)) {
+    uso(argv[0]);
+    return 1;
+  }
+  /* No agrupamento, as leitoras são os trabalhadores do pool (antes de qualquer  poolPadrao() ) */
+  if (cfg.carga == CARGA_AGRUPAMENTO) configuraPoolPadrao(cfg.nLeitoras, 0);
+  int nucleos = (int) sysconf(_SC_NPROCESSORS_ONLN);
+  conjunto* dados = geraConjunto(cfg.tipoDados, cfg.N, cfg.caminhoDados, cfg.semente, nucleos);
+  if (dados == NULL) {
+    fprintf(stderr, "Não foi possível ler o conjunto de dados '%s'\n", cfg.caminhoDados);
+    return 1;
+  }
+
+  if (cfg.saida == SAIDA_CSV && cfg.cabecalho) imprimeCabecalhoCSV();
+  if (cfg.saida == SAIDA_TEXTO) {
+    printf("Carga %s sobre %lld amostras (%s), %d escritora(s), %d leitora(s), semente %llu\n",
+           nomesCargas[cfg.carga], dados->qtAmostras, nomeConjunto(cfg.tipoDados),
+           cfg.nEscritoras, cfg.nLeitoras, cfg.semente);
+  }
+  if (cfg.saida == SAIDA_TEXTO && cfg.fragmentos >= 0) {
+    printf("  Árvore fragmentada em 8^%d raízes\n", cfg.fragmentos);
+  }
+  if (cfg.saida == SAIDA_TEXTO && cfg.mescla > 0 && cfg.fragmentos < 0) {
+    printf("  Escritoras com árvores privadas, mescladas a cada %d amostras\n", cfg.mescla);
+  }
+  if (cfg.saida == SAIDA_TEXTO && arvoreCongelada(&cfg)) {
+    printf("  Árvore congelada durante as consultas\n");
+  }
+  if (cfg.saida == SAIDA_TEXTO && cfg.buscaParalela && cfg.fragmentos < 0) {
+    printf("  Buscas por região grandes divididas em tarefas (%d trabalhadores)\n", poolPadrao()->qtTrabalhadores);
+  }
+  if (cfg.saida == SAIDA_TEXTO && cfg.carga == CARGA_AGRUPAMENTO) {
+    printf("  Agrupamento com passo %g, %d trabalhador(es) no pool; \"encontradas\" são os grupos\n",
+           cfg.raio, poolPadrao()->qtTrabalhadores);
+  }
+  if (cfg.saida == SAIDA_TEXTO && cfg.carga == CARGA_MISTURA) {
+    printf("  %d thread(s) mista(s), %.2lf seg por execução\n", cfg.nMistas, cfg.duracao);
+  }
+
+  /* Aquecimento: mesmas execuções (com a primeira proporção de escrita), resultados descartados */
+  cfg.escritaPct = cfg.proporcoes[0];
+  for (int i = 0; i < cfg.aquecimento; i++) {
+    executa(&cfg, dados, medidas);
+  }
+
+  /* Só a carga mistura varre as proporções de escrita */
+  int qtProporcoes = (cfg.carga == CARGA_MISTURA) ? cfg.qtProporcoes : 1;
+  int avisouContadores = 0, avisouPool = 0;
+
+  for (int rep = 1; rep <= cfg.repeticoes; rep++) {
+    double p99Referencia = 0;
+
+    for (int i = 0; i < qtProporcoes; i++) {
+      cfg.escritaPct = cfg.proporcoes[i];
+      int qt = executa(&cfg, dados, medidas);
+
+      for (int m = 0; m < qt; m++) {
+        if (cfg.carga == CARGA_MISTURA && strcmp(medidas[m].classe, "consulta") == 0) {
+          if (i == 0) p99Referencia = medidas[m].p99;
+          medidas[m].degradacaoP99 = (p99Referencia > 0) ? medidas[m].p99 / p99Referencia : 1;
+        }
+        imprimeMedida(&cfg, dados->qtAmostras, rep, &medidas[m]);
+
+        /* Sem contadores de hardware, avisa uma vez e segue só com os tempos */
+        if (cfg.contadores && !avisouPool && medidas[m].hwNoPool) {
+          fprintf(stderr, "[AVISO] parte do trabalho roda no pool padrão, fora das threads medidas; "
+                          "as colunas dos contadores dessas medidas ficam vazias\n");
+          avisouPool = 1;
+        }
+        if (cfg.contadores && !avisouContadores && !medidas[m].hwNoPool && !medidas[m].hwValido[HW_CICLOS]) {
+          fprintf(stderr, "[AVISO] contadores de hardware indisponíveis (%s); as colunas ficam vazias\n",
+                  medidas[m].hwErro ? strerror(medidas[m].hwErro) : "evento não suportado");
+          avisouContadores = 1;
+        }
+      }
+
+      /* Só no driver compilado com -DNOCTREE_ESTATISTICAS (make desempenho_estatisticas) */
+      estatisticasOctree est;
+      if (cfg.saida == SAIDA_TEXTO && octreeEstatisticasRuntime(&est)) {
+        printf("Repetição %d - instrumentação da fase medida\n", rep);
+        imprimeEstatisticasOctree(stdout, &est);
+      }
+      fflush(stdout);
+    }
+  }
 
+  destroiConjunto(dados);
   return 0;
 }
@@ -10,6 +10,21 @@
 
 #include "framework.h"
 #include "../src/noctree.h"
+#include "../src/ingestao.h"
+#include "../src/relatorio.h"
+#include "../src/fragmentada.h"
+#include "../src/paralelo.h"
+#include "../src/escritor.h"
+#include "../src/quadros.h"
+#include "../src/voxel.h"
+#include "../src/filtros.h"
+#include "../src/normais.h"
+#include "../src/agrupamento.h"
+#include "../src/duplo.h"
+#include "../src/ocupacao.h"
+#include "../src/diferenca.h"
+#include "../src/locacional.h"
+#include "../src/solta.h"
 
 /* Variáveis do framework de testes */
 extern int total_testes;
@@ -240,6 +255,1664 @@ void test_subdivisao_concorrente_manual() {
   destroiNo(raiz);
 }
 
+// --- Testes do Pipeline de Ingestão ---
+
+void test_ingestao_reproducao_arquivo() {
+  printf("Executando Teste 6: Ingestão - Reprodução de Arquivo de Pacotes...\n");
+  noctree* raiz = inicializaNo(inicializaAmostra(0,0,0), (float[]){100,100,100}, 0);
+  const int qtPacotes = 40;
+  const int retornosPorPacote = 100;
+  int esperados = 0;
+
+  /* Grava um arquivo de pacotes sintéticos. Um a cada 10 retornos não tem eco. */
+  char caminho[] = "/tmp/octree_pacotesXXXXXX";
+  int fd = mkstemp(caminho);
+  ASSERT(fd >= 0);
+  FILE* arq = fdopen(fd, "wb");
+
+  pacote* p = (pacote*) malloc(sizeof(pacote));
+  for (int k = 0; k < qtPacotes; k++) {
+    p->origem[0] = p->origem[1] = p->origem[2] = 0;
+    p->qtRetornos = retornosPorPacote;
+    for (int i = 0; i < retornosPorPacote; i++) {
+      p->retornos[i].distancia = (i % 10 == 0) ? 0 : 1 + (k + i) % 40;
+      p->retornos[i].azimute   = 0.06f * i;
+      p->retornos[i].elevacao  = 0.01f * (k - 20);
+      if (p->retornos[i].distancia > 0) esperados++;
+    }
+    ASSERT(gravaPacote(arq, p));
+  }
+  fclose(arq);
+  free(p);
+
+  /* Fila pequena para exercitar a contrapressão */
+  configIngestao cfg = {2, 2, 4};
+  estatisticasIngestao est;
+  ingestao* ing = iniciaIngestao(raiz, &cfg);
+  ASSERT(reproduzArquivo(ing, caminho) == qtPacotes);
+  finalizaIngestao(ing, &est);
+
+  LOG_INFO("%lld amostras em %.4lf s (%.0lf amostras/s), fila de pacotes: média %.2lf, máx %zu",
+           est.qtAmostras, est.tempo, est.amostrasPorSegundo, est.profMediaFilaPacotes, est.profMaxFilaPacotes);
+
+  ASSERT(est.qtPacotes == qtPacotes);
+  ASSERT(est.qtAmostras == esperados);
+  ASSERT(est.profMaxFilaPacotes <= 4);
+
+  /* Todas as amostras devem estar na árvore */
+  int qt_encontrados = 0;
+  amostra** todos = buscaPorRegiao(raiz, raiz->centro, 1000, &qt_encontrados);
+  ASSERT(qt_encontrados == esperados);
+  free(todos);
+
+  /* Numa árvore congelada, nada entra: as amostras recusadas são liberadas e não contam */
+  estatisticasIngestao recusada;
+  congela(raiz);
+  ing = iniciaIngestao(raiz, &cfg);
+  ASSERT(reproduzArquivo(ing, caminho) == qtPacotes);
+  finalizaIngestao(ing, &recusada);
+  remove(caminho);
+  ASSERT(recusada.qtPacotes == qtPacotes && recusada.qtAmostras == 0 && recusada.amostrasPorSegundo == 0);
+
+  destroiNo(raiz);
+}
+
+// --- Testes do Modo Quantizado ---
+
+/* Quantas das amostras originais têm uma cópia decodificada na sua folha a até  erro  por eixo */
+static int dentroDoErro(noctree* raiz, float coords[][DIM], int qt, float erro) {
+  int dentro = 0, qt_encontrados;
+  for (int i = 0; i < qt; i++) {
+    amostra alvo = {coords[i][0], coords[i][1], coords[i][2]};
+    amostra** folha = buscaNaFolha(raiz, &alvo, &qt_encontrados);
+    for (int k = 0; k < qt_encontrados; k++) {
+      if (fabsf(folha[k]->x - alvo.x) <= erro && fabsf(folha[k]->y - alvo.y) <= erro && fabsf(folha[k]->z - alvo.z) <= erro) {
+        dentro++;
+        break;
+      }
+    }
+    free(folha);
+  }
+  return dentro;
+}
+
+void test_modo_quantizado() {
+  printf("Executando Teste 7: Modo Quantizado - Erro Limitado e Inserções Após Compactar...\n");
+  noctree* raiz = inicializaNo(inicializaAmostra(0,0,0), (float[]){100,100,100}, 0);
+  const int N = 3000;
+  float coords[3000][DIM];
+
+  srand(42);
+  for (int i = 0; i < N; i++) {
+    for (int j = 0; j < DIM; j++) {
+      coords[i][j] = -50 + 100 * ((float)rand() / (float)RAND_MAX);
+    }
+  }
+
+  /* Metade antes de compactar, metade depois (as subdivisões já acontecem quantizadas) */
+  for (int i = 0; i < N / 2; i++) insereAmostra(raiz, inicializaAmostra(coords[i][0], coords[i][1], coords[i][2]));
+  float erro = compactaOctree(raiz);
+  for (int i = N / 2; i < N; i++) insereAmostra(raiz, inicializaAmostra(coords[i][0], coords[i][1], coords[i][2]));
+
+  erro = erroQuantizacao(raiz);
+  LOG_INFO("Erro máximo de quantização por eixo: %g", erro);
+  ASSERT(raiz->modo == NOCTREE_MODO_QUANTIZADO);
+  ASSERT(erro > 0 && erro <= 100.0f / (2 * NOCTREE_QUANT_MAX));
+
+  int qt_encontrados = 0;
+  amostra** todos = buscaPorRegiao(raiz, raiz->centro, 1000, &qt_encontrados);
+  ASSERT(qt_encontrados == N);
+  free(todos);
+
+  /* Cada amostra original tem uma cópia decodificada na sua folha, dentro do erro */
+  ASSERT(dentroDoErro(raiz, coords, N, erro) == N);
+
+  /* Compactada ainda vazia: as amostras são quantizadas na raiz e de novo nos filhos a cada
+   * subdivisão, então o limite inclui o meio passo da raiz */
+  noctree* cedo = inicializaNo(inicializaAmostra(0,0,0), (float[]){100,100,100}, 0);
+  compactaOctree(cedo);
+  for (int i = 0; i < N; i++) insereAmostra(cedo, inicializaAmostra(coords[i][0], coords[i][1], coords[i][2]));
+  erro = erroQuantizacao(cedo);
+  LOG_INFO("Erro máximo com a raiz quantizada desde o início: %g", erro);
+  ASSERT(erro > 100.0f / (2 * NOCTREE_QUANT_MAX) && erro < 100.0f / NOCTREE_QUANT_MAX);
+  ASSERT(dentroDoErro(cedo, coords, N, erro) == N);
+
+  destroiNo(cedo);
+  destroiNo(raiz);
+}
+
+/* Insere  qt  amostras aleatórias na árvore (roda em outra thread no teste de estatísticas) */
+typedef struct {
+  noctree* raiz;
+  int qt;
+} dados_lote_t;
+
+void* rotina_insere_lote(void* arg) {
+  dados_lote_t* dados = (dados_lote_t*)arg;
+  for (int i = 0; i < dados->qt; i++) {
+    insereAmostra(dados->raiz, inicializaAmostra(-50 + 100 * ((float)rand() / (float)RAND_MAX),
+                                                 -50 + 100 * ((float)rand() / (float)RAND_MAX),
+                                                 -50 + 100 * ((float)rand() / (float)RAND_MAX)));
+  }
+  return NULL;
+}
+
+void test_estatisticas_runtime() {
+  printf("Executando Teste 8: Estatísticas - Contadores Somados Entre Threads...\n");
+  noctree* raiz = inicializaNo(inicializaAmostra(0,0,0), (float[]){100,100,100}, 0);
+  estatisticasOctree est;
+  pthread_t th;
+  dados_lote_t lote = {raiz, 2000};
+
+  octreeZeraEstatisticas();
+
+  /* As inserções acontecem em outra thread, que termina antes da soma */
+  srand(7);
+  pthread_create(&th, NULL, rotina_insere_lote, &lote);
+  pthread_join(th, NULL);
+
+  /* As consultas, nesta */
+  long long devolvidos = 0;
+  for (int i = 0; i < 10; i++) {
+    int qt_encontrados = 0;
+    amostra centro = {-40.0f + 8 * i, 0, 0};
+    amostra** res = buscaPorRegiao(raiz, &centro, 10, &qt_encontrados);
+    devolvidos += qt_encontrados;
+    free(res);
+  }
+
+  if (octreeEstatisticasRuntime(&est)) {
+    LOG_INFO("Contadores ligados: %llu subdivisões, %llu nós visitados",
+             (unsigned long long) est.subdivisoes, (unsigned long long) est.nosVisitados);
+    ASSERT(est.subdivisoes > 0);
+    ASSERT(est.aquisicoesEscrita[0] > 0);
+    ASSERT(est.bytesAlocados >= est.subdivisoes * QT_FILHOS_NOCTREE * sizeof(noctree));
+    ASSERT(est.consultas == 10);
+    ASSERT(est.pontosDevolvidos == (uint64_t) devolvidos);
+    ASSERT(est.pontosTestados >= est.pontosDevolvidos);
+    ASSERT(est.nosVisitados >= 10);
+  } else {
+    LOG_INFO("Contadores não compilados (use make test_estatisticas)");
+    ASSERT(est.subdivisoes == 0 && est.consultas == 0 && est.bytesAlocados == 0);
+  }
+
+  destroiNo(raiz);
+}
+
+void test_relatorio_forma() {
+  printf("Executando Teste 9: Relatório - Forma e Memória, Sequencial e Paralelo...\n");
+  noctree* raiz = inicializaNo(inicializaAmostra(0,0,0), (float[]){100,100,100}, 0);
+  relatorioOctree seq, par;
+
+  /* Aglomerado bem apertado: força folhas na profundidade máxima, transbordando */
+  srand(11);
+  for (int i = 0; i < 500; i++) {
+    insereAmostra(raiz, inicializaAmostra(10 + 0.001f * (rand() % 100), 10 + 0.001f * (rand() % 100), 10));
+  }
+  for (int i = 0; i < 1500; i++) {
+    insereAmostra(raiz, inicializaAmostra(-50 + 100 * ((float)rand() / (float)RAND_MAX),
+                                          -50 + 100 * ((float)rand() / (float)RAND_MAX),
+                                          -50 + 100 * ((float)rand() / (float)RAND_MAX)));
+  }
+
+  geraRelatorioOctree(raiz, 1, &seq);
+  geraRelatorioOctree(raiz, 4, &par);
+
+  ASSERT(seq.qtPontos == 2000);
+  ASSERT(seq.qtNos == 1 + (seq.qtNos - seq.qtFolhas) * QT_FILHOS_NOCTREE); // Cada nó interno tem 8 filhos
+  ASSERT(seq.profundidadeMaxima == NOCTREE_MAX_PROFUNDIDADE + 1);
+  ASSERT(seq.qtTransbordos > 0 && seq.maiorTransbordo > NOCTREE_CAPACIDADE);
+  ASSERT(seq.qtFolhasVazias == seq.ocupacao[0]);
+  ASSERT(seq.bytesTotal > 0 && seq.bytesPorPonto > 0);
+
+  /* O percurso paralelo vê exatamente a mesma árvore */
+  ASSERT(memcmp(&seq, &par, sizeof(relatorioOctree)) == 0);
+
+  destroiNo(raiz);
+}
+
+/* Insere uma fatia de amostras na árvore fragmentada */
+typedef struct {
+  octreeFragmentada* of;
+  float (*coords)[DIM];
+  int ini, fim;
+} dados_fatia_t;
+
+void* rotina_insere_fragmentada(void* arg) {
+  dados_fatia_t* dados = (dados_fatia_t*)arg;
+  for (int i = dados->ini; i < dados->fim; i++) {
+    insereAmostraFragmentada(dados->of, inicializaAmostra(dados->coords[i][0], dados->coords[i][1], dados->coords[i][2]));
+  }
+  return NULL;
+}
+
+void test_octree_fragmentada() {
+  printf("Executando Teste 10: Fragmentada - Escritores Concorrentes e Buscas Iguais às da Árvore Comum...\n");
+  const int N = 4000, QT_THREADS = 4;
+  static float coords[4000][DIM];
+  octreeFragmentada* of = inicializaOctreeFragmentada(inicializaAmostra(0,0,0), (float[]){100,100,100}, 2);
+  noctree* raiz = inicializaNo(inicializaAmostra(0,0,0), (float[]){100,100,100}, 0);
+
+  ASSERT(of != NULL && of->qtFragmentos == 64);
+  ASSERT(inicializaOctreeFragmentada(inicializaAmostra(0,0,0), (float[]){100,100,100}, FRAGMENTADA_MAX_K + 1) == NULL);
+  ASSERT(((uintptr_t) &of->fragmentos[1].raiz) % TAM_LINHA_CACHE == 0);
+
+  srand(23);
+  for (int i = 0; i < N; i++) {
+    for (int j = 0; j < DIM; j++) coords[i][j] = -50 + 100 * ((float)rand() / (float)RAND_MAX);
+    insereAmostra(raiz, inicializaAmostra(coords[i][0], coords[i][1], coords[i][2]));
+  }
+
+  pthread_t th[4];
+  dados_fatia_t fatias[4];
+  for (int t = 0; t < QT_THREADS; t++) {
+    fatias[t] = (dados_fatia_t){of, coords, N * t / QT_THREADS, N * (t + 1) / QT_THREADS};
+    pthread_create(&th[t], NULL, rotina_insere_fragmentada, &fatias[t]);
+  }
+  for (int t = 0; t < QT_THREADS; t++) pthread_join(th[t], NULL);
+
+  /* Mesmo conjunto: as buscas por região devolvem as mesmas quantidades */
+  int iguais = 0;
+  for (int i = 0; i < 50; i++) {
+    int qtF = 0, qtC = 0;
+    amostra centro = {coords[i][0], coords[i][1], coords[i][2]};
+    amostra** rf = buscaPorRegiaoFragmentada(of, &centro, 12, &qtF);
+    amostra** rc = buscaPorRegiao(raiz, &centro, 12, &qtC);
+    if (qtF == qtC && qtF > 0) iguais++;
+    free(rf);
+    free(rc);
+  }
+  ASSERT(iguais == 50);
+
+  int qt_encontrados = 0;
+  amostra** todos = buscaPorRegiaoFragmentada(of, of->centro, 1000, &qt_encontrados);
+  ASSERT(qt_encontrados == N);
+  free(todos);
+
+  amostra alvo = {coords[7][0], coords[7][1], coords[7][2]};
+  ASSERT(encontra_ponto(fragmentoDe(of, &alvo), &alvo));
+
+  balancoFragmentos b;
+  balancoOctreeFragmentada(of, &b);
+  LOG_INFO("Amostras por fragmento: mín %lld, máx %lld, média %.1f", b.minimo, b.maximo, b.media);
+  ASSERT(b.qtFragmentos == 64 && b.media * b.qtFragmentos == N);
+  ASSERT(b.minimo > 0 && b.desequilibrio < 2); // Uniforme: nenhum fragmento vazio ou muito cheio
+
+  /* Um fragmento compactado entra na busca com cópias decodificadas, no mesmo bloco do vetor */
+  noctree* compactado = fragmentoDe(of, &alvo);
+  float erro = compactaOctree(compactado);
+  todos = buscaPorRegiaoFragmentada(of, of->centro, 1000, &qt_encontrados);
+  int pertoDoAlvo = 0;
+  for (int i = 0; i < qt_encontrados; i++) {
+    pertoDoAlvo += fabsf(todos[i]->x - alvo.x) <= erro && fabsf(todos[i]->y - alvo.y) <= erro && fabsf(todos[i]->z - alvo.z) <= erro;
+  }
+  free(todos);
+  ASSERT(qt_encontrados == N && pertoDoAlvo >= 1);
+
+  destroiOctreeFragmentada(of);
+  destroiNo(raiz);
+}
+
+/* Soma de 0 a n-1 por divisão e conquista: cada tarefa cria duas subtarefas e as espera */
+typedef struct {
+  poolTarefas* pool;
+  long inicio, fim;
+  long soma;
+} dados_soma_t;
+
+void tarefa_soma(void* arg) {
+  dados_soma_t* d = (dados_soma_t*)arg;
+  if (d->fim - d->inicio <= 64) {
+    for (long i = d->inicio; i < d->fim; i++) d->soma += i;
+    return;
+  }
+  long meio = (d->inicio + d->fim) / 2;
+  dados_soma_t esq = {d->pool, d->inicio, meio, 0}, dir = {d->pool, meio, d->fim, 0};
+  grupoTarefas g;
+  iniciaGrupo(&g);
+  submeteTarefa(d->pool, &g, tarefa_soma, &esq);
+  submeteTarefa(d->pool, &g, tarefa_soma, &dir);
+  esperaGrupo(d->pool, &g);
+  d->soma = esq.soma + dir.soma;
+}
+
+void test_pool_tarefas() {
+  printf("Executando Teste 11: Pool de Tarefas - Fork-Join Aninhado e Operações Paralelas da Árvore...\n");
+  const int N = 20000, QT_CONSULTAS = 100;
+
+  /* Tarefas que criam tarefas, num pool próprio com afinidade */
+  poolTarefas* pool = criaPool(3, 1);
+  dados_soma_t d = {pool, 0, 100000, 0};
+  grupoTarefas g;
+  iniciaGrupo(&g);
+  submeteTarefa(pool, &g, tarefa_soma, &d);
+  esperaGrupo(pool, &g);
+  ASSERT(d.soma == 100000L * 99999L / 2);
+  ASSERT(trabalhadorAtual(pool) == -1);
+  destroiPool(pool);
+
+  /* Inserção em lote no pool padrão */
+  noctree* raiz = inicializaNo(inicializaAmostra(0,0,0), (float[]){100,100,100}, 0);
+  noctree* referencia = inicializaNo(inicializaAmostra(0,0,0), (float[]){100,100,100}, 0);
+  amostra** pontos = (amostra**) malloc(sizeof(amostra*) * N);
+  srand(29);
+  for (int i = 0; i < N; i++) {
+    float x = -50 + 100 * ((float)rand() / (float)RAND_MAX);
+    float y = -50 + 100 * ((float)rand() / (float)RAND_MAX);
+    float z = -50 + 100 * ((float)rand() / (float)RAND_MAX);
+    pontos[i] = inicializaAmostra(x, y, z);
+    insereAmostra(referencia, inicializaAmostra(x, y, z));
+  }
+  ASSERT(insereLoteParalelo(raiz, pontos, N) == N);
+
+  relatorioOctree r;
+  geraRelatorioOctree(raiz, 4, &r);
+  ASSERT(r.qtPontos == N);
+
+  /* Buscas em lote iguais às buscas uma a uma */
+  amostra** centros = (amostra**) malloc(sizeof(amostra*) * QT_CONSULTAS);
+  int qts[100];
+  for (int i = 0; i < QT_CONSULTAS; i++) centros[i] = pontos[i * 7];
+  amostra*** resultados = buscaPorRegiaoEmLote(raiz, centros, QT_CONSULTAS, 25, qts);
+  int iguais = 0;
+  for (int i = 0; i < QT_CONSULTAS; i++) {
+    int qt = 0;
+    amostra** rc = buscaPorRegiao(referencia, centros[i], 25, &qt);
+    if (qt == qts[i] && qt > 0) iguais++;
+    free(rc);
+    free(resultados[i]);
+  }
+  ASSERT(iguais == QT_CONSULTAS);
+
+  free(resultados);
+  free(centros);
+  free(pontos);
+  destroiNoParalelo(raiz);
+  destroiNo(referencia);
+}
+
+/* Ordena resultados por endereço, para comparar conjuntos de ponteiros */
+int compara_ponteiros(const void* a, const void* b) {
+  uintptr_t pa = (uintptr_t) *(amostra* const*)a, pb = (uintptr_t) *(amostra* const*)b;
+  return (pa > pb) - (pa < pb);
+}
+
+void test_busca_paralela() {
+  printf("Executando Teste 12: Busca por Região Dividida em Tarefas...\n");
+  const int N = 20000;
+  noctree* raiz = inicializaNo(inicializaAmostra(0,0,0), (float[]){100,100,100}, 0);
+  srand(31);
+  for (int i = 0; i < N; i++) {
+    insereAmostra(raiz, inicializaAmostra(-50 + 100 * ((float)rand() / (float)RAND_MAX),
+                                          -50 + 100 * ((float)rand() / (float)RAND_MAX),
+                                          -50 + 100 * ((float)rand() / (float)RAND_MAX)));
+  }
+
+  /* Grande (divide) e pequena (fica na thread): os mesmos ponteiros da busca comum */
+  float raios[] = {60, 3};
+  amostra centro = {10, -5, 2};
+  for (int k = 0; k < 2; k++) {
+    int qtP = 0, qtS = 0, iguais = 1;
+    amostra** rp = buscaPorRegiaoParalela(raiz, &centro, raios[k], &qtP);
+    amostra** rs = buscaPorRegiao(raiz, &centro, raios[k], &qtS);
+    qsort(rp, qtP, sizeof(amostra*), compara_ponteiros);
+    qsort(rs, qtS, sizeof(amostra*), compara_ponteiros);
+    for (int i = 0; i < qtP && i < qtS; i++) iguais &= (rp[i] == rs[i]);
+    ASSERT(qtP == qtS && qtP > 0 && iguais);
+    free(rp);
+    free(rs);
+  }
+
+  /* A árvore toda */
+  int qt = 0;
+  amostra** todos = buscaPorRegiaoParalela(raiz, raiz->centro, 1000, &qt);
+  ASSERT(qt == N);
+  free(todos);
+
+  /* Nada dentro da esfera */
+  amostra longe = {500, 500, 500};
+  ASSERT(buscaPorRegiaoParalela(raiz, &longe, 1, &qt) == NULL && qt == 0);
+
+  destroiNoParalelo(raiz);
+}
+
+/* Escritor com árvore privada sobre uma fatia das coordenadas */
+typedef struct {
+  noctree* raiz;
+  float (*coords)[DIM];
+  int ini, fim;
+  long long enxertos;
+} dados_escritor_t;
+
+void* rotina_escritor_privado(void* arg) {
+  dados_escritor_t* dados = (dados_escritor_t*)arg;
+  escritorPrivado* e = inicializaEscritorPrivado(dados->raiz, 300);
+  for (int i = dados->ini; i < dados->fim; i++) {
+    insereAmostraEscritor(e, inicializaAmostra(dados->coords[i][0], dados->coords[i][1], dados->coords[i][2]));
+  }
+  descarregaEscritor(e);
+  dados->enxertos = e->qtEnxertos;
+  destroiEscritorPrivado(e);
+  return NULL;
+}
+
+/* Ordena coordenadas por X: cada escritor recebe uma fatia do espaço, como em uma varredura */
+int compara_x(const void* a, const void* b) {
+  float xa = ((const float*)a)[0], xb = ((const float*)b)[0];
+  return (xa > xb) - (xa < xb);
+}
+
+static uint64_t soma_escritas(estatisticasOctree* est) {
+  uint64_t total = 0;
+  for (int i = 0; i < EST_QT_NIVEIS; i++) total += est->aquisicoesEscrita[i];
+  return total;
+}
+
+void test_mescla_escritor_privado() {
+  printf("Executando Teste 13: Mescla - Escritores com Árvores Privadas Enxertadas na Compartilhada...\n");
+  const int N = 6000, QT_THREADS = 4;
+  static float coords[6000][DIM];
+  noctree* raiz = inicializaNo(inicializaAmostra(0,0,0), (float[]){100,100,100}, 0);
+  noctree* referencia = inicializaNo(inicializaAmostra(0,0,0), (float[]){100,100,100}, 0);
+  estatisticasOctree est;
+
+  srand(37);
+  for (int i = 0; i < N; i++) {
+    for (int j = 0; j < DIM; j++) coords[i][j] = -50 + 100 * ((float)rand() / (float)RAND_MAX);
+  }
+  qsort(coords, N, sizeof(coords[0]), compara_x);
+
+  octreeZeraEstatisticas();
+  pthread_t th[4];
+  dados_escritor_t fatias[4];
+  for (int t = 0; t < QT_THREADS; t++) {
+    fatias[t] = (dados_escritor_t){raiz, coords, N * t / QT_THREADS, N * (t + 1) / QT_THREADS, 0};
+    pthread_create(&th[t], NULL, rotina_escritor_privado, &fatias[t]);
+  }
+  long long enxertos = 0;
+  for (int t = 0; t < QT_THREADS; t++) {
+    pthread_join(th[t], NULL);
+    enxertos += fatias[t].enxertos;
+  }
+  int contadores = octreeEstatisticasRuntime(&est);
+  uint64_t escritasMescla = soma_escritas(&est);
+
+  octreeZeraEstatisticas();
+  for (int i = 0; i < N; i++) insereAmostra(referencia, inicializaAmostra(coords[i][0], coords[i][1], coords[i][2]));
+  octreeEstatisticasRuntime(&est);
+  uint64_t escritasDiretas = soma_escritas(&est);
+
+  ASSERT(enxertos > 0);
+
+  /* Mesmas amostras que a inserção direta */
+  relatorioOctree r;
+  geraRelatorioOctree(raiz, 1, &r);
+  ASSERT(r.qtPontos == N);
+  int iguais = 0;
+  for (int i = 0; i < 50; i++) {
+    int qtM = 0, qtD = 0;
+    amostra centro = {coords[i * 11][0], coords[i * 11][1], coords[i * 11][2]};
+    amostra** rm = buscaPorRegiao(raiz, &centro, 10, &qtM);
+    amostra** rd = buscaPorRegiao(referencia, &centro, 10, &qtD);
+    if (qtM == qtD && qtM > 0) iguais++;
+    free(rm);
+    free(rd);
+  }
+  ASSERT(iguais == 50);
+
+  if (contadores) {
+    LOG_INFO("Locks de escrita: %llu com árvores privadas, %llu com inserções diretas",
+             (unsigned long long) escritasMescla, (unsigned long long) escritasDiretas);
+    ASSERT(escritasMescla * 4 < escritasDiretas);
+  }
+
+  /* Cubos diferentes: as amostras são reinseridas uma a uma */
+  noctree* outra = inicializaNo(inicializaAmostra(20,20,20), (float[]){10,10,10}, 0);
+  for (int i = 0; i < 40; i++) insereAmostraPrivada(outra, inicializaAmostra(15 + i * 0.25f, 20, 20));
+  ASSERT(mesclaOctrees(raiz, outra, &enxertos) == NOCTREE_MESCLA_COMPLETA && enxertos == 0);
+  geraRelatorioOctree(raiz, 1, &r);
+  ASSERT(r.qtPontos == N + 40);
+
+  destroiNo(raiz);
+  destroiNo(referencia);
+}
+
+/* Quadros: cada varredura f tem  amostras_do_quadro(f)  amostras, então um quadro pela metade seria visto */
+static int amostras_do_quadro(long long f) { return 400 + 37 * (int)(f % 20); }
+
+typedef struct {
+  gerenciadorQuadros* g;
+  _Atomic int* fim;
+  int leituras, incompletos;
+} dados_leitor_quadros_t;
+
+void* rotina_leitor_quadros(void* arg) {
+  dados_leitor_quadros_t* d = (dados_leitor_quadros_t*)arg;
+  while (!atomic_load(d->fim)) {
+    quadro* q = fixaQuadro(d->g);
+    int qt = 0;
+    amostra** res = buscaPorRegiao(q->raiz, q->raiz->centro, 1000, &qt);
+    if (qt != (q->numero < 0 ? 0 : amostras_do_quadro(q->numero))) d->incompletos++;
+    d->leituras++;
+    free(res);
+    liberaQuadro(q);
+  }
+  return NULL;
+}
+
+void test_quadros_buffer_triplo() {
+  printf("Executando Teste 14: Quadros - Leitores Sempre Veem Varreduras Completas...\n");
+  const int QT_QUADROS = 60, QT_LEITORES = 2;
+  gerenciadorQuadros* g = inicializaGerenciadorQuadros(inicializaAmostra(0,0,0), (float[]){100,100,100}, 3);
+  _Atomic int fim = 0;
+
+  ASSERT(inicializaGerenciadorQuadros(inicializaAmostra(0,0,0), (float[]){100,100,100}, 4) == NULL);
+
+  pthread_t th[2];
+  dados_leitor_quadros_t leitores[2];
+  for (int t = 0; t < QT_LEITORES; t++) {
+    leitores[t] = (dados_leitor_quadros_t){g, &fim, 0, 0};
+    pthread_create(&th[t], NULL, rotina_leitor_quadros, &leitores[t]);
+  }
+
+  /* Publicador: enche a árvore de trás e publica */
+  srand(41);
+  long long ultimo = -1;
+  for (int f = 0; f < QT_QUADROS; f++) {
+    noctree* tras = quadroDeTras(g);
+    for (int i = 0; i < amostras_do_quadro(f); i++) {
+      insereAmostra(tras, inicializaAmostra(-50 + 100 * ((float)rand() / (float)RAND_MAX),
+                                            -50 + 100 * ((float)rand() / (float)RAND_MAX),
+                                            -50 + 100 * ((float)rand() / (float)RAND_MAX)));
+    }
+    ultimo = publicaQuadro(g);
+  }
+  atomic_store(&fim, 1);
+
+  int leituras = 0, incompletos = 0;
+  for (int t = 0; t < QT_LEITORES; t++) {
+    pthread_join(th[t], NULL);
+    leituras += leitores[t].leituras;
+    incompletos += leitores[t].incompletos;
+  }
+  LOG_INFO("%d leituras, %lld publicações (%lld esperaram leitores)", leituras, g->qtPublicados, g->qtEsperas);
+  ASSERT(ultimo == QT_QUADROS - 1 && g->qtPublicados == QT_QUADROS);
+  ASSERT(leituras > 0 && incompletos == 0);
+
+  /* O quadro da frente é o último, e o de trás foi reciclado mantendo os nós */
+  quadro* q = fixaQuadro(g);
+  ASSERT(q->numero == QT_QUADROS - 1);
+  liberaQuadro(q);
+
+  relatorioOctree r;
+  geraRelatorioOctree(quadroDeTras(g), 1, &r);
+  ASSERT(r.qtPontos == 0 && r.qtNos > 1);
+
+  destroiGerenciadorQuadros(g);
+}
+
+/* 1 se todos os nós da (sub)árvore estão congelados */
+static int todosCongelados(noctree* no) {
+  if (!no->congelado) return 0;
+  for (int i = 0; no->subdividido && i < QT_FILHOS_NOCTREE; i++) {
+    if (!todosCongelados(no->filhos[i])) return 0;
+  }
+  return 1;
+}
+
+void test_congela() {
+  printf("Executando Teste 15: Congelamento - Consultas Sem Lock e Inserções Recusadas...\n");
+  noctree* raiz = inicializaNo(inicializaAmostra(0,0,0), (float[]){100,100,100}, 0);
+  estatisticasOctree est;
+  relatorioOctree r;
+  int antes[20];
+
+  srand(41);
+  for (int i = 0; i < 3000; i++) {
+    insereAmostra(raiz, inicializaAmostra(-50 + 100 * ((float)rand() / (float)RAND_MAX),
+                                          -50 + 100 * ((float)rand() / (float)RAND_MAX),
+                                          -50 + 100 * ((float)rand() / (float)RAND_MAX)));
+  }
+  for (int i = 0; i < 20; i++) {
+    amostra centro = {-45.0f + 4.5f * i, 10, -10};
+    free(buscaPorRegiao(raiz, &centro, 8, &antes[i]));
+  }
+
+  congela(raiz);
+
+  /* Mesmos resultados, sem nenhum lock de leitura */
+  octreeZeraEstatisticas();
+  int iguais = 0;
+  for (int i = 0; i < 20; i++) {
+    int qt = 0;
+    amostra centro = {-45.0f + 4.5f * i, 10, -10};
+    free(buscaPorRegiao(raiz, &centro, 8, &qt));
+    if (qt == antes[i]) iguais++;
+  }
+  ASSERT(iguais == 20);
+  if (octreeEstatisticasRuntime(&est)) {
+    uint64_t leituras = 0;
+    for (int i = 0; i < EST_QT_NIVEIS; i++) leituras += est.aquisicoesLeitura[i];
+    LOG_INFO("Locks de leitura nas consultas congeladas: %llu", (unsigned long long) leituras);
+    ASSERT(leituras == 0 && est.consultas == 20);
+  }
+
+  /* Inserções e mesclas são recusadas; a amostra continua sendo de quem chamou */
+  amostra* recusada = inicializaAmostra(1, 2, 3);
+  ASSERT(insereAmostra(raiz, recusada) == 0);
+  free(recusada);
+  noctree* outra = inicializaNo(inicializaAmostra(0,0,0), (float[]){100,100,100}, 0);
+  insereAmostraPrivada(outra, inicializaAmostra(1, 2, 3));
+  ASSERT(mesclaOctrees(raiz, outra, NULL) == NOCTREE_MESCLA_RECUSADA);
+  geraRelatorioOctree(outra, 1, &r);
+  ASSERT(r.qtPontos == 1);
+  destroiNo(outra);
+
+  /* Descongelada, volta a aceitar inserções */
+  descongela(raiz);
+  ASSERT(insereAmostra(raiz, inicializaAmostra(1, 2, 3)) == 1);
+  geraRelatorioOctree(raiz, 1, &r);
+  ASSERT(r.qtPontos == 3001);
+
+  /* Só uma subárvore congelada: o que cai nela é recusado, na inserção e na mescla */
+  relatorioOctree sub;
+  geraRelatorioOctree(raiz->filhos[0], 1, &sub);
+  long long noOctante0 = sub.qtPontos;
+  congela(raiz->filhos[0]);
+  recusada = inicializaAmostra(-10, -10, -10);
+  ASSERT(insereAmostra(raiz, recusada) == 0);
+  free(recusada);
+
+  outra = inicializaNo(inicializaAmostra(0,0,0), (float[]){100,100,100}, 0);
+  int recusadas = 0;
+  for (int i = 0; i < 500; i++) {
+    amostra* p = inicializaAmostra(-50 + 100 * ((float)rand() / (float)RAND_MAX),
+                                   -50 + 100 * ((float)rand() / (float)RAND_MAX),
+                                   -50 + 100 * ((float)rand() / (float)RAND_MAX));
+    recusadas += (p->x < 0 && p->y < 0 && p->z < 0);
+    insereAmostraPrivada(outra, p);
+  }
+  /* Um aglomerado fino fora do octante congelado: a subárvore dele é enxertada numa folha do destino */
+  for (int i = 0; i < 50; i++) insereAmostraPrivada(outra, inicializaAmostra(40 + i * 0.01f, 40, 40));
+  long long enxertos;
+  ASSERT(mesclaOctrees(raiz, outra, &enxertos) == NOCTREE_MESCLA_PARCIAL && enxertos > 0);
+  geraRelatorioOctree(outra, 1, &r);
+  ASSERT(r.qtPontos == recusadas);
+  geraRelatorioOctree(raiz->filhos[0], 1, &sub);
+  ASSERT(sub.qtPontos == noOctante0 && todosCongelados(raiz->filhos[0]));
+  geraRelatorioOctree(raiz, 1, &r);
+  ASSERT(r.qtPontos == 3001 + 550 - recusadas);
+  destroiNo(outra);
+
+  /* Escritor privado: os enxertos de uma mescla parcial contam, e o que o destino recusa
+   * espera mais  limite  amostras para ser tentado de novo */
+  escritorPrivado* e = inicializaEscritorPrivado(raiz, 100);
+  for (int i = 0; i < 50; i++) insereAmostraEscritor(e, inicializaAmostra(-40 + i * 0.01f, 40, 40));
+  for (int i = 0; i < 950; i++) insereAmostraEscritor(e, inicializaAmostra(-40 + i * 0.01f, -40, -40));
+  LOG_INFO("Escritor com o octante congelado: %lld mesclas, %lld enxertos", e->qtMesclas, e->qtEnxertos);
+  ASSERT(e->qtMesclas == 10 && e->qtEnxertos > 0 && e->qtLocal == 950);
+  descongela(raiz->filhos[0]);
+  destroiEscritorPrivado(e);
+  geraRelatorioOctree(raiz, 1, &r);
+  ASSERT(r.qtPontos == 3001 + 550 - recusadas + 1000);
+
+  destroiNo(raiz);
+}
+
+/* Voxel de aresta 6.25 de uma amostra no cubo [-50, 50): a grade que  downsampleVoxel  usa com s = 10 */
+static long long chave_voxel(amostra* p) {
+  long long ix = (long long) floorf((p->x + 50) / 6.25f);
+  long long iy = (long long) floorf((p->y + 50) / 6.25f);
+  long long iz = (long long) floorf((p->z + 50) / 6.25f);
+  return ix + 16 * (iy + 16 * iz);
+}
+
+static int compara_chaves(const void* a, const void* b) {
+  long long x = *(const long long*) a, y = *(const long long*) b;
+  return (x > y) - (x < y);
+}
+
+/* Ordena as chaves e tira as repetidas; devolve quantas sobram */
+static int chaves_distintas(long long* chaves, int qt) {
+  qsort(chaves, qt, sizeof(long long), compara_chaves);
+  int distintas = 0;
+  for (int i = 0; i < qt; i++) {
+    if (i == 0 || chaves[i] != chaves[i - 1]) chaves[distintas++] = chaves[i];
+  }
+  return distintas;
+}
+
+void test_downsample_voxel() {
+  printf("Executando Teste 16: Voxels - Uma Amostra por Voxel Ocupado...\n");
+  const int N = 20000;
+  static long long esperadas[20000], obtidas[20000];
+  noctree* raiz = inicializaNo(inicializaAmostra(0,0,0), (float[]){100,100,100}, 0);
+
+  /* Coordenadas longe das faces dos voxels (múltiplos de 6.25), para o modo quantizado não trocar nenhuma de voxel */
+  srand(43);
+  for (int i = 0; i < N; i++) {
+    amostra* p = inicializaAmostra(-49.9f + 0.2f * (rand() % 499), -49.9f + 0.2f * (rand() % 499), -49.9f + 0.2f * (rand() % 499));
+    esperadas[i] = chave_voxel(p);
+    insereAmostra(raiz, p);
+  }
+  int distintas = chaves_distintas(esperadas, N);
+
+  float aresta[DIM];
+  ASSERT(nivelDoVoxel(raiz, 10, aresta) == 4 && aresta[0] == 6.25f);
+
+  /* Cada modo devolve exatamente uma amostra por voxel ocupado, dentro do próprio voxel */
+  int modos[] = {VOXEL_CENTROIDE, VOXEL_PRIMEIRO, VOXEL_MAIS_PROXIMO};
+  for (int m = 0; m < 3; m++) {
+    int qt = 0;
+    amostra** res = downsampleVoxel(raiz, 10, modos[m], &qt);
+    for (int i = 0; i < qt; i++) obtidas[i] = chave_voxel(res[i]);
+    ASSERT(qt == distintas);
+    ASSERT(chaves_distintas(obtidas, qt) == qt && memcmp(obtidas, esperadas, sizeof(long long) * qt) == 0);
+    if (modos[m] != VOXEL_CENTROIDE) { // Os representantes são amostras da árvore
+      int achadas = 0;
+      for (int i = 0; i < qt; i++) achadas += encontra_ponto(raiz, res[i]);
+      ASSERT(achadas == qt);
+    }
+    free(res);
+  }
+
+  /* Árvore reduzida */
+  relatorioOctree r;
+  noctree* reduzida = downsampleVoxelArvore(raiz, 10, VOXEL_MAIS_PROXIMO);
+  geraRelatorioOctree(reduzida, 1, &r);
+  ASSERT(r.qtPontos == distintas);
+  destroiNo(reduzida);
+
+  /* Voxel maior que a árvore: uma amostra só, a média de todas */
+  int qt = 0;
+  amostra** res = downsampleVoxel(raiz, 500, VOXEL_CENTROIDE, &qt);
+  ASSERT(qt == 1 && fabsf(res[0]->x) < 1 && fabsf(res[0]->y) < 1 && fabsf(res[0]->z) < 1);
+  free(res);
+
+  /* Modo quantizado: mesmos voxels */
+  compactaOctree(raiz);
+  res = downsampleVoxel(raiz, 10, VOXEL_CENTROIDE, &qt);
+  for (int i = 0; i < qt; i++) obtidas[i] = chave_voxel(res[i]);
+  ASSERT(qt == distintas && chaves_distintas(obtidas, qt) == qt);
+  free(res);
+
+  destroiNo(raiz);
+}
+
+/* Distância média aos k vizinhos mais próximos, por força bruta (k <= 16) */
+static float media_knn_bruta(amostra* pontos, int qt, amostra* p, int k) {
+  float melhores[17];
+  int n = 0;
+  for (int i = 0; i < qt; i++) {
+    float d2 = dist2(p, &pontos[i]);
+    if (n == k + 1 && d2 >= melhores[k]) continue;
+    int pos = (n < k + 1) ? n++ : k;
+    while (pos > 0 && melhores[pos - 1] > d2) { melhores[pos] = melhores[pos - 1]; pos--; }
+    melhores[pos] = d2;
+  }
+  double soma = 0;
+  for (int i = 1; i <= k; i++) soma += sqrtf(melhores[i]);
+  return (float)(soma / k);
+}
+
+void test_filtros_outliers() {
+  printf("Executando Teste 17: Filtros - Remoção de Outliers por Raio e Estatística...\n");
+  const int GRADE = 20, QT_RUIDO = 20;
+  static amostra todas[8000 + 20];
+  noctree* raiz = inicializaNo(inicializaAmostra(0,0,0), (float[]){100,100,100}, 0);
+  int qt = 0;
+
+  /* Uma grade densa (espaçamento 1) e ruído esparso longe dela */
+  for (int i = 0; i < GRADE; i++)
+    for (int j = 0; j < GRADE; j++)
+      for (int k = 0; k < GRADE; k++) todas[qt++] = (amostra){-10.0f + i, -10.0f + j, -10.0f + k};
+  srand(47);
+  for (int i = 0; i < QT_RUIDO; i++) {
+    todas[qt++] = (amostra){25 + 20 * ((float)rand() / (float)RAND_MAX), -45 + 90 * ((float)rand() / (float)RAND_MAX),
+                            -45 + 90 * ((float)rand() / (float)RAND_MAX)};
+  }
+  for (int i = 0; i < qt; i++) insereAmostra(raiz, inicializaAmostra(todas[i].x, todas[i].y, todas[i].z));
+
+  /* Por raio: toda a grade tem ao menos 3 vizinhos a 1.5 (os cantos têm exatamente 3); o ruído, nenhum */
+  resultadoFiltro r;
+  ASSERT(filtroRaio(raiz, 1.5f, 3, &r) == 1);
+  ASSERT(r.qt == qt && r.qtMantidas == GRADE * GRADE * GRADE);
+  int errados = 0;
+  for (long long i = 0; i < r.qt; i++) errados += (r.manter[i] != (r.amostras[i].x < 20));
+  ASSERT(errados == 0);
+  liberaResultadoFiltro(&r);
+
+  /* Estatístico: as distâncias batem com a força bruta e o ruído sai */
+  ASSERT(filtroEstatistico(raiz, 8, 1.0f, &r) == 1);
+  ASSERT(r.qt == qt);
+  int iguais = 0;
+  for (long long i = 0; i < r.qt; i += 97) {
+    iguais += fabsf(r.distancias[i] - media_knn_bruta(todas, qt, &r.amostras[i], 8)) < 1e-4f;
+  }
+  ASSERT(iguais == (r.qt + 96) / 97);
+  int ruidoMantido = 0;
+  for (long long i = 0; i < r.qt; i++) ruidoMantido += (r.amostras[i].x >= 20 && r.manter[i]);
+  ASSERT(ruidoMantido == 0);
+  ASSERT(r.qtMantidas > GRADE * GRADE * GRADE * 9 / 10);
+  LOG_INFO("SOR: %lld de %lld mantidas (média %.3f, desvio %.3f)", r.qtMantidas, r.qt, r.media, r.desvio);
+
+  noctree* limpa = arvoreFiltrada(raiz, &r);
+  relatorioOctree rel;
+  geraRelatorioOctree(limpa, 1, &rel);
+  ASSERT(rel.qtPontos == r.qtMantidas);
+  destroiNo(limpa);
+  liberaResultadoFiltro(&r);
+
+  ASSERT(filtroEstatistico(raiz, 0, 1.0f, &r) == 0 && r.qt == 0);
+  destroiNo(raiz);
+}
+
+void test_normais_curvatura() {
+  printf("Executando Teste 18: Normais - PCA por Folha e Autossistema Fechado...\n");
+
+  /* Autossistema de uma matriz conhecida: autovalores 1, 3, 3 e normal (1,-1,0)/sqrt(2) */
+  double l[3], v[DIM];
+  autoSistemaSimetrico3((double[]){2, 1, 0, 2, 0, 3}, l, v);
+  ASSERT(fabs(l[0] - 1) < 1e-6 && fabs(l[1] - 3) < 1e-6 && fabs(l[2] - 3) < 1e-6); // Autovalor duplo: acos perto de 1 perde precisão
+  ASSERT(fabs(fabs(v[0]) - M_SQRT1_2) < 1e-9 && fabs(v[0] + v[1]) < 1e-9 && fabs(v[2]) < 1e-9);
+
+  /* Plano z = 0.3x - 0.2y + 1: a normal é a do plano (virada para cima) e a curvatura é ~0 */
+  noctree* plano = inicializaNo(inicializaAmostra(0,0,0), (float[]){100,100,100}, 0);
+  for (int i = 0; i <= 80; i++) {
+    for (int j = 0; j <= 80; j++) {
+      float x = -20 + 0.5f * i, y = -20 + 0.5f * j;
+      insereAmostra(plano, inicializaAmostra(x, y, 0.3f * x - 0.2f * y + 1));
+    }
+  }
+  normaisOctree n;
+  amostra acima = {0, 0, 100};
+  ASSERT(calculaNormais(plano, 1.2f, &acima, &n) == 1);
+  ASSERT(n.qt == 81 * 81);
+  float norma = sqrtf(0.09f + 0.04f + 1);
+  amostra esperada = {-0.3f / norma, 0.2f / norma, 1 / norma};
+  int certas = 0;
+  for (long long i = 0; i < n.qt; i++) {
+    certas += (dist2(&n.normais[i], &esperada) < 1e-6f && n.curvaturas[i] < 1e-4f);
+  }
+  ASSERT(certas == n.qt);
+  liberaNormais(&n);
+  destroiNo(plano);
+
+  /* Esfera de raio 20: normais radiais, viradas para o centro, e curvatura pequena mas positiva */
+  noctree* esfera = inicializaNo(inicializaAmostra(0,0,0), (float[]){100,100,100}, 0);
+  const int N = 6000;
+  for (int i = 0; i < N; i++) { // Espiral de Fibonacci
+    float z = 1 - 2 * (i + 0.5f) / N, r = sqrtf(1 - z * z), t = 2.399963f * i;
+    insereAmostra(esfera, inicializaAmostra(20 * r * cosf(t), 20 * r * sinf(t), 20 * z));
+  }
+  amostra centro = {0, 0, 0};
+  calculaNormais(esfera, 2.5f, &centro, &n);
+  certas = 0;
+  for (long long i = 0; i < n.qt; i++) {
+    amostra* p = &n.amostras[i];
+    float cosseno = -(n.normais[i].x * p->x + n.normais[i].y * p->y + n.normais[i].z * p->z) / 20;
+    certas += (cosseno > 0.999f && n.curvaturas[i] > 0 && n.curvaturas[i] < 0.01f);
+  }
+  ASSERT(certas == n.qt);
+  liberaNormais(&n);
+
+  ASSERT(calculaNormais(esfera, 0, NULL, &n) == 0 && n.qt == 0);
+  destroiNo(esfera);
+}
+
+/* Union-find de referência: todos os pares, O(N^2) */
+static long long achaReferencia(long long* pai, long long x) {
+  while (pai[x] != x) x = pai[x] = pai[pai[x]];
+  return x;
+}
+
+void test_agrupamento_euclidiano() {
+  printf("Executando Teste 19: Agrupamento - Union-Find por Folha e Entre Folhas Vizinhas...\n");
+
+  noctree* raiz = inicializaNo(inicializaAmostra(0,0,0), (float[]){200,200,200}, 0);
+
+  /* Dois blocos densos, separados */
+  for (int i = 0; i < 10; i++)
+    for (int j = 0; j < 10; j++)
+      for (int k = 0; k < 10; k++) insereAmostra(raiz, inicializaAmostra(-20 + 0.5f * i, -20 + 0.5f * j, -20 + 0.5f * k));
+  for (int i = 0; i < 8; i++)
+    for (int j = 0; j < 8; j++)
+      for (int k = 0; k < 8; k++) insereAmostra(raiz, inicializaAmostra(15 + 0.5f * i, 15 + 0.5f * j, 15 + 0.5f * k));
+
+  /* Duas cadeias paralelas que atravessam muitas folhas, a 1 uma da outra (não se unem com 0.6) */
+  for (int i = 0; i < 145; i++) {
+    insereAmostra(raiz, inicializaAmostra(-40 + 0.55f * i, 30, 0));
+    insereAmostra(raiz, inicializaAmostra(-40 + 0.55f * i, 31, 0));
+  }
+
+  /* Amostras isoladas: ruído com minAmostras = 3 */
+  for (int i = 0; i < 5; i++) insereAmostra(raiz, inicializaAmostra(-80 + 10 * i, -80, 80));
+
+  agrupamentoOctree a;
+  ASSERT(agrupaEuclidiano(raiz, 0.6f, 3, &a) == 1);
+  ASSERT(a.qt == 1000 + 512 + 290 + 5);
+  ASSERT(a.qtGrupos == 4 && a.qtRuido == 5);
+
+  long long somaGrupos = 0;
+  for (int g = 0; g < a.qtGrupos; g++) somaGrupos += a.caixas[g].qt;
+  ASSERT(somaGrupos == a.qt - a.qtRuido);
+
+  /* Cada estrutura é um grupo só, com a caixa certa */
+  int certas = 0;
+  for (long long i = 0; i < a.qt; i++) {
+    amostra* p = &a.amostras[i];
+    int g = a.grupos[i];
+    if (p->z == 80) { certas += (g == AGRUPAMENTO_RUIDO); continue; }
+    if (g == AGRUPAMENTO_RUIDO) continue;
+    caixaGrupo* c = &a.caixas[g];
+    if (p->y == 30 || p->y == 31) certas += (c->qt == 145 && c->minimo[1] == p->y && c->maximo[1] == p->y &&
+                                              c->minimo[0] == -40 && fabsf(c->maximo[0] - (-40 + 0.55f * 144)) < 1e-4f);
+    else if (p->x < -15) certas += (c->qt == 1000 && c->minimo[0] == -20 && c->maximo[2] == -15.5f);
+    else certas += (c->qt == 512 && c->minimo[0] == 15 && c->maximo[1] == 18.5f);
+  }
+  ASSERT(certas == a.qt);
+  liberaAgrupamento(&a);
+
+  /* Nuvem aleatória perto do limiar de percolação: os grupos batem com os pares todos */
+  srand(19);
+  for (int i = 0; i < 1500; i++) {
+    insereAmostra(raiz, inicializaAmostra(40 + 50 * ((float)rand() / (float)RAND_MAX),
+                                          40 + 50 * ((float)rand() / (float)RAND_MAX),
+                                          40 + 50 * ((float)rand() / (float)RAND_MAX)));
+  }
+  ASSERT(agrupaEuclidiano(raiz, 3.0f, 4, &a) == 1);
+
+  long long* pai = (long long*) malloc(sizeof(long long) * a.qt);
+  long long* tamanho = (long long*) calloc(a.qt, sizeof(long long));
+  for (long long i = 0; i < a.qt; i++) pai[i] = i;
+  for (long long i = 0; i < a.qt; i++) {
+    for (long long j = i + 1; j < a.qt; j++) {
+      if (dist2(&a.amostras[i], &a.amostras[j]) > 9.0f) continue;
+      long long ri = achaReferencia(pai, i), rj = achaReferencia(pai, j);
+      if (ri < rj) pai[rj] = ri;
+      else if (rj < ri) pai[ri] = rj;
+    }
+  }
+  for (long long i = 0; i < a.qt; i++) tamanho[achaReferencia(pai, i)]++;
+
+  int qtGrupos = 0;
+  long long qtRuido = 0;
+  certas = 0;
+  for (long long i = 0; i < a.qt; i++) {
+    long long r = achaReferencia(pai, i);
+    if (r == i && tamanho[i] >= 4) qtGrupos++;
+    if (tamanho[r] < 4) { qtRuido++; certas += (a.grupos[i] == AGRUPAMENTO_RUIDO); continue; }
+    caixaGrupo* c = &a.caixas[a.grupos[i]];
+    amostra* p = &a.amostras[i];
+    certas += (a.grupos[i] == a.grupos[r] && c->qt == tamanho[r] &&
+               p->x >= c->minimo[0] && p->x <= c->maximo[0] && p->y >= c->minimo[1] && p->y <= c->maximo[1] &&
+               p->z >= c->minimo[2] && p->z <= c->maximo[2]);
+  }
+  ASSERT(certas == a.qt);
+  ASSERT(qtGrupos == a.qtGrupos && qtRuido == a.qtRuido); // Grupos distintos têm números distintos
+  LOG_INFO("Nuvem aleatória: %d grupos, %lld amostras de ruído", a.qtGrupos, a.qtRuido);
+  free(pai);
+  free(tamanho);
+  liberaAgrupamento(&a);
+
+  ASSERT(agrupaEuclidiano(raiz, 0, 1, &a) == 0 && a.qt == 0);
+  destroiNo(raiz);
+}
+
+static int comparaPares(const void* x, const void* y) {
+  const parAmostras* p = (const parAmostras*) x;
+  const parAmostras* q = (const parAmostras*) y;
+  if (p->a != q->a) return (p->a > q->a) - (p->a < q->a);
+  return (p->b > q->b) - (p->b < q->b);
+}
+
+void test_percurso_duplo() {
+  printf("Executando Teste 20: Percurso Duplo - Pares no Raio, Vizinho Mais Próximo e Hausdorff...\n");
+
+  noctree* a = inicializaNo(inicializaAmostra(0,0,0), (float[]){100,100,100}, 0);
+  noctree* b = inicializaNo(inicializaAmostra(0,0,0), (float[]){100,100,100}, 0);
+  srand(20);
+  for (int i = 0; i < 2000; i++) {
+    insereAmostra(a, inicializaAmostra(-40 + 80 * ((float)rand() / (float)RAND_MAX),
+                                       -40 + 80 * ((float)rand() / (float)RAND_MAX),
+                                       -10 + 20 * ((float)rand() / (float)RAND_MAX)));
+  }
+  for (int i = 0; i < 3000; i++) { // B passa de A em x e tem amostras fora do cubo da raiz
+    insereAmostra(b, inicializaAmostra(-30 + 90 * ((float)rand() / (float)RAND_MAX),
+                                       -40 + 80 * ((float)rand() / (float)RAND_MAX),
+                                       -10 + 20 * ((float)rand() / (float)RAND_MAX)));
+  }
+
+  /* Pares no raio: os mesmos da comparação de todos com todos */
+  paresOctree p;
+  ASSERT(paresNoRaio(a, b, 3.0f, &p) == 1);
+  ASSERT(p.qtA == 2000 && p.qtB == 3000);
+  long long esperados = 0;
+  for (long long i = 0; i < p.qtA; i++)
+    for (long long j = 0; j < p.qtB; j++) esperados += (dist2(&p.amostrasA[i], &p.amostrasB[j]) <= 9.0f);
+  int certos = (p.qtPares == esperados);
+  qsort(p.pares, p.qtPares, sizeof(parAmostras), comparaPares);
+  for (long long k = 0; k < p.qtPares; k++) {
+    certos &= (dist2(&p.amostrasA[p.pares[k].a], &p.amostrasB[p.pares[k].b]) <= 9.0f);
+    if (k > 0) certos &= (comparaPares(&p.pares[k - 1], &p.pares[k]) < 0); // Sem repetidos
+  }
+  ASSERT(certos && esperados > 0);
+  liberaPares(&p);
+
+  /* Raio que cobre tudo: todos os pares, pela poda de caixa inteira */
+  ASSERT(paresNoRaio(a, b, 1000, &p) == 1 && p.qtPares == 2000LL * 3000);
+  liberaPares(&p);
+  ASSERT(paresNoRaio(a, b, -1, &p) == 0 && p.qtPares == 0);
+
+  /* Vizinho mais próximo: a mesma distância da força bruta */
+  vizinhosOctree v;
+  vizinhosMaisProximos(a, b, &v);
+  ASSERT(v.qtA == 2000 && v.qtB == 3000);
+  double maiorAB = 0;
+  certos = 0;
+  for (long long i = 0; i < v.qtA; i++) {
+    float melhor = INFINITY;
+    for (long long j = 0; j < v.qtB; j++) melhor = fminf(melhor, dist2(&v.amostrasA[i], &v.amostrasB[j]));
+    certos += (v.vizinhos[i] >= 0 && dist2(&v.amostrasA[i], &v.amostrasB[v.vizinhos[i]]) == melhor &&
+               fabsf(v.distancias[i] - sqrtf(melhor)) < 1e-6f);
+    maiorAB = fmax(maiorAB, sqrtf(melhor));
+  }
+  ASSERT(certos == v.qtA);
+  liberaVizinhos(&v);
+
+  /* Hausdorff: a maior das duas direções */
+  vizinhosMaisProximos(b, a, &v);
+  double maiorBA = 0;
+  for (long long i = 0; i < v.qtA; i++) maiorBA = fmax(maiorBA, v.distancias[i]);
+  liberaVizinhos(&v);
+  double h = distanciaHausdorff(a, b);
+  ASSERT(fabs(h - fmax(maiorAB, maiorBA)) < 1e-5 && maiorBA > maiorAB); // A parte de B em x > 40 fica longe de A
+
+  /* Uma cópia deslocada: Hausdorff é o deslocamento */
+  noctree* c = inicializaNo(inicializaAmostra(0,0,0), (float[]){100,100,100}, 0);
+  noctree* d = inicializaNo(inicializaAmostra(0,0,0), (float[]){100,100,100}, 0);
+  for (int i = 0; i < 20; i++)
+    for (int j = 0; j < 20; j++) {
+      insereAmostra(c, inicializaAmostra(-20 + 2 * i, -20 + 2 * j, 0));
+      insereAmostra(d, inicializaAmostra(-20 + 2 * i, -20 + 2 * j, 0.25f));
+    }
+  ASSERT(fabs(distanciaHausdorff(c, d) - 0.25) < 1e-6);
+  destroiNo(d);
+
+  /* Árvores vazias */
+  noctree* vazia = inicializaNo(inicializaAmostra(0,0,0), (float[]){100,100,100}, 0);
+  ASSERT(distanciaHausdorff(vazia, c) == INFINITY);
+  vizinhosMaisProximos(c, vazia, &v);
+  ASSERT(v.qtA == 400 && v.qtB == 0 && v.vizinhos[0] == -1 && v.distancias[399] == INFINITY);
+  liberaVizinhos(&v);
+  ASSERT(paresNoRaio(vazia, c, 5, &p) == 1 && p.qtA == 0 && p.qtPares == 0);
+  liberaPares(&p);
+
+  destroiNo(vazia);
+  destroiNo(c);
+  destroiNo(a);
+  destroiNo(b);
+}
+
+/* Confere, no mapa todo, que nenhum nó tem 8 folhas iguais (a poda não deixou nada para trás) e
+ * que toda folha tem um dos valores de  valores  (ou é desconhecida). Devolve a quantidade de folhas. */
+static long long confereMapa(noctree* no, const float* valores, int qtValores, int* certo) {
+  if (!no->subdividido) {
+    int achou = isnan(no->logOdds);
+    for (int i = 0; i < qtValores; i++) achou |= (no->logOdds == valores[i]);
+    *certo &= achou;
+    return 1;
+  }
+  long long folhas = 0;
+  int iguais = 1;
+  for (int i = 0; i < QT_FILHOS_NOCTREE; i++) {
+    folhas += confereMapa(no->filhos[i], valores, qtValores, certo);
+    noctree* f = no->filhos[i];
+    iguais &= !f->subdividido && ((isnan(f->logOdds) && isnan(no->filhos[0]->logOdds)) || f->logOdds == no->filhos[0]->logOdds);
+  }
+  *certo &= !iguais;
+  return folhas;
+}
+
+void test_mapa_ocupacao() {
+  printf("Executando Teste 21: Ocupação - Raios em Paralelo, Um Update por Voxel e Poda...\n");
+
+  /* Cubo de 64: voxels de 64 / 2^(NOCTREE_MAX_PROFUNDIDADE + 1) */
+  noctree* mapa = inicializaOcupacao(inicializaAmostra(0,0,0), (float[]){64,64,64});
+  float voxel = 64.0f / (1 << (NOCTREE_MAX_PROFUNDIDADE + 1));
+  amostra sensor = {0.01f, 0.01f, 0.01f};
+
+  /* Uma parede em x = 20, densa o bastante para os raios se cruzarem perto do sensor */
+  const int lado = 101;
+  amostra* parede = (amostra*) malloc(sizeof(amostra) * lado * lado);
+  for (int i = 0; i < lado; i++)
+    for (int j = 0; j < lado; j++) parede[i * lado + j] = (amostra){20, -5 + 0.1f * i, -5 + 0.1f * j};
+
+  long long atualizados = integraVarredura(mapa, &sensor, parede, lado * lado, 0);
+  ASSERT(atualizados > lado * lado);
+
+  noctree* folha;
+  ASSERT(consultaOcupacao(mapa, &parede[lado * lado / 2], &folha) == OCUPACAO_OCUPADO);
+  ASSERT(consultaOcupacao(mapa, &(amostra){10, 0, 0}, NULL) == OCUPACAO_LIVRE);
+  ASSERT(consultaOcupacao(mapa, &(amostra){-10, 0, 0}, NULL) == OCUPACAO_DESCONHECIDO); // Atrás do sensor
+  ASSERT(consultaOcupacao(mapa, &(amostra){25, 0, 0}, NULL) == OCUPACAO_DESCONHECIDO);  // Atrás da parede
+  ASSERT(consultaOcupacao(mapa, &(amostra){100, 0, 0}, &folha) == OCUPACAO_DESCONHECIDO && folha == NULL);
+
+  /* Milhares de raios passam perto do sensor, mas cada voxel recebe um update só por varredura */
+  ASSERT(consultaOcupacao(mapa, &(amostra){0.5f, 0, 0}, &folha) == OCUPACAO_LIVRE && folha->logOdds == OCUPACAO_LOG_LIVRE);
+  int certo = 1;
+  long long folhasAntes = confereMapa(mapa, (float[]){OCUPACAO_LOG_LIVRE, OCUPACAO_LOG_ACERTO}, 2, &certo);
+  ASSERT(certo && folhasAntes < atualizados); // A poda juntou os blocos de voxels livres
+  ASSERT(consultaOcupacao(mapa, &(amostra){10, 0, 0}, &folha) == OCUPACAO_LIVRE && folha->tamanho[0] > voxel);
+
+  /* Mais varreduras saturam o caminho livre e a parede, com a mesma forma */
+  for (int k = 0; k < 10; k++) ASSERT(integraVarredura(mapa, &sensor, parede, lado * lado, 0) == atualizados);
+  long long folhasDepois = confereMapa(mapa, (float[]){OCUPACAO_LOG_MIN, OCUPACAO_LOG_MAX}, 2, &certo);
+  LOG_INFO("%lld voxels atualizados por varredura em %lld folhas (após 11 varreduras: %lld)", atualizados, folhasAntes, folhasDepois);
+  ASSERT(certo && folhasDepois == folhasAntes);
+  ASSERT(consultaOcupacao(mapa, &(amostra){10, 0, 0}, &folha) == OCUPACAO_LIVRE && folha->logOdds == OCUPACAO_LOG_MIN);
+
+  /* Um bloco 2x2x2 de voxels alinhado, todo ocupado, vira um nó só */
+  noctree* bloco = inicializaOcupacao(inicializaAmostra(0,0,0), (float[]){64,64,64});
+  amostra retornos[8];
+  for (int i = 0; i < 8; i++) {
+    retornos[i] = (amostra){-32 + (400 + (i & 1) + 0.5f) * voxel, -32 + (256 + ((i >> 1) & 1) + 0.5f) * voxel,
+                            -32 + (256 + ((i >> 2) & 1) + 0.5f) * voxel};
+  }
+  integraVarredura(bloco, &sensor, retornos, 8, 0);
+  ASSERT(consultaOcupacao(bloco, &retornos[7], &folha) == OCUPACAO_OCUPADO);
+  ASSERT(folha->profundidade == NOCTREE_MAX_PROFUNDIDADE && folha->logOdds == OCUPACAO_LOG_ACERTO);
+
+  /* Alcance máximo: o retorno longe não conta, mas o caminho até o alcance fica livre */
+  noctree* curto = inicializaOcupacao(inicializaAmostra(0,0,0), (float[]){64,64,64});
+  integraVarredura(curto, &sensor, parede, lado * lado, 12);
+  ASSERT(consultaOcupacao(curto, &parede[lado * lado / 2], NULL) == OCUPACAO_DESCONHECIDO);
+  ASSERT(consultaOcupacao(curto, &(amostra){11, 0, 0}, NULL) == OCUPACAO_LIVRE);
+  ASSERT(consultaOcupacao(curto, &(amostra){13, 0, 0}, NULL) == OCUPACAO_DESCONHECIDO);
+
+  /* Árvore de amostras não é mapa */
+  noctree* comum = inicializaNo(inicializaAmostra(0,0,0), (float[]){64,64,64}, 0);
+  ASSERT(integraVarredura(comum, &sensor, parede, 1, 0) == -1);
+  amostra* recusada = inicializaAmostra(1, 1, 1);
+  ASSERT(insereAmostra(mapa, recusada) == 0); // A amostra continua de quem chamou
+  free(recusada);
+
+  free(parede);
+  destroiNo(comum);
+  destroiNo(curto);
+  destroiNo(bloco);
+  destroiNo(mapa);
+}
+
+/* Célula de aresta 2 (cubo de 64 centrado na origem) de uma coordenada */
+static int celulaDe(float c) {
+  return (int) floorf((c + 32) / 2);
+}
+
+void test_diferenca_octrees() {
+  printf("Executando Teste 22: Diferença - Regiões Adicionadas, Removidas e Alteradas...\n");
+
+  /* Amostras numa grade de 0.25 deslocada de 0.125, longe das faces das células */
+  const int qt = 3000;
+  amostra* pontos = (amostra*) malloc(sizeof(amostra) * qt);
+  srand(22);
+  for (int i = 0; i < qt; i++) {
+    pontos[i] = (amostra){-30 + 0.25f * (rand() % 240) + 0.125f, -30 + 0.25f * (rand() % 240) + 0.125f,
+                          -4 + 0.25f * (rand() % 32) + 0.125f};
+  }
+
+  noctree* antes = inicializaNo(inicializaAmostra(0,0,0), (float[]){64,64,64}, 0);
+  noctree* mesma = inicializaNo(inicializaAmostra(0,0,0), (float[]){64,64,64}, 0);
+  noctree* depois = inicializaNo(inicializaAmostra(0,0,0), (float[]){64,64,64}, 0);
+  const int lado = 32;
+  long long* qtAntes = (long long*) calloc(lado * lado * lado, sizeof(long long));
+  long long* qtDepois = (long long*) calloc(lado * lado * lado, sizeof(long long));
+  #define CELULA(p) ((celulaDe((p).x) * lado + celulaDe((p).y)) * lado + celulaDe((p).z))
+
+  /* Depois: a mesma cena em outra ordem, sem o canto x, y < -20, com um objeto novo acima
+   * dela e com uma amostra movida dentro da sua célula */
+  amostra movida = pontos[qt / 2];
+  int celulaMovida = CELULA(movida);
+  float novoX = -32 + 2 * celulaDe(movida.x) + 0.125f;
+  movida.x = (movida.x == novoX) ? novoX + 1.75f : novoX;
+  for (int i = 0; i < qt; i++) {
+    insereAmostra(antes, inicializaAmostra(pontos[i].x, pontos[i].y, pontos[i].z));
+    qtAntes[CELULA(pontos[i])]++;
+
+    amostra p = pontos[qt - 1 - i];
+    insereAmostra(mesma, inicializaAmostra(p.x, p.y, p.z));
+    if (p.x < -20 && p.y < -20) continue;
+    if (qt - 1 - i == qt / 2) p = movida;
+    insereAmostra(depois, inicializaAmostra(p.x, p.y, p.z));
+    qtDepois[CELULA(p)]++;
+  }
+  for (int i = 0; i < 200; i++) {
+    amostra p = {10.125f + 0.25f * (rand() % 24), 10.125f + 0.25f * (rand() % 24), 10.125f + 0.25f * (rand() % 8)};
+    insereAmostra(depois, inicializaAmostra(p.x, p.y, p.z));
+    qtDepois[CELULA(p)]++;
+  }
+
+  /* As regiões esperadas: as contagens diferem, ou é a célula da amostra movida */
+  long long esperadas = 0, adicionadas = 0, removidas = 0;
+  for (int c = 0; c < lado * lado * lado; c++) {
+    if (qtAntes[c] != qtDepois[c] || c == celulaMovida) esperadas++;
+    if (qtAntes[c] == 0 && qtDepois[c] > 0) adicionadas++;
+    if (qtAntes[c] > 0 && qtDepois[c] == 0) removidas++;
+  }
+
+  diferencaOctree d;
+  ASSERT(diferencaOctrees(antes, depois, 2.0f, &d) == 1);
+  LOG_INFO("%lld regiões alteradas (%lld adicionadas, %lld removidas)", d.qt, d.qtAdicionadas, d.qtRemovidas);
+  ASSERT(d.qt == esperadas && d.qtAdicionadas == adicionadas && d.qtRemovidas == removidas);
+  ASSERT(adicionadas > 0 && removidas > 0 && d.aresta[0] == 2.0f);
+
+  int certas = 0, achouMovida = 0;
+  for (long long i = 0; i < d.qt; i++) {
+    regiaoAlterada* r = &d.regioes[i];
+    amostra meio = {(r->minimo[0] + r->maximo[0]) / 2, (r->minimo[1] + r->maximo[1]) / 2, (r->minimo[2] + r->maximo[2]) / 2};
+    int c = CELULA(meio);
+    certas += (r->maximo[0] - r->minimo[0] == 2.0f && r->qtAntes == qtAntes[c] && r->qtDepois == qtDepois[c] &&
+               (qtAntes[c] != qtDepois[c] || c == celulaMovida));
+    achouMovida |= (c == celulaMovida && r->qtAntes == r->qtDepois);
+  }
+  ASSERT(certas == d.qt && achouMovida);
+  liberaDiferenca(&d);
+  #undef CELULA
+
+  /* As mesmas amostras em outra ordem não mudam nada, em qualquer resolução */
+  ASSERT(diferencaOctrees(antes, mesma, 2.0f, &d) == 1 && d.qt == 0);
+  liberaDiferenca(&d);
+  ASSERT(diferencaOctrees(antes, mesma, 0.01f, &d) == 1 && d.qt == 0);
+  liberaDiferenca(&d);
+
+  /* Resolução maior que o cubo: a raiz inteira é a região */
+  ASSERT(diferencaOctrees(antes, depois, 1000, &d) == 1 && d.qt == 1);
+  ASSERT(d.regioes[0].qtAntes == qt && d.regioes[0].minimo[0] == -32 && d.regioes[0].maximo[2] == 32);
+  liberaDiferenca(&d);
+
+  /* Contra a árvore vazia, tudo foi adicionado */
+  noctree* vazia = inicializaNo(inicializaAmostra(0,0,0), (float[]){64,64,64}, 0);
+  ASSERT(diferencaOctrees(vazia, antes, 2.0f, &d) == 1 && d.qt > 0 && d.qtAdicionadas == d.qt);
+  liberaDiferenca(&d);
+
+  /* Cubos diferentes ou resolução inválida */
+  noctree* outra = inicializaNo(inicializaAmostra(1,0,0), (float[]){64,64,64}, 0);
+  ASSERT(diferencaOctrees(antes, outra, 2.0f, &d) == 0 && d.qt == 0);
+  ASSERT(diferencaOctrees(antes, depois, 0, &d) == 0 && d.qt == 0);
+
+  free(qtAntes);
+  free(qtDepois);
+  free(pontos);
+  destroiNo(outra);
+  destroiNo(vazia);
+  destroiNo(mesma);
+  destroiNo(depois);
+  destroiNo(antes);
+}
+
+/* A folha de um ponto pela descida comum, sem lock (a árvore do teste não muda enquanto isso) */
+static noctree* folhaPorDescida(noctree* no, amostra* p) {
+  while (no->subdividido) {
+    no = no->filhos[(p->x >= no->centro->x) + 2 * (p->y >= no->centro->y) + 4 * (p->z >= no->centro->z)];
+  }
+  return no;
+}
+
+static void juntaFolhas(noctree* no, noctree*** folhas, int* qt, int* capacidade, long long* nos) {
+  (*nos)++;
+  if (no->subdividido) {
+    for (int i = 0; i < QT_FILHOS_NOCTREE; i++) juntaFolhas(no->filhos[i], folhas, qt, capacidade, nos);
+    return;
+  }
+  if (*qt == *capacidade) {
+    *capacidade = *capacidade > 0 ? 2 * *capacidade : 1024;
+    *folhas = (noctree**) realloc(*folhas, sizeof(noctree*) * *capacidade);
+  }
+  (*folhas)[(*qt)++] = no;
+}
+
+/* Os cubos se tocam (face, aresta ou vértice) sem ser o mesmo */
+static int cubosEncostam(noctree* a, noctree* b) {
+  if (a == b) return 0;
+  for (int d = 0; d < DIM; d++) {
+    float ca = (d == 0) ? a->centro->x : (d == 1) ? a->centro->y : a->centro->z;
+    float cb = (d == 0) ? b->centro->x : (d == 1) ? b->centro->y : b->centro->z;
+    if (ca - a->tamanho[d] / 2 > cb + b->tamanho[d] / 2 || cb - b->tamanho[d] / 2 > ca + a->tamanho[d] / 2) return 0;
+  }
+  return 1;
+}
+
+void test_indice_locacional() {
+  printf("Executando Teste 23: Índice Locacional - Folha por Código e Vizinhas por Aritmética...\n");
+
+  /* Amostras concentradas num canto, para a árvore ter folhas de vários tamanhos */
+  noctree* raiz = inicializaNo(inicializaAmostra(0,0,0), (float[]){64,64,64}, 0);
+  srand(23);
+  for (int i = 0; i < 20000; i++) {
+    float e = (i % 2) ? 8 : 60;
+    insereAmostra(raiz, inicializaAmostra(-30 + e * ((float)rand() / (float)RAND_MAX), -30 + e * ((float)rand() / (float)RAND_MAX),
+                                          -30 + e * ((float)rand() / (float)RAND_MAX)));
+  }
+
+  noctree** folhas = NULL;
+  int qtFolhas = 0, capFolhas = 0;
+  long long qtNos = 0;
+  juntaFolhas(raiz, &folhas, &qtFolhas, &capFolhas, &qtNos);
+
+  indiceLocacional* ind = criaIndiceLocacional(raiz);
+  ASSERT(atomic_load(&ind->qt) == qtNos && ind->niveis == NOCTREE_MAX_PROFUNDIDADE + 1);
+  ASSERT(noPorCodigo(ind, 1) == raiz && noPorCodigo(ind, 8 + 5) == raiz->filhos[5]);
+
+  /* A folha de cada ponto é a da descida, inclusive fora do cubo */
+  int certas = 0;
+  uint64_t codigo;
+  for (int i = 0; i < 5000; i++) {
+    amostra p = {-40 + 80 * ((float)rand() / (float)RAND_MAX), -40 + 80 * ((float)rand() / (float)RAND_MAX),
+                 -30 + 10 * ((float)rand() / (float)RAND_MAX)};
+    noctree* folha = folhaDoPonto(ind, &p, &codigo);
+    certas += (folha == folhaPorDescida(raiz, &p) && noPorCodigo(ind, codigo) == folha &&
+               nivelDoCodigo(codigo) == folha->profundidade && codigo == codigoDoPonto(ind, &p, folha->profundidade));
+  }
+  ASSERT(certas == 5000);
+
+  /* As vizinhas de cada folha são as folhas cujo cubo encosta no dela */
+  int vizinhasCertas = 0;
+  for (int i = 0; i < qtFolhas; i += 7) {
+    amostra meio = {folhas[i]->centro->x, folhas[i]->centro->y, folhas[i]->centro->z};
+    folhaDoPonto(ind, &meio, &codigo);
+    noctree** vizinhas;
+    int qt = folhasVizinhas(ind, codigo, &vizinhas);
+
+    int esperadas = 0, achadas = 0;
+    for (int j = 0; j < qtFolhas; j++) esperadas += cubosEncostam(folhas[i], folhas[j]);
+    for (int k = 0; k < qt; k++) achadas += cubosEncostam(folhas[i], vizinhas[k]);
+    vizinhasCertas += (qt == esperadas && achadas == qt);
+    free(vizinhas);
+  }
+  ASSERT(vizinhasCertas == (qtFolhas + 6) / 7);
+
+  /* Vizinho fora do cubo e vizinho maior */
+  amostra canto = {-31.9f, -31.9f, -31.9f};
+  folhaDoPonto(ind, &canto, &codigo);
+  ASSERT(vizinhoLocacional(ind, codigo, -1, 0, 0, NULL) == NULL);
+  amostra longe = {31, 31, 31};
+  noctree* grande = folhaDoPonto(ind, &longe, &codigo);
+  uint64_t codigoVizinho;
+  ASSERT(vizinhoLocacional(ind, codigo, -1, -1, -1, &codigoVizinho) != NULL && nivelDoCodigo(codigoVizinho) <= grande->profundidade);
+
+  /* Inserções depois do índice: as consultas continuam certas, e a atualização traz os nós novos */
+  for (int i = 0; i < 20000; i++) {
+    insereAmostra(raiz, inicializaAmostra(20 + 10 * ((float)rand() / (float)RAND_MAX), 20 + 10 * ((float)rand() / (float)RAND_MAX),
+                                          20 + 10 * ((float)rand() / (float)RAND_MAX)));
+  }
+  certas = 0;
+  for (int i = 0; i < 1000; i++) {
+    amostra p = {20 + 10 * ((float)rand() / (float)RAND_MAX), 20 + 10 * ((float)rand() / (float)RAND_MAX), 25};
+    certas += (folhaDoPonto(ind, &p, NULL) == folhaPorDescida(raiz, &p));
+  }
+  ASSERT(certas == 1000);
+
+  long long nosAntes = qtNos;
+  qtFolhas = 0;
+  qtNos = 0;
+  juntaFolhas(raiz, &folhas, &qtFolhas, &capFolhas, &qtNos);
+  ASSERT(atualizaIndiceLocacional(ind) == qtNos - nosAntes && atomic_load(&ind->qt) == qtNos);
+  ASSERT(atualizaIndiceLocacional(ind) == 0);
+  LOG_INFO("%lld nós indexados numa tabela de %lld entradas", atomic_load(&ind->qt), ind->capacidade);
+
+  free(folhas);
+  destroiIndiceLocacional(ind);
+  destroiNo(raiz);
+}
+
+static int comparaIds(const void* a, const void* b) {
+  long long x = *(const long long*) a, y = *(const long long*) b;
+  return (x > y) - (x < y);
+}
+
+/* Mesmos ids, em qualquer ordem (ordena os dois vetores) */
+static int mesmosIds(long long* a, int qtA, long long* b, int qtB) {
+  if (qtA != qtB) return 0;
+  if (qtA > 0) {
+    qsort(a, qtA, sizeof(long long), comparaIds);
+    qsort(b, qtB, sizeof(long long), comparaIds);
+  }
+  for (int i = 0; i < qtA; i++) {
+    if (a[i] != b[i]) return 0;
+  }
+  return 1;
+}
+
+static int caixasSobrepoem(caixaItem* a, caixaItem* b) {
+  for (int d = 0; d < DIM; d++) {
+    if (a->minimo[d] > b->maximo[d] || b->minimo[d] > a->maximo[d]) return 0;
+  }
+  return 1;
+}
+
+static caixaItem caixaAleatoria(float extensao) {
+  caixaItem c;
+  for (int d = 0; d < DIM; d++) {
+    float centro = -55 + 110 * ((float)rand() / (float)RAND_MAX); // Alguns centros fora do cubo
+    float meia = extensao * ((float)rand() / (float)RAND_MAX);
+    c.minimo[d] = centro - meia;
+    c.maximo[d] = centro + meia;
+  }
+  return c;
+}
+
+void test_octree_solta() {
+  printf("Executando Teste 24: Octree Solta - Sobreposição, Raio de Busca, Raio de Visada e Movimento...\n");
+
+  const int qt = 3000;
+  caixaItem* caixas = (caixaItem*) malloc(sizeof(caixaItem) * qt);
+  noctree* cena = inicializaSolta(inicializaAmostra(0,0,0), (float[]){100,100,100});
+  srand(24);
+  int inseridos = 0;
+  for (int i = 0; i < qt; i++) {
+    caixas[i] = caixaAleatoria((i % 100 == 0) ? 40 : (i % 10 == 0) ? 5 : 0.5f); // Poucas enormes, algumas médias
+    inseridos += insereItemSolto(cena, &caixas[i], i);
+  }
+  ASSERT(inseridos == qt && cena->subdividido && cena->qtPontos < qt / 10); // Quase tudo desceu da raiz
+
+  long long* ids;
+  long long* esperados = (long long*) malloc(sizeof(long long) * qt);
+  int certas = 0;
+  for (int k = 0; k < 200; k++) {
+    /* Sobreposição */
+    caixaItem janela = caixaAleatoria(8);
+    int achados = buscaSobreposicao(cena, &janela, &ids), qtEsperados = 0;
+    for (int i = 0; i < qt; i++) if (caixasSobrepoem(&caixas[i], &janela)) esperados[qtEsperados++] = i;
+    certas += mesmosIds(ids, achados, esperados, qtEsperados);
+    free(ids);
+
+    /* Raio de busca */
+    amostra centro = {janela.minimo[0], janela.minimo[1], janela.minimo[2]};
+    achados = buscaItensPorRegiao(cena, &centro, 6, &ids);
+    qtEsperados = 0;
+    for (int i = 0; i < qt; i++) {
+      float d2 = 0, c[DIM] = {centro.x, centro.y, centro.z};
+      for (int d = 0; d < DIM; d++) {
+        float fora = fmaxf(caixas[i].minimo[d] - c[d], fmaxf(0, c[d] - caixas[i].maximo[d]));
+        d2 += fora * fora;
+      }
+      if (d2 <= 36) esperados[qtEsperados++] = i;
+    }
+    certas += mesmosIds(ids, achados, esperados, qtEsperados);
+    free(ids);
+  }
+  ASSERT(certas == 400);
+
+  /* Raio de visada ao longo de x: os itens cuja caixa cruza a reta, em ordem de entrada */
+  impactoSolto* impactos;
+  amostra origem = {-60, 1.5f, -2.5f}, direcao = {1, 0, 0};
+  int atingidos = lancaRaioSolto(cena, &origem, &direcao, 120, &impactos), qtEsperados = 0;
+  for (int i = 0; i < qt; i++) {
+    if (caixas[i].minimo[1] <= 1.5f && caixas[i].maximo[1] >= 1.5f && caixas[i].minimo[2] <= -2.5f && caixas[i].maximo[2] >= -2.5f &&
+        caixas[i].maximo[0] >= -60 && caixas[i].minimo[0] <= 60) esperados[qtEsperados++] = i;
+  }
+  int ordenados = 1, tCerto = 1;
+  ids = (long long*) malloc(sizeof(long long) * (atingidos + 1));
+  for (int i = 0; i < atingidos; i++) {
+    ids[i] = impactos[i].id;
+    tCerto &= fabsf(impactos[i].t - fmaxf(0, caixas[ids[i]].minimo[0] + 60)) < 1e-4f;
+    if (i > 0) ordenados &= impactos[i - 1].t <= impactos[i].t;
+  }
+  ASSERT(atingidos > 0 && ordenados && tCerto && mesmosIds(ids, atingidos, esperados, qtEsperados));
+  free(ids);
+  free(impactos);
+
+  /* Movimentos: um passo curto fica no mesmo nó; um salto muda de nó; a caixa antiga some das consultas */
+  int movidos = 0;
+  for (int i = 1; i < qt; i += 3) {
+    caixaItem nova = caixas[i];
+    float passo = (i % 2) ? 0.01f : 30;
+    for (int d = 0; d < DIM; d++) { nova.minimo[d] += passo; nova.maximo[d] += passo; }
+    movidos += moveItemSolto(cena, i, &caixas[i], &nova);
+    caixas[i] = nova;
+  }
+  ASSERT(movidos == (qt - 1 + 2) / 3);
+  certas = 0;
+  for (int k = 0; k < 100; k++) {
+    caixaItem janela = caixaAleatoria(10);
+    int achados = buscaSobreposicao(cena, &janela, &ids), qtEsperados = 0;
+    for (int i = 0; i < qt; i++) if (caixasSobrepoem(&caixas[i], &janela)) esperados[qtEsperados++] = i;
+    certas += mesmosIds(ids, achados, esperados, qtEsperados);
+    free(ids);
+  }
+  ASSERT(certas == 100);
+
+  /* Remoção: só com a caixa atual */
+  ASSERT(removeItemSolto(cena, 7, &caixas[7]) == 1 && removeItemSolto(cena, 7, &caixas[7]) == 0);
+  int achados = buscaSobreposicao(cena, &caixas[7], &ids), achouRemovido = 0;
+  for (int i = 0; i < achados; i++) achouRemovido |= (ids[i] == 7);
+  ASSERT(!achouRemovido);
+  free(ids);
+
+  /* Com só o nó de destino congelado, o movimento é recusado e o item fica na caixa antiga */
+  caixaItem perto = {{-20, -20, -20}, {-19, -19, -19}}, longe = {{20, 20, 20}, {21, 21, 21}};
+  ASSERT(insereItemSolto(cena, &perto, -1) == 1 && insereItemSolto(cena, &longe, -2) == 1);
+  congela(cena->filhos[QT_FILHOS_NOCTREE - 1]);
+  ASSERT(moveItemSolto(cena, -1, &perto, &longe) == 0);
+  achados = buscaSobreposicao(cena, &perto, &ids);
+  int continua = 0;
+  for (int i = 0; i < achados; i++) continua |= (ids[i] == -1);
+  ASSERT(continua);
+  free(ids);
+
+  /* Amostras não entram na árvore solta, e a congelada recusa itens */
+  amostra* recusada = inicializaAmostra(1, 1, 1);
+  ASSERT(insereAmostra(cena, recusada) == 0);
+  free(recusada);
+  congela(cena);
+  ASSERT(insereItemSolto(cena, &caixas[0], 0) == 0 && moveItemSolto(cena, 1, &caixas[1], &caixas[2]) == 0);
+  ASSERT(buscaSobreposicao(cena, &caixas[0], &ids) > 0);
+  free(ids);
+
+  free(esperados);
+  free(caixas);
+  destroiNo(cena); // Libera os itens junto
+}
+
+static int comparaIndices(const void* a, const void* b) {
+  uint32_t x = *(const uint32_t*) a, y = *(const uint32_t*) b;
+  return (x > y) - (x < y);
+}
+
+void test_modo_indice() {
+  printf("Executando Teste 25: Modo Índice - Posições num Vetor de Quem Chama...\n");
+
+  /* O "buffer do quadro": as amostras ficam aqui, a árvore só guarda posições */
+  const int qt = 20000;
+  amostra* quadro = (amostra*) malloc(sizeof(amostra) * qt);
+  srand(25);
+  for (int i = 0; i < qt; i++) {
+    quadro[i] = (amostra){-45 + 90 * ((float)rand() / (float)RAND_MAX), -45 + 90 * ((float)rand() / (float)RAND_MAX),
+                          -45 + 90 * ((float)rand() / (float)RAND_MAX)};
+  }
+
+  noctree* raiz = inicializaNo(inicializaAmostra(0,0,0), (float[]){100,100,100}, 0);
+  ASSERT(usaIndices(raiz, quadro, qt) == 1 && raiz->modo == NOCTREE_MODO_INDICE);
+  int inseridas = 0;
+  for (int i = 0; i < qt / 2; i++) inseridas += insereIndice(raiz, i);
+
+  /* A outra metade por um escritor privado, com ponteiros para dentro do quadro */
+  escritorPrivado* e = inicializaEscritorPrivado(raiz, 1000);
+  for (int i = qt / 2; i < qt; i++) inseridas += insereAmostraEscritor(e, &quadro[i]);
+  destroiEscritorPrivado(e);
+  ASSERT(inseridas == qt && raiz->subdividido);
+
+  /* Busca por região: as posições da força bruta; a busca comum aponta para dentro do quadro */
+  int certas = 0;
+  uint32_t* esperadas = (uint32_t*) malloc(sizeof(uint32_t) * qt);
+  for (int k = 0; k < 50; k++) {
+    amostra centro = quadro[rand() % qt];
+    int achadas, qtEsperadas = 0;
+    uint32_t* indices = buscaIndicesPorRegiao(raiz, &centro, 6, &achadas);
+    for (int i = 0; i < qt; i++) if (dist2(&quadro[i], &centro) <= 36) esperadas[qtEsperadas++] = i;
+
+    int iguais = (achadas == qtEsperadas);
+    if (iguais && achadas > 0) qsort(indices, achadas, sizeof(uint32_t), comparaIndices);
+    for (int i = 0; iguais && i < achadas; i++) iguais = (indices[i] == esperadas[i]);
+
+    int qtComum;
+    amostra** comum = buscaPorRegiao(raiz, &centro, 6, &qtComum);
+    for (int i = 0; i < qtComum; i++) iguais &= (comum[i] >= quadro && comum[i] < quadro + qt);
+    certas += iguais && qtComum == achadas;
+    free(indices);
+    free(comum);
+  }
+  ASSERT(certas == 50);
+
+  /* Busca na folha: as amostras da folha são as do quadro nessas posições */
+  int qtFolha, qtIndices;
+  amostra** folha = buscaNaFolha(raiz, &quadro[7], &qtFolha);
+  uint32_t* indicesFolha = buscaIndicesNaFolha(raiz, &quadro[7], &qtIndices);
+  int achouSetima = 0, mesmas = (qtFolha == qtIndices);
+  for (int i = 0; mesmas && i < qtIndices; i++) {
+    mesmas = (folha[i] == &quadro[indicesFolha[i]]);
+    achouSetima |= (indicesFolha[i] == 7);
+  }
+  ASSERT(mesmas && achouSetima);
+  free(folha);
+  free(indicesFolha);
+
+  /* Os módulos que leem com  leAmostra  funcionam sem mudança */
+  fotografiaOctree f;
+  fotografaOctree(raiz, &f);
+  ASSERT(f.qt == qt);
+  liberaFotografia(&f);
+
+  /* Combinações recusadas */
+  noctree* comum = inicializaNo(inicializaAmostra(0,0,0), (float[]){100,100,100}, 0);
+  ASSERT(usaIndices(raiz, quadro, qt) == 0 && insereIndice(comum, 0) == 0 && compactaOctree(raiz) == 0);
+
+  /* Só entram as amostras do vetor: posição além do fim, ponteiro de fora ou no meio de uma amostra */
+  amostra fora = quadro[0];
+  escritorPrivado* e2 = inicializaEscritorPrivado(raiz, 10);
+  ASSERT(insereIndice(raiz, qt) == 0 && insereIndice(raiz, UINT32_MAX) == 0);
+  ASSERT(insereAmostra(raiz, &fora) == 0 && insereAmostra(raiz, (amostra*) &quadro[3].y) == 0);
+  ASSERT(insereAmostraEscritor(e2, &fora) == 0);
+  destroiEscritorPrivado(e2);
+  fotografaOctree(raiz, &f);
+  ASSERT(f.qt == qt);
+  liberaFotografia(&f);
+
+  /* Mescla só sobre o mesmo vetor, com o mesmo tamanho */
+  noctree* metade = inicializaNo(inicializaAmostra(0,0,0), (float[]){100,100,100}, 0);
+  usaIndices(metade, quadro, qt / 2);
+  ASSERT(insereIndice(metade, qt / 2) == 0 && mesclaOctrees(raiz, metade, NULL) == NOCTREE_MESCLA_RECUSADA);
+  destroiNo(metade);
+  ASSERT(mesclaOctrees(raiz, comum, NULL) == NOCTREE_MESCLA_RECUSADA && buscaIndicesNaFolha(comum, &quadro[0], &qtIndices) == NULL);
+  destroiNo(comum);
+
+  /* Destruir a árvore não toca no quadro */
+  destroiNo(raiz);
+  ASSERT(quadro[qt - 1].x >= -45 && quadro[qt - 1].x <= 45);
+  free(esperadas);
+  free(quadro);
+}
+
 
 // =========== FUNÇÃO PRINCIPAL ===========
 
@@ -254,6 +1927,26 @@ int main() {
   test_safeness_escritores_concorrentes();
   test_safeness_leitor_e_escritor();
   test_subdivisao_concorrente_manual();
+  test_ingestao_reproducao_arquivo();
+  test_modo_quantizado();
+  test_estatisticas_runtime();
+  test_relatorio_forma();
+  test_octree_fragmentada();
+  test_pool_tarefas();
+  test_busca_paralela();
+  test_mescla_escritor_privado();
+  test_quadros_buffer_triplo();
+  test_congela();
+  test_downsample_voxel();
+  test_filtros_outliers();
+  test_normais_curvatura();
+  test_agrupamento_euclidiano();
+  test_percurso_duplo();
+  test_mapa_ocupacao();
+  test_diferenca_octrees();
+  test_indice_locacional();
+  test_octree_solta();
+  test_modo_indice();
 
   /* Interface com o usuário */
   print_sumario_testes();
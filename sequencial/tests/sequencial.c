@@ -10,8 +10,9 @@
 #include <stdlib.h>
 #include <stdbool.h>
 
-#include "../src/noctree.h"
-/*#include "../src/system.h" // Para NOCTREE_CAPACIDADE*/
+#include "noctree.h"
+#include "ocupacao.h"
+#include "tarefas.h"
 
 /* Ambiente de Testes */
 int total_testes = 0;
@@ -58,7 +59,7 @@ void test_inicializacao() {
   printf("Executando Teste 1: Inicialização do Nó... \n");
   float tamanho[] = {100.0f, 100.0f, 100.0f};
   amostra *amostraZero = inicializaAmostra(0,0,0);
-  noctree* no = inicializaNo(amostraZero, tamanho);
+  noctree* no = inicializaNo(amostraZero, tamanho, 0);
 
   ASSERT(no != NULL);
   ASSERT(no->qtPontos == 0);
@@ -73,7 +74,7 @@ void test_inicializacao() {
 void test_insercao_simples() {
   printf("Executando Teste 2: Inserção Simples (sem subdivisão)...\n");
   float tamanho[] = {100.0f, 100.0f, 100.0f};
-  noctree* no = inicializaNo(inicializaAmostra(0, 0, 0), tamanho);
+  noctree* no = inicializaNo(inicializaAmostra(0, 0, 0), tamanho, 0);
 
   amostra* p1 = inicializaAmostra(10, 10, 10);
   amostra* p2 = inicializaAmostra(-10, -10, -10);
@@ -92,7 +93,7 @@ void test_insercao_simples() {
 void test_subdivisao_e_redistribuicao() {
   printf("Executando Teste 3: Subdivisão e Redistribuição Simples de Pontos...\n");
   float tamanho[] = {100.0f, 100.0f, 100.0f};
-  noctree* no = inicializaNo(inicializaAmostra(0, 0, 0), tamanho);
+  noctree* no = inicializaNo(inicializaAmostra(0, 0, 0), tamanho, 0);
   amostra* pontos[NOCTREE_CAPACIDADE + 1];
 
   // Cria NOCTREE_CAPACIDADE + 1 pontos
@@ -123,7 +124,7 @@ void test_subdivisao_e_redistribuicao() {
 void test_subdivisao_recursiva() {
   printf("Executando Teste 4: Subdivisão Recursiva...\n");
   float tamanho[] = {100.0f, 100.0f, 100.0f};
-  noctree* raiz = inicializaNo(inicializaAmostra(0, 0, 0), tamanho);
+  noctree* raiz = inicializaNo(inicializaAmostra(0, 0, 0), tamanho, 0);
 
   // --- Parte 1: Inserção Manual dos Pontos ---
 
@@ -226,6 +227,71 @@ void test_subdivisao_recursiva() {
   destroiNo(raiz);
 }
 
+void test_consultas_sem_lock() {
+  printf("Executando Teste 5: Consultas na Versão Sem Lock...\n");
+  float tamanho[] = {100.0f, 100.0f, 100.0f};
+  noctree* raiz = inicializaNo(inicializaAmostra(0, 0, 0), tamanho, 0);
+
+  /* O nó não carrega lock nenhum */
+  ASSERT(NOCTREE_BYTES_LOCK == 0);
+
+  /* Uma grade de 10x10x10 pontos, um a cada 10 unidades */
+  for (int i = 0; i < 10; i++) {
+    for (int j = 0; j < 10; j++) {
+      for (int k = 0; k < 10; k++) {
+        insereAmostra(raiz, inicializaAmostra(-45 + 10 * i, -45 + 10 * j, -45 + 10 * k));
+      }
+    }
+  }
+  ASSERT(raiz->subdividido == true);
+
+  /* Raio 11 em volta de um ponto da grade: ele e os 6 vizinhos dos eixos */
+  int qt = 0;
+  amostra centro = {5, 5, 5};
+  amostra** res = buscaPorRegiao(raiz, &centro, 11, &qt);
+  ASSERT(qt == 7);
+  free(res);
+
+  /* A folha do alvo contém o próprio ponto */
+  bool achou = false;
+  res = buscaNaFolha(raiz, &centro, &qt);
+  for (int i = 0; i < qt; i++) {
+    if (res[i]->x == 5 && res[i]->y == 5 && res[i]->z == 5) achou = true;
+  }
+  ASSERT(achou);
+  free(res);
+
+  destroiNo(raiz);
+}
+
+
+void test_ocupacao_sem_lock() {
+  printf("Executando Teste 6: Mapa de Ocupação na Versão Sem Lock...\n");
+  configuraPoolPadrao(4, 0); // Os raios continuam em tarefas; as atualizações, não
+  noctree* mapa = inicializaOcupacao(inicializaAmostra(0, 0, 0), (float[]){64, 64, 64});
+  amostra sensor = {0.01f, 0.01f, 0.01f};
+
+  /* Uma varredura de 3000 raios até uma parede em x = 20 */
+  const int qt = 3000;
+  amostra* parede = (amostra*) malloc(sizeof(amostra) * qt);
+  srand(46);
+  for (int i = 0; i < qt; i++) {
+    parede[i] = (amostra){20, -15 + 30 * ((float)rand() / (float)RAND_MAX), -15 + 30 * ((float)rand() / (float)RAND_MAX)};
+  }
+  ASSERT(integraVarredura(mapa, &sensor, parede, qt, 0) > qt);
+
+  /* Todos os retornos ficam ocupados e o caminho, livre */
+  int ocupados = 0;
+  for (int i = 0; i < qt; i++) ocupados += (consultaOcupacao(mapa, &parede[i], NULL) == OCUPACAO_OCUPADO);
+  ASSERT(ocupados == qt);
+  amostra meio = {parede[0].x / 2, parede[0].y / 2, parede[0].z / 2};
+  ASSERT(consultaOcupacao(mapa, &meio, NULL) == OCUPACAO_LIVRE);
+  ASSERT(consultaOcupacao(mapa, &(amostra){-10, 0, 0}, NULL) == OCUPACAO_DESCONHECIDO); // Atrás do sensor
+
+  free(parede);
+  destroiNo(mapa);
+}
+
 
 // --- Função Principal ---
 
@@ -239,6 +305,8 @@ int main(void) {
   test_insercao_simples();
   test_subdivisao_e_redistribuicao();
   test_subdivisao_recursiva();
+  test_consultas_sem_lock();
+  test_ocupacao_sem_lock();
 
   /* Interface */
   print_sumario_testes();